@@ -24,6 +24,7 @@
 #include <math.h>
 
 #if defined(__linux__) || defined(__LINUX__)
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <boost/thread.hpp>
@@ -54,6 +55,8 @@ using namespace nlohmann;
 #include "libslic3r/Platform.hpp"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/SLAPrint.hpp"
+#include "libslic3r/SlicingCache.hpp"
+#include "libslic3r/SettingsFilesCache.hpp"
 #include "libslic3r/TriangleMesh.hpp"
 #include "libslic3r/Format/AMF.hpp"
 #include "libslic3r/Format/3mf.hpp"
@@ -63,6 +66,7 @@ using namespace nlohmann;
 #include "libslic3r/Utils.hpp"
 #include "libslic3r/Time.hpp"
 #include "libslic3r/Thread.hpp"
+#include "libslic3r/Trace.hpp"
 #include "libslic3r/BlacklistedLibraryCheck.hpp"
 #include "libslic3r/FlushVolCalc.hpp"
 
@@ -165,6 +169,8 @@ typedef struct _sliced_info {
     std::vector<std::string> downward_machines;
 }sliced_info_t;
 std::vector<PrintBase::SlicingStatus> g_slicing_warnings;
+// Warnings are reported by the objects being processed in parallel.
+std::mutex g_slicing_warnings_mutex;
 
 #if defined(__linux__) || defined(__LINUX__)
 #define PIPE_BUFFER_SIZE 512
@@ -352,6 +358,7 @@ cli_callback_mgr_t g_cli_callback_mgr;
 void cli_status_callback(const PrintBase::SlicingStatus& slicing_status)
 {
     if (slicing_status.warning_step != -1) {
+        std::lock_guard<std::mutex> lock(g_slicing_warnings_mutex);
         g_slicing_warnings.push_back(slicing_status);
         BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << boost::format(": percent=%1%, warning_step=%2%, message=%3%, message_type=%4%, flag=%5%")
             %slicing_status.percent %slicing_status.warning_step %slicing_status.text %(int)(slicing_status.message_type) %slicing_status.flags;
@@ -364,6 +371,7 @@ void cli_status_callback(const PrintBase::SlicingStatus& slicing_status)
 void default_status_callback(const PrintBase::SlicingStatus& slicing_status)
 {
     if (slicing_status.warning_step != -1) {
+        std::lock_guard<std::mutex> lock(g_slicing_warnings_mutex);
         g_slicing_warnings.push_back(slicing_status);
     }
     BOOST_LOG_TRIVIAL(debug) << __FUNCTION__ << boost::format(": percent=%1%, warning_step=%2%, message=%3%, message_type=%4%")%slicing_status.percent %slicing_status.warning_step %slicing_status.text %(int)(slicing_status.message_type);
@@ -1078,6 +1086,9 @@ int CLI::run(int argc, char **argv)
     std::string temp_path = wxFileName::GetTempDir().utf8_str().data();
     set_temporary_dir(temp_path);
 
+    if (const std::string &batch_file = m_config.opt_string("batch", true); !batch_file.empty())
+        return this->run_batch(batch_file, argv[0]);
+
     m_extra_config.apply(m_config, true);
     m_extra_config.normalize_fdm();
 
@@ -1186,6 +1197,22 @@ int CLI::run(int argc, char **argv)
     global_begin_time = (long long)Slic3r::Utils::get_current_time_utc();
     BOOST_LOG_TRIVIAL(warning) << boost::format("cli mode, Current OrcaSlicer Version %1%")%SoftFever_VERSION;
 
+    if (const std::string &slicing_cache_dir = m_config.opt_string("slicing_cache_dir", true); ! slicing_cache_dir.empty())
+        SlicingCache::set_directory(slicing_cache_dir, size_t(std::max(0, m_config.option<ConfigOptionInt>("slicing_cache_size", true)->value)) << 20);
+
+    // Export the trace however the job ends.
+    ScopeGuard trace_export;
+    if (const std::string &trace_file = m_config.opt_string("trace_file", true); ! trace_file.empty()) {
+        Trace::enable();
+        trace_export = ScopeGuard([trace_file]() {
+            Trace::disable();
+            Trace::export_chrome_trace(trace_file);
+            Trace::export_summary(boost::filesystem::path(trace_file).replace_extension(".summary.json").string());
+            for (const Trace::ZoneSummary &zone : Trace::summary())
+                BOOST_LOG_TRIVIAL(info) << boost::format("trace: %1%, count %2%, total %3$.1f ms, max %4$.1f ms") % zone.name % zone.count % zone.total_ms % zone.max_ms;
+        });
+    }
+
     //BBS: add plate data related logic
     PlateDataPtrs plate_data_src;
     std::vector<plate_obj_size_info_t> plate_obj_size_infos;
@@ -1678,7 +1705,8 @@ int CLI::run(int argc, char **argv)
             std::map<std::string, std::string> key_values;
             std::string reason;
 
-            config_substitutions = config.load_from_json(file, config_substitution_rule, key_values, reason);
+            //Orca: in batch mode, the settings files are parsed once and reused by the following jobs as long as they are not modified.
+            config_substitutions = SettingsFilesCache::load(file, config_substitution_rule, config, key_values, reason);
             if (!reason.empty()) {
                 BOOST_LOG_TRIVIAL(error) <<__FUNCTION__<<  ":Can not load config from file "<<file<<"\n";
                 return CLI_CONFIG_FILE_ERROR;
@@ -5941,6 +5969,137 @@ int CLI::run(int argc, char **argv)
     return 0;
 }
 
+// Split a line of a batch jobs file into arguments, double quotes group arguments containing spaces.
+static std::vector<std::string> split_job_arguments(const std::string &line)
+{
+    std::vector<std::string> args;
+    std::string arg;
+    bool quoted = false, has_arg = false;
+    for (char c : line) {
+        if (c == '"') {
+            quoted = !quoted;
+            has_arg = true;
+        }
+        else if (!quoted && (c == ' ' || c == '\t' || c == '\r')) {
+            if (has_arg) {
+                args.emplace_back(std::move(arg));
+                arg.clear();
+                has_arg = false;
+            }
+        }
+        else {
+            arg += c;
+            has_arg = true;
+        }
+    }
+    if (has_arg)
+        args.emplace_back(std::move(arg));
+    return args;
+}
+
+int CLI::run_batch(const std::string &jobs_file, const char *program_name)
+{
+    if (SettingsFilesCache::enabled()) {
+        boost::nowide::cerr << "batch can not be used inside a batch job" << std::endl;
+        return CLI_INVALID_PARAMS;
+    }
+    const ConfigOptionInt *opt_loglevel = m_config.opt<ConfigOptionInt>("debug");
+    set_logging_level(opt_loglevel ? opt_loglevel->value : 2);
+
+    boost::nowide::ifstream ifs;
+    std::istream *is = &boost::nowide::cin;
+    if (jobs_file != "-") {
+        ifs.open(jobs_file);
+        if (!ifs) {
+            boost::nowide::cerr << "can not open batch file " << jobs_file << std::endl;
+            return CLI_FILE_NOTFOUND;
+        }
+        is = &ifs;
+    }
+
+    std::string outfile_dir = m_config.opt_string("outputdir", true);
+    boost::filesystem::path batch_dir = outfile_dir.empty() ? boost::filesystem::current_path() : boost::filesystem::path(outfile_dir);
+    std::string result_file = (batch_dir / "batch_result.json").string();
+    BOOST_LOG_TRIVIAL(warning) << boost::format("batch mode, Current OrcaSlicer Version %1%, jobs from %2%")%SoftFever_VERSION %jobs_file;
+
+    // Keep the parsed settings files for the following jobs. Config definitions, the TBB worker threads
+    // and the slicing cache stay initialized for the whole batch as well.
+    SettingsFilesCache::set_enabled(true);
+
+    json j_jobs = json::array();
+    int  job_index = 0, batch_ret = CLI_SUCCESS;
+    auto batch_begin = std::chrono::steady_clock::now();
+    std::string line;
+    while (std::getline(*is, line)) {
+        std::vector<std::string> args = split_job_arguments(line);
+        if (args.empty() || boost::starts_with(args.front(), "#"))
+            continue;
+        ++ job_index;
+
+        // Each job exports into its own directory, so that its output files and result.json are not overwritten by other jobs.
+        std::string job_dir;
+        for (size_t i = 0; i < args.size(); ++ i) {
+            if (args[i] == "--outputdir" && i + 1 < args.size())
+                job_dir = args[i + 1];
+            else if (boost::starts_with(args[i], "--outputdir="))
+                job_dir = args[i].substr(strlen("--outputdir="));
+        }
+        if (job_dir.empty()) {
+            job_dir = (batch_dir / ("job_" + std::to_string(job_index))).string();
+            args.emplace_back("--outputdir");
+            args.emplace_back(job_dir);
+        }
+        boost::system::error_code ec;
+        boost::filesystem::create_directories(job_dir, ec);
+
+        std::vector<char*> job_argv;
+        job_argv.emplace_back(const_cast<char*>(program_name));
+        for (std::string &arg : args)
+            job_argv.emplace_back(arg.data());
+        job_argv.emplace_back(nullptr);
+
+        BOOST_LOG_TRIVIAL(warning) << boost::format("batch job %1% started: %2%")%job_index %line;
+        auto job_begin = std::chrono::steady_clock::now();
+        int  ret;
+        try {
+            ret = CLI().run(int(job_argv.size()) - 1, job_argv.data());
+        }
+        catch (const std::exception &ex) {
+            boost::nowide::cerr << "batch job " << job_index << " failed: " << ex.what() << std::endl;
+            ret = CLI_SLICING_ERROR;
+        }
+        long long job_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - job_begin).count();
+        g_slicing_warnings.clear();
+        if (ret != CLI_SUCCESS && batch_ret == CLI_SUCCESS)
+            batch_ret = ret;
+
+        boost::nowide::cout << boost::format("batch job %1% finished, return %2%, %3% ms, output %4%")%job_index %ret %job_time %job_dir << std::endl;
+        json j_job;
+        j_job["index"]        = job_index;
+        j_job["command"]      = line;
+        j_job["outputdir"]    = job_dir;
+        j_job["return_code"]  = ret;
+        j_job["error_string"] = cli_errors.count(ret) ? cli_errors[ret] : std::string();
+        j_job["time_ms"]      = job_time;
+        j_jobs.push_back(j_job);
+
+        // Rewritten after every job, so that the progress of a batch fed through stdin may be observed.
+        json j;
+        j["jobs"]         = j_jobs;
+        j["job_count"]    = job_index;
+        j["return_code"]  = batch_ret;
+        j["total_time_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - batch_begin).count();
+        boost::nowide::ofstream c(result_file, std::ios::out | std::ios::trunc);
+        c << std::setw(4) << j << std::endl;
+    }
+
+    SettingsFilesCache::set_enabled(false);
+    BOOST_LOG_TRIVIAL(warning) << boost::format("batch finished, %1% jobs, return %2%")%job_index %batch_ret;
+    boost::nowide::cout.flush();
+    boost::nowide::cerr.flush();
+    return batch_ret;
+}
+
 bool CLI::setup(int argc, char **argv)
 {
     // Detect the operating system flavor after SLIC3R_LOGLEVEL is set.
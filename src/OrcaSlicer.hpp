@@ -112,6 +112,9 @@ private:
 
     bool setup(int argc, char **argv);
 
+    /// Runs the jobs listed in jobs_file (or on stdin for "-") in this process, each job by a separate CLI instance.
+    int run_batch(const std::string &jobs_file, const char *program_name);
+
     /// Prints usage of the CLI.
     void print_help(bool include_print_options = false, PrinterTechnology printer_technology = ptAny) const;
 
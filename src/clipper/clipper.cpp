@@ -788,7 +788,7 @@ bool ClipperBase::AddPath(const Path &pg, PolyType PolyTyp, bool Closed)
     return false;
 
   // Allocate a new edge array.
-  std::vector<TEdge> edges(highI + 1);
+  std::vector<TEdge> edges = AllocateEdges(highI + 1);
   // Fill in the edge array.
   bool result = AddPathInternal(pg, highI, PolyTyp, Closed, edges.data());
   if (result)
@@ -975,11 +975,45 @@ bool ClipperBase::AddPathInternal(const Path &pg, int highI, PolyType PolyTyp, b
 }
 //------------------------------------------------------------------------------
 
+// Upper limit of the number of edges retained by ClipperBase::Clear() for reuse.
+static constexpr const size_t EdgesFreeCapacityMax = 65536;
+// Upper limit of the number of output point chunks and output records retained for reuse after Clipper::Execute().
+static constexpr const size_t OutPtsChunksFreeMax  = 1024;
+static constexpr const size_t PolyOutsFreeMax      = 1024;
+// Upper limit of the capacity of the work vectors retained by Clear() for reuse. Larger vectors grown by an operation on a huge input are released.
+static constexpr const size_t WorkVectorCapacityMax = 65536;
+
+template<typename T>
+static inline void ReleaseIfLarge(std::vector<T> &v)
+{
+  if (v.capacity() > WorkVectorCapacityMax)
+    std::vector<T>().swap(v);
+}
+
+std::vector<TEdge> ClipperBase::AllocateEdges(size_t num_edges)
+{
+  std::vector<TEdge> edges;
+  if (! m_edgesFree.empty()) {
+    edges = std::move(m_edgesFree.back());
+    m_edgesFree.pop_back();
+    m_edgesFreeCapacity -= edges.capacity();
+  }
+  edges.assign(num_edges, TEdge());
+  return edges;
+}
+
 void ClipperBase::Clear()
 {
   CLIPPERLIB_PROFILE_FUNC();
   m_MinimaList.clear();
+  for (std::vector<TEdge> &edges : m_edges)
+    if (m_edgesFreeCapacity + edges.capacity() <= EdgesFreeCapacityMax) {
+      m_edgesFreeCapacity += edges.capacity();
+      m_edgesFree.emplace_back(std::move(edges));
+    }
   m_edges.clear();
+  ReleaseIfLarge(m_MinimaList);
+  ReleaseIfLarge(m_NumEdges);
 #ifndef CLIPPERLIB_INT32
   m_UseFullRange = false;
 #endif // CLIPPERLIB_INT32
@@ -1063,6 +1097,7 @@ IntRect ClipperBase::GetBounds()
 
 Clipper::Clipper(int initOptions) : 
   ClipperBase(),
+  m_OutPtsChunksUsed(0),
   m_OutPtsFree(nullptr),
   m_OutPtsChunkSize(32),
   m_OutPtsChunkLast(32),
@@ -1079,11 +1114,34 @@ Clipper::Clipper(int initOptions) :
 }
 //------------------------------------------------------------------------------
 
+void Clipper::Clear()
+{
+  ClipperBase::Clear();
+  DisposeAllOutRecs();
+  ReleaseIfLarge(m_Joins);
+  ReleaseIfLarge(m_GhostJoins);
+  ReleaseIfLarge(m_IntersectList);
+  ReleaseIfLarge(m_Maxima);
+  if (m_Scanbeam.capacity() > WorkVectorCapacityMax)
+    m_Scanbeam.release();
+}
+//------------------------------------------------------------------------------
+
+Clipper::~Clipper()
+{
+  Clear();
+  for (OutPt *pts : m_OutPts)
+    delete[] pts;
+  for (OutRec *rec : m_PolyOutsFree)
+    delete rec;
+}
+//------------------------------------------------------------------------------
+
 void Clipper::Reset()
 {
   CLIPPERLIB_PROFILE_FUNC();
   ClipperBase::Reset();
-  m_Scanbeam = std::priority_queue<cInt>();
+  m_Scanbeam.clear();
   m_Maxima.clear();
   m_ActiveEdges = 0;
   m_SortedEdges = 0;
@@ -1204,24 +1262,31 @@ OutPt* Clipper::AllocateOutPt()
     pt = m_OutPtsFree;
     m_OutPtsFree = pt->Next;
   } else if (m_OutPtsChunkLast < m_OutPtsChunkSize) {
-    // Get a point from the last chunk.
-    pt = m_OutPts.back() + (m_OutPtsChunkLast ++);
+    // Get a point from the last chunk in use.
+    pt = m_OutPts[m_OutPtsChunksUsed - 1] + (m_OutPtsChunkLast ++);
   } else {
-    // The last chunk is full. Allocate a new one.
-    m_OutPts.push_back(new OutPt[m_OutPtsChunkSize]);
+    // The last chunk in use is full. Take the next chunk retained from a previous Execute() or allocate a new one.
+    if (m_OutPtsChunksUsed == m_OutPts.size())
+      m_OutPts.push_back(new OutPt[m_OutPtsChunkSize]);
+    pt = m_OutPts[m_OutPtsChunksUsed ++];
     m_OutPtsChunkLast = 1;
-    pt = m_OutPts.back();
   }
   return pt;
 }
 
 void Clipper::DisposeAllOutRecs()
 {
-  for (OutPt *pts : m_OutPts)
-    delete[] pts;
+  // Keep a limited number of output point chunks and output records for the next Execute().
+  for (size_t i = OutPtsChunksFreeMax; i < m_OutPts.size(); ++ i)
+    delete[] m_OutPts[i];
+  if (m_OutPts.size() > OutPtsChunksFreeMax)
+    m_OutPts.resize(OutPtsChunksFreeMax);
   for (OutRec *rec : m_PolyOuts)
-    delete rec;
-  m_OutPts.clear();
+    if (m_PolyOutsFree.size() < PolyOutsFreeMax)
+      m_PolyOutsFree.emplace_back(rec);
+    else
+      delete rec;
+  m_OutPtsChunksUsed = 0;
   m_OutPtsFree = nullptr;
   m_OutPtsChunkLast = m_OutPtsChunkSize;
   m_PolyOuts.clear();
@@ -2004,7 +2069,13 @@ void Clipper::AppendPolygon(TEdge *e1, TEdge *e2) const
 
 OutRec* Clipper::CreateOutRec()
 {
-  OutRec* result = new OutRec;
+  OutRec* result;
+  if (m_PolyOutsFree.empty())
+    result = new OutRec;
+  else {
+    result = m_PolyOutsFree.back();
+    m_PolyOutsFree.pop_back();
+  }
   result->IsHole = false;
   result->IsOpen = false;
   result->FirstLeft = 0;
@@ -3362,6 +3433,12 @@ void ClipperOffset::Clear()
     delete m_polyNodes.Childs[i];
   m_polyNodes.Childs.clear();
   m_lowest.x() = -1;
+  // Release the input edges of the last Execute() held by the cleaning Clipper, and the work vectors grown large.
+  m_clipper.Clear();
+  ReleaseIfLarge(m_destPolys);
+  ReleaseIfLarge(m_srcPoly);
+  ReleaseIfLarge(m_destPoly);
+  ReleaseIfLarge(m_normals);
 }
 //------------------------------------------------------------------------------
 
@@ -3462,7 +3539,9 @@ void ClipperOffset::Execute(Paths& solution, double delta)
   DoOffset(delta);
   
   //now clean up 'corners' ...
-  Clipper clpr;
+  Clipper &clpr = m_clipper;
+  clpr.Clear();
+  clpr.ReverseSolution(false);
   clpr.AddPaths(m_destPolys, ptSubject, true);
   if (delta > 0)
   {
@@ -3493,7 +3572,9 @@ void ClipperOffset::Execute(PolyTree& solution, double delta)
   DoOffset(delta);
 
   //now clean up 'corners' ...
-  Clipper clpr;
+  Clipper &clpr = m_clipper;
+  clpr.Clear();
+  clpr.ReverseSolution(false);
   clpr.AddPaths(m_destPolys, ptSubject, true);
   if (delta > 0)
   {
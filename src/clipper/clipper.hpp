@@ -52,6 +52,7 @@
 
 #include <vector>
 #include <deque>
+#include <cassert>
 #include <stdexcept>
 #include <cstring>
 #include <cstdlib>
@@ -181,6 +182,17 @@ public:
     void Clear() {  AllNodes.clear(); Childs.clear(); }
     int Total() const;
     void RemoveOutermostPolygon();
+    // Building the tree outside of Clipper, for example from the output of another clipping library.
+    // The nodes are referenced by pointers, therefore the total number of nodes has to be reserved first.
+    void Reserve(size_t num_nodes) { assert(AllNodes.empty()); AllNodes.reserve(num_nodes); }
+    PolyNode& AddNode(PolyNode &parent, Path &&contour) {
+        assert(AllNodes.size() < AllNodes.capacity());
+        AllNodes.emplace_back();
+        PolyNode &node = AllNodes.back();
+        node.Contour = std::move(contour);
+        parent.AddChild(node);
+        return node;
+    }
 private:
     PolyTree(const PolyTree &src) = delete;
     PolyTree& operator=(const PolyTree &src) = delete;
@@ -310,7 +322,8 @@ public:
     if (num_paths == 1)
         return AddPath(*paths_provider.begin(), PolyTyp, Closed);
 
-    std::vector<int> num_edges(num_paths, 0);
+    std::vector<int> &num_edges = m_NumEdges;
+    num_edges.assign(num_paths, 0);
     int num_edges_total = 0;
     size_t i = 0;
     for (const Path &pg : paths_provider) {
@@ -331,7 +344,7 @@ public:
       return false;
 
     // Allocate a new edge array.
-    std::vector<TEdge> edges(num_edges_total);
+    std::vector<TEdge> edges = AllocateEdges(num_edges_total);
     // Fill in the edge array.
     bool result = false;
     TEdge *p_edge = edges.data();
@@ -352,6 +365,8 @@ public:
     return result;
   }
 
+  // Clear the input paths. The edge arrays are kept for reuse by the next AddPath() / AddPaths() calls,
+  // thus a Clipper object executing many operations does not allocate its edges for every operation.
   void Clear();
   IntRect GetBounds();
   // By default, when three or more vertices are collinear in input polygons (subject or clip), the Clipper object removes the 'inner' vertices before clipping.
@@ -360,6 +375,8 @@ public:
   void PreserveCollinear(bool value) {m_PreserveCollinear = value;};
 protected:
   bool AddPathInternal(const Path &pg, int highI, PolyType PolyTyp, bool Closed, TEdge* edges);
+  // Returns a zeroed edge array, recycling an edge array released by Clear() if available.
+  std::vector<TEdge> AllocateEdges(size_t num_edges);
   TEdge* AddBoundsToLML(TEdge *e, bool IsClosed);
   void Reset();
   TEdge* ProcessBound(TEdge* E, bool IsClockwise);
@@ -379,6 +396,11 @@ protected:
 
   // A vector of edges per each input path.
   std::vector<std::vector<TEdge>> m_edges;
+  // Edge arrays released by Clear(), to be reused by AllocateEdges().
+  std::vector<std::vector<TEdge>> m_edgesFree;
+  size_t           m_edgesFreeCapacity { 0 };
+  // Temporary for AddPaths().
+  std::vector<int> m_NumEdges;
   // Don't remove intermediate vertices of a collinear sequence of points.
   bool             m_PreserveCollinear;
   // Is any of the paths inserted by AddPath() or AddPaths() open?
@@ -390,8 +412,12 @@ class Clipper : public ClipperBase
 {
 public:
   Clipper(int initOptions = 0);
-  ~Clipper() { Clear(); }
-  void Clear() { ClipperBase::Clear(); DisposeAllOutRecs(); }
+  // The buffers retained between the Execute() calls are owned by the Clipper object.
+  Clipper(const Clipper &) = delete;
+  Clipper& operator=(const Clipper &) = delete;
+  ~Clipper();
+  // Clear the input paths and the output. The buffers are kept for reuse by the next Execute(), up to a limit.
+  void Clear();
   bool Execute(ClipType clipType,
       Paths &solution,
       PolyFillType fillType = pftEvenOdd) 
@@ -423,8 +449,13 @@ private:
   
   // Output polygons.
   std::vector<OutRec*>  m_PolyOuts;
+  // Released output polygons, to be reused by CreateOutRec().
+  std::vector<OutRec*>  m_PolyOutsFree;
   // Output points, allocated by a continuous sets of m_OutPtsChunkSize.
+  // The chunks are kept allocated after the output is built, to be reused by the next Execute().
   std::vector<OutPt*>   m_OutPts;
+  // Number of chunks of m_OutPts in use, the last chunk in use is filled up to m_OutPtsChunkLast.
+  size_t                m_OutPtsChunksUsed;
   // List of free output points, to be used before taking a point from m_OutPts or allocating a new chunk.
   OutPt                *m_OutPtsFree;
   size_t                m_OutPtsChunkSize;
@@ -434,8 +465,13 @@ private:
   std::vector<Join>     m_GhostJoins;
   std::vector<IntersectNode> m_IntersectList;
   ClipType              m_ClipType;
-  // A priority queue (a binary heap) of Y coordinates.
-  std::priority_queue<cInt> m_Scanbeam;
+  // A priority queue (a binary heap) of Y coordinates. Clearing it keeps its storage allocated.
+  struct Scanbeam : public std::priority_queue<cInt> {
+    void   clear() { this->c.clear(); }
+    size_t capacity() const { return this->c.capacity(); }
+    void   release() { std::vector<cInt>().swap(this->c); }
+  };
+  Scanbeam              m_Scanbeam;
   // Maxima are collected by ProcessEdgesAtTopOfScanbeam(), consumed by ProcessHorizontal().
   std::vector<cInt>     m_Maxima;
   TEdge                *m_ActiveEdges;
@@ -509,7 +545,11 @@ class ClipperOffset
 {
 public:
   ClipperOffset(double miterLimit = 2.0, double roundPrecision = 0.25, double shortestEdgeLength = 0.) :
-    MiterLimit(miterLimit), ArcTolerance(roundPrecision), ShortestEdgeLength(shortestEdgeLength), m_lowest(-1, 0) {}
+    MiterLimit(miterLimit), ArcTolerance(roundPrecision), ShortestEdgeLength(shortestEdgeLength), m_lowest(-1, 0
+#ifdef CLIPPERLIB_USE_XYZ
+      , 0
+#endif // CLIPPERLIB_USE_XYZ
+    ) {}
   ~ClipperOffset() { Clear(); }
   void AddPath(const Path& path, JoinType joinType, EndType endType);
   template<typename PathsProvider>
@@ -529,6 +569,8 @@ private:
   Path m_srcPoly;
   Path m_destPoly;
   std::vector<DoublePoint> m_normals;
+  // Cleans up the offsetted contours, reused by the Execute() calls.
+  Clipper m_clipper;
   double m_delta, m_sinA, m_sin, m_cos;
   double m_miterLim, m_StepsPerRad;
   // x: index of the lowest contour in m_polyNodes
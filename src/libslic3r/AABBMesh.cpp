@@ -2,6 +2,7 @@
 #include <Execution/ExecutionTBB.hpp>
 
 #include <libslic3r/AABBTreeIndirect.hpp>
+#include <libslic3r/AABBTreeWide.hpp>
 #include <libslic3r/TriangleMesh.hpp>
 
 #include <numeric>
@@ -14,8 +15,10 @@ namespace Slic3r {
 
 class AABBMesh::AABBImpl {
 private:
-    AABBTreeIndirect::Tree3f m_tree;
-    double                   m_triangle_ray_epsilon;
+    AABBTreeIndirect::Tree3f   m_tree;
+    // Faster to cast rays than m_tree, which is kept for the distance queries. Built by the first ray query.
+    AABBTreeIndirect::LazyWideTree m_ray_tree;
+    double                         m_triangle_ray_epsilon;
 
 public:
     void init(const indexed_triangle_set &its, bool calculate_epsilon)
@@ -29,6 +32,7 @@ public:
         }
         m_tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(
             its.vertices, its.indices);
+        m_ray_tree = AABBTreeIndirect::LazyWideTree();
     }
 
     void intersect_ray(const indexed_triangle_set &its,
@@ -37,7 +41,7 @@ public:
                        igl::Hit &                  hit)
     {
         AABBTreeIndirect::intersect_ray_first_hit(its.vertices, its.indices,
-                                                  m_tree, s, dir, hit, m_triangle_ray_epsilon);
+                                                  m_ray_tree.get(its), s, dir, hit, m_triangle_ray_epsilon);
     }
 
     void intersect_ray(const indexed_triangle_set &its,
@@ -46,7 +50,7 @@ public:
                        std::vector<igl::Hit> &     hits)
     {
         AABBTreeIndirect::intersect_ray_all_hits(its.vertices, its.indices,
-                                                 m_tree, s, dir, hits, m_triangle_ray_epsilon);
+                                                 m_ray_tree.get(its), s, dir, hits, m_triangle_ray_epsilon);
     }
 
     double squared_distance(const indexed_triangle_set & its,
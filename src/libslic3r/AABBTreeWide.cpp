@@ -0,0 +1,199 @@
+#include "AABBTreeWide.hpp"
+
+namespace Slic3r {
+namespace AABBTreeIndirect {
+
+namespace {
+
+struct Primitive
+{
+    Eigen::AlignedBox3f bbox;
+    Vec3f               centroid;
+    uint32_t            idx;
+};
+
+struct Range
+{
+    size_t              begin;
+    size_t              end;
+    Eigen::AlignedBox3f bbox;
+
+    size_t size() const { return end - begin; }
+};
+
+// Half of the surface area of a box, the SAH cost of a box is proportional to it.
+inline float half_area(const Eigen::AlignedBox3f &bbox)
+{
+    const Vec3f d = bbox.sizes();
+    return d.x() * d.y() + d.y() * d.z() + d.z() * d.x();
+}
+
+class WideTreeBuilder
+{
+public:
+    WideTreeBuilder(std::vector<Primitive> &primitives, std::vector<WideTree::Node> &nodes, float eps) :
+        m_primitives(primitives), m_nodes(nodes), m_eps(eps) {}
+
+    // Build a node over the primitives of the range, returns index of the node.
+    int32_t build_node(const Range &range, int depth)
+    {
+        // Close to the maximum depth, split at the median. Then the remaining depth is at most log4(2^32) = 16.
+        const bool sah = depth < WideTree::MaxDepth - 16;
+        // Split the range into up to Width children, always splitting the child of the largest surface area
+        // (or the largest child when splitting at the median).
+        std::array<Range, WideTree::Width> children;
+        int num_children = 0;
+        children[num_children ++] = range;
+        while (num_children < WideTree::Width) {
+            int   best = -1;
+            float best_size = 0.f;
+            for (int i = 0; i < num_children; ++ i)
+                if (children[i].size() > WideTree::MaxLeafSize) {
+                    float size = sah ? half_area(children[i].bbox) : float(children[i].size());
+                    if (best == -1 || size > best_size) {
+                        best      = i;
+                        best_size = size;
+                    }
+                }
+            if (best == -1)
+                break;
+            const Range split = children[best];
+            size_t center = this->split(split, sah);
+            children[best]            = this->range(split.begin, center);
+            children[num_children ++] = this->range(center, split.end);
+        }
+
+        const int32_t node_idx = int32_t(m_nodes.size());
+        m_nodes.emplace_back();
+        {
+            WideTree::Node &node = m_nodes.back();
+            for (int i = 0; i < WideTree::Width; ++ i) {
+                for (int axis = 0; axis < 3; ++ axis) {
+                    node.min[axis][i] = i < num_children ? children[i].bbox.min()[axis] - m_eps :   std::numeric_limits<float>::infinity();
+                    node.max[axis][i] = i < num_children ? children[i].bbox.max()[axis] + m_eps : - std::numeric_limits<float>::infinity();
+                }
+                node.child[i] = -1;
+                node.count[i] = 0;
+                if (i < num_children && children[i].size() <= WideTree::MaxLeafSize) {
+                    node.child[i] = int32_t(children[i].begin);
+                    node.count[i] = uint32_t(children[i].size());
+                }
+            }
+        }
+        for (int i = 0; i < num_children; ++ i)
+            if (children[i].size() > WideTree::MaxLeafSize) {
+                int32_t child_idx = this->build_node(children[i], depth + 1);
+                // m_nodes may have been reallocated.
+                m_nodes[node_idx].child[i] = child_idx;
+            }
+        return node_idx;
+    }
+
+    Range range(size_t begin, size_t end) const
+    {
+        Range out { begin, end, Eigen::AlignedBox3f() };
+        for (size_t i = begin; i < end; ++ i)
+            out.bbox.extend(m_primitives[i].bbox);
+        return out;
+    }
+
+private:
+    // Split the range into two non-empty ranges, returns the first primitive of the second range.
+    // The split plane is perpendicular to the longest axis of the bounding box of the centroids. The primitives
+    // are binned by their centroids and the split minimizing the SAH cost is chosen. If there is no such split,
+    // or if sah is false, the range is split at the median.
+    size_t split(const Range &range, bool sah)
+    {
+        Eigen::AlignedBox3f centroids;
+        for (size_t i = range.begin; i < range.end; ++ i)
+            centroids.extend(m_primitives[i].centroid);
+        int axis = 0;
+        const float extent = centroids.sizes().maxCoeff(&axis);
+        if (sah && extent > 0.f) {
+            constexpr int                           num_bins = 16;
+            std::array<Eigen::AlignedBox3f, num_bins> bins;
+            std::array<size_t, num_bins>              counts {};
+            const float min   = centroids.min()[axis];
+            const float scale = float(num_bins) / extent;
+            auto bin_of = [min, scale, axis](const Primitive &p) { return std::min(num_bins - 1, int((p.centroid[axis] - min) * scale)); };
+            for (size_t i = range.begin; i < range.end; ++ i) {
+                int bin = bin_of(m_primitives[i]);
+                bins[bin].extend(m_primitives[i].bbox);
+                ++ counts[bin];
+            }
+            // SAH costs of the bins right of a split, sweeping from the right.
+            std::array<float, num_bins> right_cost {};
+            Eigen::AlignedBox3f         bbox;
+            size_t                      cnt = 0;
+            for (int i = num_bins - 1; i > 0; -- i) {
+                bbox.extend(bins[i]);
+                cnt += counts[i];
+                right_cost[i] = cnt == 0 ? 0.f : half_area(bbox) * float(cnt);
+            }
+            bbox.setEmpty();
+            cnt = 0;
+            int   best_split = -1;
+            float best_cost  = std::numeric_limits<float>::max();
+            for (int i = 0; i + 1 < num_bins; ++ i) {
+                bbox.extend(bins[i]);
+                cnt += counts[i];
+                if (cnt == 0 || cnt == range.size())
+                    continue;
+                float cost = half_area(bbox) * float(cnt) + right_cost[i + 1];
+                if (cost < best_cost) {
+                    best_cost  = cost;
+                    best_split = i + 1;
+                }
+            }
+            if (best_split != -1)
+                return std::partition(m_primitives.begin() + range.begin, m_primitives.begin() + range.end,
+                    [&bin_of, best_split](const Primitive &p) { return bin_of(p) < best_split; }) - m_primitives.begin();
+        }
+        const size_t center = (range.begin + range.end) / 2;
+        std::nth_element(m_primitives.begin() + range.begin, m_primitives.begin() + center, m_primitives.begin() + range.end,
+            [axis](const Primitive &l, const Primitive &r) { return l.centroid[axis] < r.centroid[axis]; });
+        return center;
+    }
+
+    std::vector<Primitive>      &m_primitives;
+    std::vector<WideTree::Node> &m_nodes;
+    // Inflation of the bounding boxes to account for the rounding of the ray - box test in floats.
+    const float                  m_eps;
+};
+
+} // namespace
+
+void WideTree::build(const std::vector<stl_vertex> &vertices, const std::vector<stl_triangle_vertex_indices> &faces)
+{
+    this->clear();
+    if (faces.empty())
+        return;
+
+    std::vector<Primitive> primitives;
+    primitives.reserve(faces.size());
+    Eigen::AlignedBox3f bbox;
+    for (size_t i = 0; i < faces.size(); ++ i) {
+        const stl_triangle_vertex_indices &face = faces[i];
+        Primitive p;
+        p.bbox = Eigen::AlignedBox3f(vertices[face(0)], vertices[face(0)]);
+        p.bbox.extend(vertices[face(1)]);
+        p.bbox.extend(vertices[face(2)]);
+        p.centroid = p.bbox.center();
+        p.idx      = uint32_t(i);
+        bbox.extend(p.bbox);
+        primitives.emplace_back(p);
+    }
+
+    const float eps = 4.f * std::numeric_limits<float>::epsilon() * std::max(bbox.min().cwiseAbs().maxCoeff(), bbox.max().cwiseAbs().maxCoeff());
+    // A 4-wide tree with leaves of up to 4 triangles has about a tenth of nodes compared to the number of triangles.
+    m_nodes.reserve(faces.size() / 8 + 1);
+    WideTreeBuilder builder(primitives, m_nodes, eps);
+    builder.build_node(builder.range(0, primitives.size()), 0);
+
+    m_triangles.reserve(primitives.size());
+    for (const Primitive &p : primitives)
+        m_triangles.emplace_back(p.idx);
+}
+
+} // namespace AABBTreeIndirect
+} // namespace Slic3r
@@ -0,0 +1,254 @@
+// Wide bounding volume hierarchy over an indexed triangle set, specialized for ray casting.
+
+#ifndef slic3r_AABBTreeWide_hpp_
+#define slic3r_AABBTreeWide_hpp_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define SLIC3R_AABB_TREE_WIDE_SSE
+#endif
+
+#include <admesh/stl.h>
+
+#include "AABBTreeIndirect.hpp"
+
+namespace Slic3r {
+namespace AABBTreeIndirect {
+
+// Bounding volume hierarchy with four children per node for casting rays against an indexed triangle set.
+// Contrary to the balanced binary Tree, the hierarchy is built with the surface area heuristic (SAH) evaluated
+// over binned centroids, which produces tighter boxes for meshes of triangles of varying size, and up to four
+// triangles are stored in a leaf. The boxes of the four children of a node are stored as a structure of arrays,
+// so that a ray is tested against all of them at once by vectorized code, and the children are visited from
+// the closest one, so that the search for the first hit terminates early.
+// The boxes are stored in floats, the ray - triangle intersections are calculated with the accuracy of the ray
+// the same way as with the binary Tree.
+// Use intersect_ray_first_hit() / intersect_ray_all_hits() with a WideTree the same way as with a Tree.
+class WideTree
+{
+public:
+    static constexpr int    Width        = 4;
+    static constexpr int    MaxLeafSize  = 4;
+    // Depth of the tree is limited by switching from SAH to median splits, bounding the traversal stack.
+    static constexpr int    MaxDepth     = 48;
+    static constexpr size_t MaxStackSize = (Width - 1) * MaxDepth + Width;
+
+    struct alignas(64) Node {
+        // Bounding boxes of the children, per axis. An unused child has an empty (inverted) box.
+        float    min[3][Width];
+        float    max[3][Width];
+        // Index of a child node, or index of the first triangle of a leaf into triangles().
+        int32_t  child[Width];
+        // Number of triangles of a leaf, zero for a child node.
+        uint32_t count[Width];
+    };
+
+    void build(const indexed_triangle_set &its) { this->build(its.vertices, its.indices); }
+    void build(const std::vector<stl_vertex> &vertices, const std::vector<stl_triangle_vertex_indices> &faces);
+    void clear() { m_nodes.clear(); m_triangles.clear(); }
+
+    bool                          empty()     const { return m_nodes.empty(); }
+    const std::vector<Node>&      nodes()     const { return m_nodes; }
+    // Indices of the triangles referenced by the leaves, the triangles of a leaf are stored consecutively.
+    const std::vector<uint32_t>&  triangles() const { return m_triangles; }
+
+private:
+    std::vector<Node>             m_nodes;
+    std::vector<uint32_t>         m_triangles;
+};
+
+// WideTree built by the first ray query, for the meshes of which many are never queried for rays.
+// Thread safe, the copies share the tree, thus they shall refer to the same mesh.
+class LazyWideTree
+{
+public:
+    const WideTree& get(const indexed_triangle_set &its) const {
+        std::call_once(m_data->built, [this, &its]() { m_data->tree.build(its); });
+        return m_data->tree;
+    }
+
+private:
+    struct Data {
+        std::once_flag built;
+        WideTree       tree;
+    };
+    std::shared_ptr<Data> m_data { std::make_shared<Data>() };
+};
+
+namespace detail {
+    // Ray in floats prepared for the slab test against the boxes of a WideTree node.
+    struct WideTreeRay
+    {
+        template<typename VectorType>
+        WideTreeRay(const VectorType &origin, const VectorType &dir) {
+            for (int i = 0; i < 3; ++ i) {
+                this->origin[i] = float(origin[i]);
+                float d = float(dir[i]);
+                // Avoid infinities, which would produce NaNs for a ray starting at the plane of a box.
+                this->invdir[i] = std::abs(d) < 1e-30f ? std::copysign(1e30f, d) : 1.f / d;
+                this->negative[i] = this->invdir[i] < 0.f;
+            }
+        }
+        float origin[3];
+        float invdir[3];
+        bool  negative[3];
+    };
+
+    // Ray parameters where the ray enters the boxes of the children of a node, infinity where the ray misses a box
+    // or enters it beyond t_max. The slab test is performed for all the children at once with SSE,
+    // scalar code is used on other platforms.
+    inline void wide_tree_ray_boxes(const WideTree::Node &node, const WideTreeRay &ray, float t_max, float (&t_entry)[WideTree::Width])
+    {
+        const float *near_x = ray.negative[0] ? node.max[0] : node.min[0];
+        const float *far_x  = ray.negative[0] ? node.min[0] : node.max[0];
+        const float *near_y = ray.negative[1] ? node.max[1] : node.min[1];
+        const float *far_y  = ray.negative[1] ? node.min[1] : node.max[1];
+        const float *near_z = ray.negative[2] ? node.max[2] : node.min[2];
+        const float *far_z  = ray.negative[2] ? node.min[2] : node.max[2];
+#ifdef SLIC3R_AABB_TREE_WIDE_SSE
+        static_assert(WideTree::Width == 4, "The SSE slab test expects 4 children per node");
+        const __m128 ox = _mm_set1_ps(ray.origin[0]), ix = _mm_set1_ps(ray.invdir[0]);
+        const __m128 oy = _mm_set1_ps(ray.origin[1]), iy = _mm_set1_ps(ray.invdir[1]);
+        const __m128 oz = _mm_set1_ps(ray.origin[2]), iz = _mm_set1_ps(ray.invdir[2]);
+        const __m128 t0 = _mm_max_ps(
+            _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_x), ox), ix), _mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_y), oy), iy)),
+            _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(near_z), oz), iz), _mm_setzero_ps()));
+        const __m128 t1 = _mm_min_ps(
+            _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_x), ox), ix), _mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_y), oy), iy)),
+            _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(far_z), oz), iz), _mm_set1_ps(t_max)));
+        const __m128 hit = _mm_cmple_ps(t0, t1);
+        _mm_storeu_ps(t_entry, _mm_or_ps(_mm_and_ps(hit, t0), _mm_andnot_ps(hit, _mm_set1_ps(std::numeric_limits<float>::infinity()))));
+#else
+        for (int i = 0; i < WideTree::Width; ++ i) {
+            float t0 = std::max(std::max((near_x[i] - ray.origin[0]) * ray.invdir[0], (near_y[i] - ray.origin[1]) * ray.invdir[1]),
+                                std::max((near_z[i] - ray.origin[2]) * ray.invdir[2], 0.f));
+            float t1 = std::min(std::min((far_x[i] - ray.origin[0]) * ray.invdir[0], (far_y[i] - ray.origin[1]) * ray.invdir[1]),
+                                std::min((far_z[i] - ray.origin[2]) * ray.invdir[2], t_max));
+            t_entry[i] = t0 <= t1 ? t0 : std::numeric_limits<float>::infinity();
+        }
+#endif
+    }
+
+    struct WideTreeStackEntry
+    {
+        int32_t  child;
+        uint32_t count;
+        float    t;
+    };
+
+    // Push the children of a node hit by the ray, sorted so that the closest child is popped first.
+    inline void wide_tree_push_children(const WideTree::Node &node, const float (&t_entry)[WideTree::Width],
+        std::array<WideTreeStackEntry, WideTree::MaxStackSize> &stack, size_t &stack_size)
+    {
+        const size_t first = stack_size;
+        for (int i = 0; i < WideTree::Width; ++ i)
+            if (t_entry[i] != std::numeric_limits<float>::infinity()) {
+                assert(stack_size < stack.size());
+                size_t j = stack_size ++;
+                for (; j > first && stack[j - 1].t < t_entry[i]; -- j)
+                    stack[j] = stack[j - 1];
+                stack[j] = { node.child[i], node.count[i], t_entry[i] };
+            }
+    }
+} // namespace detail
+
+// Find a first intersection of a ray with indexed triangle set, see intersect_ray_first_hit() over a Tree.
+template<typename VertexType, typename IndexedFaceType, typename VectorType>
+inline bool intersect_ray_first_hit(
+	const std::vector<VertexType> 		&vertices,
+	const std::vector<IndexedFaceType> 	&faces,
+	const WideTree 						&tree,
+	const VectorType					&origin,
+	const VectorType 					&dir,
+	igl::Hit 							&hit,
+	const double 						 eps = 0.000001)
+{
+    if (tree.empty())
+        return false;
+    const detail::WideTreeRay ray(origin, dir);
+    std::array<detail::WideTreeStackEntry, WideTree::MaxStackSize> stack;
+    size_t stack_size = 0;
+    stack[stack_size ++] = { 0, 0, 0.f };
+    double best_t     = std::numeric_limits<double>::infinity();
+    // best_t rounded up to float with a margin for the rounding errors of the slab test.
+    float  best_t_box = std::numeric_limits<float>::infinity();
+    bool   found      = false;
+    while (stack_size > 0) {
+        const detail::WideTreeStackEntry entry = stack[-- stack_size];
+        if (entry.t > best_t_box)
+            continue;
+        if (entry.count > 0) {
+            for (uint32_t i = 0; i < entry.count; ++ i) {
+                const uint32_t         idx  = tree.triangles()[entry.child + i];
+                const IndexedFaceType &face = faces[idx];
+                double t, u, v;
+                if (detail::intersect_triangle(origin, dir, vertices[face(0)], vertices[face(1)], vertices[face(2)], t, u, v, eps)
+                    && t > 0. && t < best_t) {
+                    best_t = t;
+                    hit    = igl::Hit { int(idx), -1, float(u), float(v), float(t) };
+                    found  = true;
+                }
+            }
+            if (found)
+                best_t_box = float(best_t) * (1.f + 1e-5f);
+        } else {
+            float t_entry[WideTree::Width];
+            detail::wide_tree_ray_boxes(tree.nodes()[entry.child], ray, best_t_box, t_entry);
+            detail::wide_tree_push_children(tree.nodes()[entry.child], t_entry, stack, stack_size);
+        }
+    }
+    return found;
+}
+
+// Find all intersections of a ray with indexed triangle set, see intersect_ray_all_hits() over a Tree.
+// The output hits are sorted by the ray parameter.
+template<typename VertexType, typename IndexedFaceType, typename VectorType>
+inline bool intersect_ray_all_hits(
+	const std::vector<VertexType> 		&vertices,
+	const std::vector<IndexedFaceType> 	&faces,
+	const WideTree 						&tree,
+	const VectorType					&origin,
+	const VectorType 					&dir,
+	std::vector<igl::Hit> 				&hits,
+	const double 						 eps = 0.000001)
+{
+    hits.clear();
+    if (tree.empty())
+        return false;
+    const detail::WideTreeRay ray(origin, dir);
+    std::array<detail::WideTreeStackEntry, WideTree::MaxStackSize> stack;
+    size_t stack_size = 0;
+    stack[stack_size ++] = { 0, 0, 0.f };
+    while (stack_size > 0) {
+        const detail::WideTreeStackEntry entry = stack[-- stack_size];
+        if (entry.count > 0) {
+            for (uint32_t i = 0; i < entry.count; ++ i) {
+                const uint32_t         idx  = tree.triangles()[entry.child + i];
+                const IndexedFaceType &face = faces[idx];
+                double t, u, v;
+                if (detail::intersect_triangle(origin, dir, vertices[face(0)], vertices[face(1)], vertices[face(2)], t, u, v, eps) && t > 0.)
+                    hits.emplace_back(igl::Hit{ int(idx), -1, float(u), float(v), float(t) });
+            }
+        } else {
+            float t_entry[WideTree::Width];
+            detail::wide_tree_ray_boxes(tree.nodes()[entry.child], ray, std::numeric_limits<float>::infinity(), t_entry);
+            detail::wide_tree_push_children(tree.nodes()[entry.child], t_entry, stack, stack_size);
+        }
+    }
+    std::sort(hits.begin(), hits.end(), [](const auto &l, const auto &r) { return l.t < r.t; });
+    return ! hits.empty();
+}
+
+} // namespace AABBTreeIndirect
+} // namespace Slic3r
+
+#endif /* slic3r_AABBTreeWide_hpp_ */
@@ -1,5 +1,8 @@
 #include "Clipper2Utils.hpp"
 
+#include <algorithm>
+#include <cassert>
+
 namespace Slic3r {
 
 //BBS: FIXME
@@ -57,4 +60,142 @@ Slic3r::Polylines intersection_pl_2(const Slic3r::Polylines& subject, const Slic
 Slic3r::Polylines  diff_pl_2(const Slic3r::Polylines& subject, const Slic3r::Polygons& clip)
     { return _clipper2_pl_open(Clipper2Lib::ClipType::Difference, subject, clip); }
 
-}
\ No newline at end of file
+namespace ClipperUtils {
+
+static Clipper2Lib::ClipType clip_type2(ClipperLib::ClipType clip_type)
+{
+    switch (clip_type) {
+    case ClipperLib::ctIntersection: return Clipper2Lib::ClipType::Intersection;
+    case ClipperLib::ctUnion:        return Clipper2Lib::ClipType::Union;
+    case ClipperLib::ctDifference:   return Clipper2Lib::ClipType::Difference;
+    case ClipperLib::ctXor:          return Clipper2Lib::ClipType::Xor;
+    }
+    assert(false);
+    return Clipper2Lib::ClipType::None;
+}
+
+static Clipper2Lib::FillRule fill_rule2(ClipperLib::PolyFillType fill_type)
+{
+    switch (fill_type) {
+    case ClipperLib::pftEvenOdd:  return Clipper2Lib::FillRule::EvenOdd;
+    case ClipperLib::pftNonZero:  return Clipper2Lib::FillRule::NonZero;
+    case ClipperLib::pftPositive: return Clipper2Lib::FillRule::Positive;
+    case ClipperLib::pftNegative: return Clipper2Lib::FillRule::Negative;
+    }
+    assert(false);
+    return Clipper2Lib::FillRule::NonZero;
+}
+
+static Clipper2Lib::JoinType join_type2(ClipperLib::JoinType join_type)
+{
+    switch (join_type) {
+    case ClipperLib::jtSquare: return Clipper2Lib::JoinType::Square;
+    case ClipperLib::jtRound:  return Clipper2Lib::JoinType::Round;
+    case ClipperLib::jtMiter:  return Clipper2Lib::JoinType::Miter;
+    }
+    assert(false);
+    return Clipper2Lib::JoinType::Miter;
+}
+
+static Clipper2Lib::EndType end_type2(ClipperLib::EndType end_type)
+{
+    switch (end_type) {
+    case ClipperLib::etClosedPolygon: return Clipper2Lib::EndType::Polygon;
+    case ClipperLib::etClosedLine:    return Clipper2Lib::EndType::Joined;
+    case ClipperLib::etOpenButt:      return Clipper2Lib::EndType::Butt;
+    case ClipperLib::etOpenSquare:    return Clipper2Lib::EndType::Square;
+    case ClipperLib::etOpenRound:     return Clipper2Lib::EndType::Round;
+    }
+    assert(false);
+    return Clipper2Lib::EndType::Polygon;
+}
+
+static ClipperLib::Path to_path(const Clipper2Lib::Path64 &path64)
+{
+    ClipperLib::Path out;
+    out.reserve(path64.size());
+    for (const Clipper2Lib::Point64 &pt : path64)
+        out.emplace_back(coord_t(pt.x), coord_t(pt.y));
+    return out;
+}
+
+static ClipperLib::Paths to_paths(const Clipper2Lib::Paths64 &paths64)
+{
+    ClipperLib::Paths out;
+    out.reserve(paths64.size());
+    for (const Clipper2Lib::Path64 &path64 : paths64)
+        out.emplace_back(to_path(path64));
+    return out;
+}
+
+static void setup_clipper2(Clipper2Lib::Clipper64 &clipper, const Clipper2Lib::Paths64 &subject, const Clipper2Lib::Paths64 &clip, bool reverse_solution)
+{
+    // ClipperLib defaults, Clipper2 preserves collinear points by default.
+    clipper.PreserveCollinear = false;
+    clipper.ReverseSolution   = reverse_solution;
+    clipper.AddSubject(subject);
+    if (! clip.empty())
+        clipper.AddClip(clip);
+}
+
+void clipper2_execute(ClipperLib::ClipType clip_type, const Clipper2Lib::Paths64 &subject, const Clipper2Lib::Paths64 &clip,
+    ClipperLib::PolyFillType fill_type, bool reverse_solution, ClipperLib::Paths &out)
+{
+    Clipper2Lib::Clipper64 clipper;
+    setup_clipper2(clipper, subject, clip, reverse_solution);
+    Clipper2Lib::Paths64 solution;
+    clipper.Execute(clip_type2(clip_type), fill_rule2(fill_type), solution);
+    out = to_paths(solution);
+}
+
+void clipper2_execute(ClipperLib::ClipType clip_type, const Clipper2Lib::Paths64 &subject, const Clipper2Lib::Paths64 &clip,
+    ClipperLib::PolyFillType fill_type, bool reverse_solution, ClipperLib::PolyTree &out)
+{
+    Clipper2Lib::Clipper64 clipper;
+    setup_clipper2(clipper, subject, clip, reverse_solution);
+    Clipper2Lib::PolyTree64 solution;
+    clipper.Execute(clip_type2(clip_type), fill_rule2(fill_type), solution);
+
+    struct Inner {
+        static size_t count_nodes(const Clipper2Lib::PolyPath64 &polypath) {
+            size_t cnt = polypath.Count();
+            for (const Clipper2Lib::PolyPath64 *child : polypath)
+                cnt += count_nodes(*child);
+            return cnt;
+        }
+        static void copy_nodes(const Clipper2Lib::PolyPath64 &polypath, ClipperLib::PolyTree &tree, ClipperLib::PolyNode &parent) {
+            for (const Clipper2Lib::PolyPath64 *child : polypath)
+                copy_nodes(*child, tree, tree.AddNode(parent, to_path(child->Polygon())));
+        }
+    };
+    out.Clear();
+    out.Reserve(Inner::count_nodes(solution));
+    Inner::copy_nodes(solution, out, out);
+}
+
+ClipperLib::Paths clipper2_offset(const Points &path, double delta, ClipperLib::JoinType join_type, double miter_limit, ClipperLib::EndType end_type)
+{
+    Clipper2Lib::ClipperOffset co;
+    if (join_type == ClipperLib::jtRound)
+        co.ArcTolerance(miter_limit);
+    else
+        co.MiterLimit(miter_limit);
+    Clipper2Lib::Path64 path64;
+    path64.reserve(path.size());
+    for (const Point &pt : path)
+        path64.emplace_back(pt.x(), pt.y());
+    const bool closed = end_type == ClipperLib::etClosedPolygon;
+    // Negative contours keep their orientation with Clipper2, while ClipperLib makes them positive.
+    const bool reversed = closed && Clipper2Lib::Area(path64) < 0;
+    co.AddPath(path64, join_type2(join_type), end_type2(end_type));
+    // Clipper2 offsets open paths and closed lines by the half of delta on each side.
+    ClipperLib::Paths out = to_paths(co.Execute(closed ? delta : 2. * std::abs(delta)));
+    if (reversed)
+        for (ClipperLib::Path &p : out)
+            std::reverse(p.begin(), p.end());
+    return out;
+}
+
+} // namespace ClipperUtils
+
+}
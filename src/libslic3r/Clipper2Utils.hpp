@@ -3,6 +3,7 @@
 
 #include "libslic3r.h"
 #include "clipper2/clipper.h"
+#include "clipper.hpp"
 #include "Polygon.hpp"
 #include "Polyline.hpp"
 
@@ -11,7 +12,38 @@ namespace Slic3r {
 Slic3r::Polylines  intersection_pl_2(const Slic3r::Polylines& subject, const Slic3r::Polygons& clip);
 Slic3r::Polylines  diff_pl_2(const Slic3r::Polylines& subject, const Slic3r::Polygons& clip);
 
+// Clipper2 implementation of the ClipperLib engine calls of ClipperUtils, used if ClipperUtils::backend() is Backend::Clipper2.
+// Inputs and outputs are ClipperLib types, so that the results may be post-processed by ClipperUtils the same way
+// as the results of ClipperLib.
+namespace ClipperUtils {
+
+    template<typename PathsProvider>
+    inline Clipper2Lib::Paths64 to_paths64(PathsProvider &&paths)
+    {
+        Clipper2Lib::Paths64 out;
+        out.reserve(paths.size());
+        for (const Points &path : paths) {
+            Clipper2Lib::Path64 path64;
+            path64.reserve(path.size());
+            for (const Point &pt : path)
+                path64.emplace_back(pt.x(), pt.y());
+            out.emplace_back(std::move(path64));
+        }
+        return out;
+    }
+
+    // Boolean operation on closed paths. With reverse_solution, the orientation of the output is reversed.
+    void clipper2_execute(ClipperLib::ClipType clip_type, const Clipper2Lib::Paths64 &subject, const Clipper2Lib::Paths64 &clip,
+        ClipperLib::PolyFillType fill_type, bool reverse_solution, ClipperLib::Paths &out);
+    void clipper2_execute(ClipperLib::ClipType clip_type, const Clipper2Lib::Paths64 &subject, const Clipper2Lib::Paths64 &clip,
+        ClipperLib::PolyFillType fill_type, bool reverse_solution, ClipperLib::PolyTree &out);
+
+    // Offset of a single path, the contours are reoriented so that the outermost one has a positive area the same way
+    // ClipperLib::ClipperOffset::Execute() does. miter_limit is the arc tolerance for jtRound.
+    ClipperLib::Paths clipper2_offset(const Points &path, double delta, ClipperLib::JoinType join_type, double miter_limit, ClipperLib::EndType end_type);
+
+} // namespace ClipperUtils
+
 }
 
 #endif
-
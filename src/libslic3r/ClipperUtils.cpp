@@ -1,7 +1,11 @@
 #include "ClipperUtils.hpp"
+#include "Clipper2Utils.hpp"
 #include "Geometry.hpp"
 #include "ShortestPath.hpp"
 
+#include <atomic>
+#include <cstdlib>
+
 // #define CLIPPER_UTILS_DEBUG
 
 #ifdef CLIPPER_UTILS_DEBUG
@@ -58,6 +62,14 @@ namespace ClipperUtils {
 Points EmptyPathsProvider::s_empty_points;
 Points SinglePathProvider::s_end;
 
+static std::atomic<Backend> s_backend = [] {
+    const char *backend = std::getenv("SLIC3R_CLIPPER_BACKEND");
+    return backend != nullptr && strcmp(backend, "clipper2") == 0 ? Backend::Clipper2 : Backend::Clipper;
+}();
+
+Backend backend() { return s_backend.load(std::memory_order_relaxed); }
+void    set_backend(Backend backend) { s_backend.store(backend, std::memory_order_relaxed); }
+
 // Clip source polygon to be used as a clipping polygon with a bouding box around the source (to be clipped) polygon.
 // Useful as an optimization for expensive ClipperLib operations, for example when clipping source polygons one by one
 // with a set of polygons covering the whole layer below.
@@ -259,28 +271,37 @@ bool has_duplicate_points(const ClipperLib::PolyTree &polytree)
 }
 #endif
 
+// Offset a single path with the active backend.
+// The output contours are reoriented so that the outer most contour has a positive area.
+static ClipperLib::Paths offset_path(const ClipperLib::Path &path, float offset, ClipperLib::JoinType joinType, double miterLimit, ClipperLib::EndType endType)
+{
+    if (ClipperUtils::backend() == ClipperUtils::Backend::Clipper2)
+        return ClipperUtils::clipper2_offset(path, offset, joinType, miterLimit, endType);
+    ClipperUtils::ReusableClipperOffset co;
+    if (joinType == jtRound)
+        co->ArcTolerance = miterLimit;
+    else
+        co->MiterLimit = miterLimit;
+    co->ShortestEdgeLength = std::abs(offset * ClipperOffsetShortestEdgeFactor);
+    co->AddPath(path, joinType, endType);
+    ClipperLib::Paths out;
+    co->Execute(out, offset);
+    return out;
+}
+
 // Offset CCW contours outside, CW contours (holes) inside.
 // Don't calculate union of the output paths.
 template<typename PathsProvider>
 static ClipperLib::Paths raw_offset(PathsProvider &&paths, float offset, ClipperLib::JoinType joinType, double miterLimit, ClipperLib::EndType endType = ClipperLib::etClosedPolygon)
 {
-    ClipperLib::ClipperOffset co;
     ClipperLib::Paths out;
     out.reserve(paths.size());
-    ClipperLib::Paths out_this;
-    if (joinType == jtRound)
-        co.ArcTolerance = miterLimit;
-    else
-        co.MiterLimit = miterLimit;
-    co.ShortestEdgeLength = std::abs(offset * ClipperOffsetShortestEdgeFactor);
     for (const ClipperLib::Path &path : paths) {
-        co.Clear();
         // Execute reorients the contours so that the outer most contour has a positive area. Thus the output
         // contours will be CCW oriented even though the input paths are CW oriented.
         // Offset is applied after contour reorientation, thus the signum of the offset value is reversed.
-        co.AddPath(path, joinType, endType);
         bool ccw = endType == ClipperLib::etClosedPolygon ? ClipperLib::Orientation(path) : true;
-        co.Execute(out_this, ccw ? offset : - offset);
+        ClipperLib::Paths out_this = offset_path(path, ccw ? offset : - offset, joinType, miterLimit, endType);
         if (! ccw) {
             // Reverse the resulting contours.
             for (ClipperLib::Path &path : out_this)
@@ -305,11 +326,15 @@ TResult clipper_do(
     TClip &&                       clip,
     const ClipperLib::PolyFillType fillType)
 {
-    ClipperLib::Clipper clipper;
-    clipper.AddPaths(std::forward<TSubj>(subject), ClipperLib::ptSubject, true);
-    clipper.AddPaths(std::forward<TClip>(clip),    ClipperLib::ptClip,    true);
     TResult retval;
-    clipper.Execute(clipType, retval, fillType, fillType);
+    if (ClipperUtils::backend() == ClipperUtils::Backend::Clipper2) {
+        ClipperUtils::clipper2_execute(clipType, ClipperUtils::to_paths64(std::forward<TSubj>(subject)), ClipperUtils::to_paths64(std::forward<TClip>(clip)), fillType, false, retval);
+        return retval;
+    }
+    ClipperUtils::ReusableClipper clipper;
+    clipper->AddPaths(std::forward<TSubj>(subject), ClipperLib::ptSubject, true);
+    clipper->AddPaths(std::forward<TClip>(clip),    ClipperLib::ptClip,    true);
+    clipper->Execute(clipType, retval, fillType, fillType);
     return retval;
 }
 
@@ -334,10 +359,14 @@ TResult clipper_union(
     // fillType pftNonZero and pftPositive "should" produce the same result for "normalized with implicit union" set of polygons
     const ClipperLib::PolyFillType fillType = ClipperLib::pftNonZero)
 {
-    ClipperLib::Clipper clipper;
-    clipper.AddPaths(std::forward<TSubj>(subject), ClipperLib::ptSubject, true);
     TResult retval;
-    clipper.Execute(ClipperLib::ctUnion, retval, fillType, fillType);
+    if (ClipperUtils::backend() == ClipperUtils::Backend::Clipper2) {
+        ClipperUtils::clipper2_execute(ClipperLib::ctUnion, ClipperUtils::to_paths64(std::forward<TSubj>(subject)), {}, fillType, false, retval);
+        return retval;
+    }
+    ClipperUtils::ReusableClipper clipper;
+    clipper->AddPaths(std::forward<TSubj>(subject), ClipperLib::ptSubject, true);
+    clipper->Execute(ClipperLib::ctUnion, retval, fillType, fillType);
     return retval;
 }
 
@@ -377,12 +406,18 @@ static TResult shrink_paths(PathsProvider &&paths, float offset, ClipperLib::Joi
     //assert(offset > 0);
     TResult out;
     if (auto raw = raw_offset(std::forward<PathsProvider>(paths), - offset, joinType, miterLimit); ! raw.empty()) {
-        ClipperLib::Clipper clipper;
-        clipper.AddPaths(raw, ClipperLib::ptSubject, true);
-        ClipperLib::IntRect r = clipper.GetBounds();
-        clipper.AddPath({ { r.left - 10, r.bottom + 10 }, { r.right + 10, r.bottom + 10 }, { r.right + 10, r.top - 10 }, { r.left - 10, r.top - 10 } }, ClipperLib::ptSubject, true);
-        clipper.ReverseSolution(true);
-        clipper.Execute(ClipperLib::ctUnion, out, ClipperLib::pftNegative, ClipperLib::pftNegative);
+        if (ClipperUtils::backend() == ClipperUtils::Backend::Clipper2) {
+            // Equivalent to removing the outermost polygon of the negative union with the bounding rectangle below:
+            // Keep the areas covered positively.
+            ClipperUtils::clipper2_execute(ClipperLib::ctUnion, ClipperUtils::to_paths64(raw), {}, ClipperLib::pftPositive, false, out);
+            return out;
+        }
+        ClipperUtils::ReusableClipper clipper;
+        clipper->AddPaths(raw, ClipperLib::ptSubject, true);
+        ClipperLib::IntRect r = clipper->GetBounds();
+        clipper->AddPath({ { r.left - 10, r.bottom + 10 }, { r.right + 10, r.bottom + 10 }, { r.right + 10, r.top - 10 }, { r.left - 10, r.top - 10 } }, ClipperLib::ptSubject, true);
+        clipper->ReverseSolution(true);
+        clipper->Execute(ClipperLib::ctUnion, out, ClipperLib::pftNegative, ClipperLib::pftNegative);
         remove_outermost_polygon(out);
     }
     return out;
@@ -423,17 +458,7 @@ Polygons contour_to_polygons(const Polygons &polygons, const float line_width, C
 static int offset_expolygon_inner(const Slic3r::ExPolygon &expoly, const float delta, ClipperLib::JoinType joinType, double miterLimit, ClipperLib::Paths &out)
 {
     // 1) Offset the outer contour.
-    ClipperLib::Paths contours;
-    {
-        ClipperLib::ClipperOffset co;
-        if (joinType == jtRound)
-            co.ArcTolerance = miterLimit;
-        else
-            co.MiterLimit = miterLimit;
-        co.ShortestEdgeLength = std::abs(delta * ClipperOffsetShortestEdgeFactor);
-        co.AddPath(expoly.contour.points, joinType, ClipperLib::etClosedPolygon);
-        co.Execute(contours, delta);
-    }
+    ClipperLib::Paths contours = offset_path(expoly.contour.points, delta, joinType, miterLimit, ClipperLib::etClosedPolygon);
     if (contours.empty())
         // No need to try to offset the holes.
         return 0;
@@ -444,23 +469,11 @@ static int offset_expolygon_inner(const Slic3r::ExPolygon &expoly, const float d
     } else {
         // 2) Offset the holes one by one, collect the offsetted holes.
         ClipperLib::Paths holes;
-        {
-            for (const Polygon &hole : expoly.holes) {
-                ClipperLib::ClipperOffset co;
-                if (joinType == jtRound)
-                    co.ArcTolerance = miterLimit;
-                else
-                    co.MiterLimit = miterLimit;
-                co.ShortestEdgeLength = std::abs(delta * ClipperOffsetShortestEdgeFactor);
-                co.AddPath(hole.points, joinType, ClipperLib::etClosedPolygon);
-                ClipperLib::Paths out2;
-                // Execute reorients the contours so that the outer most contour has a positive area. Thus the output
-                // contours will be CCW oriented even though the input paths are CW oriented.
-                // Offset is applied after contour reorientation, thus the signum of the offset value is reversed.
-                co.Execute(out2, - delta);
-                append(holes, std::move(out2));
-            }
-        }
+        for (const Polygon &hole : expoly.holes)
+            // Execute reorients the contours so that the outer most contour has a positive area. Thus the output
+            // contours will be CCW oriented even though the input paths are CW oriented.
+            // Offset is applied after contour reorientation, thus the signum of the offset value is reversed.
+            append(holes, offset_path(hole.points, - delta, joinType, miterLimit, ClipperLib::etClosedPolygon));
 
         // 3) Subtract holes from the contours.
         if (holes.empty()) {
@@ -822,11 +835,11 @@ Slic3r::ExPolygons xor_ex(const Slic3r::ExPolygons &subject, const Slic3r::ExPol
 template<typename PathsProvider1, typename PathsProvider2>
 Polylines _clipper_pl_open(ClipperLib::ClipType clipType, PathsProvider1 &&subject, PathsProvider2 &&clip)
 {
-    ClipperLib::Clipper clipper;
-    clipper.AddPaths(std::forward<PathsProvider1>(subject), ClipperLib::ptSubject, false);
-    clipper.AddPaths(std::forward<PathsProvider2>(clip), ClipperLib::ptClip, true);
+    ClipperUtils::ReusableClipper clipper;
+    clipper->AddPaths(std::forward<PathsProvider1>(subject), ClipperLib::ptSubject, false);
+    clipper->AddPaths(std::forward<PathsProvider2>(clip), ClipperLib::ptClip, true);
     ClipperLib::PolyTree retval;
-    clipper.Execute(clipType, retval, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    clipper->Execute(clipType, retval, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
     return PolyTreeToPolylines(std::move(retval));
 }
 
@@ -1005,11 +1018,11 @@ Polygons simplify_polygons(const Polygons &subject, bool preserve_collinear)
 {
     ClipperLib::Paths output;
     if (preserve_collinear) {
-        ClipperLib::Clipper c;
-        c.PreserveCollinear(true);
-        c.StrictlySimple(true);
-        c.AddPaths(ClipperUtils::PolygonsProvider(subject), ClipperLib::ptSubject, true);
-        c.Execute(ClipperLib::ctUnion, output, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+        ClipperUtils::ReusableClipper c;
+        c->PreserveCollinear(true);
+        c->StrictlySimple(true);
+        c->AddPaths(ClipperUtils::PolygonsProvider(subject), ClipperLib::ptSubject, true);
+        c->Execute(ClipperLib::ctUnion, output, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
     } else {
         output = ClipperLib::SimplifyPolygons(ClipperUtils::PolygonsProvider(subject), ClipperLib::pftNonZero);
     }
@@ -1024,11 +1037,11 @@ ExPolygons simplify_polygons_ex(const Polygons &subject, bool preserve_collinear
         return union_ex(simplify_polygons(subject, false));
 
     ClipperLib::PolyTree polytree;    
-    ClipperLib::Clipper c;
-    c.PreserveCollinear(true);
-    c.StrictlySimple(true);
-    c.AddPaths(ClipperUtils::PolygonsProvider(subject), ClipperLib::ptSubject, true);
-    c.Execute(ClipperLib::ctUnion, polytree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    ClipperUtils::ReusableClipper c;
+    c->PreserveCollinear(true);
+    c->StrictlySimple(true);
+    c->AddPaths(ClipperUtils::PolygonsProvider(subject), ClipperLib::ptSubject, true);
+    c->Execute(ClipperLib::ctUnion, polytree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
     
     // convert into ExPolygons
     return PolyTreeToExPolygons(std::move(polytree));
@@ -1037,12 +1050,12 @@ ExPolygons simplify_polygons_ex(const Polygons &subject, bool preserve_collinear
 Polygons top_level_islands(const Slic3r::Polygons &polygons)
 {
     // init Clipper
-    ClipperLib::Clipper clipper;
-    clipper.Clear();
+    ClipperUtils::ReusableClipper clipper;
+    clipper->Clear();
     // perform union
-    clipper.AddPaths(ClipperUtils::PolygonsProvider(polygons), ClipperLib::ptSubject, true);
+    clipper->AddPaths(ClipperUtils::PolygonsProvider(polygons), ClipperLib::ptSubject, true);
     ClipperLib::PolyTree polytree;
-    clipper.Execute(ClipperLib::ctUnion, polytree, ClipperLib::pftEvenOdd, ClipperLib::pftEvenOdd); 
+    clipper->Execute(ClipperLib::ctUnion, polytree, ClipperLib::pftEvenOdd, ClipperLib::pftEvenOdd); 
     // Convert only the top level islands to the output.
     Polygons out;
     out.reserve(polytree.ChildCount());
@@ -1061,10 +1074,10 @@ ClipperLib::Paths fix_after_outer_offset(
 {
   	ClipperLib::Paths solution;
   	if (! input.empty()) {
-		ClipperLib::Clipper clipper;
-	  	clipper.AddPath(input, ClipperLib::ptSubject, true);
-		clipper.ReverseSolution(reverse_result);
-		clipper.Execute(ClipperLib::ctUnion, solution, filltype, filltype);
+		ClipperUtils::ReusableClipper clipper;
+	  	clipper->AddPath(input, ClipperLib::ptSubject, true);
+		clipper->ReverseSolution(reverse_result);
+		clipper->Execute(ClipperLib::ctUnion, solution, filltype, filltype);
 	}
     return solution;
 }
@@ -1079,16 +1092,16 @@ ClipperLib::Paths fix_after_inner_offset(
 {
   	ClipperLib::Paths solution;
   	if (! input.empty()) {
-		ClipperLib::Clipper clipper;
-		clipper.AddPath(input, ClipperLib::ptSubject, true);
-		ClipperLib::IntRect r = clipper.GetBounds();
+		ClipperUtils::ReusableClipper clipper;
+		clipper->AddPath(input, ClipperLib::ptSubject, true);
+		ClipperLib::IntRect r = clipper->GetBounds();
 		r.left -= 10; r.top -= 10; r.right += 10; r.bottom += 10;
 		if (filltype == ClipperLib::pftPositive)
-			clipper.AddPath({ ClipperLib::IntPoint(r.left, r.bottom), ClipperLib::IntPoint(r.left, r.top), ClipperLib::IntPoint(r.right, r.top), ClipperLib::IntPoint(r.right, r.bottom) }, ClipperLib::ptSubject, true);
+			clipper->AddPath({ ClipperLib::IntPoint(r.left, r.bottom), ClipperLib::IntPoint(r.left, r.top), ClipperLib::IntPoint(r.right, r.top), ClipperLib::IntPoint(r.right, r.bottom) }, ClipperLib::ptSubject, true);
 		else
-			clipper.AddPath({ ClipperLib::IntPoint(r.left, r.bottom), ClipperLib::IntPoint(r.right, r.bottom), ClipperLib::IntPoint(r.right, r.top), ClipperLib::IntPoint(r.left, r.top) }, ClipperLib::ptSubject, true);
-		clipper.ReverseSolution(reverse_result);
-		clipper.Execute(ClipperLib::ctUnion, solution, filltype, filltype);
+			clipper->AddPath({ ClipperLib::IntPoint(r.left, r.bottom), ClipperLib::IntPoint(r.right, r.bottom), ClipperLib::IntPoint(r.right, r.top), ClipperLib::IntPoint(r.left, r.top) }, ClipperLib::ptSubject, true);
+		clipper->ReverseSolution(reverse_result);
+		clipper->Execute(ClipperLib::ctUnion, solution, filltype, filltype);
 		if (! solution.empty())
 			solution.erase(solution.begin());
 	}
@@ -1267,11 +1280,11 @@ Polygons variable_offset_inner(const ExPolygon &expoly, const std::vector<std::v
 	if (holes.empty())
 		output = std::move(contours);
 	else {
-		ClipperLib::Clipper clipper;
-		clipper.Clear();
-		clipper.AddPaths(contours, ClipperLib::ptSubject, true);
-		clipper.AddPaths(holes, ClipperLib::ptClip, true);
-		clipper.Execute(ClipperLib::ctDifference, output, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+		ClipperUtils::ReusableClipper clipper;
+		clipper->Clear();
+		clipper->AddPaths(contours, ClipperLib::ptSubject, true);
+		clipper->AddPaths(holes, ClipperLib::ptClip, true);
+		clipper->Execute(ClipperLib::ctDifference, output, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
 	}
 
 	return to_polygons(std::move(output));
@@ -1309,11 +1322,11 @@ for (const std::vector<float>& ds : deltas)
 	if (holes.empty())
 		output = std::move(contours);
 	else {
-		ClipperLib::Clipper clipper;
-		clipper.Clear();
-		clipper.AddPaths(contours, ClipperLib::ptSubject, true);
-		clipper.AddPaths(holes, ClipperLib::ptClip, true);
-		clipper.Execute(ClipperLib::ctDifference, output, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+		ClipperUtils::ReusableClipper clipper;
+		clipper->Clear();
+		clipper->AddPaths(contours, ClipperLib::ptSubject, true);
+		clipper->AddPaths(holes, ClipperLib::ptClip, true);
+		clipper->Execute(ClipperLib::ctDifference, output, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
 	}
 
 	return to_polygons(std::move(output));
@@ -1353,11 +1366,11 @@ for (const std::vector<float>& ds : deltas)
 		for (ClipperLib::Path &path : contours) 
 			output.emplace_back(std::move(path));
 	} else {
-		ClipperLib::Clipper clipper;
-		clipper.AddPaths(contours, ClipperLib::ptSubject, true);
-		clipper.AddPaths(holes, ClipperLib::ptClip, true);
+		ClipperUtils::ReusableClipper clipper;
+		clipper->AddPaths(contours, ClipperLib::ptSubject, true);
+		clipper->AddPaths(holes, ClipperLib::ptClip, true);
 	    ClipperLib::PolyTree polytree;
-		clipper.Execute(ClipperLib::ctDifference, polytree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+		clipper->Execute(ClipperLib::ctDifference, polytree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
 	    output = PolyTreeToExPolygons(std::move(polytree));
 	}
 
@@ -1399,11 +1412,11 @@ ExPolygons variable_offset_inner_ex(const ExPolygon &expoly, const std::vector<s
 		for (ClipperLib::Path &path : contours) 
 			output.emplace_back(std::move(path));
 	} else {
-		ClipperLib::Clipper clipper;
-		clipper.AddPaths(contours, ClipperLib::ptSubject, true);
-		clipper.AddPaths(holes, ClipperLib::ptClip, true);
+		ClipperUtils::ReusableClipper clipper;
+		clipper->AddPaths(contours, ClipperLib::ptSubject, true);
+		clipper->AddPaths(holes, ClipperLib::ptClip, true);
 	    ClipperLib::PolyTree polytree;
-		clipper.Execute(ClipperLib::ctDifference, polytree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+		clipper->Execute(ClipperLib::ctDifference, polytree, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
 	    output = PolyTreeToExPolygons(std::move(polytree));
 	}
 
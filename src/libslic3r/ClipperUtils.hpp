@@ -321,6 +321,76 @@ namespace ClipperUtils {
     [[nodiscard]] Polygons clip_clipper_polygons_with_subject_bbox(const ExPolygon &src, const BoundingBox &bbox, const bool get_entire_polygons = false);
     [[nodiscard]] Polygons clip_clipper_polygons_with_subject_bbox(const ExPolygons &src, const BoundingBox &bbox, const bool get_entire_polygons = false);
 
+    // Clipper engine (ClipperLib::Clipper or ClipperLib::ClipperOffset) borrowed from a pool owned by the calling thread.
+    // The engines keep their edge arrays, output points and records, joins and scan beam storage between the calls,
+    // thus the Boolean operations and offsets executed millions of times when slicing do not allocate them from scratch.
+    // The engine is cleared and its options are reset to defaults when returned to the pool. The borrowing calls may nest.
+    // A thread keeps at most max_pooled engines of each type, the engines of deeper nested calls are released when returned.
+    // An engine limits the buffers it retains when cleared, see ClipperLib::Clipper::Clear().
+    template<typename Engine>
+    class ReusableEngine
+    {
+    public:
+        static constexpr const size_t max_pooled = 2;
+
+        ReusableEngine() {
+            std::vector<std::unique_ptr<Engine>> &pool = ReusableEngine::pool();
+            if (pool.empty())
+                m_engine = std::make_unique<Engine>();
+            else {
+                m_engine = std::move(pool.back());
+                pool.pop_back();
+            }
+        }
+        ~ReusableEngine() {
+            std::vector<std::unique_ptr<Engine>> &pool = ReusableEngine::pool();
+            if (pool.size() < max_pooled) {
+                reset(*m_engine);
+                pool.emplace_back(std::move(m_engine));
+            }
+        }
+        ReusableEngine(const ReusableEngine&) = delete;
+        ReusableEngine& operator=(const ReusableEngine&) = delete;
+
+        Engine& operator*()  { return *m_engine; }
+        Engine* operator->() { return m_engine.get(); }
+
+    private:
+        static std::vector<std::unique_ptr<Engine>>& pool() {
+            static thread_local std::vector<std::unique_ptr<Engine>> engines;
+            return engines;
+        }
+        static void reset(ClipperLib::Clipper &clipper) {
+            clipper.Clear();
+            clipper.ReverseSolution(false);
+            clipper.StrictlySimple(false);
+            clipper.PreserveCollinear(false);
+        }
+        static void reset(ClipperLib::ClipperOffset &co) {
+            co.Clear();
+            // Defaults of the ClipperOffset constructor.
+            co.MiterLimit         = 2.;
+            co.ArcTolerance       = 0.25;
+            co.ShortestEdgeLength = 0.;
+        }
+
+        std::unique_ptr<Engine> m_engine;
+    };
+    using ReusableClipper       = ReusableEngine<ClipperLib::Clipper>;
+    using ReusableClipperOffset = ReusableEngine<ClipperLib::ClipperOffset>;
+
+    // Library executing the Boolean operations and offsets of closed polygons: union_(), diff(), intersection(), xor_ex(),
+    // their _ex variants, offset(), offset_ex(), offset2_ex(), opening() and closing().
+    // Clipping of open polylines and the remaining utilities always use ClipperLib.
+    enum class Backend {
+        Clipper,
+        Clipper2,
+    };
+    // ClipperLib by default, Clipper2 if the environment variable SLIC3R_CLIPPER_BACKEND is set to "clipper2".
+    Backend backend();
+    // Switch the backend for all threads. Not to be called while any other thread performs clipping.
+    void    set_backend(Backend backend);
+
     }
 
 // Perform union of input polygons using the non-zero rule, convert to ExPolygons.
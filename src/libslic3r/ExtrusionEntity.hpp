@@ -6,9 +6,12 @@
 #include "Polyline.hpp"
 
 #include <assert.h>
+#include <new>
 #include <string_view>
 #include <numeric>
 
+#include <oneapi/tbb/scalable_allocator.h>
+
 namespace Slic3r {
 
 class ExPolygon;
@@ -143,6 +146,16 @@ public:
 
     static std::string role_to_string(ExtrusionRole role);
     static ExtrusionRole string_to_role(const std::string_view role);
+
+    // Tens of millions of extrusion entities are allocated by the parallel perimeter and infill generators
+    // and released together when the layers are invalidated. Allocate them from the thread local pools
+    // of the TBB scalable allocator instead of the global heap.
+    static void* operator new(size_t size) {
+        if (void *ptr = scalable_malloc(size))
+            return ptr;
+        throw std::bad_alloc();
+    }
+    static void  operator delete(void *ptr) noexcept { scalable_free(ptr); }
 };
 
 typedef std::vector<ExtrusionEntity*> ExtrusionEntitiesPtr;
@@ -6,6 +6,22 @@
 
 #include <string>
 
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/predef/other/endian.h>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/parallel_sort.h>
+
+#include <fast_float/fast_float.h>
+
+#if BOOST_ENDIAN_BIG_BYTE
+extern void stl_internal_reverse_quads(char *buf, size_t cnt);
+#endif /* BOOST_ENDIAN_BIG_BYTE */
+
 #ifdef _WIN32
 #define DIR_SEPARATOR '\\'
 #else
@@ -39,6 +55,311 @@ bool load_stl(const char *path, Model *model, const char *object_name_in, Import
     return true;
 }
 
+// Storage of the facets decoded from a memory mapped STL file, either admesh facets or a triangle soup of three vertices per facet.
+static inline void stl_store_facet(std::vector<stl_facet> &out, size_t idx, const stl_facet &facet) { out[idx] = facet; }
+static inline void stl_store_facet(std::vector<stl_vertex> &out, size_t idx, const stl_facet &facet)
+{
+    out[idx * 3]     = facet.vertex[0];
+    out[idx * 3 + 1] = facet.vertex[1];
+    out[idx * 3 + 2] = facet.vertex[2];
+}
+static inline size_t stl_num_stored_facets(const std::vector<stl_facet> &out) { return out.size(); }
+static inline size_t stl_num_stored_facets(const std::vector<stl_vertex> &out) { return out.size() / 3; }
+static inline void   stl_resize_stored_facets(std::vector<stl_facet> &out, size_t num_facets) { out.resize(num_facets); }
+static inline void   stl_resize_stored_facets(std::vector<stl_vertex> &out, size_t num_facets) { out.resize(num_facets * 3); }
+static inline const stl_vertex* stl_stored_vertices(const std::vector<stl_facet> &out, size_t idx) { return out[idx].vertex; }
+static inline const stl_vertex* stl_stored_vertices(const std::vector<stl_vertex> &out, size_t idx) { return out.data() + idx * 3; }
+
+// Drops the facets with a NaN vertex the same way stl_read() does, returns the number of facets dropped.
+template<typename Facets>
+static size_t stl_remove_nan_facets(Facets &facets)
+{
+    auto has_nan = [&facets](size_t idx) {
+        const stl_vertex *v = stl_stored_vertices(facets, idx);
+        return v[0].hasNaN() || v[1].hasNaN() || v[2].hasNaN();
+    };
+    const size_t num_facets = stl_num_stored_facets(facets);
+    bool         any_nan    = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, num_facets), false,
+        [&has_nan](const tbb::blocked_range<size_t> &range, bool any) {
+            for (size_t i = range.begin(); ! any && i < range.end(); ++ i)
+                any = has_nan(i);
+            return any;
+        }, [](bool l, bool r) { return l || r; });
+    if (! any_nan)
+        return 0;
+    constexpr size_t stride = std::is_same_v<Facets, std::vector<stl_facet>> ? 1 : 3;
+    size_t num_valid = 0;
+    for (size_t i = 0; i < num_facets; ++ i)
+        if (! has_nan(i)) {
+            if (num_valid != i)
+                std::copy_n(facets.begin() + i * stride, stride, facets.begin() + num_valid * stride);
+            ++ num_valid;
+        }
+    stl_resize_stored_facets(facets, num_valid);
+    return num_facets - num_valid;
+}
+
+// Extracts the model id and country code from the "solid" line of an ASCII STL in the form "solid name MW 1.0 <model_id> <country_code>".
+static void stl_parse_mw_data(const char *begin, const char *end, std::string &model_id, std::string &country_code)
+{
+    const char *eol = std::find_if(begin, end, [](char c) { return c == '\n' || c == '\r'; });
+    std::string solid_line(begin, eol);
+    model_id.clear();
+    country_code.clear();
+    if (size_t mw_position = solid_line.find("MW"); mw_position != std::string::npos) {
+        char version_str[16], model_id_str[128], country_code_str[16];
+        if (sscanf(solid_line.c_str() + mw_position + 2, "%15s %127s %15s", version_str, model_id_str, country_code_str) == 3 && strcmp(version_str, "1.0") == 0) {
+            model_id     = model_id_str;
+            country_code = country_code_str;
+        }
+    }
+}
+
+// Decodes the binary STL facets in parallel, interrupted LOAD_STL_UNIT_NUM times to report the progress.
+template<typename Facets>
+static bool stl_parse_binary(const char *begin, const char *end, size_t header_size, ImportstlProgressFn stlFn, Facets &facets)
+{
+    const size_t num_facets = size_t(end - begin - header_size) / SIZEOF_STL_FACET;
+    const char  *data       = begin + header_size;
+    stl_resize_stored_facets(facets, num_facets);
+    std::string  model_id, country_code;
+    const size_t num_units = 5;
+    for (size_t unit = 0; unit < num_units; ++ unit) {
+        if (stlFn) {
+            bool cb_cancel = false;
+            stlFn(int(unit * num_facets / num_units), int(num_facets), cb_cancel, model_id, country_code);
+            if (cb_cancel)
+                return false;
+        }
+        tbb::parallel_for(tbb::blocked_range<size_t>(unit * num_facets / num_units, (unit + 1) * num_facets / num_units, 4096),
+            [data, &facets](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i < range.end(); ++ i) {
+                    stl_facet facet;
+                    memcpy(&facet, data + i * SIZEOF_STL_FACET, SIZEOF_STL_FACET);
+#if BOOST_ENDIAN_BIG_BYTE
+                    // Convert the loaded little endian data to big endian.
+                    stl_internal_reverse_quads((char*)&facet, 48);
+#endif /* BOOST_ENDIAN_BIG_BYTE */
+                    stl_store_facet(facets, i, facet);
+                }
+            });
+    }
+    return true;
+}
+
+// Decodes the ASCII STL facets with fast_float. Tolerates the same deviations from the format as stl_read():
+// repeated solid / endsolid, text after endloop and endfacet and mangled normals. Besides LF and CRLF, CR line endings are accepted.
+template<typename Facets>
+static bool stl_parse_ascii(const char *begin, const char *end, ImportstlProgressFn stlFn, Facets &facets)
+{
+    const char *ptr = begin;
+    auto is_space   = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; };
+    auto skip_space = [&ptr, end, &is_space]() { while (ptr < end && is_space(*ptr)) ++ ptr; };
+    auto skip_line  = [&ptr, end]() { while (ptr < end && *ptr != '\n' && *ptr != '\r') ++ ptr; };
+    // Next whitespace delimited token.
+    auto token      = [&ptr, end, &skip_space, &is_space]() {
+        skip_space();
+        const char *token_begin = ptr;
+        while (ptr < end && ! is_space(*ptr)) ++ ptr;
+        return std::string_view(token_begin, ptr - token_begin);
+    };
+    auto number     = [&token](float &value) {
+        std::string_view str = token();
+        return ! str.empty() && fast_float::from_chars(str.data(), str.data() + str.size(), value).ptr == str.data() + str.size();
+    };
+
+    std::string model_id, country_code;
+    skip_space();
+    if (end - ptr >= 5 && strncmp(ptr, "solid", 5) == 0)
+        stl_parse_mw_data(ptr, end, model_id, country_code);
+
+    // Roughly 250 bytes per facet.
+    const size_t num_facets_estimate = size_t(end - begin) / 250 + 1;
+    stl_resize_stored_facets(facets, num_facets_estimate);
+    const size_t report_step = std::max<size_t>(size_t(end - begin) / 5, 1);
+    size_t       next_report = 0;
+    size_t       num_facets  = 0;
+    for (;;) {
+        std::string_view keyword = token();
+        if (keyword.empty())
+            break;
+        if (keyword == "solid" || keyword == "endsolid") {
+            // name might contain spaces and it also may be empty
+            skip_line();
+            continue;
+        }
+        if (size_t(ptr - begin) >= next_report) {
+            if (stlFn) {
+                bool cb_cancel = false;
+                stlFn(int((ptr - begin) >> 10), int((end - begin) >> 10) + 1, cb_cancel, model_id, country_code);
+                if (cb_cancel)
+                    return false;
+            }
+            next_report += report_step;
+        }
+        stl_facet facet;
+        bool      normal_valid = true;
+        bool      valid        = keyword == "facet" && token() == "normal";
+        for (int i = 0; valid && i < 3; ++ i)
+            // The facet normal may contain infinities or not a numbers, it is reset to zero then.
+            normal_valid &= number(facet.normal(i));
+        valid = valid && token() == "outer" && token() == "loop";
+        for (int j = 0; valid && j < 3; ++ j)
+            valid = token() == "vertex" && number(facet.vertex[j].x()) && number(facet.vertex[j].y()) && number(facet.vertex[j].z());
+        // Some G-code generators tend to produce text after "endloop" and "endfacet". Just ignore it.
+        valid = valid && token() == "endloop";
+        skip_line();
+        valid = valid && token() == "endfacet";
+        skip_line();
+        if (! valid) {
+            BOOST_LOG_TRIVIAL(error) << "Something is syntactically very wrong with this ASCII STL! ";
+            return false;
+        }
+        if (! normal_valid)
+            facet.normal = stl_normal::Zero();
+        facet.extra[0] = facet.extra[1] = 0;
+        if (num_facets == stl_num_stored_facets(facets))
+            stl_resize_stored_facets(facets, num_facets * 2);
+        stl_store_facet(facets, num_facets ++, facet);
+    }
+    stl_resize_stored_facets(facets, num_facets);
+    return true;
+}
+
+// Memory maps an STL file, detects its type the same way stl_open() does and decodes its facets.
+template<typename Facets>
+static StlMappedResult stl_parse_mapped(const char *path, ImportstlProgressFn stlFn, int custom_header_length, Facets &facets, stl_stats *stats)
+{
+    if (custom_header_length < LABEL_SIZE)
+        custom_header_length = LABEL_SIZE;
+    boost::iostreams::mapped_file_source mapped_file;
+    try {
+        // Mapping of an empty file fails.
+        if (boost::filesystem::file_size(boost::filesystem::path(path)) > 0)
+            mapped_file.open(boost::filesystem::path(path));
+    } catch (...) {
+        BOOST_LOG_TRIVIAL(info) << "Unable to map file " << path;
+    }
+    if (! mapped_file.is_open())
+        return StlMappedResult::NotMapped;
+
+    const char  *begin       = mapped_file.data();
+    const char  *end         = begin + mapped_file.size();
+    const size_t header_size = size_t(custom_header_length) + NUM_FACET_SIZE;
+    if (mapped_file.size() < header_size + 128) {
+        BOOST_LOG_TRIVIAL(error) << "stl_parse_mapped: The input is an empty file: " << path;
+        return StlMappedResult::Failed;
+    }
+    // Check for binary or ASCII file.
+    const bool binary = std::any_of(begin + header_size, begin + header_size + 128, [](char c) { return (unsigned char)c > 127; });
+    if (stats) {
+        stats->type = binary ? ::binary : ::ascii;
+        stats->reset_header(custom_header_length);
+        size_t header_len = 0;
+        for (; header_len < size_t(custom_header_length) && (binary || begin[header_len] != '\n'); ++ header_len)
+            stats->header[header_len] = begin[header_len];
+        stats->header[header_len] = '\0';
+    }
+    if (binary) {
+        if ((mapped_file.size() - header_size) % SIZEOF_STL_FACET != 0 || mapped_file.size() < STL_MIN_FILE_SIZE) {
+            BOOST_LOG_TRIVIAL(error) << "stl_parse_mapped: The file " << path << " has the wrong size.";
+            return StlMappedResult::Failed;
+        }
+        return stl_parse_binary(begin, end, header_size, stlFn, facets) ? StlMappedResult::Success : StlMappedResult::Failed;
+    }
+    return stl_parse_ascii(begin, end, stlFn, facets) ? StlMappedResult::Success : StlMappedResult::Failed;
+}
+
+StlMappedResult stl_open_mapped(stl_file &stl, const char *path, ImportstlProgressFn stlFn, int custom_header_length)
+{
+    stl.clear();
+    if (StlMappedResult result = stl_parse_mapped(path, stlFn, custom_header_length, stl.facet_start, &stl.stats); result != StlMappedResult::Success) {
+        stl.clear();
+        return result;
+    }
+    stl_remove_nan_facets(stl.facet_start);
+
+    stl_stats &stats = stl.stats;
+    stats.number_of_facets    = uint32_t(stl.facet_start.size());
+    stats.original_num_facets = int(stats.number_of_facets);
+    if (! stl.facet_start.empty()) {
+        // The same statistics as collected by stl_facet_stats().
+        const stl_facet &first = stl.facet_start.front();
+        stats.shortest_edge = (first.vertex[1] - first.vertex[0]).cwiseAbs().maxCoeff();
+        using MinMax = std::pair<stl_vertex, stl_vertex>;
+        MinMax bbox = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, stl.facet_start.size()), MinMax(first.vertex[0], first.vertex[0]),
+            [&stl](const tbb::blocked_range<size_t> &range, MinMax bbox) {
+                for (size_t i = range.begin(); i < range.end(); ++ i)
+                    for (const stl_vertex &v : stl.facet_start[i].vertex) {
+                        bbox.first  = bbox.first.cwiseMin(v);
+                        bbox.second = bbox.second.cwiseMax(v);
+                    }
+                return bbox;
+            },
+            [](const MinMax &l, const MinMax &r) { return MinMax(l.first.cwiseMin(r.first), l.second.cwiseMax(r.second)); });
+        stats.min = bbox.first;
+        stats.max = bbox.second;
+    }
+    stats.size              = stats.max - stats.min;
+    stats.bounding_diameter = stats.size.norm();
+    stl.neighbors_start.assign(stats.number_of_facets, stl_neighbors());
+    return StlMappedResult::Success;
+}
+
+StlMappedResult its_read_stl(const char *path, indexed_triangle_set &its, ImportstlProgressFn stlFn, int custom_header_length)
+{
+    // Triangle soup, three vertices per facet.
+    std::vector<stl_vertex> vertices;
+    if (StlMappedResult result = stl_parse_mapped(path, stlFn, custom_header_length, vertices, nullptr); result != StlMappedResult::Success)
+        return result;
+    stl_remove_nan_facets(vertices);
+
+    // Merge the vertices with identical coordinates by sorting their indices, the first occurence of a vertex is kept.
+    const size_t num_vertices = vertices.size();
+    if (num_vertices >= size_t(std::numeric_limits<int>::max())) {
+        BOOST_LOG_TRIVIAL(error) << "its_read_stl: The file " << path << " has too many facets.";
+        return StlMappedResult::Failed;
+    }
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_vertices), [&vertices](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i)
+            // Negative zero is the same vertex as positive zero.
+            vertices[i] += stl_vertex::Zero();
+    });
+    std::vector<uint32_t> order(num_vertices);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_vertices), [&order](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i)
+            order[i] = uint32_t(i);
+    });
+    tbb::parallel_sort(order.begin(), order.end(), [&vertices](uint32_t l, uint32_t r) {
+        const stl_vertex &vl = vertices[l];
+        const stl_vertex &vr = vertices[r];
+        return vl.x() < vr.x() || (vl.x() == vr.x() && (vl.y() < vr.y() || (vl.y() == vr.y() && (vl.z() < vr.z() || (vl.z() == vr.z() && l < r)))));
+    });
+    // For each vertex, the first vertex with the same coordinates.
+    std::vector<uint32_t> first_same(num_vertices);
+    for (size_t i = 0; i < num_vertices; ++ i)
+        first_same[order[i]] = (i > 0 && vertices[order[i]] == vertices[order[i - 1]]) ? first_same[order[i - 1]] : order[i];
+    // Compactify the vertices in place in the order of their first occurence, reuse order as a map to the compacted vertices.
+    uint32_t num_shared = 0;
+    for (size_t i = 0; i < num_vertices; ++ i)
+        if (first_same[i] == i) {
+            vertices[num_shared] = vertices[i];
+            order[i] = num_shared ++;
+        }
+    vertices.resize(num_shared);
+    vertices.shrink_to_fit();
+
+    its.indices.assign(num_vertices / 3, stl_triangle_vertex_indices());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, its.indices.size()), [&its, &order, &first_same](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i)
+            for (int j = 0; j < 3; ++ j)
+                its.indices[i](j) = int(order[first_same[i * 3 + j]]);
+    });
+    its.vertices = std::move(vertices);
+    its.properties.clear();
+    return StlMappedResult::Success;
+}
+
 bool store_stl(const char *path, TriangleMesh *mesh, bool binary)
 {
     if (binary)
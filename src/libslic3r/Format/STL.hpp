@@ -12,6 +12,21 @@ class ModelObject;
 // Load an STL file into a provided model.
 extern bool load_stl(const char *path, Model *model, const char *object_name = nullptr, ImportstlProgressFn stlFn = nullptr, int custom_header_length = 80);
 
+enum class StlMappedResult {
+    Success,
+    // The file could not be memory mapped, the caller may fall back to stl_open().
+    NotMapped,
+    // The file is malformed or the loading was canceled by stlFn, it shall not be parsed again.
+    Failed,
+};
+
+// Read an STL file through a memory mapping into the admesh structures, as stl_open() does.
+// Binary facets are decoded by parallel chunks, ASCII numbers are parsed with fast_float. Facets with NaN vertices are dropped.
+extern StlMappedResult stl_open_mapped(stl_file &stl, const char *path, ImportstlProgressFn stlFn = nullptr, int custom_header_length = 80);
+// Read an STL file through a memory mapping straight into an indexed triangle set, without the admesh structures.
+// Vertices with identical coordinates are merged, no other repair is performed.
+extern StlMappedResult its_read_stl(const char *path, indexed_triangle_set &its, ImportstlProgressFn stlFn = nullptr, int custom_header_length = 80);
+
 extern bool store_stl(const char *path, TriangleMesh *mesh, bool binary);
 extern bool store_stl(const char *path, ModelObject *model_object, bool binary);
 extern bool store_stl(const char *path, Model *model, bool binary);
@@ -0,0 +1,457 @@
+#include "SlicedLayers.hpp"
+
+#include "../Layer.hpp"
+#include "../Print.hpp"
+
+#include <typeinfo>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/nowide/fstream.hpp>
+
+namespace Slic3r {
+
+namespace SlicedLayers {
+
+static constexpr const char MAGIC[4] = { 'O', 'S', 'L', 'B' };
+static constexpr const size_t LAYERS_HEADER_SIZE = sizeof(MAGIC) + 3 * sizeof(uint32_t) + sizeof(uint64_t);
+
+// Type tags of the ExtrusionEntities.
+enum class EntityType : uint8_t {
+    Path,
+    PathOriented,
+    MultiPath,
+    Loop,
+    Collection,
+};
+
+// The points are copied as a single block if Point is a tightly packed pair of little endian int64.
+static constexpr const bool points_packed = BOOST_ENDIAN_LITTLE_BYTE && sizeof(coord_t) == sizeof(int64_t) && sizeof(Point) == 2 * sizeof(int64_t);
+
+void Writer::write(const Points &points)
+{
+    this->write_value(uint32_t(points.size()));
+    if constexpr (points_packed) {
+        const auto *p = reinterpret_cast<const unsigned char*>(points.data());
+        m_data.insert(m_data.end(), p, p + points.size() * sizeof(Point));
+    } else {
+        for (const Point &pt : points) {
+            this->write_value(int64_t(pt.x()));
+            this->write_value(int64_t(pt.y()));
+        }
+    }
+}
+
+void Reader::read(Points &points)
+{
+    auto num_points = this->read_value<uint32_t>();
+    this->check_available(size_t(num_points) * 2 * sizeof(int64_t));
+    points.resize(num_points);
+    if constexpr (points_packed) {
+        memcpy(points.data(), m_ptr, num_points * sizeof(Point));
+        m_ptr += num_points * sizeof(Point);
+    } else {
+        for (Point &pt : points) {
+            pt.x() = coord_t(this->read_value<int64_t>());
+            pt.y() = coord_t(this->read_value<int64_t>());
+        }
+    }
+}
+
+void Writer::write(const Polyline &polyline)
+{
+    this->write(polyline.points);
+    // Arc fitting result.
+    this->write_value(uint32_t(polyline.fitting_result.size()));
+    for (const PathFittingData &fitting : polyline.fitting_result) {
+        this->write_value(uint64_t(fitting.start_point_index));
+        this->write_value(uint64_t(fitting.end_point_index));
+        this->write_value(uint8_t(fitting.path_type));
+        if (fitting.path_type == EMovePathType::Arc_move_cw || fitting.path_type == EMovePathType::Arc_move_ccw) {
+            const ArcSegment &arc = fitting.arc_data;
+            this->write(Points{ arc.center, arc.start_point, arc.end_point });
+            this->write_value(arc.radius);
+            this->write_value(uint8_t(arc.direction));
+        }
+    }
+}
+
+void Reader::read(Polyline &polyline)
+{
+    this->read(polyline.points);
+    auto num_fittings = this->read_value<uint32_t>();
+    this->check_available(num_fittings);
+    polyline.fitting_result.clear();
+    polyline.fitting_result.reserve(num_fittings);
+    for (uint32_t i = 0; i < num_fittings; ++ i) {
+        PathFittingData fitting;
+        fitting.start_point_index = size_t(this->read_value<uint64_t>());
+        fitting.end_point_index   = size_t(this->read_value<uint64_t>());
+        fitting.path_type         = EMovePathType(this->read_value<uint8_t>());
+        if (fitting.path_type >= EMovePathType::Count || fitting.start_point_index > fitting.end_point_index ||
+            fitting.end_point_index >= polyline.points.size())
+            throw_malformed();
+        if (fitting.path_type == EMovePathType::Arc_move_cw || fitting.path_type == EMovePathType::Arc_move_ccw) {
+            Points arc_points;
+            this->read(arc_points);
+            if (arc_points.size() != 3)
+                throw_malformed();
+            auto radius    = this->read_value<double>();
+            auto direction = ArcDirection(this->read_value<uint8_t>());
+            if (direction >= ArcDirection::Count)
+                throw_malformed();
+            fitting.arc_data = ArcSegment(arc_points[0], radius, arc_points[1], arc_points[2], direction);
+        }
+        polyline.fitting_result.emplace_back(fitting);
+    }
+}
+
+void Writer::write(const ExPolygon &expolygon)
+{
+    this->write(expolygon.contour);
+    this->write_value(uint32_t(expolygon.holes.size()));
+    for (const Polygon &hole : expolygon.holes)
+        this->write(hole);
+}
+
+void Reader::read(ExPolygon &expolygon)
+{
+    this->read(expolygon.contour);
+    auto num_holes = this->read_value<uint32_t>();
+    this->check_available(size_t(num_holes) * sizeof(uint32_t));
+    expolygon.holes.assign(num_holes, Polygon());
+    for (Polygon &hole : expolygon.holes)
+        this->read(hole);
+}
+
+void Writer::write(const ExPolygons &expolygons)
+{
+    this->write_value(uint32_t(expolygons.size()));
+    for (const ExPolygon &expolygon : expolygons)
+        this->write(expolygon);
+}
+
+void Reader::read(ExPolygons &expolygons)
+{
+    auto num_expolygons = this->read_value<uint32_t>();
+    // Each ExPolygon takes at least 8 bytes, don't allocate more than the data could possibly hold.
+    this->check_available(size_t(num_expolygons) * 2 * sizeof(uint32_t));
+    expolygons.assign(num_expolygons, ExPolygon());
+    for (ExPolygon &expolygon : expolygons)
+        this->read(expolygon);
+}
+
+void Writer::write(const SurfaceCollection &surfaces)
+{
+    this->write_value(uint32_t(surfaces.surfaces.size()));
+    for (const Surface &surface : surfaces.surfaces) {
+        this->write_value(uint8_t(surface.surface_type));
+        this->write_value(surface.thickness);
+        this->write_value(uint16_t(surface.thickness_layers));
+        this->write_value(surface.bridge_angle);
+        this->write_value(uint16_t(surface.extra_perimeters));
+        this->write(surface.expolygon);
+    }
+}
+
+void Reader::read(SurfaceCollection &surfaces)
+{
+    auto num_surfaces = this->read_value<uint32_t>();
+    this->check_available(num_surfaces);
+    surfaces.surfaces.clear();
+    surfaces.surfaces.reserve(num_surfaces);
+    for (uint32_t i = 0; i < num_surfaces; ++ i) {
+        auto surface_type = this->read_value<uint8_t>();
+        if (surface_type >= stCount)
+            throw_malformed();
+        Surface &surface = surfaces.surfaces.emplace_back(SurfaceType(surface_type));
+        surface.thickness        = this->read_value<double>();
+        surface.thickness_layers = this->read_value<uint16_t>();
+        surface.bridge_angle     = this->read_value<double>();
+        surface.extra_perimeters = this->read_value<uint16_t>();
+        this->read(surface.expolygon);
+    }
+}
+
+void Writer::write(const ExtrusionPath &path)
+{
+    this->write_value(uint8_t(path.role()));
+    this->write_value(uint8_t((path.can_reverse() ? 1 : 0) | (path.is_force_no_extrusion() ? 2 : 0)));
+    this->write_value(path.mm3_per_mm);
+    this->write_value(path.width);
+    this->write_value(path.height);
+    this->write_value(path.overhang_degree);
+    this->write_value(int32_t(path.curve_degree));
+    this->write_value(int32_t(path.inset_idx));
+    this->write(path.polyline);
+}
+
+void Reader::read(ExtrusionPath &path)
+{
+    auto role = this->read_value<uint8_t>();
+    if (role >= erCount)
+        throw_malformed();
+    path.set_extrusion_role(ExtrusionRole(role));
+    auto flags = this->read_value<uint8_t>();
+    if ((flags & 1) == 0)
+        path.set_reverse();
+    path.set_force_no_extrusion((flags & 2) != 0);
+    path.mm3_per_mm      = this->read_value<double>();
+    path.width           = this->read_value<float>();
+    path.height          = this->read_value<float>();
+    path.overhang_degree = this->read_value<double>();
+    path.curve_degree    = this->read_value<int32_t>();
+    path.inset_idx       = this->read_value<int32_t>();
+    this->read(path.polyline);
+}
+
+void Writer::write(const ExtrusionEntity &entity)
+{
+    // Only the entity types stored into the layers are supported. Compare the exact types, as for example
+    // ExtrusionLoopSloped derived from ExtrusionLoop carries data, which would be lost.
+    const std::type_info &type = typeid(entity);
+    if (type == typeid(ExtrusionEntityCollection)) {
+        this->write_value(EntityType::Collection);
+        this->write(static_cast<const ExtrusionEntityCollection&>(entity));
+    } else if (type == typeid(ExtrusionPath)) {
+        this->write_value(EntityType::Path);
+        this->write(static_cast<const ExtrusionPath&>(entity));
+    } else if (type == typeid(ExtrusionPathOriented)) {
+        this->write_value(EntityType::PathOriented);
+        this->write(static_cast<const ExtrusionPath&>(entity));
+    } else if (type == typeid(ExtrusionMultiPath)) {
+        const auto &multipath = static_cast<const ExtrusionMultiPath&>(entity);
+        this->write_value(EntityType::MultiPath);
+        this->write_value(uint8_t(multipath.can_reverse()));
+        this->write_value(int32_t(multipath.inset_idx));
+        this->write_value(uint32_t(multipath.paths.size()));
+        for (const ExtrusionPath &path : multipath.paths)
+            this->write(path);
+    } else if (type == typeid(ExtrusionLoop)) {
+        const auto &loop = static_cast<const ExtrusionLoop&>(entity);
+        this->write_value(EntityType::Loop);
+        this->write_value(uint8_t(loop.loop_role()));
+        this->write_value(int32_t(loop.inset_idx));
+        this->write_value(uint32_t(loop.paths.size()));
+        for (const ExtrusionPath &path : loop.paths)
+            this->write(path);
+    } else
+        throw Slic3r::InvalidArgument(std::string("Cannot serialize extrusion entity of type ") + type.name());
+}
+
+ExtrusionEntity* Reader::read_entity()
+{
+    switch (this->read_value<EntityType>()) {
+    case EntityType::Path: {
+        auto path = std::make_unique<ExtrusionPath>();
+        this->read(*path);
+        return path.release();
+    }
+    case EntityType::PathOriented: {
+        auto path = std::make_unique<ExtrusionPathOriented>(erNone, -1, -1.f, -1.f);
+        this->read(*path);
+        return path.release();
+    }
+    case EntityType::MultiPath: {
+        auto multipath = std::make_unique<ExtrusionMultiPath>();
+        if (this->read_value<uint8_t>() == 0)
+            multipath->set_reverse();
+        multipath->inset_idx = this->read_value<int32_t>();
+        auto num_paths = this->read_value<uint32_t>();
+        this->check_available(num_paths);
+        multipath->paths.assign(num_paths, ExtrusionPath());
+        for (ExtrusionPath &path : multipath->paths)
+            this->read(path);
+        return multipath.release();
+    }
+    case EntityType::Loop: {
+        // ExtrusionLoopRole is a set of flags.
+        auto loop_role = this->read_value<uint8_t>();
+        if ((loop_role & ~(elrHole | elrInternal | elrSkirt)) != 0)
+            throw_malformed();
+        auto loop = std::make_unique<ExtrusionLoop>(ExtrusionLoopRole(loop_role));
+        loop->inset_idx = this->read_value<int32_t>();
+        auto num_paths = this->read_value<uint32_t>();
+        this->check_available(num_paths);
+        loop->paths.assign(num_paths, ExtrusionPath());
+        for (ExtrusionPath &path : loop->paths)
+            this->read(path);
+        return loop.release();
+    }
+    case EntityType::Collection: {
+        auto collection = std::make_unique<ExtrusionEntityCollection>();
+        this->read(*collection);
+        return collection.release();
+    }
+    default:
+        throw_malformed();
+    }
+}
+
+void Writer::write(const ExtrusionEntityCollection &collection)
+{
+    // The reversibility flag of a collection is only observable if the collection may be sorted.
+    this->write_value(uint8_t((collection.no_sort ? 1 : 0) | (collection.can_reverse() ? 2 : 0)));
+    this->write_value(int32_t(collection.inset_idx));
+    this->write_value(uint32_t(collection.entities.size()));
+    for (const ExtrusionEntity *entity : collection.entities)
+        this->write(*entity);
+}
+
+void Reader::read(ExtrusionEntityCollection &collection)
+{
+    collection.clear();
+    auto flags = this->read_value<uint8_t>();
+    collection.no_sort = (flags & 1) != 0;
+    if (! collection.no_sort && (flags & 2) == 0)
+        collection.set_reverse();
+    collection.inset_idx = this->read_value<int32_t>();
+    auto num_entities    = this->read_value<uint32_t>();
+    // Each entity takes at least its type tag.
+    this->check_available(num_entities);
+    collection.entities.reserve(num_entities);
+    for (uint32_t i = 0; i < num_entities; ++ i)
+        collection.entities.emplace_back(this->read_entity());
+}
+
+std::vector<unsigned char> serialize(const PrintObject &print_object)
+{
+    auto layers         = print_object.layers();
+    auto support_layers = print_object.support_layers();
+
+    Writer writer;
+    for (char c : MAGIC)
+        writer.write_value(c);
+    writer.write_value(VERSION);
+    writer.write_value(uint32_t(layers.size()));
+    writer.write_value(uint32_t(support_layers.size()));
+    // Placeholder of the layer table offset.
+    writer.write_value(uint64_t(0));
+    assert(writer.size() == LAYERS_HEADER_SIZE);
+
+    std::vector<uint64_t> offsets;
+    offsets.reserve(layers.size() + support_layers.size());
+    for (const Layer *layer : layers) {
+        offsets.emplace_back(writer.size());
+        writer.write_value(double(layer->print_z));
+        writer.write_value(double(layer->slice_z));
+        writer.write_value(double(layer->height));
+        writer.write(layer->lslices);
+        writer.write_value(uint32_t(layer->region_count()));
+        for (const LayerRegion *layerm : layer->regions()) {
+            writer.write(layerm->slices);
+            writer.write(layerm->fill_surfaces);
+            writer.write(layerm->perimeters);
+            writer.write(layerm->thin_fills);
+            writer.write(layerm->fills);
+        }
+    }
+    for (const SupportLayer *layer : support_layers) {
+        offsets.emplace_back(writer.size());
+        writer.write_value(double(layer->print_z));
+        writer.write_value(double(layer->height));
+        writer.write(layer->lslices);
+        writer.write(layer->support_fills);
+    }
+
+    const uint64_t layer_table_offset = little_endian(uint64_t(writer.size()));
+    for (uint64_t offset : offsets)
+        writer.write_value(offset);
+    memcpy(writer.data().data() + LAYERS_HEADER_SIZE - sizeof(uint64_t), &layer_table_offset, sizeof(uint64_t));
+    return std::move(writer.data());
+}
+
+void store(const PrintObject &print_object, const std::string &path)
+{
+    std::vector<unsigned char> data = serialize(print_object);
+    boost::nowide::ofstream ofs(path, std::ios::binary);
+    ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (! ofs)
+        throw Slic3r::FileIOError(std::string("Failed to write sliced layers to ") + path);
+}
+
+struct LayersReader::MappedFile
+{
+    boost::iostreams::mapped_file_source file;
+};
+
+LayersReader::LayersReader(const unsigned char *data, size_t size)
+{
+    this->open(data, size);
+}
+
+LayersReader::LayersReader(const std::string &path) : m_mapped_file(std::make_unique<MappedFile>())
+{
+    try {
+        m_mapped_file->file.open(boost::filesystem::path(path));
+    } catch (const std::exception &ex) {
+        throw Slic3r::FileIOError(std::string("Failed to open sliced layers file ") + path + ": " + ex.what());
+    }
+    this->open(reinterpret_cast<const unsigned char*>(m_mapped_file->file.data()), m_mapped_file->file.size());
+}
+
+LayersReader::~LayersReader() = default;
+
+void LayersReader::open(const unsigned char *data, size_t size)
+{
+    if (size < LAYERS_HEADER_SIZE || memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+        throw Slic3r::FileIOError("Not a sliced layers file");
+    Reader reader(data, data + size);
+    reader.seek(sizeof(MAGIC));
+    if (reader.read_value<uint32_t>() != VERSION)
+        throw Slic3r::FileIOError("Unsupported version of the sliced layers file");
+    m_num_layers         = reader.read_value<uint32_t>();
+    m_num_support_layers = reader.read_value<uint32_t>();
+    m_layer_table_offset = size_t(reader.read_value<uint64_t>());
+    if (m_layer_table_offset > size || (size - m_layer_table_offset) / sizeof(uint64_t) < m_num_layers + m_num_support_layers)
+        throw Slic3r::FileIOError("Malformed sliced layers data");
+    m_data = data;
+    m_size = size;
+}
+
+size_t LayersReader::record_offset(size_t idx) const
+{
+    uint64_t offset;
+    memcpy(&offset, m_data + m_layer_table_offset + idx * sizeof(uint64_t), sizeof(uint64_t));
+    return size_t(little_endian(offset));
+}
+
+LayerData LayersReader::layer(size_t idx) const
+{
+    assert(idx < m_num_layers);
+    Reader reader(m_data, m_data + m_layer_table_offset);
+    reader.seek(this->record_offset(idx));
+    LayerData out;
+    out.print_z = reader.read_value<double>();
+    out.slice_z = reader.read_value<double>();
+    out.height  = reader.read_value<double>();
+    reader.read(out.lslices);
+    auto num_regions = reader.read_value<uint32_t>();
+    reader.check_available(num_regions);
+    out.regions.resize(num_regions);
+    for (RegionData &region : out.regions) {
+        reader.read(region.slices);
+        reader.read(region.fill_surfaces);
+        reader.read(region.perimeters);
+        reader.read(region.thin_fills);
+        reader.read(region.fills);
+    }
+    return out;
+}
+
+SupportLayerData LayersReader::support_layer(size_t idx) const
+{
+    assert(idx < m_num_support_layers);
+    Reader reader(m_data, m_data + m_layer_table_offset);
+    reader.seek(this->record_offset(m_num_layers + idx));
+    SupportLayerData out;
+    out.print_z = reader.read_value<double>();
+    out.height  = reader.read_value<double>();
+    reader.read(out.lslices);
+    reader.read(out.support_fills);
+    return out;
+}
+
+} // namespace SlicedLayers
+
+} // namespace Slic3r
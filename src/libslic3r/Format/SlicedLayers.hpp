@@ -0,0 +1,180 @@
+#ifndef slic3r_Format_SlicedLayers_hpp_
+#define slic3r_Format_SlicedLayers_hpp_
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <boost/predef/other/endian.h>
+
+#include "../Exception.hpp"
+#include "../ExPolygon.hpp"
+#include "../ExtrusionEntityCollection.hpp"
+#include "../SurfaceCollection.hpp"
+
+namespace Slic3r {
+
+class PrintObject;
+
+// Compact versioned binary format of the layers of a PrintObject: the slices, the typed region slices and fill surfaces
+// and the perimeter, gap fill and infill extrusions of the object layers, and the support extrusions of the support layers.
+//
+// File layout:
+//   Header    { char magic[4]; uint32 version; uint32 num_layers; uint32 num_support_layers; uint64 layer_table_offset; }
+//   Records   one record per layer, then one record per support layer
+//   Table     (num_layers + num_support_layers) x uint64 offsets of the layer records from the start of the file
+// All values are stored little endian, they are byte swapped on big endian hosts. Coordinates are stored as int64 independently of the size of coord_t.
+// Point arrays are stored contiguously, thus a loaded polyline is a single copy out of the file buffer.
+// A reader opened on a file memory maps the file and decodes just the layers requested through the offset table.
+namespace SlicedLayers {
+
+static constexpr const uint32_t VERSION = 1;
+
+// Convert a value between the native byte order and the little endian byte order of the data, the conversion is its own inverse.
+template<typename T>
+inline T little_endian(T value)
+{
+#if BOOST_ENDIAN_BIG_BYTE
+    auto *p = reinterpret_cast<unsigned char*>(&value);
+    std::reverse(p, p + sizeof(T));
+#endif // BOOST_ENDIAN_BIG_BYTE
+    return value;
+}
+
+// Decoded LayerRegion.
+struct RegionData
+{
+    SurfaceCollection           slices;
+    SurfaceCollection           fill_surfaces;
+    ExtrusionEntityCollection   perimeters;
+    ExtrusionEntityCollection   thin_fills;
+    ExtrusionEntityCollection   fills;
+};
+
+// Decoded Layer.
+struct LayerData
+{
+    coordf_t                    print_z { 0 };
+    coordf_t                    slice_z { 0 };
+    coordf_t                    height  { 0 };
+    ExPolygons                  lslices;
+    std::vector<RegionData>     regions;
+};
+
+// Decoded SupportLayer.
+struct SupportLayerData
+{
+    coordf_t                    print_z { 0 };
+    coordf_t                    height  { 0 };
+    ExPolygons                  lslices;
+    ExtrusionEntityCollection   support_fills;
+};
+
+// Low level encoder of the geometric primitives, shared with the SlicingCache.
+class Writer
+{
+public:
+    template<typename T>
+    void write_value(const T value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types may be written");
+        const T     le = little_endian(value);
+        const auto *p  = reinterpret_cast<const unsigned char*>(&le);
+        m_data.insert(m_data.end(), p, p + sizeof(T));
+    }
+    void write(const Points &points);
+    void write(const Polygon &polygon) { this->write(polygon.points); }
+    void write(const Polyline &polyline);
+    void write(const ExPolygon &expolygon);
+    void write(const ExPolygons &expolygons);
+    void write(const SurfaceCollection &surfaces);
+    void write(const ExtrusionPath &path);
+    void write(const ExtrusionEntity &entity);
+    void write(const ExtrusionEntityCollection &collection);
+
+    size_t                              size() const { return m_data.size(); }
+    const std::vector<unsigned char>&   data() const { return m_data; }
+    std::vector<unsigned char>&         data() { return m_data; }
+
+private:
+    std::vector<unsigned char>          m_data;
+};
+
+// Low level decoder of the geometric primitives. Throws Slic3r::FileIOError on malformed data.
+class Reader
+{
+public:
+    Reader(const unsigned char *begin, const unsigned char *end) : m_begin(begin), m_ptr(begin), m_end(end) {}
+
+    template<typename T>
+    T read_value() {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types may be read");
+        this->check_available(sizeof(T));
+        T value;
+        memcpy(&value, m_ptr, sizeof(T));
+        m_ptr += sizeof(T);
+        return little_endian(value);
+    }
+    void read(Points &points);
+    void read(Polygon &polygon) { this->read(polygon.points); }
+    void read(Polyline &polyline);
+    void read(ExPolygon &expolygon);
+    void read(ExPolygons &expolygons);
+    void read(SurfaceCollection &surfaces);
+    void read(ExtrusionPath &path);
+    ExtrusionEntity* read_entity();
+    void read(ExtrusionEntityCollection &collection);
+
+    void   seek(size_t offset) { if (offset > size_t(m_end - m_begin)) throw_malformed(); m_ptr = m_begin + offset; }
+    bool   at_end() const { return m_ptr == m_end; }
+    // Verify that at least n bytes remain, to reject element counts of malformed data before allocating memory for them.
+    void   check_available(size_t n) const { if (size_t(m_end - m_ptr) < n) throw_malformed(); }
+
+private:
+    [[noreturn]] static void throw_malformed() { throw Slic3r::FileIOError("Malformed sliced layers data"); }
+
+    const unsigned char *m_begin;
+    const unsigned char *m_ptr;
+    const unsigned char *m_end;
+};
+
+// Serialize layers and support layers of a sliced PrintObject.
+std::vector<unsigned char> serialize(const PrintObject &print_object);
+// Throws Slic3r::FileIOError if the file could not be written.
+void store(const PrintObject &print_object, const std::string &path);
+
+// Random access to the layers stored in a buffer or in a memory mapped file.
+class LayersReader
+{
+public:
+    // The buffer has to outlive the reader.
+    LayersReader(const unsigned char *data, size_t size);
+    // Memory map a file.
+    explicit LayersReader(const std::string &path);
+    ~LayersReader();
+
+    size_t              num_layers() const { return m_num_layers; }
+    size_t              num_support_layers() const { return m_num_support_layers; }
+    LayerData           layer(size_t idx) const;
+    SupportLayerData    support_layer(size_t idx) const;
+
+private:
+    void                open(const unsigned char *data, size_t size);
+    size_t              record_offset(size_t idx) const;
+
+    struct MappedFile;
+    std::unique_ptr<MappedFile> m_mapped_file;
+    const unsigned char        *m_data { nullptr };
+    size_t                      m_size { 0 };
+    size_t                      m_num_layers { 0 };
+    size_t                      m_num_support_layers { 0 };
+    size_t                      m_layer_table_offset { 0 };
+};
+
+} // namespace SlicedLayers
+
+} // namespace Slic3r
+
+#endif // slic3r_Format_SlicedLayers_hpp_
@@ -14,6 +14,7 @@
 
 #include "bbs_3mf.hpp"
 
+#include <charconv>
 #include <limits>
 #include <stdexcept>
 #include <iomanip>
@@ -1125,6 +1126,11 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         bool _handle_start_triangle(const char** attributes, unsigned int num_attributes);
         bool _handle_end_triangle();
 
+        // Fast path for the vertex and triangle elements, which make up the bulk of the model files:
+        // the attributes are scanned once instead of being looked up one by one.
+        static void _append_vertex(Geometry& geometry, float unit_factor, const char** attributes, unsigned int num_attributes);
+        static void _append_triangle(Geometry& geometry, const char** attributes, unsigned int num_attributes);
+
         bool _handle_start_components(const char** attributes, unsigned int num_attributes);
         bool _handle_end_components();
 
@@ -1643,19 +1649,28 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
                 m_sub_model_path.clear();
             }
 #else
+            // Uncompressed sizes of the sub models, the largest ones are scheduled first so that a single huge object
+            // does not end up being parsed last while the other workers are idle.
+            std::vector<std::pair<mz_uint64, size_t>> object_sizes;
             for (auto path : m_sub_model_paths) {
                 ObjectImporter *object_importer = new ObjectImporter(this, filename, path);
+                std::string entry_path = (! path.empty() && path.front() == '/') ? path.substr(1) : path;
+                int         entry_index = mz_zip_reader_locate_file(&archive, entry_path.c_str(), nullptr, 0);
+                mz_zip_archive_file_stat entry_stat;
+                object_sizes.emplace_back((entry_index >= 0 && mz_zip_reader_file_stat(&archive, mz_uint(entry_index), &entry_stat)) ? entry_stat.m_uncomp_size : 0,
+                    m_object_importers.size());
                 m_object_importers.push_back(object_importer);
             }
+            std::stable_sort(object_sizes.begin(), object_sizes.end(), [](const auto &l, const auto &r) { return l.first > r.first; });
 
             bool object_load_result = true;
             boost::mutex mutex;
             tbb::parallel_for(
-                tbb::blocked_range<size_t>(0, m_object_importers.size()),
-                [this, &mutex, &object_load_result](const tbb::blocked_range<size_t>& importer_range) {
+                tbb::blocked_range<size_t>(0, m_object_importers.size(), 1),
+                [this, &mutex, &object_load_result, &object_sizes](const tbb::blocked_range<size_t>& importer_range) {
                     CNumericLocalesSetter locales_setter;
-                    for (size_t object_index = importer_range.begin(); object_index < importer_range.end(); ++ object_index) {
-                        bool result = m_object_importers[object_index]->extract_object_model();
+                    for (size_t i = importer_range.begin(); i < importer_range.end(); ++ i) {
+                        bool result = m_object_importers[object_sizes[i].second]->extract_object_model();
                         {
                             boost::unique_lock l(mutex);
                             object_load_result &= result;
@@ -1671,8 +1686,8 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
             //merge these objects into one
             for (auto obj_importer : m_object_importers) {
-                for (const IdToCurrentObjectMap::value_type&  obj : obj_importer->object_list)
-                    m_current_objects.insert({ std::move(obj.first), std::move(obj.second)});
+                for (IdToCurrentObjectMap::value_type &obj : obj_importer->object_list)
+                    m_current_objects.insert({ obj.first, std::move(obj.second) });
                 for (auto group_color : obj_importer->object_group_id_to_color)
                     m_group_id_to_color.insert(std::move(group_color));
 
@@ -3134,7 +3149,12 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         bool res = true;
         unsigned int num_attributes = (unsigned int)XML_GetSpecifiedAttributeCount(m_xml_parser);
 
-        if (::strcmp(MODEL_TAG, name) == 0)
+        // vertex and triangle make up the bulk of the elements, test them first
+        if (::strcmp(VERTEX_TAG, name) == 0)
+            res = _handle_start_vertex(attributes, num_attributes);
+        else if (::strcmp(TRIANGLE_TAG, name) == 0)
+            res = _handle_start_triangle(attributes, num_attributes);
+        else if (::strcmp(MODEL_TAG, name) == 0)
             res = _handle_start_model(attributes, num_attributes);
         else if (::strcmp(RESOURCES_TAG, name) == 0)
             res = _handle_start_resources(attributes, num_attributes);
@@ -3148,12 +3168,8 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
             res = _handle_start_mesh(attributes, num_attributes);
         else if (::strcmp(VERTICES_TAG, name) == 0)
             res = _handle_start_vertices(attributes, num_attributes);
-        else if (::strcmp(VERTEX_TAG, name) == 0)
-            res = _handle_start_vertex(attributes, num_attributes);
         else if (::strcmp(TRIANGLES_TAG, name) == 0)
             res = _handle_start_triangles(attributes, num_attributes);
-        else if (::strcmp(TRIANGLE_TAG, name) == 0)
-            res = _handle_start_triangle(attributes, num_attributes);
         else if (::strcmp(COMPONENTS_TAG, name) == 0)
             res = _handle_start_components(attributes, num_attributes);
         else if (::strcmp(COMPONENT_TAG, name) == 0)
@@ -3176,7 +3192,11 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         bool res = true;
 
-        if (::strcmp(MODEL_TAG, name) == 0)
+        if (::strcmp(VERTEX_TAG, name) == 0)
+            res = _handle_end_vertex();
+        else if (::strcmp(TRIANGLE_TAG, name) == 0)
+            res = _handle_end_triangle();
+        else if (::strcmp(MODEL_TAG, name) == 0)
             res = _handle_end_model();
         else if (::strcmp(RESOURCES_TAG, name) == 0)
             res = _handle_end_resources();
@@ -3190,12 +3210,8 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
             res = _handle_end_mesh();
         else if (::strcmp(VERTICES_TAG, name) == 0)
             res = _handle_end_vertices();
-        else if (::strcmp(VERTEX_TAG, name) == 0)
-            res = _handle_end_vertex();
         else if (::strcmp(TRIANGLES_TAG, name) == 0)
             res = _handle_end_triangles();
-        else if (::strcmp(TRIANGLE_TAG, name) == 0)
-            res = _handle_end_triangle();
         else if (::strcmp(COMPONENTS_TAG, name) == 0)
             res = _handle_end_components();
         else if (::strcmp(COMPONENT_TAG, name) == 0)
@@ -3553,10 +3569,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         // appends the vertex coordinates
         // missing values are set equal to ZERO
         if (m_curr_object)
-            m_curr_object->geometry.vertices.emplace_back(
-                m_unit_factor * bbs_get_attribute_value_float(attributes, num_attributes, X_ATTR),
-                m_unit_factor * bbs_get_attribute_value_float(attributes, num_attributes, Y_ATTR),
-                m_unit_factor * bbs_get_attribute_value_float(attributes, num_attributes, Z_ATTR));
+            _append_vertex(m_curr_object->geometry, m_unit_factor, attributes, num_attributes);
         return true;
     }
 
@@ -3591,18 +3604,8 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         // appends the triangle's vertices indices
         // missing values are set equal to ZERO
-        if (m_curr_object) {
-            m_curr_object->geometry.triangles.emplace_back(
-                bbs_get_attribute_value_int(attributes, num_attributes, V1_ATTR),
-                bbs_get_attribute_value_int(attributes, num_attributes, V2_ATTR),
-                bbs_get_attribute_value_int(attributes, num_attributes, V3_ATTR));
-
-            m_curr_object->geometry.custom_supports.push_back(bbs_get_attribute_value_string(attributes, num_attributes, CUSTOM_SUPPORTS_ATTR));
-            m_curr_object->geometry.custom_seam.push_back(bbs_get_attribute_value_string(attributes, num_attributes, CUSTOM_SEAM_ATTR));
-            m_curr_object->geometry.mmu_segmentation.push_back(bbs_get_attribute_value_string(attributes, num_attributes, MMU_SEGMENTATION_ATTR));
-            // BBS
-            m_curr_object->geometry.face_properties.push_back(bbs_get_attribute_value_string(attributes, num_attributes, FACE_PROPERTY_ATTR));
-        }
+        if (m_curr_object)
+            _append_triangle(m_curr_object->geometry, attributes, num_attributes);
         return true;
     }
 
@@ -3612,6 +3615,51 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         return true;
     }
 
+    void _BBS_3MF_Importer::_append_vertex(Geometry& geometry, float unit_factor, const char** attributes, unsigned int num_attributes)
+    {
+        // missing values are set equal to ZERO
+        Vec3f vertex = Vec3f::Zero();
+        if (num_attributes % 2 == 0)
+            for (unsigned int a = 0; a < num_attributes; a += 2) {
+                // X_ATTR, Y_ATTR, Z_ATTR
+                const char *key = attributes[a];
+                if (key[0] >= 'x' && key[0] <= 'z' && key[1] == 0) {
+                    const char *text = attributes[a + 1];
+                    fast_float::from_chars(text, text + strlen(text), vertex[key[0] - 'x']);
+                }
+            }
+        geometry.vertices.emplace_back(unit_factor * vertex);
+    }
+
+    void _BBS_3MF_Importer::_append_triangle(Geometry& geometry, const char** attributes, unsigned int num_attributes)
+    {
+        // missing values are set equal to ZERO
+        Vec3i32 triangle = Vec3i32::Zero();
+        std::string custom_supports, custom_seam, mmu_segmentation, face_property;
+        if (num_attributes % 2 == 0)
+            for (unsigned int a = 0; a < num_attributes; a += 2) {
+                const char *key  = attributes[a];
+                const char *text = attributes[a + 1];
+                if (key[0] == 'v' && key[1] >= '1' && key[1] <= '3' && key[2] == 0)
+                    // V1_ATTR, V2_ATTR, V3_ATTR
+                    boost::spirit::qi::parse(text, text + strlen(text), boost::spirit::qi::int_, triangle[key[1] - '1']);
+                else if (::strcmp(key, CUSTOM_SUPPORTS_ATTR) == 0)
+                    custom_supports = text;
+                else if (::strcmp(key, CUSTOM_SEAM_ATTR) == 0)
+                    custom_seam = text;
+                else if (::strcmp(key, MMU_SEGMENTATION_ATTR) == 0)
+                    mmu_segmentation = text;
+                else if (::strcmp(key, FACE_PROPERTY_ATTR) == 0)
+                    face_property = text;
+            }
+        geometry.triangles.emplace_back(triangle);
+        geometry.custom_supports.emplace_back(std::move(custom_supports));
+        geometry.custom_seam.emplace_back(std::move(custom_seam));
+        geometry.mmu_segmentation.emplace_back(std::move(mmu_segmentation));
+        // BBS
+        geometry.face_properties.emplace_back(std::move(face_property));
+    }
+
     bool _BBS_3MF_Importer::_handle_start_components(const char** attributes, unsigned int num_attributes)
     {
         // reset current components
@@ -5188,10 +5236,7 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         // appends the vertex coordinates
         // missing values are set equal to ZERO
         if (current_object)
-            current_object->geometry.vertices.emplace_back(
-                object_unit_factor * bbs_get_attribute_value_float(attributes, num_attributes, X_ATTR),
-                object_unit_factor * bbs_get_attribute_value_float(attributes, num_attributes, Y_ATTR),
-                object_unit_factor * bbs_get_attribute_value_float(attributes, num_attributes, Z_ATTR));
+            _append_vertex(current_object->geometry, object_unit_factor, attributes, num_attributes);
         return true;
     }
 
@@ -5226,18 +5271,8 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         // appends the triangle's vertices indices
         // missing values are set equal to ZERO
-        if (current_object) {
-            current_object->geometry.triangles.emplace_back(
-                bbs_get_attribute_value_int(attributes, num_attributes, V1_ATTR),
-                bbs_get_attribute_value_int(attributes, num_attributes, V2_ATTR),
-                bbs_get_attribute_value_int(attributes, num_attributes, V3_ATTR));
-
-            current_object->geometry.custom_supports.push_back(bbs_get_attribute_value_string(attributes, num_attributes, CUSTOM_SUPPORTS_ATTR));
-            current_object->geometry.custom_seam.push_back(bbs_get_attribute_value_string(attributes, num_attributes, CUSTOM_SEAM_ATTR));
-            current_object->geometry.mmu_segmentation.push_back(bbs_get_attribute_value_string(attributes, num_attributes, MMU_SEGMENTATION_ATTR));
-            // BBS
-            current_object->geometry.face_properties.push_back(bbs_get_attribute_value_string(attributes, num_attributes, FACE_PROPERTY_ATTR));
-        }
+        if (current_object)
+            _append_triangle(current_object->geometry, attributes, num_attributes);
         return true;
     }
 
@@ -5317,7 +5352,12 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         bool res = true;
         unsigned int num_attributes = (unsigned int)XML_GetSpecifiedAttributeCount(object_xml_parser);
 
-        if (::strcmp(MODEL_TAG, name) == 0)
+        // vertex and triangle make up the bulk of the elements, test them first
+        if (::strcmp(VERTEX_TAG, name) == 0)
+            res = _handle_object_start_vertex(attributes, num_attributes);
+        else if (::strcmp(TRIANGLE_TAG, name) == 0)
+            res = _handle_object_start_triangle(attributes, num_attributes);
+        else if (::strcmp(MODEL_TAG, name) == 0)
             res = _handle_object_start_model(attributes, num_attributes);
         else if (::strcmp(RESOURCES_TAG, name) == 0)
             res = _handle_object_start_resources(attributes, num_attributes);
@@ -5331,12 +5371,8 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
             res = _handle_object_start_mesh(attributes, num_attributes);
         else if (::strcmp(VERTICES_TAG, name) == 0)
             res = _handle_object_start_vertices(attributes, num_attributes);
-        else if (::strcmp(VERTEX_TAG, name) == 0)
-            res = _handle_object_start_vertex(attributes, num_attributes);
         else if (::strcmp(TRIANGLES_TAG, name) == 0)
             res = _handle_object_start_triangles(attributes, num_attributes);
-        else if (::strcmp(TRIANGLE_TAG, name) == 0)
-            res = _handle_object_start_triangle(attributes, num_attributes);
         else if (::strcmp(COMPONENTS_TAG, name) == 0)
             res = _handle_object_start_components(attributes, num_attributes);
         else if (::strcmp(COMPONENT_TAG, name) == 0)
@@ -5355,7 +5391,11 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
 
         bool res = true;
 
-        if (::strcmp(MODEL_TAG, name) == 0)
+        if (::strcmp(VERTEX_TAG, name) == 0)
+            res = _handle_object_end_vertex();
+        else if (::strcmp(TRIANGLE_TAG, name) == 0)
+            res = _handle_object_end_triangle();
+        else if (::strcmp(MODEL_TAG, name) == 0)
             res = _handle_object_end_model();
         else if (::strcmp(RESOURCES_TAG, name) == 0)
             res = _handle_object_end_resources();
@@ -5369,12 +5409,8 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
             res = _handle_object_end_mesh();
         else if (::strcmp(VERTICES_TAG, name) == 0)
             res = _handle_object_end_vertices();
-        else if (::strcmp(VERTEX_TAG, name) == 0)
-            res = _handle_object_end_vertex();
         else if (::strcmp(TRIANGLES_TAG, name) == 0)
             res = _handle_object_end_triangles();
-        else if (::strcmp(TRIANGLE_TAG, name) == 0)
-            res = _handle_object_end_triangle();
         else if (::strcmp(COMPONENTS_TAG, name) == 0)
             res = _handle_object_end_components();
         else if (::strcmp(COMPONENT_TAG, name) == 0)
@@ -6419,6 +6455,40 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         stream << std::setprecision(std::numeric_limits<float>::max_digits10);
     }
 
+    // Finalizes an in-memory archive filled by a worker thread, returns its buffer to be merged into the 3mf by add_heap_archives().
+    static std::pair<void*, size_t> finalize_heap_archive(mz_zip_archive &archive)
+    {
+        std::pair<void*, size_t> out { nullptr, 0 };
+        if (! mz_zip_writer_finalize_heap_archive(&archive, &out.first, &out.second))
+            out = { nullptr, 0 };
+        mz_zip_writer_end(&archive);
+        return out;
+    }
+
+    // Copies the entries of the in-memory archives into the 3mf in the order of heap_archives, so that the layout of the 3mf
+    // does not depend on the order the worker threads finished in, and releases the buffers.
+    static bool add_heap_archives(mz_zip_archive &archive, std::vector<std::pair<void*, size_t>> &heap_archives)
+    {
+        bool result = true;
+        for (std::pair<void*, size_t> &heap_archive : heap_archives) {
+            if (heap_archive.first == nullptr) {
+                result = false;
+                continue;
+            }
+            mz_zip_archive reader;
+            mz_zip_zero_struct(&reader);
+            if (mz_zip_reader_init_mem(&reader, heap_archive.first, heap_archive.second, 0)) {
+                for (mz_uint i = 0; i < mz_zip_reader_get_num_files(&reader); ++ i)
+                    result &= bool(mz_zip_writer_add_from_zip_reader(&archive, &reader, i));
+                mz_zip_reader_end(&reader);
+            } else
+                result = false;
+            mz_free(heap_archive.first);
+            heap_archive = { nullptr, 0 };
+        }
+        return result;
+    }
+
     /*
     * BBS: Production Extension (SplitModel)
     *   save sub model if objects_data is not empty
@@ -6703,8 +6773,9 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
         _add_relationships_file_to_archive(archive, MODEL_RELS_FILE, object_paths, {"http://schemas.microsoft.com/3dmanufacturing/2013/01/3dmodel"});
 
         if (!m_from_backup_save) {
-            boost::mutex mutex;
-            tbb::parallel_for(tbb::blocked_range<size_t>(0, objects_data.size(), 1), [this, &mutex, &model, objects = model.objects, &objects_data, &object_paths, main = &archive, project](const tbb::blocked_range<size_t>& range) {
+            // Each object is serialized and deflated into its own in-memory archive, the archives are merged in order afterwards.
+            std::vector<std::pair<void*, size_t>> object_archives(objects_data.size(), { nullptr, 0 });
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, objects_data.size(), 1), [this, &model, objects = model.objects, &objects_data, &object_paths, &object_archives, project](const tbb::blocked_range<size_t>& range) {
                 for (size_t i = range.begin(); i < range.end(); ++i) {
                     auto iter = objects_data.find(objects[i]);
                     ObjectToObjectDataMap objects_data2;
@@ -6716,18 +6787,14 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
                     CNumericLocalesSetter locales_setter;
                     _add_model_file_to_archive(object_paths[i], archive, model, objects_data2, nullptr, project);
                     iter->second = objects_data2.begin()->second;
-                    void *ppBuf; size_t pSize;
-                    mz_zip_writer_finalize_heap_archive(&archive, &ppBuf, &pSize);
-                    mz_zip_writer_end(&archive);
-                    mz_zip_zero_struct(&archive);
-                    mz_zip_reader_init_mem(&archive, ppBuf, pSize, 0);
-                    {
-                        boost::unique_lock l(mutex);
-                        mz_zip_writer_add_from_zip_reader(main, &archive, 0);
-                    }
-                    mz_zip_reader_end(&archive);
+                    object_archives[i] = finalize_heap_archive(archive);
                 }
             });
+            if (! add_heap_archives(archive, object_archives)) {
+                add_error("Unable to add object model files to archive");
+                BOOST_LOG_TRIVIAL(error) << __FUNCTION__ << ":" << __LINE__ << boost::format(", Unable to add object model files to archive\n");
+                return false;
+            }
         }
 
         return true;
@@ -6873,6 +6940,11 @@ void PlateData::parse_filament_info(GCodeProcessorResult *result)
             }
             // Return pointer to the end.
             return ptr;
+#elif defined(__cpp_lib_to_chars) && ! defined(__APPLE__)
+            // Round-trippable float, shortest possible. Several times faster than sprintf("%.9g"), which goes through
+            // the locale machinery and prints up to 9 significant digits even for short decimals.
+            // Older stdlib on macOS does not support std::to_chars for floating point numbers.
+            return std::to_chars(buf, buf + 32, f).ptr;
 #else
             // Round-trippable float, shortest possible.
             return buf + sprintf(buf, "%.9g", f);
@@ -7870,8 +7942,9 @@ bool _BBS_3MF_Exporter::_add_gcode_file_to_archive(mz_zip_archive& archive, cons
         }
     }
 
-    boost::mutex mutex;
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, plate_data_list2.size(), 1), [this, &plate_data_list2, &root_archive = archive, &mutex, &result](const tbb::blocked_range<size_t>& range) {
+    // The G-codes are deflated into in-memory archives in parallel and merged in the order of the plates afterwards.
+    std::vector<std::pair<void*, size_t>> gcode_archives(plate_data_list2.size(), { nullptr, 0 });
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, plate_data_list2.size(), 1), [this, &plate_data_list2, &gcode_archives, &result](const tbb::blocked_range<size_t>& range) {
         for (int i = range.begin(); i < range.end(); ++i) {
             PlateData* plate_data = plate_data_list2[i];
             auto src_gcode_file = plate_data->gcode_file;
@@ -7898,19 +7971,12 @@ bool _BBS_3MF_Exporter::_add_gcode_file_to_archive(mz_zip_archive& archive, cons
                 }
                 mz_zip_writer_add_staged_finish(&context);
             }
-            void *ppBuf; size_t pSize;
-            mz_zip_writer_finalize_heap_archive(&archive, &ppBuf, &pSize);
-            mz_zip_writer_end(&archive);
-            mz_zip_zero_struct(&archive);
-            mz_zip_reader_init_mem(&archive, ppBuf, pSize, 0);
-            {
-                boost::unique_lock l(mutex);
-                mz_zip_writer_add_from_zip_reader(&root_archive, &archive, 0);
-            }
-            mz_zip_reader_end(&archive);
+            gcode_archives[i] = finalize_heap_archive(archive);
             BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << ":" <<__LINE__ << boost::format(", store  %1% to 3mf %2%\n") % src_gcode_file % gcode_in_3mf;
         }
     });
+    if (! add_heap_archives(archive, gcode_archives))
+        result = false;
     return result;
 }
 
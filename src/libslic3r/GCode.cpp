@@ -2760,30 +2760,40 @@ void GCode::process_layers(
 {
     // The pipeline is variable: The vase mode filter is optional.
     size_t layer_to_print_idx = 0;
-    const auto generator = tbb::make_filter<void, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-        [this, &print, &tool_ordering, &print_object_instances_ordering, &layers_to_print, &layer_to_print_idx](tbb::flow_control& fc) -> LayerResult {
-            if (layer_to_print_idx >= layers_to_print.size()) {
-                if (layer_to_print_idx == layers_to_print.size() + (m_pressure_equalizer ? 1 : 0)) {
-                    fc.stop();
-                    return {};
-                } else {
-                    // Pressure equalizer need insert empty input. Because it returns one layer back.
-                    // Insert NOP (no operation) layer;
-                    ++layer_to_print_idx;
-                    return LayerResult::make_nop_layer_result();
-                }
-            } else {
-                const std::pair<coordf_t, std::vector<LayerToPrint>>& layer = layers_to_print[layer_to_print_idx++];
-                const LayerTools& layer_tools = tool_ordering.tools_for_layer(layer.first);
-                print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(layer_to_print_idx)));
-                if (m_wipe_tower && layer_tools.has_wipe_tower)
-                    m_wipe_tower->next_layer();
-                //BBS
-                check_placeholder_parser_failed();
-                print.throw_if_canceled();
-                return this->process_layer(print, layer.second, layer_tools, &layer == &layers_to_print.back(), &print_object_instances_ordering, size_t(-1));
+    const auto layer_source = tbb::make_filter<void, PreparedLayer>(slic3r_tbb_filtermode::serial_in_order,
+        [this, &layers_to_print, &layer_to_print_idx](tbb::flow_control& fc) -> PreparedLayer {
+            // Pressure equalizer need insert empty input. Because it returns one layer back.
+            if (layer_to_print_idx == layers_to_print.size() + (m_pressure_equalizer ? 1 : 0)) {
+                fc.stop();
+                return {};
             }
+            return { layer_to_print_idx ++ };
+        });
+    // Build the layer data, which does not depend on the G-code generator state, for several layers in parallel.
+    const auto layer_preparation = tbb::make_filter<PreparedLayer, PreparedLayer>(slic3r_tbb_filtermode::parallel,
+        [this, &layers_to_print](PreparedLayer in) -> PreparedLayer {
+            TRACE_ZONE("GCode::prepare_layer");
+            if (in.layer_to_print_idx < layers_to_print.size())
+                prepare_layer(layers_to_print[in.layer_to_print_idx].second, in);
+            return in;
+        });
+    const auto layer_generator = tbb::make_filter<PreparedLayer, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
+        [this, &print, &tool_ordering, &print_object_instances_ordering, &layers_to_print](PreparedLayer in) -> LayerResult {
+            if (in.layer_to_print_idx >= layers_to_print.size())
+                // Insert NOP (no operation) layer;
+                return LayerResult::make_nop_layer_result();
+            TRACE_ZONE("GCode::process_layer");
+            const std::pair<coordf_t, std::vector<LayerToPrint>>& layer = layers_to_print[in.layer_to_print_idx];
+            const LayerTools& layer_tools = tool_ordering.tools_for_layer(layer.first);
+            print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(in.layer_to_print_idx + 1)));
+            if (m_wipe_tower && layer_tools.has_wipe_tower)
+                m_wipe_tower->next_layer();
+            //BBS
+            check_placeholder_parser_failed();
+            print.throw_if_canceled();
+            return this->process_layer(print, layer.second, layer_tools, &layer == &layers_to_print.back(), &print_object_instances_ordering, size_t(-1), false, &in);
         });
+    const auto generator = layer_source & layer_preparation & layer_generator;
     if (m_spiral_vase) {
         float nozzle_diameter  = EXTRUDER_CONFIG(nozzle_diameter);
         float max_xy_smoothing = m_config.get_abs_value("spiral_mode_max_xy_smoothing", nozzle_diameter);
@@ -2794,28 +2804,32 @@ void GCode::process_layers(
         	if (in.nop_layer_result)
                 return in;
                 
+            TRACE_ZONE("GCode::spiral_vase");
             spiral_mode.enable(in.spiral_vase_enable);
             bool last_layer = in.layer_id == layers_to_print.size() - 1;
             return { spiral_mode.process_layer(std::move(in.gcode), last_layer), in.layer_id, in.spiral_vase_enable, in.cooling_buffer_flush};
         });
     const auto pressure_equalizer = tbb::make_filter<LayerResult, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
         [pressure_equalizer = this->m_pressure_equalizer.get()](LayerResult in) -> LayerResult {
+            TRACE_ZONE("GCode::pressure_equalizer");
             return pressure_equalizer->process_layer(std::move(in));
         });
     const auto cooling = tbb::make_filter<LayerResult, std::string>(slic3r_tbb_filtermode::serial_in_order,
         [&cooling_buffer = *this->m_cooling_buffer.get()](LayerResult in) -> std::string {
         	if (in.nop_layer_result)
                 return in.gcode;
+            TRACE_ZONE("GCode::cooling_buffer");
             return cooling_buffer.process_layer(std::move(in.gcode), in.layer_id, in.cooling_buffer_flush);
         });
     const auto pa_processor_filter = tbb::make_filter<std::string, std::string>(slic3r_tbb_filtermode::serial_in_order,
             [&pa_processor = *this->m_pa_processor](std::string in) -> std::string {
+                TRACE_ZONE("GCode::pa_processor");
                 return pa_processor.process_layer(std::move(in));
             }
         );
     
     const auto output = tbb::make_filter<std::string, void>(slic3r_tbb_filtermode::serial_in_order,
-        [&output_stream](std::string s) { output_stream.write(s); }
+        [&output_stream](std::string s) { TRACE_ZONE("GCode::output"); output_stream.write(s); }
     );
 
     const auto fan_mover = tbb::make_filter<std::string, std::string>(slic3r_tbb_filtermode::serial_in_order,
@@ -2824,6 +2838,7 @@ void GCode::process_layers(
         CNumericLocalesSetter locales_setter;
 
         if (config.fan_speedup_time.value != 0 || config.fan_kickstart.value > 0) {
+            TRACE_ZONE("GCode::fan_mover");
             if (fan_mover.get() == nullptr)
                 fan_mover.reset(new Slic3r::FanMover(
                     writer,
@@ -2863,27 +2878,37 @@ void GCode::process_layers(
 {
     // The pipeline is variable: The vase mode filter is optional.
     size_t layer_to_print_idx = 0;
-    const auto generator = tbb::make_filter<void, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
-        [this, &print, &tool_ordering, &layers_to_print, &layer_to_print_idx, single_object_idx, prime_extruder](tbb::flow_control& fc) -> LayerResult {
-            if (layer_to_print_idx >= layers_to_print.size()) {
-                if (layer_to_print_idx == layers_to_print.size() + (m_pressure_equalizer ? 1 : 0)) {
-                    fc.stop();
-                    return {};
-                } else {
-                    // Pressure equalizer need insert empty input. Because it returns one layer back.
-                    // Insert NOP (no operation) layer;
-                    ++layer_to_print_idx;
-                    return LayerResult::make_nop_layer_result();
-                }
-            } else {
-                LayerToPrint &layer = layers_to_print[layer_to_print_idx ++];
-                print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(layer_to_print_idx)));
-                //BBS
-                check_placeholder_parser_failed();
-                print.throw_if_canceled();
-                return this->process_layer(print, { std::move(layer) }, tool_ordering.tools_for_layer(layer.print_z()), &layer == &layers_to_print.back(), nullptr, single_object_idx, prime_extruder);
+    const auto layer_source = tbb::make_filter<void, PreparedLayer>(slic3r_tbb_filtermode::serial_in_order,
+        [this, &layers_to_print, &layer_to_print_idx](tbb::flow_control& fc) -> PreparedLayer {
+            // Pressure equalizer need insert empty input. Because it returns one layer back.
+            if (layer_to_print_idx == layers_to_print.size() + (m_pressure_equalizer ? 1 : 0)) {
+                fc.stop();
+                return {};
             }
+            return { layer_to_print_idx ++ };
+        });
+    // Build the layer data, which does not depend on the G-code generator state, for several layers in parallel.
+    const auto layer_preparation = tbb::make_filter<PreparedLayer, PreparedLayer>(slic3r_tbb_filtermode::parallel,
+        [this, &layers_to_print](PreparedLayer in) -> PreparedLayer {
+            TRACE_ZONE("GCode::prepare_layer");
+            if (in.layer_to_print_idx < layers_to_print.size())
+                prepare_layer({ layers_to_print[in.layer_to_print_idx] }, in);
+            return in;
+        });
+    const auto layer_generator = tbb::make_filter<PreparedLayer, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
+        [this, &print, &tool_ordering, &layers_to_print, single_object_idx, prime_extruder](PreparedLayer in) -> LayerResult {
+            if (in.layer_to_print_idx >= layers_to_print.size())
+                // Insert NOP (no operation) layer;
+                return LayerResult::make_nop_layer_result();
+            TRACE_ZONE("GCode::process_layer");
+            LayerToPrint &layer = layers_to_print[in.layer_to_print_idx];
+            print.set_status(80, Slic3r::format(_(L("Generating G-code: layer %1%")), std::to_string(in.layer_to_print_idx + 1)));
+            //BBS
+            check_placeholder_parser_failed();
+            print.throw_if_canceled();
+            return this->process_layer(print, { std::move(layer) }, tool_ordering.tools_for_layer(layer.print_z()), &layer == &layers_to_print.back(), nullptr, single_object_idx, prime_extruder, &in);
         });
+    const auto generator = layer_source & layer_preparation & layer_generator;
     if (m_spiral_vase) {
         float nozzle_diameter  = EXTRUDER_CONFIG(nozzle_diameter);
         float max_xy_smoothing = m_config.get_abs_value("spiral_mode_max_xy_smoothing", nozzle_diameter);
@@ -2893,34 +2918,39 @@ void GCode::process_layers(
         [&spiral_mode = *this->m_spiral_vase.get(), &layers_to_print](LayerResult in)->LayerResult {
             if (in.nop_layer_result)
                 return in;
+            TRACE_ZONE("GCode::spiral_vase");
             spiral_mode.enable(in.spiral_vase_enable);
             bool last_layer = in.layer_id == layers_to_print.size() - 1;
             return { spiral_mode.process_layer(std::move(in.gcode), last_layer), in.layer_id, in.spiral_vase_enable, in.cooling_buffer_flush };
         });
     const auto pressure_equalizer = tbb::make_filter<LayerResult, LayerResult>(slic3r_tbb_filtermode::serial_in_order,
         [pressure_equalizer = this->m_pressure_equalizer.get()](LayerResult in) -> LayerResult {
-             return pressure_equalizer->process_layer(std::move(in));
+            TRACE_ZONE("GCode::pressure_equalizer");
+            return pressure_equalizer->process_layer(std::move(in));
         });
     const auto cooling = tbb::make_filter<LayerResult, std::string>(slic3r_tbb_filtermode::serial_in_order,
         [&cooling_buffer = *this->m_cooling_buffer.get()](LayerResult in)->std::string {
             if (in.nop_layer_result)
                 return in.gcode;
+            TRACE_ZONE("GCode::cooling_buffer");
             return cooling_buffer.process_layer(std::move(in.gcode), in.layer_id, in.cooling_buffer_flush);
         });
     const auto pa_processor_filter = tbb::make_filter<std::string, std::string>(slic3r_tbb_filtermode::serial_in_order,
         [&pa_processor = *this->m_pa_processor](std::string in) -> std::string {
+            TRACE_ZONE("GCode::pa_processor");
             return pa_processor.process_layer(std::move(in));
         }
     );
     
     const auto output = tbb::make_filter<std::string, void>(slic3r_tbb_filtermode::serial_in_order,
-        [&output_stream](std::string s) { output_stream.write(s); }
+        [&output_stream](std::string s) { TRACE_ZONE("GCode::output"); output_stream.write(s); }
     );
 
     const auto fan_mover = tbb::make_filter<std::string, std::string>(slic3r_tbb_filtermode::serial_in_order,
         [&fan_mover = this->m_fan_mover, &config = this->config(), &writer = this->m_writer](std::string in)->std::string {
 
         if (config.fan_speedup_time.value != 0 || config.fan_kickstart.value > 0) {
+            TRACE_ZONE("GCode::fan_mover");
             if (fan_mover.get() == nullptr)
                 fan_mover.reset(new Slic3r::FanMover(
                     writer,
@@ -3582,6 +3612,31 @@ std::string GCode::generate_skirt(const Print &print,
     return gcode;
 }
 
+// Is the overhang speed estimated for any extrusion of this layer?
+static bool layer_needs_overhang_distancers(const GCode::LayerToPrint &layer_to_print)
+{
+    if (layer_to_print.object_layer == nullptr)
+        return false;
+    const auto &regions = layer_to_print.object_layer->regions();
+    return std::any_of(regions.begin(), regions.end(), [](const LayerRegion *r) {
+        return r->has_extrusions() && r->region().config().enable_overhang_speed && !r->region().config().overhang_speed_classic;
+    });
+}
+
+void GCode::prepare_layer(const std::vector<LayerToPrint> &layers, PreparedLayer &prepared)
+{
+    prepared.overhang_distancers.assign(layers.size(), std::nullopt);
+    for (size_t i = 0; i < layers.size(); ++ i)
+        if (layer_needs_overhang_distancers(layers[i]))
+            prepared.overhang_distancers[i] = ExtrusionQualityEstimator::build_layer_distancers(layers[i].object_layer);
+    // reduce_crossing_wall is a G-code option, it is not overridden per object.
+    for (size_t i = 0; i < layers.size(); ++ i)
+        if (const Layer *layer = layers[i].layer(); layer != nullptr && layer->object()->print()->config().reduce_crossing_wall) {
+            prepared.avoid_crossing_boundaries.resize(layers.size());
+            prepared.avoid_crossing_boundaries[i] = m_avoid_crossing_perimeters.build_layer_boundaries(*layer);
+        }
+}
+
 // In sequential mode, process_layer is called once per each object and its copy,
 // therefore layers will contain a single entry and single_object_instance_idx will point to the copy of the object.
 // In non-sequential mode, process_layer is called per each print_z height with all object and support layers accumulated.
@@ -3599,9 +3654,11 @@ LayerResult GCode::process_layer(
     // Otherwise print a single copy of a single object.
     const size_t                     		 single_object_instance_idx,
     // BBS
-    const bool                               prime_extruder)
+    const bool                               prime_extruder,
+    PreparedLayer                           *prepared)
 {
     assert(! layers.empty());
+    assert(prepared == nullptr || prepared->overhang_distancers.size() == layers.size());
     // Either printing all copies of all objects, or just a single copy of a single object.
     assert(single_object_instance_idx == size_t(-1) || layers.size() == 1);
 
@@ -3899,17 +3956,14 @@ LayerResult GCode::process_layer(
         return next_extruder;
     };
     
-    for (const auto &layer_to_print : layers) {
-        if (layer_to_print.object_layer) {
-            const auto& regions = layer_to_print.object_layer->regions();
-            const bool  enable_overhang_speed = std::any_of(regions.begin(), regions.end(), [](const LayerRegion* r) {
-                return r->has_extrusions() && r->region().config().enable_overhang_speed && !r->region().config().overhang_speed_classic;
-            });
-            if (enable_overhang_speed) {
-                m_extrusion_quality_estimator.prepare_for_new_layer(layer_to_print.original_object,
-                                                                    layer_to_print.object_layer);
-            }
-        }
+    for (size_t i = 0; i < layers.size(); ++ i) {
+        const LayerToPrint &layer_to_print = layers[i];
+        if (prepared != nullptr) {
+            // Distancers were already built by the parallel stage of the process_layers() pipeline.
+            if (std::optional<ExtrusionQualityEstimator::LayerDistancers> &distancers = prepared->overhang_distancers[i]; distancers)
+                m_extrusion_quality_estimator.prepare_for_new_layer(layer_to_print.original_object, std::move(*distancers));
+        } else if (layer_needs_overhang_distancers(layer_to_print))
+            m_extrusion_quality_estimator.prepare_for_new_layer(layer_to_print.original_object, layer_to_print.object_layer);
     }
 
     // Group extrusions by an extruder, then by an object, an island and a region.
@@ -4252,7 +4306,9 @@ LayerResult GCode::process_layer(
                 m_layer = layer_to_print.layer();
                 m_object_layer_over_raft = object_layer_over_raft;
                 if (m_config.reduce_crossing_wall)
-                    m_avoid_crossing_perimeters.init_layer(*m_layer);
+                    // Boundaries were already built by the parallel stage of the process_layers() pipeline, if available.
+                    m_avoid_crossing_perimeters.init_layer(*m_layer, prepared != nullptr && ! prepared->avoid_crossing_boundaries.empty() ?
+                        &prepared->avoid_crossing_boundaries[instance_to_print.layer_id] : nullptr);
 
                 if (this->config().gcode_label_objects) {
                     gcode += std::string("; printing object ") + instance_to_print.print_object.model_object()->name +
@@ -5094,14 +5150,13 @@ void GCode::GCodeOutputStream::close()
     }
 }
 
-void GCode::GCodeOutputStream::write(const char *what)
+void GCode::GCodeOutputStream::write(const char *what, size_t length)
 {
-    if (what != nullptr) {
-        const char* gcode = what;
+    if (length > 0) {
         // writes string to file
-        fwrite(gcode, 1, ::strlen(gcode), this->f);
-        //FIXME don't allocate a string, maybe process a batch of lines?
-        m_processor.process_buffer(std::string(gcode));
+        fwrite(what, 1, length, this->f);
+        // The G-code processor parses the chunk in place, while it is being exported.
+        m_processor.process_buffer(what, length);
     }
 }
 
@@ -28,6 +28,7 @@
 #include "GCode/AdaptivePAProcessor.hpp"
 
 #include <memory>
+#include <optional>
 #include <map>
 #include <set>
 #include <string>
@@ -288,8 +289,10 @@ private:
         void close();
 
         // Write a string into a file.
-        void write(const std::string& what) { this->write(what.c_str()); }
-        void write(const char* what);
+        void write(const std::string& what) { this->write(what.c_str(), what.size()); }
+        void write(const char* what) { if (what != nullptr) this->write(what, ::strlen(what)); }
+        // Write a zero terminated string of a known length into a file and pass it to the G-code processor.
+        void write(const char* what, size_t length);
 
         // Write a string into a file.
         // Add a newline, if the string does not end with a newline already.
@@ -316,6 +319,20 @@ private:
         const Layer& layer,
         unsigned int extruder_id);
 
+    // Layer data, which does not depend on the state of the G-code generator. It is built by a parallel stage
+    // of the process_layers() pipeline ahead of the serial G-code generator stage.
+    struct PreparedLayer
+    {
+        // Index into the layers to print. Index past the last layer marks the NOP layer of the pressure equalizer.
+        size_t                                                                  layer_to_print_idx { 0 };
+        // Overhang distancers for each LayerToPrint of this print_z, empty if overhang speed is not enabled.
+        std::vector<std::optional<ExtrusionQualityEstimator::LayerDistancers>> overhang_distancers;
+        // Boundaries for avoiding crossing perimeters for each LayerToPrint, empty if reduce_crossing_wall is not enabled.
+        std::vector<AvoidCrossingPerimeters::LayerBoundaries>                   avoid_crossing_boundaries;
+    };
+    // Called by several threads in parallel, it only touches the thread safe boundary cache of m_avoid_crossing_perimeters.
+    void prepare_layer(const std::vector<LayerToPrint> &layers, PreparedLayer &prepared);
+
     LayerResult process_layer(
         const Print                     &print,
         // Set of object & print layers of the same PrintObject and with the same print_z.
@@ -328,7 +345,10 @@ private:
         // Otherwise print a single copy of a single object.
         const size_t                     single_object_idx = size_t(-1),
         // BBS
-        const bool                       prime_extruder = false);
+        const bool                       prime_extruder = false,
+        // Layer data precomputed by prepare_layer() for the layers, may be null.
+        PreparedLayer                   *prepared = nullptr);
+
     // Process all layers of all objects (non-sequential mode) with a parallel pipeline:
     // Generate G-code, run the filters (vase mode, cooling buffer), run the G-code analyser
     // and export G-code into file.
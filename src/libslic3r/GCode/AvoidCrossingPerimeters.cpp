@@ -1166,6 +1166,156 @@ static void init_boundary(AvoidCrossingPerimeters::Boundary *boundary, Polygons
     init_boundary_distances(boundary);
 }
 
+static std::shared_ptr<const AvoidCrossingPerimeters::Boundary> make_boundary(Polygons &&boundary_polygons)
+{
+    auto boundary = std::make_shared<AvoidCrossingPerimeters::Boundary>();
+    init_boundary(boundary.get(), std::move(boundary_polygons));
+    return boundary;
+}
+
+static inline void hash_combine(size_t &hash, uint64_t value)
+{
+    hash = (hash ^ size_t(value)) * size_t(0x100000001b3ull);
+    hash ^= hash >> 29;
+}
+
+void AvoidCrossingPerimeters::BoundaryInputs::add(const ExPolygons &expolygons)
+{
+    counts.emplace_back(expolygons.size());
+    hash_combine(hash, expolygons.size());
+    for (const ExPolygon &expolygon : expolygons) {
+        counts.emplace_back(expolygon.holes.size());
+        hash_combine(hash, expolygon.holes.size());
+        this->add(expolygon.contour.points);
+        for (const Polygon &hole : expolygon.holes)
+            this->add(hole.points);
+    }
+}
+
+void AvoidCrossingPerimeters::BoundaryInputs::add(const Points &pts)
+{
+    counts.emplace_back(pts.size());
+    hash_combine(hash, pts.size());
+    for (const Point &pt : pts)
+        hash_combine(hash, (uint64_t(uint32_t(pt.x())) << 32) | uint64_t(uint32_t(pt.y())));
+    append(points, pts);
+}
+
+std::atomic<size_t> AvoidCrossingPerimeters::s_boundary_cache_capacity { AvoidCrossingPerimeters::default_boundary_cache_capacity };
+
+template<typename T>
+template<typename Build>
+std::shared_ptr<const T> AvoidCrossingPerimeters::BoundaryCache<T>::get(BoundaryInputs &&inputs, Build &&build)
+{
+    const size_t capacity = s_boundary_cache_capacity;
+    if (capacity == 0)
+        return build();
+    std::promise<std::shared_ptr<const T>> promise;
+    std::shared_future<std::shared_ptr<const T>> future;
+    size_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = std::find_if(m_entries.begin(), m_entries.end(), [&inputs](const Entry &entry) { return entry.inputs == inputs; });
+        if (it != m_entries.end()) {
+            std::rotate(m_entries.begin(), it, it + 1);
+            future = m_entries.front().boundary;
+        } else {
+            if (m_entries.size() >= capacity)
+                m_entries.erase(m_entries.begin() + (capacity - 1), m_entries.end());
+            id = ++ m_last_id;
+            m_entries.insert(m_entries.begin(), Entry{ std::move(inputs), promise.get_future().share(), id });
+        }
+    }
+    if (future.valid())
+        // Built or being built by another thread.
+        return future.get();
+    // Build outside of the lock, the threads asking for other inputs are not blocked.
+    std::shared_ptr<const T> out;
+    try {
+        out = build();
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+        // Don't keep the failure, the following requests for the same inputs build the boundary again.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (auto it = std::find_if(m_entries.begin(), m_entries.end(), [id](const Entry &entry) { return entry.id == id; }); it != m_entries.end())
+            m_entries.erase(it);
+        throw;
+    }
+    promise.set_value(out);
+    return out;
+}
+
+static const ExPolygons& empty_expolygons()
+{
+    static const ExPolygons empty;
+    return empty;
+}
+
+// Inputs of get_boundary().
+static AvoidCrossingPerimeters::BoundaryInputs get_boundary_inputs(const Layer &layer)
+{
+    AvoidCrossingPerimeters::BoundaryInputs inputs;
+    inputs.param = get_perimeter_spacing(layer);
+    inputs.add(layer.lslices);
+    auto const  *support_layer = dynamic_cast<const SupportLayer *>(&layer);
+    const Layer *layer_below   = support_layer ? layer.object()->get_first_layer_bellow_printz(layer.print_z, EPSILON) : nullptr;
+    inputs.add(layer_below ? layer_below->lslices : empty_expolygons());
+#ifdef INCLUDE_SUPPORTS_IN_BOUNDARY
+    inputs.add(support_layer ? support_layer->support_islands : empty_expolygons());
+#endif
+    ExPolygons top_layer_polygons;
+    for (const LayerRegion *layer_region : layer.regions())
+        for (const Surface &surface : layer_region->fill_surfaces.surfaces)
+            if (surface.is_top()) top_layer_polygons.emplace_back(surface.expolygon);
+    inputs.add(top_layer_polygons);
+    return inputs;
+}
+
+// Inputs of get_boundary_external(): slices of all the objects printed at the same print_z with the shifts of their instances.
+static AvoidCrossingPerimeters::BoundaryInputs get_boundary_external_inputs(const Layer &layer)
+{
+    AvoidCrossingPerimeters::BoundaryInputs inputs;
+    inputs.param = get_perimeter_spacing_external(layer);
+    const bool is_support_layer = dynamic_cast<const SupportLayer *>(&layer) != nullptr;
+    for (const PrintObject *object : layer.object()->print()->objects()) {
+        const Layer *l           = object->get_layer_at_printz(layer.print_z, EPSILON);
+        const Layer *layer_below = is_support_layer ? object->get_first_layer_bellow_printz(layer.print_z, EPSILON) : nullptr;
+        inputs.add(l ? l->lslices : empty_expolygons());
+        inputs.add(layer_below ? layer_below->lslices : empty_expolygons());
+#ifdef INCLUDE_SUPPORTS_IN_BOUNDARY
+        if (is_support_layer)
+            inputs.add(static_cast<const SupportLayer&>(layer).support_islands);
+#endif
+        Points shifts;
+        for (const PrintInstance &instance : object->instances())
+            shifts.emplace_back(instance.shift);
+        inputs.add(shifts);
+    }
+    return inputs;
+}
+
+static float get_lslices_offset(const Layer &layer)
+{
+    return -get_external_perimeter_width(layer) / float(2.);
+}
+
+static std::shared_ptr<const AvoidCrossingPerimeters::OffsetSlices> build_lslices_offset(const Layer &layer, float perimeter_offset)
+{
+    auto out = std::make_shared<AvoidCrossingPerimeters::OffsetSlices>();
+    out->expolygons = offset_ex(layer.lslices, perimeter_offset);
+
+    out->bboxes.reserve(out->expolygons.size());
+    for (const ExPolygon &ex_poly : out->expolygons)
+        out->bboxes.emplace_back(get_extents(ex_poly));
+
+    BoundingBox bbox_slice(get_extents(layer.lslices));
+    bbox_slice.offset(SCALED_EPSILON);
+
+    out->grid.set_bbox(bbox_slice);
+    out->grid.create(out->expolygons, coord_t(scale_(1.)));
+    return out;
+}
+
 // Plan travel, which avoids perimeter crossings by following the boundaries of the layer.
 Polyline AvoidCrossingPerimeters::travel_to(const GCode &gcodegen, const Point &point, bool *could_be_wipe_disabled)
 {
@@ -1182,26 +1332,33 @@ Polyline AvoidCrossingPerimeters::travel_to(const GCode &gcodegen, const Point &
     Vec2d startf = start.cast<double>();
     Vec2d endf   = end  .cast<double>();
 
+    static const OffsetSlices empty_lslices_offset {};
+    const OffsetSlices &lslices_offset = m_lslices_offset ? *m_lslices_offset : empty_lslices_offset;
+
     bool is_support_layer = dynamic_cast<const SupportLayer *>(gcodegen.layer()) != nullptr;
-    if (!use_external && (is_support_layer || (!m_lslices_offset.empty() && !any_expolygon_contains(m_lslices_offset, m_lslices_offset_bboxes, m_grid_lslices_offset, travel)))) {
+    if (!use_external && (is_support_layer || (!lslices_offset.expolygons.empty() && !any_expolygon_contains(lslices_offset.expolygons, lslices_offset.bboxes, lslices_offset.grid, travel)))) {
         // Initialize m_internal only when it is necessary.
-        if (m_internal.boundaries.empty())
-            init_boundary(&m_internal, to_polygons(get_boundary(*gcodegen.layer())));
+        if (!m_internal || m_internal->boundaries.empty()) {
+            const Layer &layer = *gcodegen.layer();
+            m_internal = m_internal_cache.get(get_boundary_inputs(layer), [&layer]() { return make_boundary(to_polygons(get_boundary(layer))); });
+        }
 
         // Trim the travel line by the bounding box.
-        if (!m_internal.boundaries.empty() && Geometry::liang_barsky_line_clipping(startf, endf, m_internal.bbox)) {
-            travel_intersection_count = avoid_perimeters(m_internal, startf.cast<coord_t>(), endf.cast<coord_t>(), *gcodegen.layer(), result_pl);
+        if (!m_internal->boundaries.empty() && Geometry::liang_barsky_line_clipping(startf, endf, m_internal->bbox)) {
+            travel_intersection_count = avoid_perimeters(*m_internal, startf.cast<coord_t>(), endf.cast<coord_t>(), *gcodegen.layer(), result_pl);
             result_pl.points.front()  = start;
             result_pl.points.back()   = end;
         }
     } else if(use_external) {
         // Initialize m_external only when exist any external travel for the current layer.
-        if (m_external.boundaries.empty())
-            init_boundary(&m_external, get_boundary_external(*gcodegen.layer()));
+        if (!m_external || m_external->boundaries.empty()) {
+            const Layer &layer = *gcodegen.layer();
+            m_external = m_external_cache.get(get_boundary_external_inputs(layer), [&layer]() { return make_boundary(get_boundary_external(layer)); });
+        }
 
         // Trim the travel line by the bounding box.
-        if (!m_external.boundaries.empty() && Geometry::liang_barsky_line_clipping(startf, endf, m_external.bbox)) {
-            travel_intersection_count = avoid_perimeters(m_external, startf.cast<coord_t>(), endf.cast<coord_t>(), *gcodegen.layer(), result_pl);
+        if (!m_external->boundaries.empty() && Geometry::liang_barsky_line_clipping(startf, endf, m_external->bbox)) {
+            travel_intersection_count = avoid_perimeters(*m_external, startf.cast<coord_t>(), endf.cast<coord_t>(), *gcodegen.layer(), result_pl);
             result_pl.points.front()  = start;
             result_pl.points.back()   = end;
         }
@@ -1233,32 +1390,30 @@ Polyline AvoidCrossingPerimeters::travel_to(const GCode &gcodegen, const Point &
     } else if (max_detour_length_exceeded) {
         *could_be_wipe_disabled = false;
     } else
-        *could_be_wipe_disabled = !need_wipe(gcodegen, m_lslices_offset, m_lslices_offset_bboxes, m_grid_lslices_offset, travel, result_pl, travel_intersection_count);
+        *could_be_wipe_disabled = !need_wipe(gcodegen, lslices_offset.expolygons, lslices_offset.bboxes, lslices_offset.grid, travel, result_pl, travel_intersection_count);
 
     return result_pl;
 }
 
 // ************************************* AvoidCrossingPerimeters::init_layer() *****************************************
 
-void AvoidCrossingPerimeters::init_layer(const Layer &layer)
+AvoidCrossingPerimeters::LayerBoundaries AvoidCrossingPerimeters::build_layer_boundaries(const Layer &layer)
 {
-    m_internal.clear();
-    m_external.clear();
-    m_lslices_offset.clear();
-    m_lslices_offset_bboxes.clear();
-
-    float perimeter_offset = -get_external_perimeter_width(layer) / float(2.);
-    m_lslices_offset        = offset_ex(layer.lslices, perimeter_offset);
-
-    m_lslices_offset_bboxes.reserve(m_lslices_offset.size());
-    for (const ExPolygon &ex_poly : m_lslices_offset)
-        m_lslices_offset_bboxes.emplace_back(get_extents(ex_poly));
-
-    BoundingBox bbox_slice(get_extents(layer.lslices));
-    bbox_slice.offset(SCALED_EPSILON);
+    float perimeter_offset = get_lslices_offset(layer);
+    BoundaryInputs inputs;
+    inputs.param = perimeter_offset;
+    inputs.add(layer.lslices);
+    LayerBoundaries out;
+    out.layer  = &layer;
+    out.slices = m_lslices_offset_cache.get(std::move(inputs), [&layer, perimeter_offset]() { return build_lslices_offset(layer, perimeter_offset); });
+    return out;
+}
 
-    m_grid_lslices_offset.set_bbox(bbox_slice);
-    m_grid_lslices_offset.create(m_lslices_offset, coord_t(scale_(1.)));
+void AvoidCrossingPerimeters::init_layer(const Layer &layer, const LayerBoundaries *prepared)
+{
+    m_internal.reset();
+    m_external.reset();
+    m_lslices_offset = prepared != nullptr && prepared->layer == &layer ? prepared->slices : this->build_layer_boundaries(layer).slices;
 }
 
 #if 0
@@ -5,6 +5,11 @@
 #include "../ExPolygon.hpp"
 #include "../EdgeGrid.hpp"
 
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+
 namespace Slic3r {
 
 // Forward declarations.
@@ -23,7 +28,21 @@ public:
     bool        disabled_once() const   { return m_disabled_once; }
     void        reset_once_modifiers()  { m_use_external_mp_once = false; m_disabled_once = false; }
 
-    void        init_layer(const Layer &layer);
+    struct Boundary;
+    struct OffsetSlices;
+    // Boundaries of a layer, which do not depend on the state of the G-code generator. They are built by build_layer_boundaries()
+    // ahead of init_layer(), possibly for several layers in parallel. The internal boundary is not prepared, it is built
+    // by the first travel which needs it.
+    struct LayerBoundaries
+    {
+        const Layer                        *layer { nullptr };
+        std::shared_ptr<const OffsetSlices> slices;
+    };
+    // Thread safe, it may be called in parallel with itself and with the other methods.
+    LayerBoundaries build_layer_boundaries(const Layer &layer);
+
+    // Boundaries of the layer are taken from prepared if it was built for this layer, otherwise they are built when needed.
+    void        init_layer(const Layer &layer, const LayerBoundaries *prepared = nullptr);
 
     Polyline    travel_to(const GCode& gcodegen, const Point& point)
     {
@@ -50,6 +69,38 @@ public:
         }
     };
 
+    struct OffsetSlices {
+        // Lslices offseted by half an external perimeter width. Used for detection if line or polyline is inside of any polygon.
+        ExPolygons               expolygons;
+        std::vector<BoundingBox> bboxes;
+        // Used for detection of line or polyline is inside of any polygon.
+        EdgeGrid::Grid           grid;
+    };
+
+    // Polygons and a parameter (perimeter spacing or offset) a boundary is built from. Boundaries built from equal inputs are equal,
+    // thus a boundary is reused for the following layers with the same slices, typically for prismatic parts and for the instances
+    // of an object.
+    struct BoundaryInputs
+    {
+        float               param { 0.f };
+        // Points of all the input polygons.
+        Points              points;
+        // Structure of the inputs: number of ExPolygons of an input, number of holes of each ExPolygon and number of points of each polygon.
+        std::vector<size_t> counts;
+        size_t              hash  { 0 };
+
+        void add(const ExPolygons &expolygons);
+        void add(const Points &pts);
+        bool operator==(const BoundaryInputs &rhs) const
+            { return hash == rhs.hash && param == rhs.param && counts == rhs.counts && points == rhs.points; }
+    };
+
+    // Number of the most recently built boundaries of each kind kept for reuse, zero disables the reuse. Applies to the caches
+    // of all the instances. A layer of a single object printed with several instances, or sharing the print_z with the layers
+    // of other objects, reuses the boundaries of its neighbours.
+    static constexpr size_t default_boundary_cache_capacity = 8;
+    static void             set_boundary_cache_capacity(size_t capacity) { s_boundary_cache_capacity = capacity; }
+
 private:
     bool           m_use_external_mp { false };
     // just for the next travel move
@@ -58,15 +109,40 @@ private:
     // we enable it by default for the first travel move in print
     bool           m_disabled_once { true };
 
-    // Lslices offseted by half an external perimeter width. Used for detection if line or polyline is inside of any polygon.
-    ExPolygons               m_lslices_offset;
-    std::vector<BoundingBox> m_lslices_offset_bboxes;
-    // Used for detection of line or polyline is inside of any polygon.
-    EdgeGrid::Grid           m_grid_lslices_offset;
-    // Store all needed data for travels inside object
-    Boundary m_internal;
-    // Store all needed data for travels outside object
-    Boundary m_external;
+    // Recently built boundaries with the inputs they were built from, the most recently used first.
+    // Thread safe: A boundary being built by one thread is waited for by the other threads asking for the same inputs,
+    // thus the identical layers prepared in parallel build their boundary just once.
+    template<typename T>
+    class BoundaryCache
+    {
+    public:
+        // Returns the boundary built from inputs equal to inputs, or the one returned by build(), which is then cached.
+        // If build() throws, the exception is passed to the threads waiting for the boundary and the entry is removed.
+        template<typename Build>
+        std::shared_ptr<const T> get(BoundaryInputs &&inputs, Build &&build);
+
+    private:
+        struct Entry {
+            BoundaryInputs                               inputs;
+            std::shared_future<std::shared_ptr<const T>> boundary;
+            // Identifies the entry of a failed build.
+            size_t                                       id;
+        };
+        std::mutex                                       m_mutex;
+        std::vector<Entry>                               m_entries;
+        size_t                                           m_last_id { 0 };
+    };
+    static std::atomic<size_t> s_boundary_cache_capacity;
+
+    // Lslices of the current layer offseted by half an external perimeter width.
+    std::shared_ptr<const OffsetSlices> m_lslices_offset;
+    // Store all needed data for travels inside object, built when the first travel needs it.
+    std::shared_ptr<const Boundary>     m_internal;
+    // Store all needed data for travels outside object, built when the first travel needs it.
+    std::shared_ptr<const Boundary>     m_external;
+    BoundaryCache<OffsetSlices>         m_lslices_offset_cache;
+    BoundaryCache<Boundary>             m_internal_cache;
+    BoundaryCache<Boundary>             m_external_cache;
 };
 
 } // namespace Slic3r
@@ -1,9 +1,7 @@
 #include "ConflictChecker.hpp"
 
 #include <tbb/parallel_for.h>
-#include <tbb/concurrent_vector.h>
 
-#include <map>
 #include <functional>
 #include <atomic>
 
@@ -22,9 +20,11 @@ inline IndexPair point_map_grid_index(const Point &pt, int64_t xdist, int64_t yd
 
 inline bool nearly_equal(const Point &p1, const Point &p2) { return std::abs(p1.x() - p2.x()) < SCALED_EPSILON && std::abs(p1.y() - p2.y()) < SCALED_EPSILON; }
 
-inline Grids line_rasterization(const Line &line, int64_t xdist = scale_(1), int64_t ydist = scale_(1))
+// Call visitor(IndexPair) for the grid cells crossed by the line, from line.a to line.b.
+template<typename Visitor>
+inline void line_rasterization(const Line &line, Visitor &&visitor, int64_t xdist = scale_(1), int64_t ydist = scale_(1))
 {
-    Grids     res;
+    size_t    cnt          = 0;
     Point     rayStart     = line.a;
     Point     rayEnd       = line.b;
     IndexPair currentVoxel = point_map_grid_index(rayStart, xdist, ydist);
@@ -48,7 +48,8 @@ inline Grids line_rasterization(const Line &line, int64_t xdist = scale_(1), int
     double tDeltaX = ray.x() != 0 ? static_cast<double>(xdist) / ray.x() * stepX : DBL_MAX;
     double tDeltaY = ray.y() != 0 ? static_cast<double>(ydist) / ray.y() * stepY : DBL_MAX;
 
-    res.push_back(currentVoxel);
+    visitor(currentVoxel);
+    ++ cnt;
 
     double tx = tMaxX;
     double ty = tMaxY;
@@ -57,14 +58,16 @@ inline Grids line_rasterization(const Line &line, int64_t xdist = scale_(1), int
         if (lastVoxel.first == currentVoxel.first) {
             for (int64_t i = currentVoxel.second; i != lastVoxel.second; i += (int64_t) stepY) {
                 currentVoxel.second += (int64_t) stepY;
-                res.push_back(currentVoxel);
+                visitor(currentVoxel);
+                ++ cnt;
             }
             break;
         }
         if (lastVoxel.second == currentVoxel.second) {
             for (int64_t i = currentVoxel.first; i != lastVoxel.first; i += (int64_t) stepX) {
                 currentVoxel.first += (int64_t) stepX;
-                res.push_back(currentVoxel);
+                visitor(currentVoxel);
+                ++ cnt;
             }
             break;
         }
@@ -76,14 +79,94 @@ inline Grids line_rasterization(const Line &line, int64_t xdist = scale_(1), int
             currentVoxel.second += (int64_t) stepY;
             ty += tDeltaY;
         }
-        res.push_back(currentVoxel);
-        if (res.size() >= 100000) { // bug
+        visitor(currentVoxel);
+        ++ cnt;
+        if (cnt >= 100000) { // bug
             assert(0);
         }
     }
-
-    return res;
 }
+
+// Lines of a layer binned into the grid cells they cross. Flat open addressing hash table with linear probing,
+// the lines of a cell are chained in the order they were inserted.
+class GridCellLines
+{
+public:
+    explicit GridCellLines(size_t num_lines)
+    {
+        size_t capacity = 16;
+        while (capacity < 2 * num_lines) capacity *= 2;
+        m_slots.assign(capacity, Slot());
+        m_nodes.reserve(2 * num_lines);
+    }
+
+    // Call visitor(line_idx) for the lines of the cell until it returns true, then add line_idx to the cell.
+    // Returns true if the visitor returned true.
+    template<typename Visitor>
+    bool visit_and_insert(const IndexPair &cell, int line_idx, Visitor &&visitor)
+    {
+        Slot &slot = this->slot(cell);
+        for (int node = slot.head; node != -1; node = m_nodes[node].next)
+            if (visitor(m_nodes[node].line)) return true;
+        int node = int(m_nodes.size());
+        m_nodes.push_back({line_idx, -1});
+        if (slot.head == -1) {
+            slot.head = node;
+            ++m_size;
+        } else
+            m_nodes[slot.tail].next = node;
+        slot.tail = node;
+        if (2 * m_size > m_slots.size()) this->grow();
+        return false;
+    }
+
+private:
+    struct Slot
+    {
+        uint64_t key  = 0;
+        int      head = -1;
+        int      tail = -1;
+    };
+    struct Node
+    {
+        int line;
+        int next;
+    };
+
+    static uint64_t key(const IndexPair &cell) { return (uint64_t(uint32_t(cell.first)) << 32) | uint64_t(uint32_t(cell.second)); }
+    size_t          home(uint64_t key) const { return size_t((key * 0x9E3779B97F4A7C15ull) >> 32) & (m_slots.size() - 1); }
+
+    // Slot of the cell, an empty slot if the cell has no lines yet.
+    Slot &slot(const IndexPair &cell)
+    {
+        uint64_t k = key(cell);
+        for (size_t i = home(k);; i = (i + 1) & (m_slots.size() - 1)) {
+            Slot &slot = m_slots[i];
+            if (slot.head == -1) {
+                slot.key = k;
+                return slot;
+            }
+            if (slot.key == k) return slot;
+        }
+    }
+
+    void grow()
+    {
+        std::vector<Slot> slots(m_slots.size() * 2);
+        std::swap(slots, m_slots);
+        for (const Slot &slot : slots)
+            if (slot.head != -1) {
+                size_t i = home(slot.key);
+                while (m_slots[i].head != -1) i = (i + 1) & (m_slots.size() - 1);
+                m_slots[i] = slot;
+            }
+    }
+
+    std::vector<Slot> m_slots;
+    std::vector<Node> m_nodes;
+    // Number of non-empty slots.
+    size_t            m_size = 0;
+};
 } // namespace RasterizationImpl
 
 void LinesBucketQueue::emplace_back_bucket(ExtrusionLayers &&els, const void *objPtr, Point offset)
@@ -131,14 +214,20 @@ LineWithIDs LinesBucketQueue::getCurLines() const
 {
     LineWithIDs lines;
     for (const LinesBucket &bucket : line_buckets) {
-        if (bucket.valid()) {
-            LineWithIDs tmpLines = bucket.curLines();
-            lines.insert(lines.end(), tmpLines.begin(), tmpLines.end());
-        }
+        if (bucket.valid()) { bucket.pileLines(bucket._curPileIdx, lines); }
     }
     return lines;
 }
 
+LinesBucketPiles LinesBucketQueue::getCurPiles() const
+{
+    LinesBucketPiles piles;
+    for (const LinesBucket &bucket : line_buckets) {
+        if (bucket.valid()) { piles.emplace_back(&bucket, bucket._curPileIdx); }
+    }
+    return piles;
+}
+
 void getExtrusionPathsFromEntity(const ExtrusionEntityCollection *entity, ExtrusionPaths &paths)
 {
     std::function<void(const ExtrusionEntityCollection *, ExtrusionPaths &)> getExtrusionPathImpl = [&](const ExtrusionEntityCollection *entity, ExtrusionPaths &paths) {
@@ -200,19 +289,19 @@ ObjectExtrusions getAllLayersExtrusionPathsFromObject(PrintObject *obj)
 ConflictComputeOpt ConflictChecker::find_inter_of_lines(const LineWithIDs &lines)
 {
     using namespace RasterizationImpl;
-    std::map<IndexPair, std::vector<int>> indexToLine;
+    GridCellLines      indexToLine(lines.size());
+    ConflictComputeOpt res;
 
     for (int i = 0; i < lines.size(); ++i) {
-        const LineWithID &l1      = lines[i];
-        auto              indexes = line_rasterization(l1._line);
-        for (auto index : indexes) {
-            const auto &possibleIntersectIdxs = indexToLine[index];
-            for (auto possibleIntersectIdx : possibleIntersectIdxs) {
-                const LineWithID &l2 = lines[possibleIntersectIdx];
-                if (auto interRes = line_intersect(l1, l2); interRes.has_value()) { return interRes; }
-            }
-            indexToLine[index].push_back(i);
-        }
+        const LineWithID &l1 = lines[i];
+        bool              found = false;
+        line_rasterization(l1._line, [&](const IndexPair &index) {
+            found = found || indexToLine.visit_and_insert(index, i, [&](int possibleIntersectIdx) {
+                        res = line_intersect(l1, lines[possibleIntersectIdx]);
+                        return res.has_value();
+                    });
+        });
+        if (found) { return res; }
     }
     return {};
 }
@@ -236,38 +325,48 @@ ConflictResultOpt ConflictChecker::find_inter_of_lines_in_diff_objs(PrintObjectP
         }
         conflictQueue.emplace_back_bucket(std::move(wtels), wtdptr.value(), {wtdptr.value()->plate_origin.x(), wtdptr.value()->plate_origin.y()});
     }
-    for (PrintObject *obj : objs) {
-        auto layers = getAllLayersExtrusionPathsFromObject(obj);
-        conflictQueue.emplace_back_bucket(std::move(layers.perimeters), obj, obj->instances().front().shift);
-        conflictQueue.emplace_back_bucket(std::move(layers.support), obj, obj->instances().front().shift);
+    std::vector<ObjectExtrusions> objsExtrusions(objs.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, objs.size()), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++i) { objsExtrusions[i] = getAllLayersExtrusionPathsFromObject(objs[i]); }
+    });
+    for (size_t i = 0; i < objs.size(); ++i) {
+        PrintObject *obj = objs[i];
+        conflictQueue.emplace_back_bucket(std::move(objsExtrusions[i].perimeters), obj, obj->instances().front().shift);
+        conflictQueue.emplace_back_bucket(std::move(objsExtrusions[i].support), obj, obj->instances().front().shift);
     }
 
-    std::vector<LineWithIDs> layersLines;
-    std::vector<float>       bottomZs;
+    // Only the piles of the layers are recorded here, the lines are collected by the workers checking the layers.
+    std::vector<LinesBucketPiles> layersPiles;
+    std::vector<float>            bottomZs;
     while (conflictQueue.valid()) {
-        LineWithIDs lines = conflictQueue.getCurLines();
+        LinesBucketPiles piles = conflictQueue.getCurPiles();
         float curBottomZ = conflictQueue.getCurrBottomZ();
         bottomZs.push_back(curBottomZ);
-        layersLines.push_back(std::move(lines));
+        layersPiles.push_back(std::move(piles));
     }
 
-    bool                                                          find = false;
-    tbb::concurrent_vector<std::pair<ConflictComputeResult, float>> conflict;
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, layersLines.size()), [&](tbb::blocked_range<size_t> range) {
-        for (size_t i = range.begin(); i < range.end(); i++) {
-            auto interRes = find_inter_of_lines(layersLines[i]);
-            if (interRes.has_value()) {
-                find = true;
-                conflict.emplace_back(interRes.value(), bottomZs[i]);
+    // The lowest conflicting layer is reported. Layers above a conflict already found are not checked.
+    std::atomic<size_t>             firstConflictLayer(layersPiles.size());
+    std::vector<ConflictComputeOpt> conflicts(layersPiles.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, layersPiles.size()), [&](const tbb::blocked_range<size_t> &range) {
+        LineWithIDs lines;
+        for (size_t i = range.begin(); i < range.end() && i < firstConflictLayer.load(std::memory_order_relaxed); i++) {
+            lines.clear();
+            for (const auto &[bucket, pileIdx] : layersPiles[i]) { bucket->pileLines(pileIdx, lines); }
+            conflicts[i] = find_inter_of_lines(lines);
+            if (conflicts[i].has_value()) {
+                size_t first = firstConflictLayer.load(std::memory_order_relaxed);
+                while (i < first && !firstConflictLayer.compare_exchange_weak(first, i, std::memory_order_relaxed)) {}
                 break;
             }
         }
     });
 
-    if (find) {
-        const void *ptr1           = conflict[0].first._obj1;
-        const void *ptr2           = conflict[0].first._obj2;
-        float       conflictPrintZ = conflict[0].second;
+    const size_t conflictLayer = firstConflictLayer.load();
+    if (conflictLayer < layersPiles.size()) {
+        const void *ptr1           = conflicts[conflictLayer]->_obj1;
+        const void *ptr2           = conflicts[conflictLayer]->_obj2;
+        float       conflictPrintZ = bottomZs[conflictLayer];
         if (wtdptr.has_value()) {
             const FakeWipeTower *wtdp = wtdptr.value();
             if (ptr1 == wtdp || ptr2 == wtdp) {
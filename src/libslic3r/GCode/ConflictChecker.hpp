@@ -64,12 +64,14 @@ public:
     LinesBucket(ExtrusionLayers &&paths, const void* id, Point offset) : _piles(paths), _id(id), _offset(offset) {}
     LinesBucket(LinesBucket &&) = default;
 
-    std::pair<int, int> curRange() const
+    // Range of the piles starting at the same height as the pile pileIdx.
+    std::pair<int, int> pileRange(unsigned pileIdx) const
     {
-        auto begin = std::lower_bound(_piles.begin(), _piles.end(), _piles[_curPileIdx], [](const ExtrusionLayer &l, const ExtrusionLayer &r) { return l.bottom_z < r.bottom_z; });
-        auto end = std::upper_bound(_piles.begin(), _piles.end(), _piles[_curPileIdx], [](const ExtrusionLayer &l, const ExtrusionLayer &r) { return l.bottom_z < r.bottom_z; });
+        auto begin = std::lower_bound(_piles.begin(), _piles.end(), _piles[pileIdx], [](const ExtrusionLayer &l, const ExtrusionLayer &r) { return l.bottom_z < r.bottom_z; });
+        auto end = std::upper_bound(_piles.begin(), _piles.end(), _piles[pileIdx], [](const ExtrusionLayer &l, const ExtrusionLayer &r) { return l.bottom_z < r.bottom_z; });
         return std::make_pair<int, int>(std::distance(_piles.begin(), begin), std::distance(_piles.begin(), end));
     }
+    std::pair<int, int> curRange() const { return pileRange(_curPileIdx); }
     bool valid() const { return _curPileIdx < _piles.size(); }
     void raise()
     {
@@ -79,20 +81,23 @@ public:
         _curBottomZ = _curPileIdx == _piles.size() ? _piles.back().bottom_z : _piles[_curPileIdx].bottom_z;
     }
     float curBottomZ() const { return _curBottomZ; }
-    LineWithIDs curLines() const
+    // Lines of the piles starting at the same height as the pile pileIdx, appended to lines.
+    void pileLines(unsigned pileIdx, LineWithIDs &lines) const
     {
-        auto [b, e] = curRange();
-        LineWithIDs lines;
+        auto [b, e] = pileRange(pileIdx);
         for (int i = b; i < e; ++i) {
             for (const ExtrusionPath &path : _piles[i].paths) {
                 if (path.is_force_no_extrusion() == false) {
-                    Polyline check_polyline = path.polyline;
-                    check_polyline.translate(_offset);
-                    Lines tmpLines = check_polyline.lines();
-                    for (const Line &line : tmpLines) { lines.emplace_back(line, _id, path.role()); }
+                    const Points &pts = path.polyline.points;
+                    for (size_t j = 1; j < pts.size(); ++j) { lines.emplace_back(Line(pts[j - 1] + _offset, pts[j] + _offset), _id, path.role()); }
                 }
             }
         }
+    }
+    LineWithIDs curLines() const
+    {
+        LineWithIDs lines;
+        pileLines(_curPileIdx, lines);
         return lines;
     }
 
@@ -106,6 +111,9 @@ struct LinesBucketPtrComp
     bool operator()(const LinesBucket *left, const LinesBucket *right) { return *left > *right; }
 };
 
+// Current piles of the buckets of a LinesBucketQueue: the bucket and the index of its pile.
+using LinesBucketPiles = std::vector<std::pair<const LinesBucket *, unsigned>>;
+
 class LinesBucketQueue
 {
 public:
@@ -117,6 +125,8 @@ public:
     bool        valid() const { return line_bucket_ptr_queue.empty() == false; }
     float       getCurrBottomZ();
     LineWithIDs getCurLines() const;
+    // Same as getCurLines(), but only the piles are recorded, so that the lines may be collected later.
+    LinesBucketPiles getCurPiles() const;
 };
 
 void getExtrusionPathsFromEntity(const ExtrusionEntityCollection *entity, ExtrusionPaths &paths);
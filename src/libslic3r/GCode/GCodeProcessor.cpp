@@ -17,6 +17,8 @@
 
 #include <fast_float/fast_float.h>
 
+#include <tbb/parallel_invoke.h>
+
 #include <float.h>
 #include <assert.h>
 #include <regex>
@@ -247,6 +249,8 @@ void GCodeProcessor::TimeMachine::reset()
     prev.reset();
     gcode_time.reset();
     blocks = std::vector<TimeBlock>();
+    num_queued_blocks = 0;
+    planner_steps = std::vector<PlannerStep>();
     g1_times_cache = std::vector<G1LinesCacheItem>();
     std::fill(moves_time.begin(), moves_time.end(), 0.0f);
     std::fill(roles_time.begin(), roles_time.end(), 0.0f);
@@ -298,13 +302,13 @@ void planner_reverse_pass_kernel(GCodeProcessor::TimeBlock& curr, GCodeProcessor
     }
 }
 
-static void recalculate_trapezoids(std::vector<GCodeProcessor::TimeBlock>& blocks)
+static void recalculate_trapezoids(std::vector<GCodeProcessor::TimeBlock>::iterator begin, std::vector<GCodeProcessor::TimeBlock>::iterator end)
 {
     GCodeProcessor::TimeBlock* curr = nullptr;
     GCodeProcessor::TimeBlock* next = nullptr;
 
-    for (size_t i = 0; i < blocks.size(); ++i) {
-        GCodeProcessor::TimeBlock& b = blocks[i];
+    for (auto it = begin; it != end; ++it) {
+        GCodeProcessor::TimeBlock& b = *it;
 
         curr = next;
         next = &b;
@@ -332,60 +336,81 @@ static void recalculate_trapezoids(std::vector<GCodeProcessor::TimeBlock>& block
     }
 }
 
+void GCodeProcessor::TimeMachine::push_block(const TimeBlock& block)
+{
+    blocks.push_back(block);
+    if (++num_queued_blocks > TimeProcessor::Planner::refresh_threshold)
+        calculate_time(TimeProcessor::Planner::queue_size);
+}
+
 void GCodeProcessor::TimeMachine::calculate_time(size_t keep_last_n_blocks, float additional_time)
 {
-    if (!enabled || blocks.size() < 2)
+    if (!enabled || num_queued_blocks < 2)
         return;
 
-    assert(keep_last_n_blocks <= blocks.size());
-
-    // forward_pass
-    for (size_t i = 0; i + 1 < blocks.size(); ++i) {
-        planner_forward_pass_kernel(blocks[i], blocks[i + 1]);
-    }
-
-    // reverse_pass
-    for (int i = static_cast<int>(blocks.size()) - 1; i > 0; --i)
-        planner_reverse_pass_kernel(blocks[i - 1], blocks[i]);
-
-    recalculate_trapezoids(blocks);
-
-    size_t n_blocks_process = blocks.size() - keep_last_n_blocks;
-    for (size_t i = 0; i < n_blocks_process; ++i) {
-        const TimeBlock& block = blocks[i];
-        float block_time = block.time();
-        if (i == 0)
-            block_time += additional_time;
-
-        time += block_time;
-        gcode_time.cache += block_time;
-        //BBS: don't calculate travel of start gcode into travel time
-        if (!block.flags.prepare_stage || block.move_type != EMoveType::Travel)
-            moves_time[static_cast<size_t>(block.move_type)] += block_time;
-        roles_time[static_cast<size_t>(block.role)] += block_time;
-        if (block.layer_id >= layers_time.size()) {
-            const size_t curr_size = layers_time.size();
-            layers_time.resize(block.layer_id);
-            for (size_t i = curr_size; i < layers_time.size(); ++i) {
-                layers_time[i] = 0.0f;
+    assert(keep_last_n_blocks <= num_queued_blocks);
+
+    planner_steps.push_back({ blocks.size(), keep_last_n_blocks, additional_time, stop_times.size() });
+    num_queued_blocks = keep_last_n_blocks;
+}
+
+void GCodeProcessor::TimeMachine::execute_planner_steps()
+{
+    // Index of the first block of the planner queue.
+    size_t queue_begin = 0;
+    for (const PlannerStep& step : planner_steps) {
+        auto begin = blocks.begin() + queue_begin;
+        auto end   = blocks.begin() + step.blocks_end;
+
+        // forward_pass
+        for (auto it = begin; it + 1 < end; ++it)
+            planner_forward_pass_kernel(*it, *(it + 1));
+
+        // reverse_pass
+        for (auto it = end - 1; it > begin; --it)
+            planner_reverse_pass_kernel(*(it - 1), *it);
+
+        recalculate_trapezoids(begin, end);
+
+        // Only the stop times known at the time of the request are updated.
+        auto stop_times_end = stop_times.begin() + step.num_stop_times;
+        size_t n_blocks_process = step.blocks_end - queue_begin - step.keep_last_n_blocks;
+        for (size_t i = 0; i < n_blocks_process; ++i) {
+            const TimeBlock& block = *(begin + i);
+            float block_time = block.time();
+            if (i == 0)
+                block_time += step.additional_time;
+
+            time += block_time;
+            gcode_time.cache += block_time;
+            //BBS: don't calculate travel of start gcode into travel time
+            if (!block.flags.prepare_stage || block.move_type != EMoveType::Travel)
+                moves_time[static_cast<size_t>(block.move_type)] += block_time;
+            roles_time[static_cast<size_t>(block.role)] += block_time;
+            if (block.layer_id >= layers_time.size()) {
+                const size_t curr_size = layers_time.size();
+                layers_time.resize(block.layer_id);
+                for (size_t i = curr_size; i < layers_time.size(); ++i) {
+                    layers_time[i] = 0.0f;
+                }
             }
+            layers_time[block.layer_id - 1] += block_time;
+            //BBS
+            if (block.flags.prepare_stage)
+                prepare_time += block_time;
+            g1_times_cache.push_back({ block.g1_line_id, block.remaining_internal_g1_lines, time });
+            // update times for remaining time to printer stop placeholders
+            auto it_stop_time = std::lower_bound(stop_times.begin(), stop_times_end, block.g1_line_id,
+                [](const StopTime& t, unsigned int value) { return t.g1_line_id < value; });
+            if (it_stop_time != stop_times_end && it_stop_time->g1_line_id == block.g1_line_id)
+                it_stop_time->elapsed_time = time;
         }
-        layers_time[block.layer_id - 1] += block_time;
-        //BBS
-        if (block.flags.prepare_stage)
-            prepare_time += block_time;
-        g1_times_cache.push_back({ block.g1_line_id, block.remaining_internal_g1_lines, time });
-        // update times for remaining time to printer stop placeholders
-        auto it_stop_time = std::lower_bound(stop_times.begin(), stop_times.end(), block.g1_line_id,
-            [](const StopTime& t, unsigned int value) { return t.g1_line_id < value; });
-        if (it_stop_time != stop_times.end() && it_stop_time->g1_line_id == block.g1_line_id)
-            it_stop_time->elapsed_time = time;
-    }
-
-    if (keep_last_n_blocks)
-        blocks.erase(blocks.begin(), blocks.begin() + n_blocks_process);
-    else
-        blocks.clear();
+        queue_begin += n_blocks_process;
+    }
+
+    blocks.erase(blocks.begin(), blocks.begin() + queue_begin);
+    planner_steps.clear();
+    assert(blocks.size() == num_queued_blocks);
 }
 
 void GCodeProcessor::TimeProcessor::reset()
@@ -404,6 +429,32 @@ void GCodeProcessor::TimeProcessor::reset()
     machines[static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Normal)].enabled = true;
 }
 
+void GCodeProcessor::TimeProcessor::refresh_time()
+{
+    if (std::any_of(machines.begin(), machines.end(), [](const TimeMachine &machine) { return machine.blocks.size() > Planner::execute_threshold; }))
+        execute_planner_steps();
+}
+
+void GCodeProcessor::TimeProcessor::execute_planner_steps()
+{
+    TimeMachine &normal  = machines[static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Normal)];
+    TimeMachine &stealth = machines[static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Stealth)];
+    if (!normal.planner_steps.empty() && !stealth.planner_steps.empty())
+        tbb::parallel_invoke([&normal]() { normal.execute_planner_steps(); },
+                             [&stealth]() { stealth.execute_planner_steps(); });
+    else
+        for (TimeMachine &machine : machines)
+            if (!machine.planner_steps.empty())
+                machine.execute_planner_steps();
+}
+
+void GCodeProcessor::TimeProcessor::calculate_time()
+{
+    for (TimeMachine &machine : machines)
+        machine.calculate_time();
+    execute_planner_steps();
+}
+
 void GCodeProcessor::UsedFilaments::reset()
 {
     color_change_cache = 0.0f;
@@ -557,6 +608,7 @@ void GCodeProcessorResult::reset() {
     lock();
 
     moves = std::vector<GCodeProcessorResult::MoveVertex>();
+    interpolation_points = std::vector<Vec3f>();
     printable_area = Pointfs();
     //BBS: add bed exclude area
     bed_exclude_area = Pointfs();
@@ -584,6 +636,7 @@ void GCodeProcessorResult::reset() {
     lock();
 
     moves.clear();
+    interpolation_points.clear();
     lines_ends.clear();
     printable_area = Pointfs();
     //BBS: add bed exclude area
@@ -1294,10 +1347,10 @@ void GCodeProcessor::initialize(const std::string& filename)
     m_result.moves.emplace_back(GCodeProcessorResult::MoveVertex());
 }
 
-void GCodeProcessor::process_buffer(const std::string &buffer)
+void GCodeProcessor::process_buffer(const char *buffer, size_t length)
 {
     //FIXME maybe cache GCodeLine gline to be over multiple parse_buffer() invocations.
-    m_parser.parse_buffer(buffer, [this](GCodeReader&, const GCodeReader::GCodeLine& line) { 
+    m_parser.parse_buffer(buffer, length, [this](GCodeReader&, const GCodeReader::GCodeLine& line) { 
         this->process_gcode_line(line, false);
     });
 }
@@ -1313,10 +1366,10 @@ void GCodeProcessor::finalize(bool post_process)
     }
 
     // process the time blocks
+    m_time_processor.calculate_time();
     for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
         TimeMachine& machine = m_time_processor.machines[i];
         TimeMachine::CustomGCodeTime& gcode_time = machine.gcode_time;
-        machine.calculate_time();
         if (gcode_time.needed && gcode_time.cache != 0.0f)
             gcode_time.times.push_back({ CustomGCode::ColorChange, gcode_time.cache });
     }
@@ -2746,7 +2799,6 @@ void GCodeProcessor::process_G1(const GCodeReader::GCodeLine& line, const std::o
 
         TimeMachine::State& curr = machine.curr;
         TimeMachine::State& prev = machine.prev;
-        std::vector<TimeBlock>& blocks = machine.blocks;
 
         curr.feedrate = (delta_pos[E] == 0.0f) ?
             minimum_travel_feedrate(static_cast<PrintEstimatedStatistics::ETimeMode>(i), m_feedrate) :
@@ -2850,7 +2902,7 @@ void GCodeProcessor::process_G1(const GCodeReader::GCodeLine& line, const std::o
 
         // calculates block entry feedrate
         float vmax_junction = curr.safe_feedrate;
-        if (!blocks.empty() && prev.feedrate > PREVIOUS_FEEDRATE_THRESHOLD) {
+        if (machine.num_queued_blocks > 0 && prev.feedrate > PREVIOUS_FEEDRATE_THRESHOLD) {
             bool prev_speed_larger = prev.feedrate > block.feedrate_profile.cruise;
             float smaller_speed_factor = prev_speed_larger ? (block.feedrate_profile.cruise / prev.feedrate) : (prev.feedrate / block.feedrate_profile.cruise);
             // Pick the smaller of the nominal speeds. Higher speed shall not be achieved at the junction during coasting.
@@ -2944,12 +2996,11 @@ void GCodeProcessor::process_G1(const GCodeReader::GCodeLine& line, const std::o
         // updates previous
         prev = curr;
 
-        blocks.push_back(block);
-
-        if (blocks.size() > TimeProcessor::Planner::refresh_threshold)
-            machine.calculate_time(TimeProcessor::Planner::queue_size);
+        machine.push_block(block);
     }
 
+    m_time_processor.refresh_time();
+
     const Vec3f plate_offset = {(float) m_x_offset, (float) m_y_offset, 0.0f};
 
     if (m_seams_detector.is_active()) {
@@ -3204,7 +3255,6 @@ void  GCodeProcessor::process_G2_G3(const GCodeReader::GCodeLine& line)
 
         TimeMachine::State& curr = machine.curr;
         TimeMachine::State& prev = machine.prev;
-        std::vector<TimeBlock>& blocks = machine.blocks;
 
         curr.feedrate = (type == EMoveType::Travel) ?
             minimum_travel_feedrate(static_cast<PrintEstimatedStatistics::ETimeMode>(i), m_feedrate) :
@@ -3286,7 +3336,7 @@ void  GCodeProcessor::process_G2_G3(const GCodeReader::GCodeLine& line)
         //BBS: calculates block entry feedrate
         static const float PREVIOUS_FEEDRATE_THRESHOLD = 0.0001f;
         float vmax_junction = curr.safe_feedrate;
-        if (!blocks.empty() && prev.feedrate > PREVIOUS_FEEDRATE_THRESHOLD) {
+        if (machine.num_queued_blocks > 0 && prev.feedrate > PREVIOUS_FEEDRATE_THRESHOLD) {
             bool prev_speed_larger = prev.feedrate > block.feedrate_profile.cruise;
             float smaller_speed_factor = prev_speed_larger ? (block.feedrate_profile.cruise / prev.feedrate) : (prev.feedrate / block.feedrate_profile.cruise);
             //BBS: Pick the smaller of the nominal speeds. Higher speed shall not be achieved at the junction during coasting.
@@ -3379,12 +3429,11 @@ void  GCodeProcessor::process_G2_G3(const GCodeReader::GCodeLine& line)
         //BBS: updates previous
         prev = curr;
 
-        blocks.push_back(block);
-
-        if (blocks.size() > TimeProcessor::Planner::refresh_threshold)
-            machine.calculate_time(TimeProcessor::Planner::queue_size);
+        machine.push_block(block);
     }
 
+    m_time_processor.refresh_time();
+
     //BBS: seam detector
     Vec3f plate_offset = {(float) m_x_offset, (float) m_y_offset, 0.0f};
 
@@ -4687,9 +4736,9 @@ void GCodeProcessor::run_post_process()
             auto it_bufend = buffer.begin() + cnt_read;
             while (it != it_bufend || (eof && !gcode_line.empty())) {
                 // Find end of line.
-                bool eol = false;
-                auto it_end = it;
-                for (; it_end != it_bufend && !(eol = *it_end == '\r' || *it_end == '\n'); ++it_end);
+                const char *line_begin = buffer.data() + (it - buffer.begin());
+                auto it_end = it + (GCodeReader::find_end_of_line(line_begin, buffer.data() + cnt_read) - line_begin);
+                bool eol = it_end != it_bufend;
                 // End of line is indicated also if end of file was reached.
                 eol |= eof && it_end == it_bufend;
                 gcode_line.insert(gcode_line.end(), it, it_end);
@@ -4768,14 +4817,15 @@ void GCodeProcessor::store_move_vertex(EMoveType type, EMovePathType path_type)
         ((type == EMoveType::Seam) ? m_last_line_id : m_line_id);
 
     //BBS: apply plate's and extruder's offset to arc interpolation points
+    const uint32_t interpolation_points_offset = uint32_t(m_result.interpolation_points.size());
     if (path_type == EMovePathType::Arc_move_cw ||
         path_type == EMovePathType::Arc_move_ccw) {
         for (size_t i = 0; i < m_interpolation_points.size(); i++)
-            m_interpolation_points[i] =
+            m_result.interpolation_points.emplace_back(
                 Vec3f(m_interpolation_points[i].x() + m_x_offset,
                       m_interpolation_points[i].y() + m_y_offset,
                       m_processing_start_custom_gcode ? m_first_layer_height : m_interpolation_points[i].z()) +
-                m_extruder_offsets[m_extruder_id];
+                m_extruder_offsets[m_extruder_id]);
     }
 
     m_result.moves.push_back({
@@ -4799,7 +4849,8 @@ void GCodeProcessor::store_move_vertex(EMoveType type, EMovePathType path_type)
         //BBS: add arc move related data
         path_type,
         Vec3f(m_arc_center(0, 0) + m_x_offset, m_arc_center(1, 0) + m_y_offset, m_arc_center(2, 0)) + m_extruder_offsets[m_extruder_id],
-        m_interpolation_points,
+        interpolation_points_offset,
+        uint32_t(m_result.interpolation_points.size()) - interpolation_points_offset
     });
 
     if (type == EMoveType::Seam) {
@@ -4959,11 +5010,20 @@ void GCodeProcessor::process_custom_gcode_time(CustomGCode::Type code)
         if (!machine.enabled)
             continue;
 
-        TimeMachine::CustomGCodeTime& gcode_time = machine.gcode_time;
-        gcode_time.needed = true;
+        machine.gcode_time.needed = true;
         //FIXME this simulates st_synchronize! is it correct?
         // The estimated time may be longer than the real print time.
         machine.simulate_st_synchronize();
+    }
+    // gcode_time.cache is up to date once the requested planner runs are executed.
+    m_time_processor.execute_planner_steps();
+
+    for (size_t i = 0; i < static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count); ++i) {
+        TimeMachine& machine = m_time_processor.machines[i];
+        if (!machine.enabled)
+            continue;
+
+        TimeMachine::CustomGCodeTime& gcode_time = machine.gcode_time;
         if (gcode_time.cache != 0.0f) {
             gcode_time.times.push_back({ code, gcode_time.cache });
             gcode_time.cache = 0.0f;
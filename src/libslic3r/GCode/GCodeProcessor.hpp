@@ -172,12 +172,15 @@ class Print;
             //BBS: arc move related data
             EMovePathType move_path_type{ EMovePathType::Noop_move };
             Vec3f arc_center_position{ Vec3f::Zero() };      // mm
-            std::vector<Vec3f> interpolation_points;     // interpolation points of arc for drawing
+            // interpolation points of arc for drawing, stored as a range of GCodeProcessorResult::interpolation_points
+            // to avoid a heap allocation per move
+            uint32_t interpolation_points_offset{ 0 };
+            uint32_t interpolation_points_count{ 0 };
 
             float volumetric_rate() const { return feedrate * mm3_per_mm; }
             //BBS: new function to support arc move
             bool is_arc_move_with_interpolation_points() const {
-                return (move_path_type == EMovePathType::Arc_move_ccw || move_path_type == EMovePathType::Arc_move_cw) && interpolation_points.size();
+                return (move_path_type == EMovePathType::Arc_move_ccw || move_path_type == EMovePathType::Arc_move_cw) && interpolation_points_count > 0;
             }
             bool is_arc_move() const {
                 return move_path_type == EMovePathType::Arc_move_ccw || move_path_type == EMovePathType::Arc_move_cw;
@@ -194,6 +197,8 @@ class Print;
         std::string filename;
         unsigned int id;
         std::vector<MoveVertex> moves;
+        // Interpolation points of all the arc moves, referenced by MoveVertex::interpolation_points_offset / count.
+        std::vector<Vec3f> interpolation_points;
         // Positions of ends of lines of the final G-code this->filename after TimeProcessor::post_process() finalizes the G-code.
         std::vector<size_t> lines_ends;
         Pointfs printable_area;
@@ -230,6 +235,12 @@ class Print;
 #endif // ENABLE_GCODE_VIEWER_STATISTICS
         void reset();
 
+        // i-th interpolation point of the arc move
+        const Vec3f& interpolation_point(const MoveVertex &move, size_t i) const {
+            assert(i < move.interpolation_points_count);
+            return interpolation_points[move.interpolation_points_offset + i];
+        }
+
         //BBS: add mutex for protection of gcode result
         mutable std::mutex result_mutex;
         GCodeProcessorResult& operator=(const GCodeProcessorResult &other)
@@ -237,6 +248,7 @@ class Print;
             filename = other.filename;
             id = other.id;
             moves = other.moves;
+            interpolation_points = other.interpolation_points;
             lines_ends = other.lines_ends;
             printable_area = other.printable_area;
             bed_exclude_area = other.bed_exclude_area;
@@ -434,6 +446,17 @@ class Print;
                 float elapsed_time;
             };
 
+            // Planner run requested by calculate_time(), executed later by execute_planner_steps().
+            struct PlannerStep
+            {
+                // One past the last block of the planner queue.
+                size_t blocks_end;
+                size_t keep_last_n_blocks;
+                float additional_time;
+                // Number of the stop_times known at the time of the request.
+                size_t num_stop_times;
+            };
+
             bool enabled;
             float acceleration; // mm/s^2
             // hard limit for the acceleration, to which the firmware will clamp.
@@ -458,6 +481,9 @@ class Print;
             State prev;
             CustomGCodeTime gcode_time;
             std::vector<TimeBlock> blocks;
+            // Number of the blocks at the end of blocks, which are not consumed by the planner_steps yet.
+            size_t num_queued_blocks;
+            std::vector<PlannerStep> planner_steps;
             std::vector<G1LinesCacheItem> g1_times_cache;
             std::array<float, static_cast<size_t>(EMoveType::Count)> moves_time;
             std::array<float, static_cast<size_t>(ExtrusionRole::erCount)> roles_time;
@@ -469,7 +495,12 @@ class Print;
 
             // Simulates firmware st_synchronize() call
             void simulate_st_synchronize(float additional_time = 0.0f);
+            // Appends a block to the planner queue, requests a planner run once the queue exceeds Planner::refresh_threshold.
+            void push_block(const TimeBlock& block);
+            // Requests a planner run over the queued blocks, which is executed by execute_planner_steps().
             void calculate_time(size_t keep_last_n_blocks = 0, float additional_time = 0.0f);
+            // Executes the requested planner runs in order and drops the blocks they consumed.
+            void execute_planner_steps();
         };
 
         struct TimeProcessor
@@ -482,6 +513,9 @@ class Print;
                 // The firmware recalculates last planner_queue_size trapezoidal blocks each time a new block is added.
                 // We are not simulating the firmware exactly, we calculate a sequence of blocks once a reasonable number of blocks accumulate.
                 static constexpr size_t refresh_threshold = queue_size * 4;
+                // The requested planner runs are executed in batches once a machine collects this many blocks,
+                // so that the Normal and Stealth machines are processed concurrently in large tasks.
+                static constexpr size_t execute_threshold = refresh_threshold * 64;
             };
 
             // extruder_id is currently used to correctly calculate filament load / unload times into the total print time.
@@ -500,6 +534,13 @@ class Print;
             std::array<TimeMachine, static_cast<size_t>(PrintEstimatedStatistics::ETimeMode::Count)> machines;
 
             void reset();
+            // Execute the requested planner runs of the machines once one of them collected more than Planner::execute_threshold blocks.
+            void refresh_time();
+            // Execute the requested planner runs of all the machines. The machines are independent of each other,
+            // thus the Normal and Stealth machines are processed concurrently.
+            void execute_planner_steps();
+            // Process all the queued blocks of all the machines.
+            void calculate_time();
         };
 
         struct UsedFilaments  // filaments per ColorChange
@@ -790,7 +831,9 @@ class Print;
 
         // Streaming interface, for processing G-codes just generated by PrusaSlicer in a pipelined fashion.
         void initialize(const std::string& filename);
-        void process_buffer(const std::string& buffer);
+        void process_buffer(const std::string& buffer) { this->process_buffer(buffer.c_str(), buffer.size()); }
+        // Process a chunk of G-code as it is being exported, without copying it. The chunk has to be zero terminated.
+        void process_buffer(const char* buffer, size_t length);
         void finalize(bool post_process);
 
         float get_time(PrintEstimatedStatistics::ETimeMode mode) const;
@@ -11,6 +11,7 @@
 #include <queue>
 
 #include "libslic3r/AABBTreeLines.hpp"
+#include "libslic3r/AABBTreeWide.hpp"
 #include "libslic3r/KDTreeIndirect.hpp"
 #include "libslic3r/ExtrusionEntity.hpp"
 #include "libslic3r/Print.hpp"
@@ -125,7 +126,7 @@ Vec3f sample_power_cosine_hemisphere(const Vec2f &samples, float power) {
   return Vec3f(cos(term1) * term3, sin(term1) * term3, term2);
 }
 
-std::vector<float> raycast_visibility(const AABBTreeIndirect::Tree<3, float> &raycasting_tree,
+std::vector<float> raycast_visibility(const AABBTreeIndirect::WideTree &raycasting_tree,
                                       const indexed_triangle_set &triangles,
                                       const TriangleSetSamples &samples,
                                       size_t negative_volumes_start_index) {
@@ -685,8 +686,8 @@ void compute_global_occlusion(GlobalModelInfo &result, const PrintObject *po,
 
   BOOST_LOG_TRIVIAL(debug)
       << "SeamPlacer: build AABB tree: start";
-  auto raycasting_tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(triangle_set.vertices,
-                                                                                     triangle_set.indices);
+  AABBTreeIndirect::WideTree raycasting_tree;
+  raycasting_tree.build(triangle_set);
 
   throw_if_canceled();
   BOOST_LOG_TRIVIAL(debug)
@@ -4,9 +4,12 @@
 #include <boost/log/trivial.hpp>
 #include <boost/nowide/fstream.hpp>
 #include <boost/nowide/cstdio.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <cctype>
 #include "Utils.hpp"
 
 #include "LocalesUtils.hpp"
@@ -14,6 +17,10 @@
 #include <Shiny/Shiny.h>
 #include <fast_float/fast_float.h>
 
+#ifndef _WIN32
+    #include <sys/mman.h>
+#endif
+
 namespace Slic3r {
 
 void GCodeReader::apply_config(const GCodeConfig &config)
@@ -122,16 +129,66 @@ void GCodeReader::update_coordinates(GCodeLine &gline, std::pair<const char*, co
     }
 }
 
+template<typename ParseLineCallback, typename LineEndCallback>
+bool GCodeReader::parse_buffer_raw_internal(const char *begin, const char *end, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback)
+{
+    // Line buffer, only used for the last line of the file. The line parser expects the line to be followed
+    // by an end of line character and it may peek one character past it, which could be past the mapped memory.
+    std::string gcode_line;
+    m_parsing = true;
+    for (const char *it = begin; it != end;) {
+        const char *it_end = find_end_of_line(it, end);
+        if (it_end + 1 >= end) {
+            gcode_line.assign(it, it_end);
+            parse_line_callback(gcode_line.c_str(), gcode_line.c_str() + gcode_line.size());
+        } else
+            parse_line_callback(it, it_end);
+        if (! m_parsing)
+            // The callback wishes to exit.
+            return true;
+        // Skip EOL.
+        it = it_end;
+        if (it != end && *it == '\r')
+            ++ it;
+        if (it != end && *it == '\n') {
+            line_end_callback(it - begin + 1);
+            ++ it;
+        }
+    }
+    return true;
+}
+
 template<typename ParseLineCallback, typename LineEndCallback>
 bool GCodeReader::parse_file_raw_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback)
 {
+    // Parse the memory mapped file in place, without copying it into a buffer.
+    boost::iostreams::mapped_file_source mapped_file;
+    try {
+        // Mapping of an empty file fails.
+        if (m_memory_mapping && boost::filesystem::file_size(boost::filesystem::path(filename)) > 0)
+            mapped_file.open(boost::filesystem::path(filename));
+    } catch (...) {
+        // Fall back to reading the file through a buffer, for example if the address space is exhausted.
+        BOOST_LOG_TRIVIAL(info) << "Unable to map file " << filename << ", reading it through a buffer.";
+    }
+    if (mapped_file.is_open()) {
+#ifndef _WIN32
+        ::madvise(const_cast<char*>(mapped_file.data()), mapped_file.size(), MADV_SEQUENTIAL);
+#endif
+        return this->parse_buffer_raw_internal(mapped_file.data(), mapped_file.data() + mapped_file.size(), parse_line_callback, line_end_callback);
+    }
+
     FilePtr in{ boost::nowide::fopen(filename.c_str(), "rb") };
+    if (in.f == nullptr)
+        return false;
 
     // Read the input stream 64kB at a time, extract lines and process them.
     std::vector<char> buffer(65536 * 10, 0);
     // Line buffer.
     std::string gcode_line;
     size_t file_pos = 0;
+    // The previous block ended with '\r', which may be followed by '\n' at the start of this block.
+    bool   cr_at_block_end = false;
     m_parsing = true;
     for (;;) {
         size_t cnt_read = ::fread(buffer.data(), 1, buffer.size(), in.f);
@@ -140,13 +197,16 @@ bool GCodeReader::parse_file_raw_internal(const std::string &filename, ParseLine
         bool eof       = cnt_read == 0;
         auto it        = buffer.begin();
         auto it_bufend = buffer.begin() + cnt_read;
+        if (cr_at_block_end && it != it_bufend && *it == '\n') {
+            line_end_callback(file_pos + 1);
+            ++ it;
+        }
+        cr_at_block_end = false;
         while (it != it_bufend || (eof && ! gcode_line.empty())) {
             // Find end of line.
-            bool eol    = false;
-            auto it_end = it;
-            for (; it_end != it_bufend && ! (eol = *it_end == '\r' || *it_end == '\n'); ++ it_end)
-                if (*it_end == '\n')
-                    line_end_callback(file_pos + (it_end - buffer.begin()) + 1);
+            const char *line_begin = buffer.data() + (it - buffer.begin());
+            auto it_end = it + (find_end_of_line(line_begin, buffer.data() + cnt_read) - line_begin);
+            bool eol    = it_end != it_bufend;
             // End of line is indicated also if end of file was reached.
             eol |= eof && it_end == it_bufend;
             if (eol) {
@@ -164,8 +224,10 @@ bool GCodeReader::parse_file_raw_internal(const std::string &filename, ParseLine
                 gcode_line.insert(gcode_line.end(), it, it_end);
             // Skip EOL.
             it = it_end; 
-            if (it != it_bufend && *it == '\r')
+            if (it != it_bufend && *it == '\r') {
                 ++ it;
+                cr_at_block_end = it == it_bufend;
+            }
             if (it != it_bufend && *it == '\n') {
                 line_end_callback(file_pos + (it - buffer.begin()) + 1);
                 ++ it;
@@ -260,10 +322,20 @@ bool GCodeReader::GCodeLine::has_value(char axis, float &value) const
             break;
         // Check the name of the axis.
         if (*c == axis) {
-            // Try to parse the numeric value.
-            char   *pend = nullptr;
-            double  v = strtod(++ c, &pend);
-            if (pend != nullptr && is_end_of_word(*pend)) {
+            // Try to parse the numeric value. Accept the input accepted by strtod(), which was used before:
+            // Leading whitespaces and '+' sign, which fast_float rejects, and an empty value parsed as zero.
+            const char *pstart = ++ c;
+            const char *pnum   = pstart;
+            while (std::isspace(static_cast<unsigned char>(*pnum)))
+                ++ pnum;
+            if (*pnum == '+' && pnum[1] != '-' && pnum[1] != '+')
+                ++ pnum;
+            double v = 0.;
+            auto [pend, ec] = fast_float::from_chars(pnum, m_raw.c_str() + m_raw.size(), v);
+            if (ec == std::errc::invalid_argument)
+                // No conversion, as if strtod() returned zero.
+                pend = pstart;
+            if (is_end_of_word(*pend)) {
                 // The axis value has been parsed correctly.
                 value = float(v);
                 return true;
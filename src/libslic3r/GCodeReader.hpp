@@ -4,6 +4,7 @@
 #include "libslic3r.h"
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <string>
 #include <string_view>
@@ -107,9 +108,15 @@ public:
 
     template<typename Callback>
     void parse_buffer(const std::string &buffer, Callback callback)
+        { this->parse_buffer(buffer.c_str(), buffer.size(), callback); }
+
+    // Parse a buffer of G-code lines without copying it. The buffer has to be zero terminated at buffer[length].
+    template<typename Callback>
+    void parse_buffer(const char *buffer, size_t length, Callback callback)
     {
-        const char *ptr = buffer.c_str();
-        const char *end = ptr + buffer.size();
+        assert(buffer[length] == 0);
+        const char *ptr = buffer;
+        const char *end = ptr + length;
         GCodeLine gline;
         m_parsing = true;
         while (m_parsing && *ptr != 0) {
@@ -146,6 +153,21 @@ public:
     // To be called by the callback to stop parsing.
     void quit_parsing() { m_parsing = false; }
 
+    // The files are parsed from a memory mapping by default. If disabled, they are read through a buffer,
+    // as they are when the mapping fails.
+    void set_memory_mapping(bool enable) { m_memory_mapping = enable; }
+
+    // Returns pointer to the first '\r' or '\n' in <begin, end), or end if there is none.
+    // memchr() is vectorized by the C runtime, which is considerably faster than testing the characters one by one.
+    static const char* find_end_of_line(const char *begin, const char *end) {
+        const char *eol = static_cast<const char*>(::memchr(begin, '\n', end - begin));
+        if (eol == nullptr)
+            eol = end;
+        if (const char *cr = static_cast<const char*>(::memchr(begin, '\r', eol - begin)); cr != nullptr)
+            eol = cr;
+        return eol;
+    }
+
     float& x()       { return m_position[X]; }
     float  x() const { return m_position[X]; }
     float& y()       { return m_position[Y]; }
@@ -163,6 +185,8 @@ public:
     float  j() const { return m_position[J]; }
 
 private:
+    template<typename ParseLineCallback, typename LineEndCallback>
+    bool        parse_buffer_raw_internal(const char *begin, const char *end, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback);
     template<typename ParseLineCallback, typename LineEndCallback>
     bool        parse_file_raw_internal(const std::string &filename, ParseLineCallback parse_line_callback, LineEndCallback line_end_callback);
     template<typename ParseLineCallback, typename LineEndCallback>
@@ -191,6 +215,7 @@ private:
     bool        m_verbose;
     // To be set by the callback to stop parsing.
     bool        m_parsing{ false };
+    bool        m_memory_mapping{ true };
 };
 
 } /* namespace Slic3r */
@@ -248,6 +248,49 @@ void Layer::make_perimeters()
     BOOST_LOG_TRIVIAL(trace) << "Generating perimeters for layer " << this->id() << " - Done";
 }
 
+void Layer::backup_perimeters()
+{
+    for (LayerRegion *layerm : m_regions) {
+        if (layerm->slices.empty()) {
+            // Layer::make_perimeters() produces nothing for an empty region, there is nothing to back up.
+            layerm->perimeters_backup.reset();
+            continue;
+        }
+        if (! layerm->perimeters_backup)
+            layerm->perimeters_backup = std::make_unique<LayerRegion::PerimetersBackup>();
+        LayerRegion::PerimetersBackup &backup = *layerm->perimeters_backup;
+        backup.perimeters                 = layerm->perimeters;
+        backup.thin_fills                 = layerm->thin_fills;
+        backup.fill_surfaces              = layerm->fill_surfaces;
+        backup.fill_expolygons            = layerm->fill_expolygons;
+        backup.fill_no_overlap_expolygons = layerm->fill_no_overlap_expolygons;
+    }
+}
+
+bool Layer::restore_perimeters()
+{
+    for (const LayerRegion *layerm : m_regions)
+        if (! layerm->slices.empty() && ! layerm->perimeters_backup)
+            return false;
+    BOOST_LOG_TRIVIAL(trace) << "Restoring perimeters for layer " << this->id();
+    for (LayerRegion *layerm : m_regions) {
+        if (layerm->slices.empty()) {
+            // Same as Layer::make_perimeters() does for an empty region.
+            layerm->perimeters.clear();
+            layerm->fills.clear();
+            layerm->thin_fills.clear();
+            continue;
+        }
+        const LayerRegion::PerimetersBackup &backup = *layerm->perimeters_backup;
+        layerm->perimeters                 = backup.perimeters;
+        layerm->thin_fills                 = backup.thin_fills;
+        layerm->fill_surfaces              = backup.fill_surfaces;
+        layerm->fill_expolygons            = backup.fill_expolygons;
+        layerm->fill_no_overlap_expolygons = backup.fill_no_overlap_expolygons;
+    }
+    return true;
+}
+
 void Layer::export_region_slices_to_svg(const char *path) const
 {
     BoundingBox bbox;
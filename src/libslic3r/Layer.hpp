@@ -71,6 +71,17 @@ public:
     // (this collection contains only ExtrusionEntityCollection objects)
     ExtrusionEntityCollection   fills;
 
+    // Output of the perimeter generator backed up by PrintObject::make_perimeters() for objects with multiple layer ranges,
+    // so that the layers not affected by a layer range config change are restored instead of being regenerated.
+    struct PerimetersBackup {
+        ExtrusionEntityCollection   perimeters;
+        ExtrusionEntityCollection   thin_fills;
+        SurfaceCollection           fill_surfaces;
+        ExPolygons                  fill_expolygons;
+        ExPolygons                  fill_no_overlap_expolygons;
+    };
+    std::unique_ptr<PerimetersBackup> perimeters_backup;
+
     Flow    flow(FlowRole role) const;
     Flow    flow(FlowRole role, double layer_height) const;
     Flow    bridging_flow(FlowRole role, bool thick_bridge = false) const;
@@ -181,6 +192,11 @@ public:
         return false;
     }
     void                    make_perimeters();
+    // Back up the output of make_perimeters() of all regions with non-empty slices, see LayerRegion::perimeters_backup.
+    void                    backup_perimeters();
+    // Restore the output of make_perimeters() from the backup. Returns false if any of the non-empty regions has not been backed up.
+    bool                    restore_perimeters();
+    void                    clear_perimeters_backup() { for (LayerRegion *layerm : m_regions) layerm->perimeters_backup.reset(); }
     // Phony version of make_fills() without parameters for Perl integration only.
     void                    make_fills() { this->make_fills(nullptr, nullptr); }
     void                    make_fills(FillAdaptive::Octree* adaptive_fill_octree, FillAdaptive::Octree* support_fill_octree, FillLightning::Generator* lightning_generator = nullptr);
@@ -2,11 +2,15 @@
 #include "Exception.hpp"
 #include "Flow.hpp"
 #include "Utils.hpp"
+#include <cctype>
 #include <cstring>
 #include <ctime>
 #include <iomanip>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <map>
+#include <unordered_map>
 #ifdef _MSC_VER
     #include <stdlib.h>  // provides **_environ
 #else
@@ -793,6 +797,8 @@ namespace client
         // If true, the macro processor will evaluate just a boolean condition using the full expressive power of the macro processor.
         bool                     just_boolean_expression = false;
         std::string              error_message;
+        // If set, a segment of this template is being parsed and the parsing errors are reported relative to the whole template.
+        const std::string       *whole_template         = nullptr;
 
         // Table to translate symbol tag to a human readable error message.
         static std::map<std::string, std::string> tag_to_error_message;
@@ -1565,8 +1571,8 @@ namespace client
         static void process_error_message(const MyContext *context, const boost::spirit::info &info, const Iterator &it_begin, const Iterator &it_end, const Iterator &it_error)
         {
             std::string &msg = const_cast<MyContext*>(context)->error_message;
-            std::string  first(it_begin, it_error);
-            std::string  last(it_error, it_end);
+            std::string  first(context->whole_template ? context->whole_template->begin() : it_begin, it_error);
+            std::string  last(it_error, context->whole_template ? context->whole_template->end() : it_end);
             auto         first_pos  = first.rfind('\n');
             auto         last_pos   = last.find('\n');
             int          line_nr    = 1;
@@ -1581,7 +1587,7 @@ namespace client
             }
             auto error_line = std::string(first, first_pos) + std::string(last, 0, last_pos);
             // Position of the it_error from the start of its line.
-            auto error_pos  = (it_error - it_begin) - first_pos;
+            auto error_pos  = first.size() - first_pos;
             msg += "Parsing error at line " + std::to_string(line_nr);
             if (! info.tag.empty() && info.tag.front() == '*') {
                 // The gat contains an explanatory string.
@@ -2327,32 +2333,711 @@ namespace client
 
         qi::symbols<char> keywords;
     };
+
+    // An expression or a legacy variable expansion compiled into a tree of the semantic actions of the macro_processor grammar,
+    // called in the order the grammar calls them, thus the results and the error messages match the expansion by the grammar.
+    struct CompiledExpression
+    {
+        enum class Type {
+            // Variable, optionally indexed by lhs.
+            Variable,
+            Parentheses,
+            Minus,
+            Plus,
+            Not,
+            Min,
+            Max,
+            ToInt,
+            Round,
+            DoubleLiteral,
+            IntLiteral,
+            BoolLiteral,
+            StringLiteral,
+            Multiply,
+            Divide,
+            Modulo,
+            Add,
+            Subtract,
+            Lower,
+            Greater,
+            Leq,
+            Geq,
+            Equal,
+            NotEqual,
+            And,
+            Or,
+            // [variable] or [variable_index]
+            LegacyVariable,
+            // [variable[index_variable]]
+            LegacyIndexedVariable,
+        };
+        Type                                type;
+        // Start of a unary expression, name of a variable, a string literal including the quotes.
+        IteratorRange                       range;
+        // End of a parenthesized expression, of an indexed variable or of a numeric literal.
+        Iterator                            end_pos;
+        // Name of the index variable of LegacyIndexedVariable.
+        IteratorRange                       index_range;
+        double                              d { 0. };
+        int                                 i { 0 };
+        bool                                b { false };
+        std::unique_ptr<CompiledExpression> lhs;
+        std::unique_ptr<CompiledExpression> rhs;
+
+        void evaluate(const MyContext *ctx, expr &out) const
+        {
+            // The unary expressions start with the position of their first token.
+            auto start = [this, &out]() { out.it_range = IteratorRange(range.begin(), range.begin()); };
+            expr param;
+            switch (type) {
+            case Type::Variable:
+            {
+                OptWithPos    opt;
+                IteratorRange name = range;
+                MyContext::resolve_variable(ctx, name, opt);
+                if (lhs) {
+                    int index = 0;
+                    lhs->evaluate(ctx, param);
+                    MyContext::evaluate_index(param, index);
+                    OptWithPos indexed;
+                    MyContext::store_variable_index(ctx, opt, index, end_pos, indexed);
+                    opt = indexed;
+                }
+                start();
+                MyContext::variable_value(ctx, opt, out);
+                break;
+            }
+            case Type::Parentheses:
+            case Type::Plus:
+            {
+                lhs->evaluate(ctx, param);
+                Iterator end = end_pos;
+                start();
+                FactorActions::expr_(param, end, out);
+                break;
+            }
+            case Type::Minus:   lhs->evaluate(ctx, param); start(); FactorActions::minus_(param, out); break;
+            case Type::Not:     lhs->evaluate(ctx, param); start(); FactorActions::not_(param, out); break;
+            case Type::ToInt:   lhs->evaluate(ctx, param); start(); FactorActions::to_int(param, out); break;
+            case Type::Round:   lhs->evaluate(ctx, param); start(); FactorActions::round(param, out); break;
+            case Type::Min:     lhs->evaluate(ctx, out); rhs->evaluate(ctx, param); expr::min(out, param); break;
+            case Type::Max:     lhs->evaluate(ctx, out); rhs->evaluate(ctx, param); expr::max(out, param); break;
+            case Type::DoubleLiteral: { double v = d; Iterator end = end_pos; start(); FactorActions::double_(ctx, v, end, out); break; }
+            case Type::IntLiteral:    { int    v = i; Iterator end = end_pos; start(); FactorActions::int_(ctx, v, end, out); break; }
+            case Type::BoolLiteral:   { bool   v = b; Iterator end = end_pos; start(); FactorActions::bool_(ctx, v, end, out); break; }
+            case Type::StringLiteral: { IteratorRange literal = range; FactorActions::string_(ctx, literal, out); break; }
+            default:
+                // Binary operators.
+                lhs->evaluate(ctx, out);
+                rhs->evaluate(ctx, param);
+                switch (type) {
+                case Type::Multiply: out *= param; break;
+                case Type::Divide:   out /= param; break;
+                case Type::Modulo:   out %= param; break;
+                case Type::Add:      out += param; break;
+                case Type::Subtract: out -= param; break;
+                case Type::Lower:    expr::lower(out, param); break;
+                case Type::Greater:  expr::greater(out, param); break;
+                case Type::Leq:      expr::leq(out, param); break;
+                case Type::Geq:      expr::geq(out, param); break;
+                case Type::Equal:    expr::equal(out, param); break;
+                case Type::NotEqual: expr::not_equal(out, param); break;
+                case Type::And:      expr::logical_and(out, param); break;
+                case Type::Or:       expr::logical_or(out, param); break;
+                default:             assert(false);
+                }
+            }
+        }
+
+        void expand(const MyContext *ctx, std::string &out) const
+        {
+            IteratorRange name = range;
+            if (type == Type::LegacyVariable) {
+                MyContext::legacy_variable_expansion(ctx, name, out);
+            } else if (type == Type::LegacyIndexedVariable) {
+                IteratorRange index = index_range;
+                MyContext::legacy_variable_expansion2(ctx, name, index, out);
+            } else {
+                expr value;
+                this->evaluate(ctx, value);
+                expr::to_string2(value, out);
+            }
+        }
+
+        bool evaluate_boolean(const MyContext *ctx) const
+        {
+            expr value;
+            bool out = false;
+            this->evaluate(ctx, value);
+            expr::evaluate_boolean(value, out);
+            return out;
+        }
+    };
 }
 
 static const client::macro_processor g_macro_processor_instance;
 
-static std::string process_macro(const std::string &templ, client::MyContext &context)
+static void throw_if_error(client::MyContext &context)
 {
-    std::string output;
-    phrase_parse(templ.begin(), templ.end(), g_macro_processor_instance(&context), client::skipper{}, output);
 	if (! context.error_message.empty()) {
         if (context.error_message.back() != '\n' && context.error_message.back() != '\r')
             context.error_message += '\n';
         throw Slic3r::PlaceholderParserError(context.error_message);
     }
+}
+
+static std::string process_macro(client::Iterator begin, client::Iterator end, client::MyContext &context)
+{
+    std::string output;
+    phrase_parse(begin, end, g_macro_processor_instance(&context), client::skipper{}, output);
+    throw_if_error(context);
     return output;
 }
 
+static std::string process_macro(const std::string &templ, client::MyContext &context)
+{
+    return process_macro(templ.begin(), templ.end(), context);
+}
+
+// A template compiled into a tree of free-form texts, which are copied to the output verbatim, of macros, and of the
+// {if}{elsif}{else}{endif} blocks enclosing texts. The macro processor then parses neither the free-form texts, which make up
+// most of a custom G-code, nor the inactive conditional blocks. The macros and the conditions made of just an expression
+// or of a legacy variable expansion are compiled, the others are expanded by the macro processor sharing a single context.
+struct CompiledTemplate
+{
+    struct Branch;
+    struct Node
+    {
+        enum class Type {
+            Text,
+            Macro,
+            Conditional,
+        };
+        Type                                        type;
+        // Range of the template string for Text and Macro.
+        size_t                                      begin;
+        size_t                                      end;
+        // Compiled Macro, if null, the macro is expanded by the macro processor.
+        std::unique_ptr<client::CompiledExpression> expression;
+        // Branches of a Conditional, the first one with a true condition is expanded.
+        std::vector<Branch>                         branches;
+    };
+    struct Branch
+    {
+        // Range of the condition, empty for the "else" branch.
+        size_t                                      condition_begin;
+        size_t                                      condition_end;
+        // Compiled condition, if null, the condition is evaluated by the macro processor.
+        std::unique_ptr<client::CompiledExpression> condition;
+        std::vector<Node>                           body;
+    };
+    // The compiled expressions point into this copy of the template.
+    std::string       templ;
+    std::vector<Node> nodes;
+};
+
+namespace {
+
+// Compiler of an expression to client::CompiledExpression following the macro_processor grammar.
+// Only the operators, functions and literals used by the usual custom G-codes are compiled, the compiler gives up
+// on the others, for example the ternary operator, the regular expressions or the random() function.
+class ExpressionCompiler
+{
+public:
+    using Iterator      = client::Iterator;
+    using IteratorRange = client::IteratorRange;
+    using Expression    = std::unique_ptr<client::CompiledExpression>;
+    using Type          = client::CompiledExpression::Type;
+
+    ExpressionCompiler(Iterator begin, Iterator end) : m_it(begin), m_end(end) {}
+
+    // Returns null if the range is not a single expression, which could be compiled.
+    Expression compile_expression()
+    {
+        Expression out = this->logical_or_expression();
+        return out && this->at_end() ? std::move(out) : nullptr;
+    }
+
+    // Compile the inside of a legacy variable expansion [variable] or [variable[index_variable]].
+    Expression compile_legacy_variable_expansion()
+    {
+        IteratorRange name = this->identifier();
+        if (name.empty())
+            return nullptr;
+        Expression out = this->make(Type::LegacyVariable, name);
+        if (this->accept("[")) {
+            out->type        = Type::LegacyIndexedVariable;
+            out->index_range = this->identifier();
+            if (out->index_range.empty() || ! this->accept("]"))
+                return nullptr;
+        }
+        return this->at_end() ? std::move(out) : nullptr;
+    }
+
+private:
+    Expression make(Type type, IteratorRange range, Expression lhs = nullptr, Expression rhs = nullptr)
+    {
+        auto out   = std::make_unique<client::CompiledExpression>();
+        out->type  = type;
+        out->range = range;
+        out->lhs   = std::move(lhs);
+        out->rhs   = std::move(rhs);
+        return out;
+    }
+
+    void skip()
+    {
+        while (m_it != m_end && (*m_it == ' ' || *m_it == '\t' || *m_it == '\r' || *m_it == '\n'))
+            ++ m_it;
+    }
+    bool at_end()
+    {
+        this->skip();
+        return m_it == m_end;
+    }
+    bool accept(const char *op)
+    {
+        this->skip();
+        size_t len = strlen(op);
+        if (size_t(m_end - m_it) < len || ! std::equal(op, op + len, m_it))
+            return false;
+        m_it += len;
+        return true;
+    }
+    static bool identifier_char(char c) { return std::isalnum((unsigned char)c) || c == '_'; }
+    // Word at the current position, a keyword or an identifier.
+    IteratorRange word()
+    {
+        this->skip();
+        Iterator end = m_it;
+        if (end != m_end && (std::isalpha((unsigned char)*end) || *end == '_'))
+            while (++ end != m_end && identifier_char(*end)) ;
+        return { m_it, end };
+    }
+    bool accept_keyword(const char *keyword)
+    {
+        IteratorRange w = this->word();
+        if (size_t(w.size()) != strlen(keyword) || ! std::equal(w.begin(), w.end(), keyword))
+            return false;
+        m_it = w.end();
+        return true;
+    }
+    static bool is_keyword(IteratorRange w) { return g_macro_processor_instance.keywords.find(std::string(w.begin(), w.end())) != nullptr; }
+    // Identifier, which is not a keyword, or an empty range.
+    IteratorRange identifier()
+    {
+        IteratorRange w = this->word();
+        if (w.empty() || is_keyword(w))
+            return { m_it, m_it };
+        m_it = w.end();
+        return w;
+    }
+
+    // A left associative sequence of binary operators of the same precedence.
+    template<typename Operand>
+    Expression binary(Operand operand, std::initializer_list<std::pair<const char*, Type>> operators)
+    {
+        Expression out = (this->*operand)();
+        while (out) {
+            auto op = std::find_if(operators.begin(), operators.end(), [this](const auto &op)
+                { return std::isalpha((unsigned char)op.first[0]) ? this->accept_keyword(op.first) : this->accept(op.first); });
+            if (op == operators.end())
+                break;
+            Expression rhs = (this->*operand)();
+            if (! rhs)
+                return nullptr;
+            IteratorRange range = out->range;
+            out = this->make(op->second, range, std::move(out), std::move(rhs));
+        }
+        return out;
+    }
+    Expression logical_or_expression()
+        { return this->binary(&ExpressionCompiler::logical_and_expression, { { "or", Type::Or }, { "||", Type::Or } }); }
+    Expression logical_and_expression()
+        { return this->binary(&ExpressionCompiler::equality_expression, { { "and", Type::And }, { "&&", Type::And } }); }
+    Expression equality_expression()
+    {
+        Expression out = this->binary(&ExpressionCompiler::relational_expression, { { "==", Type::Equal }, { "!=", Type::NotEqual }, { "<>", Type::NotEqual } });
+        // Regular expressions are not compiled.
+        return out && ! this->accept("=~") && ! this->accept("!~") ? std::move(out) : nullptr;
+    }
+    Expression relational_expression()
+        { return this->binary(&ExpressionCompiler::additive_expression, { { "<=", Type::Leq }, { ">=", Type::Geq }, { "<", Type::Lower }, { ">", Type::Greater } }); }
+    Expression additive_expression()
+        { return this->binary(&ExpressionCompiler::multiplicative_expression, { { "+", Type::Add }, { "-", Type::Subtract } }); }
+    Expression multiplicative_expression()
+        { return this->binary(&ExpressionCompiler::unary_expression, { { "*", Type::Multiply }, { "/", Type::Divide }, { "%", Type::Modulo } }); }
+
+    Expression unary_expression()
+    {
+        this->skip();
+        const Iterator start = m_it;
+        const IteratorRange at_start { start, start };
+        auto end_pos = [this](Expression out) {
+            if (out) {
+                this->skip();
+                out->end_pos = m_it;
+            }
+            return out;
+        };
+        auto unary = [this, &at_start](Type type) {
+            Expression param = this->unary_expression();
+            return param ? this->make(type, at_start, std::move(param)) : nullptr;
+        };
+        // Function with one or two parameters in parentheses.
+        auto function = [this, &at_start](Type type, bool two_params) -> Expression {
+            Expression param1, param2;
+            if (! this->accept("(") || ! (param1 = this->logical_or_expression()) ||
+                (two_params && (! this->accept(",") || ! (param2 = this->logical_or_expression()))) || ! this->accept(")"))
+                return nullptr;
+            return this->make(type, at_start, std::move(param1), std::move(param2));
+        };
+        if (m_it == m_end)
+            return nullptr;
+        if (IteratorRange name = this->identifier(); ! name.empty()) {
+            Expression out = this->make(Type::Variable, name);
+            if (this->accept("[")) {
+                if (! (out->lhs = this->additive_expression()) || ! this->accept("]"))
+                    return nullptr;
+                out = end_pos(std::move(out));
+            }
+            return out;
+        }
+        if (this->accept("(")) {
+            Expression param = this->logical_or_expression();
+            return param && this->accept(")") ? end_pos(this->make(Type::Parentheses, at_start, std::move(param))) : nullptr;
+        }
+        if (this->accept("-"))
+            return unary(Type::Minus);
+        if (this->accept("+"))
+            return end_pos(unary(Type::Plus));
+        if (this->accept_keyword("not") || this->accept("!"))
+            return unary(Type::Not);
+        if (this->accept_keyword("min"))
+            return function(Type::Min, true);
+        if (this->accept_keyword("max"))
+            return function(Type::Max, true);
+        if (this->accept_keyword("int"))
+            return function(Type::ToInt, false);
+        if (this->accept_keyword("round"))
+            return function(Type::Round, false);
+        if (this->accept_keyword("true") || this->accept_keyword("false")) {
+            Expression out = this->make(Type::BoolLiteral, at_start);
+            out->b = *start == 't';
+            return end_pos(std::move(out));
+        }
+        if (*m_it == '"') {
+            // String literal, the escape sequences are validated when evaluated.
+            for (++ m_it; m_it != m_end && *m_it != '"'; ++ m_it)
+                if (*m_it == '\\' && ++ m_it == m_end)
+                    return nullptr;
+            if (m_it == m_end)
+                return nullptr;
+            return this->make(Type::StringLiteral, { start, ++ m_it });
+        }
+        if (std::isdigit((unsigned char)*m_it) || *m_it == '.') {
+            // Numeric literals parsed the same way as by the grammar.
+            Expression out = this->make(Type::DoubleLiteral, at_start);
+            if (! qi::parse(m_it, m_end, qi::real_parser<double, client::strict_real_policies_without_nan_inf>(), out->d)) {
+                out->type = Type::IntLiteral;
+                if (! qi::parse(m_it, m_end, qi::int_, out->i))
+                    return nullptr;
+            }
+            return end_pos(std::move(out));
+        }
+        // Other functions, keywords or characters.
+        return nullptr;
+    }
+
+    Iterator       m_it;
+    const Iterator m_end;
+};
+
+// Compiler of a template, which has already been successfully expanded by the macro processor.
+// Only the {if}{elsif}{else}{endif} blocks enclosing texts are compiled, the code blocks {if ... then ...; endif} are left
+// to the macro processor. If the blocks are mixed in a single macro, for example {x = 1; if x > 0}...{endif},
+// the compilation fails and the template is expanded by the macro processor as a whole.
+class TemplateCompiler
+{
+public:
+    TemplateCompiler(const std::string &templ) : m_templ(templ) {}
+
+    std::vector<CompiledTemplate::Node> compile()
+    {
+        std::vector<CompiledTemplate::Node> out;
+        Macro                               stop;
+        size_t                              pos = 0;
+        // The macro processor skips the leading white spaces of a template.
+        while (pos < m_templ.size() && (m_templ[pos] == ' ' || m_templ[pos] == '\t' || m_templ[pos] == '\r' || m_templ[pos] == '\n'))
+            ++ pos;
+        if (! this->parse_text_block(pos, out, stop) || stop.type != Macro::Type::End) {
+            out.clear();
+            out.push_back({ CompiledTemplate::Node::Type::Macro, 0, m_templ.size() });
+        }
+        return out;
+    }
+
+private:
+    struct Macro {
+        enum class Type {
+            // A macro without any open block.
+            Plain,
+            If,
+            Elsif,
+            Else,
+            Endif,
+            // End of the template reached.
+            End,
+            Unsupported,
+        };
+        Type   type;
+        // Range of the condition of If and Elsif.
+        size_t condition_begin { 0 };
+        size_t condition_end   { 0 };
+    };
+
+    // Skip a string literal or a regular expression starting at pos, return the position of its closing quote.
+    size_t skip_literal(size_t pos) const
+    {
+        const char quote = m_templ[pos];
+        for (++ pos; pos < m_templ.size() && m_templ[pos] != quote; ++ pos)
+            if (m_templ[pos] == '\\')
+                ++ pos;
+        return pos;
+    }
+
+    // Classify a macro by its keywords, which are not part of a string literal or of a regular expression.
+    Macro classify(size_t begin, size_t end) const
+    {
+        std::vector<std::pair<std::string, size_t>> keywords;
+        bool                                        semicolon = false;
+        // Last character of the code, which is not a white space. A slash following an operator starts a regular expression.
+        char                                        last      = '{';
+        for (size_t pos = begin; pos < end; ++ pos) {
+            char c = m_templ[pos];
+            if (c == '"' || (c == '/' && (last == ',' || last == '~' || last == '('))) {
+                pos  = this->skip_literal(pos);
+                last = c;
+            } else if (std::isalpha((unsigned char)c) || c == '_') {
+                size_t first = pos;
+                while (pos + 1 < end && (std::isalnum((unsigned char)m_templ[pos + 1]) || m_templ[pos + 1] == '_'))
+                    ++ pos;
+                std::string word(m_templ, first, pos + 1 - first);
+                if (word == "if" || word == "elsif" || word == "else" || word == "endif" || word == "then")
+                    keywords.emplace_back(std::move(word), first);
+                last = 'a';
+            } else if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+                semicolon |= c == ';';
+                last       = c;
+            }
+        }
+        if (keywords.empty())
+            return { Macro::Type::Plain };
+        auto only_code = [this, end](size_t pos) {
+            for (; pos < end; ++ pos)
+                if (char c = m_templ[pos]; c != ' ' && c != '\t' && c != '\r' && c != '\n')
+                    return false;
+            return true;
+        };
+        auto starts_with = [this, begin](size_t pos) {
+            for (size_t i = begin; i < pos; ++ i)
+                if (char c = m_templ[i]; c != ' ' && c != '\t' && c != '\r' && c != '\n')
+                    return false;
+            return true;
+        };
+        if (keywords.size() == 1 && ! semicolon && starts_with(keywords.front().second)) {
+            const auto &[word, pos] = keywords.front();
+            if (word == "if" || word == "elsif")
+                return { word == "if" ? Macro::Type::If : Macro::Type::Elsif, pos + word.size(), end };
+            if (word == "else" && only_code(pos + word.size()))
+                return { Macro::Type::Else };
+            if (word == "endif" && only_code(pos + word.size()))
+                return { Macro::Type::Endif };
+        }
+        // A macro closing all the blocks it opens is left to the macro processor.
+        int depth = 0;
+        for (const auto &[word, pos] : keywords) {
+            if (word == "if")
+                ++ depth;
+            else if (word == "endif")
+                -- depth;
+            else if (depth == 0)
+                return { Macro::Type::Unsupported };
+            if (depth < 0)
+                return { Macro::Type::Unsupported };
+        }
+        return { depth == 0 ? Macro::Type::Plain : Macro::Type::Unsupported };
+    }
+
+    std::unique_ptr<client::CompiledExpression> compile_expression(size_t begin, size_t end) const
+    {
+        return ExpressionCompiler(m_templ.begin() + begin, m_templ.begin() + end).compile_expression();
+    }
+
+    // Parse the texts and macros up to the end of the template or up to a macro continuing or closing the enclosing block,
+    // which is returned in stop. Returns false if a part of the template cannot be compiled.
+    bool parse_text_block(size_t &pos, std::vector<CompiledTemplate::Node> &out, Macro &stop) const
+    {
+        using Node = CompiledTemplate::Node;
+        for (;;) {
+            size_t next = std::min(m_templ.find_first_of("{[", pos), m_templ.size());
+            if (next > pos)
+                out.push_back({ Node::Type::Text, pos, next });
+            if (next == m_templ.size()) {
+                pos  = next;
+                stop = { Macro::Type::End };
+                return true;
+            }
+            if (m_templ[next] == '[') {
+                // Legacy variable expansion [name] or [name[index]].
+                pos = next;
+                for (int depth = 0; pos < m_templ.size(); ++ pos)
+                    if (m_templ[pos] == '[')
+                        ++ depth;
+                    else if (m_templ[pos] == ']' && -- depth == 0)
+                        break;
+                if (pos == m_templ.size())
+                    return false;
+                out.push_back({ Node::Type::Macro, next, ++ pos,
+                    ExpressionCompiler(m_templ.begin() + next + 1, m_templ.begin() + pos - 1).compile_legacy_variable_expansion() });
+                continue;
+            }
+            // Find the closing brace.
+            pos = next + 1;
+            for (char last = '{'; pos < m_templ.size() && m_templ[pos] != '}'; ++ pos)
+                if (char c = m_templ[pos]; c == '"' || (c == '/' && (last == ',' || last == '~' || last == '(')))
+                    pos = this->skip_literal(pos), last = c;
+                else if (c != ' ' && c != '\t' && c != '\r' && c != '\n')
+                    last = c;
+            if (pos >= m_templ.size())
+                return false;
+            Macro macro = this->classify(next + 1, pos ++);
+            switch (macro.type) {
+            case Macro::Type::Plain:
+                out.push_back({ Node::Type::Macro, next, pos, this->compile_expression(next + 1, pos - 1) });
+                break;
+            case Macro::Type::If:
+            {
+                Node conditional { Node::Type::Conditional, next, next };
+                for (;;) {
+                    conditional.branches.push_back({ macro.condition_begin, macro.condition_end,
+                        macro.condition_begin == macro.condition_end ? nullptr : this->compile_expression(macro.condition_begin, macro.condition_end) });
+                    if (! this->parse_text_block(pos, conditional.branches.back().body, macro))
+                        return false;
+                    if (macro.type == Macro::Type::Endif)
+                        break;
+                    if (macro.type == Macro::Type::Else) {
+                        // The "else" branch has an empty condition.
+                        macro.condition_begin = macro.condition_end = 0;
+                        if (conditional.branches.back().condition_begin == conditional.branches.back().condition_end)
+                            return false;
+                    } else if (macro.type != Macro::Type::Elsif ||
+                               conditional.branches.back().condition_begin == conditional.branches.back().condition_end)
+                        return false;
+                }
+                out.emplace_back(std::move(conditional));
+                break;
+            }
+            case Macro::Type::Elsif:
+            case Macro::Type::Else:
+            case Macro::Type::Endif:
+                stop = macro;
+                return true;
+            default:
+                return false;
+            }
+        }
+    }
+
+    const std::string &m_templ;
+};
+
+} // namespace
+
+static void expand_compiled(const std::string &templ, const std::vector<CompiledTemplate::Node> &nodes, client::MyContext &context, std::string &output)
+{
+    for (const CompiledTemplate::Node &node : nodes)
+        switch (node.type) {
+        case CompiledTemplate::Node::Type::Text:
+            output.append(templ, node.begin, node.end - node.begin);
+            break;
+        case CompiledTemplate::Node::Type::Macro:
+            if (node.expression) {
+                std::string value;
+                node.expression->expand(&context, value);
+                output += value;
+            } else
+                output += process_macro(templ.begin() + node.begin, templ.begin() + node.end, context);
+            break;
+        case CompiledTemplate::Node::Type::Conditional:
+            for (const CompiledTemplate::Branch &branch : node.branches) {
+                bool condition = true;
+                if (branch.condition) {
+                    condition = branch.condition->evaluate_boolean(&context);
+                } else if (branch.condition_begin != branch.condition_end) {
+                    context.just_boolean_expression = true;
+                    condition = process_macro(templ.begin() + branch.condition_begin, templ.begin() + branch.condition_end, context) == "true";
+                    context.just_boolean_expression = false;
+                }
+                if (condition) {
+                    expand_compiled(templ, branch.body, context, output);
+                    break;
+                }
+            }
+            break;
+        }
+}
+
+// Templates compiled on their first expansion. Custom G-codes are expanded for every layer and tool change, though there are just a few of them.
+static std::mutex                                                               s_compiled_templates_mutex;
+static std::unordered_map<std::string, std::shared_ptr<const CompiledTemplate>> s_compiled_templates;
+static constexpr const size_t                                                   s_compiled_templates_max = 1024;
+
 std::string PlaceholderParser::process(const std::string &templ, unsigned int current_extruder_id, const DynamicConfig *config_override, DynamicConfig *config_outputs, ContextData *context_data) const
 {
+    auto init_context = [&](client::MyContext &context) {
+        context.external_config 	= this->external_config();
+        context.config              = &this->config();
+        context.config_override     = config_override;
+        context.config_outputs      = config_outputs;
+        context.current_extruder_id = current_extruder_id;
+        context.context_data        = context_data;
+    };
+
+    std::shared_ptr<const CompiledTemplate> compiled;
+    {
+        std::lock_guard<std::mutex> lock(s_compiled_templates_mutex);
+        if (auto it = s_compiled_templates.find(templ); it != s_compiled_templates.end())
+            compiled = it->second;
+    }
+
     client::MyContext context;
-    context.external_config 	= this->external_config();
-    context.config              = &this->config();
-    context.config_override     = config_override;
-    context.config_outputs      = config_outputs;
-    context.current_extruder_id = current_extruder_id;
-    context.context_data        = context_data;
-    return process_macro(templ, context);
+    init_context(context);
+    std::string output;
+    if (compiled) {
+        // The macros are evaluated in place, so that an error is reported relative to the whole template.
+        // The template is not expanded again on error, as the macros already evaluated may have modified the outputs,
+        // the global variables or the random number generator.
+        context.whole_template = &compiled->templ;
+        try {
+            expand_compiled(compiled->templ, compiled->nodes, context, output);
+        } catch (const qi::expectation_failure<client::Iterator> &ex) {
+            // Thrown by the semantic actions called by a compiled expression, outside of the grammar's error handler.
+            client::MyContext::process_error_message(&context, ex.what_, ex.first, ex.last, ex.first);
+            throw_if_error(context);
+        }
+    } else {
+        // Compile the template only after it was expanded successfully, thus the compiler does not need to validate it.
+        output = process_macro(templ, context);
+        auto new_compiled   = std::make_shared<CompiledTemplate>();
+        new_compiled->templ = templ;
+        new_compiled->nodes = TemplateCompiler(new_compiled->templ).compile();
+        std::lock_guard<std::mutex> lock(s_compiled_templates_mutex);
+        if (s_compiled_templates.size() >= s_compiled_templates_max)
+            s_compiled_templates.clear();
+        s_compiled_templates.emplace(templ, std::move(new_compiled));
+    }
+    return output;
 }
 
 // Evaluate a boolean expression using the full expressive power of the PlaceholderParser boolean expression syntax.
@@ -22,15 +22,18 @@
 
 #include <algorithm>
 #include <limits>
+#include <unordered_map>
 #include <unordered_set>
 #include <boost/filesystem/path.hpp>
 #include <boost/format.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/regex.hpp>
 #include <boost/nowide/fstream.hpp>
 
 #include <tbb/blocked_range.h>
 #include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 
 //BBS: add json support
 #include "nlohmann/json.hpp"
@@ -49,6 +52,36 @@ namespace Slic3r {
 template class PrintState<PrintStep, psCount>;
 template class PrintState<PrintObjectStep, posCount>;
 
+const char* trace_step_name(PrintStep step)
+{
+    switch (step) {
+    case psWipeTower:       return "psWipeTower";
+    case psSkirtBrim:       return "psSkirtBrim";
+    case psGCodeExport:     return "psGCodeExport";
+    case psConflictCheck:   return "psConflictCheck";
+    default:                return "PrintStep";
+    }
+}
+
+const char* trace_step_name(PrintObjectStep step)
+{
+    switch (step) {
+    case posSlice:                      return "posSlice";
+    case posPerimeters:                 return "posPerimeters";
+    case posEstimateCurledExtrusions:   return "posEstimateCurledExtrusions";
+    case posPrepareInfill:              return "posPrepareInfill";
+    case posInfill:                     return "posInfill";
+    case posIroning:                    return "posIroning";
+    case posSupportMaterial:            return "posSupportMaterial";
+    case posSimplifyPath:               return "posSimplifyPath";
+    case posSimplifySupportPath:        return "posSimplifySupportPath";
+    case posDetectOverhangsForLift:     return "posDetectOverhangsForLift";
+    case posSimplifyWall:               return "posSimplifyWall";
+    case posSimplifyInfill:             return "posSimplifyInfill";
+    default:                            return "PrintObjectStep";
+    }
+}
+
 PrintRegion::PrintRegion(const PrintRegionConfig &config) : PrintRegion(config, config.hash()) {}
 PrintRegion::PrintRegion(PrintRegionConfig &&config) : PrintRegion(std::move(config), config.hash()) {}
 
@@ -1830,6 +1863,7 @@ std::map<ObjectID, unsigned int> getObjectExtruderMap(const Print& print) {
 // Slicing process, running at a background thread.
 void Print::process(long long *time_cost_with_cache, bool use_cache)
 {
+    TRACE_ZONE("Print::process");
     long long start_time = 0, end_time = 0;
     if (time_cost_with_cache)
         *time_cost_with_cache = 0;
@@ -1844,14 +1878,33 @@ void Print::process(long long *time_cost_with_cache, bool use_cache)
     for (PrintObject *obj : m_objects)
         obj->clear_shared_object();
 
+    // Meshes are compared by content, so that copies of an object loaded from separate files share the slicing results.
+    auto is_mesh_the_same = [](const TriangleMesh &mesh1, const TriangleMesh &mesh2) -> bool {
+        const indexed_triangle_set &its1 = mesh1.its;
+        const indexed_triangle_set &its2 = mesh2.its;
+        return &mesh1 == &mesh2 ||
+            (its1.vertices.size() == its2.vertices.size() && its1.indices.size() == its2.indices.size() &&
+             std::equal(its1.vertices.begin(), its1.vertices.end(), its2.vertices.begin()) &&
+             std::equal(its1.indices.begin(), its1.indices.end(), its2.indices.begin()));
+    };
+    auto is_layer_config_ranges_the_same = [](const t_layer_config_ranges &ranges1, const t_layer_config_ranges &ranges2) -> bool {
+        return ranges1.size() == ranges2.size() &&
+            std::equal(ranges1.begin(), ranges1.end(), ranges2.begin(), [](const auto &range1, const auto &range2) {
+                return range1.first == range2.first && range1.second.get() == range2.second.get();
+            });
+    };
     //add the print_object share check logic
-    auto is_print_object_the_same = [this](const PrintObject* object1, const PrintObject* object2) -> bool{
+    auto is_print_object_the_same = [this, &is_mesh_the_same, &is_layer_config_ranges_the_same](const PrintObject* object1, const PrintObject* object2) -> bool{
         if (object1->trafo().matrix() != object2->trafo().matrix())
             return false;
         const ModelObject* model_obj1 = object1->model_object();
         const ModelObject* model_obj2 = object2->model_object();
         if (model_obj1->volumes.size() != model_obj2->volumes.size())
             return false;
+        if (model_obj1 != model_obj2 &&
+            (model_obj1->layer_height_profile.get() != model_obj2->layer_height_profile.get() ||
+             ! is_layer_config_ranges_the_same(model_obj1->layer_config_ranges, model_obj2->layer_config_ranges)))
+            return false;
         bool has_extruder1 = model_obj1->config.has("extruder");
         bool has_extruder2 = model_obj2->config.has("extruder");
         if ((has_extruder1 != has_extruder2)
@@ -1862,7 +1915,7 @@ void Print::process(long long *time_cost_with_cache, bool use_cache)
             const ModelVolume &model_volume2 = *model_obj2->volumes[index];
             if (model_volume1.type() != model_volume2.type())
                 return false;
-            if (model_volume1.mesh_ptr() != model_volume2.mesh_ptr())
+            if (! is_mesh_the_same(model_volume1.mesh(), model_volume2.mesh()))
                 return false;
             if (!(model_volume1.get_transformation() == model_volume2.get_transformation()))
                 return false;
@@ -1886,50 +1939,81 @@ void Print::process(long long *time_cost_with_cache, bool use_cache)
             return false;
         return true;
     };
+    // Hash of the geometry compared by is_print_object_the_same(), to find the candidates for sharing without comparing all pairs of objects.
+    // Each mesh is hashed once, even if referenced by many objects.
+    std::unordered_map<const TriangleMesh*, size_t> mesh_hashes;
+    auto mesh_hash = [&mesh_hashes](const TriangleMesh &mesh) -> size_t {
+        auto [it, inserted] = mesh_hashes.emplace(&mesh, 0);
+        if (inserted) {
+            const indexed_triangle_set &its = mesh.its;
+            static_assert(sizeof(stl_vertex) == 3 * sizeof(float) && sizeof(stl_triangle_vertex_indices) == 3 * sizeof(int), "Packed vertices and indices expected");
+            size_t seed = 0;
+            boost::hash_range(seed, its.vertices.empty() ? nullptr : its.vertices.front().data(), its.vertices.empty() ? nullptr : its.vertices.front().data() + 3 * its.vertices.size());
+            boost::hash_range(seed, its.indices.empty() ? nullptr : its.indices.front().data(), its.indices.empty() ? nullptr : its.indices.front().data() + 3 * its.indices.size());
+            it->second = seed;
+        }
+        return it->second;
+    };
+    auto print_object_hash = [&mesh_hash](const PrintObject *object) -> size_t {
+        size_t seed = boost::hash_range(object->trafo().matrix().data(), object->trafo().matrix().data() + 16);
+        for (const ModelVolume *model_volume : object->model_object()->volumes) {
+            boost::hash_combine(seed, int(model_volume->type()));
+            boost::hash_combine(seed, mesh_hash(model_volume->mesh()));
+            const Transform3d &volume_trafo = model_volume->get_matrix();
+            boost::hash_combine(seed, boost::hash_range(volume_trafo.data(), volume_trafo.data() + 16));
+        }
+        return seed;
+    };
+    std::unordered_map<size_t, std::vector<PrintObject*>> slicing_objects_by_hash;
+    auto find_shared_object = [&slicing_objects_by_hash, &is_print_object_the_same](const PrintObject *obj, size_t hash) -> PrintObject* {
+        if (auto it = slicing_objects_by_hash.find(hash); it != slicing_objects_by_hash.end())
+            for (PrintObject *slicing_obj : it->second)
+                if (is_print_object_the_same(obj, slicing_obj))
+                    return slicing_obj;
+        return nullptr;
+    };
+
     int object_count = m_objects.size();
+    std::vector<size_t> object_hashes;
+    object_hashes.reserve(object_count);
+    for (const PrintObject *obj : m_objects)
+        object_hashes.emplace_back(print_object_hash(obj));
     std::set<PrintObject*> need_slicing_objects;
     std::set<PrintObject*> re_slicing_objects;
     if (!use_cache) {
         for (int index = 0; index < object_count; index++)
         {
             PrintObject *obj =  m_objects[index];
-            for (PrintObject *slicing_obj : need_slicing_objects)
-            {
-                if (is_print_object_the_same(obj, slicing_obj)) {
-                    obj->set_shared_object(slicing_obj);
-                    break;
-                }
-            }
-            if (!obj->get_shared_object())
+            if (PrintObject *slicing_obj = find_shared_object(obj, object_hashes[index]); slicing_obj)
+                obj->set_shared_object(slicing_obj);
+            else {
                 need_slicing_objects.insert(obj);
+                slicing_objects_by_hash[object_hashes[index]].emplace_back(obj);
+            }
         }
     }
     else {
         for (int index = 0; index < object_count; index++)
         {
             PrintObject *obj =  m_objects[index];
-            if (obj->layer_count() > 0)
+            if (obj->layer_count() > 0) {
                 need_slicing_objects.insert(obj);
+                slicing_objects_by_hash[object_hashes[index]].emplace_back(obj);
+            }
         }
         for (int index = 0; index < object_count; index++)
         {
             PrintObject *obj =  m_objects[index];
-            bool found_shared = false;
             if (need_slicing_objects.find(obj) == need_slicing_objects.end()) {
-                for (PrintObject *slicing_obj : need_slicing_objects)
-                {
-                    if (is_print_object_the_same(obj, slicing_obj)) {
-                        obj->set_shared_object(slicing_obj);
-                        found_shared = true;
-                        break;
-                    }
-                }
-                if (!found_shared) {
+                if (PrintObject *slicing_obj = find_shared_object(obj, object_hashes[index]); slicing_obj)
+                    obj->set_shared_object(slicing_obj);
+                else {
                     BOOST_LOG_TRIVIAL(warning) << boost::format("Also can not find the shared object, identify_id %1%, maybe shared object is skipped")%obj->model_object()->instances[0]->loaded_id;
                     //throw Slic3r::SlicingError("Cannot find the cached data.");
                     //don't report errot, set use_cache to false, and reslice these objects
                     need_slicing_objects.insert(obj);
                     re_slicing_objects.insert(obj);
+                    slicing_objects_by_hash[object_hashes[index]].emplace_back(obj);
                     //use_cache = false;
                 }
             }
@@ -1939,71 +2023,52 @@ void Print::process(long long *time_cost_with_cache, bool use_cache)
     BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << boost::format(": total object counts %1% in current print, need to slice %2%")%m_objects.size()%need_slicing_objects.size();
     BOOST_LOG_TRIVIAL(info) << "Starting the slicing process." << log_memory_info();
     if (!use_cache) {
-        for (PrintObject *obj : m_objects) {
-            if (need_slicing_objects.count(obj) != 0) {
-                obj->make_perimeters();
-            }
-            else {
-                if (obj->set_started(posSlice))
-                    obj->set_done(posSlice);
-                if (obj->set_started(posPerimeters))
-                    obj->set_done(posPerimeters);
-            }
-        }
-        for (PrintObject *obj : m_objects) {
-            if (need_slicing_objects.count(obj) != 0) {
-                obj->estimate_curled_extrusions();
-            }
-            else {
-                if (obj->set_started(posEstimateCurledExtrusions))
-                    obj->set_done(posEstimateCurledExtrusions);
-            }
-        }
-        for (PrintObject *obj : m_objects) {
-            if (need_slicing_objects.count(obj) != 0) {
-                obj->infill();
-            }
-            else {
-                if (obj->set_started(posPrepareInfill))
-                    obj->set_done(posPrepareInfill);
-                if (obj->set_started(posInfill))
-                    obj->set_done(posInfill);
-            }
-        }
-        for (PrintObject *obj : m_objects) {
-            if (need_slicing_objects.count(obj) != 0) {
-                obj->ironing();
-            }
-            else {
-                if (obj->set_started(posIroning))
-                    obj->set_done(posIroning);
-            }
-        }
-
-        tbb::parallel_for(tbb::blocked_range<int>(0, int(m_objects.size())),
-            [this, need_slicing_objects](const tbb::blocked_range<int>& range) {
-                for (int i = range.begin(); i < range.end(); i++) {
-                    PrintObject* obj = m_objects[i];
-                    if (need_slicing_objects.count(obj) != 0) {
-                        obj->generate_support_material();
-                    }
-                    else {
-                        if (obj->set_started(posSupportMaterial))
-                            obj->set_done(posSupportMaterial);
+        std::vector<PrintObject*> slicing_objects;
+        for (PrintObject *obj : m_objects)
+            if (need_slicing_objects.count(obj) != 0)
+                slicing_objects.emplace_back(obj);
+        static constexpr void (PrintObject::*object_steps[])() = {
+            &PrintObject::make_perimeters, &PrintObject::estimate_curled_extrusions, &PrintObject::infill,
+            &PrintObject::ironing, &PrintObject::generate_support_material, &PrintObject::detect_overhangs_for_lift
+        };
+        if (m_process_objects_concurrently && slicing_objects.size() > 1) {
+            // Each object runs through its steps independently of the other objects, so that small objects do not wait
+            // at every step for the largest object to finish. The steps are parallelized over layers internally.
+            // The steps of an object only write to the object, its layers and its support layers. Shared with the other objects are:
+            //  - the Print config and regions, which are read only while processing,
+            //  - the step states of the objects, which are guarded by the Print state mutex, including g_last_timestamp,
+            //  - set_status() and the warnings, which are serialized by PrintBase while the objects are processed concurrently.
+            // The support generators were already run concurrently over objects before.
+            // The G-code is verified to be the same as with the serial processing by the "Objects processed concurrently" test.
+            // Start with the tallest objects, which likely take the longest.
+            std::stable_sort(slicing_objects.begin(), slicing_objects.end(), [](const PrintObject *l, const PrintObject *r) { return l->height() > r->height(); });
+            this->set_status_concurrent(true);
+            ScopeGuard status_guard([this]() { this->set_status_concurrent(false); });
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, slicing_objects.size(), 1),
+                [&slicing_objects](const tbb::blocked_range<size_t>& range) {
+                    for (size_t i = range.begin(); i < range.end(); ++ i) {
+                        PrintObject *obj = slicing_objects[i];
+                        // A thread waiting for the parallel loops of a step shall not pick up the steps of another object.
+                        tbb::this_task_arena::isolate([obj]() {
+                            for (auto step : object_steps)
+                                (obj->*step)();
+                        });
                     }
                 }
-            }
-        );
-
-        for (PrintObject* obj : m_objects) {
-            if (need_slicing_objects.count(obj) != 0) {
-                obj->detect_overhangs_for_lift();
-            }
-            else {
-                if (obj->set_started(posDetectOverhangsForLift))
-                    obj->set_done(posDetectOverhangsForLift);
-            }
+            );
+        } else {
+            // Each step is a barrier over all objects.
+            for (auto step : object_steps)
+                for (PrintObject *obj : slicing_objects)
+                    (obj->*step)();
         }
+
+        // Objects sharing the layers of another object are marked as done, their layers are copied below.
+        for (PrintObject *obj : m_objects)
+            if (need_slicing_objects.count(obj) == 0)
+                for (PrintObjectStep step : { posSlice, posPerimeters, posEstimateCurledExtrusions, posPrepareInfill, posInfill, posIroning, posSupportMaterial, posDetectOverhangsForLift })
+                    if (obj->set_started(step))
+                        obj->set_done(step);
     }
     else {
         for (PrintObject *obj : m_objects) {
@@ -2196,6 +2261,7 @@ void Print::process(long long *time_cost_with_cache, bool use_cache)
 // It is up to the caller to show an error message.
 std::string Print::export_gcode(const std::string& path_template, GCodeProcessorResult* result, ThumbnailsGeneratorCallback thumbnail_cb)
 {
+    TRACE_ZONE("Print::export_gcode");
     // output everything to a G-code file
     // The following call may die if the filename_format template substitution fails.
     std::string path = this->output_filepath(path_template);
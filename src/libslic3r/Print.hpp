@@ -98,6 +98,10 @@ enum PrintObjectStep {
     posCount,
 };
 
+// Names of the steps in the Trace zones.
+const char* trace_step_name(PrintStep step);
+const char* trace_step_name(PrintObjectStep step);
+
 // A PrintRegion object represents a group of volumes to print
 // sharing the same config (including the same assigned extruder(s))
 class PrintRegion
@@ -383,6 +387,8 @@ public:
     SupportLayer* add_tree_support_layer(int id, coordf_t height, coordf_t print_z, coordf_t slice_z);
     std::shared_ptr<TreeSupportData> alloc_tree_support_preview_cache();
     void clear_tree_support_preview_cache() { m_tree_support_preview_cache.reset(); }
+    // Release the perimeters backed up by make_perimeters(), see Print::set_keep_perimeters_backup().
+    void clear_perimeters_backup();
 
     size_t          support_layer_count() const { return m_support_layers.size(); }
     void            clear_support_layers();
@@ -533,6 +539,15 @@ private:
     // so that next call to make_perimeters() performs a union() before computing loops
     bool                    				m_typed_slices = false;
 
+    // Configurations the perimeters backed up at m_layers were generated with.
+    // Only maintained for objects with multiple layer ranges, see PrintObject::make_perimeters().
+    struct PerimetersCache {
+        PrintConfig                         print_config;
+        PrintObjectConfig                   object_config;
+        std::vector<PrintRegionConfig>      region_configs;
+    };
+    std::unique_ptr<PerimetersCache>        m_perimeters_cache;
+
     std::pair<FillAdaptive::OctreePtr, FillAdaptive::OctreePtr> m_adaptive_fill_octrees;
     FillLightning::GeneratorPtr m_lightning_generator;
 
@@ -959,6 +974,14 @@ public:
     //SoftFever
     bool &is_BBL_printer() { return m_isBBLPrinter; }
     const bool is_BBL_printer() const { return m_isBBLPrinter; }
+    // Back up the perimeters of objects with multiple layer ranges, so that editing the config of one layer range
+    // restores the perimeters of the other ranges instead of regenerating them. The backups double the memory held by
+    // the perimeters, thus they are only kept when the Print is processed repeatedly, that is by the background slicing of the GUI.
+    void set_keep_perimeters_backup(bool keep) { m_keep_perimeters_backup = keep; }
+    bool keep_perimeters_backup() const { return m_keep_perimeters_backup; }
+    void clear_perimeters_backup() { for (PrintObject *object : m_objects) object->clear_perimeters_backup(); }
+    // Run the steps of different objects concurrently (default), or run each step over all objects before starting the next one.
+    void set_process_objects_concurrently(bool concurrently) { m_process_objects_concurrently = concurrently; }
     CalibMode& calib_mode() { return m_calib_params.mode; }
     const CalibMode calib_mode() const { return m_calib_params.mode; }
     void set_calib_params(const Calib_Params& params);
@@ -1037,6 +1060,8 @@ private:
     // Estimated print time, filament consumed.
     PrintStatistics                         m_print_statistics;
     bool                                    m_support_used {false};
+    bool                                    m_keep_perimeters_backup {false};
+    bool                                    m_process_objects_concurrently {true};
 
     //BBS: plate's origin
     Vec3d   m_origin;
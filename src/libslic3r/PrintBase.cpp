@@ -105,6 +105,14 @@ std::string PrintBase::output_filepath(const std::string &path, const std::strin
 //BBS: move set_status from hpp to cpp
 void  PrintBase::set_status(int percent, const std::string &message, unsigned int flags, int warning_step) const
 {
+    std::unique_lock<std::mutex> lock(m_status_mutex, std::defer_lock);
+    if (m_status_concurrent.load(std::memory_order_relaxed)) {
+        lock.lock();
+        // Another object already reported a later step.
+        if (flags == SlicingStatus::DEFAULT && percent < m_status_percent)
+            return;
+        m_status_percent = std::max(m_status_percent, percent);
+    }
 	if (m_status_callback)
         m_status_callback(SlicingStatus(percent, message, flags, warning_step));
     else
@@ -114,6 +122,9 @@ void  PrintBase::set_status(int percent, const std::string &message, unsigned in
 void PrintBase::status_update_warnings(int step, PrintStateBase::WarningLevel  warning_level,
     const std::string &message, const PrintObjectBase* print_object, PrintStateBase::SlicingNotificationType message_id)
 {
+    std::unique_lock<std::mutex> lock(m_status_mutex, std::defer_lock);
+    if (m_status_concurrent.load(std::memory_order_relaxed))
+        lock.lock();
     if (this->m_status_callback) {
         auto status = print_object ? SlicingStatus(*print_object, step, message, message_id, warning_level) : SlicingStatus(*this, step, message, message_id, warning_level);
         m_status_callback(status);
@@ -126,6 +137,9 @@ void PrintBase::status_update_warnings(int step, PrintStateBase::WarningLevel  w
 void PrintBase::status_update_warnings(int step, PrintStateBase::WarningLevel warning_level,
     const std::string& message, PrintObjectBase &object, PrintStateBase::SlicingNotificationType message_id)
 {
+    std::unique_lock<std::mutex> lock(m_status_mutex, std::defer_lock);
+    if (m_status_concurrent.load(std::memory_order_relaxed))
+        lock.lock();
     //BBS: add object it into slicing status
     if (this->m_status_callback) {
         m_status_callback(SlicingStatus(object, step, message, message_id, warning_level));
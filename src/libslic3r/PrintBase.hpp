@@ -13,6 +13,7 @@
 #include "Model.hpp"
 #include "PlaceholderParser.hpp"
 #include "PrintConfig.hpp"
+#include "Trace.hpp"
 
 namespace Slic3r {
 
@@ -537,6 +538,10 @@ protected:
 	void                   status_update_warnings(int step, PrintStateBase::WarningLevel warning_level,
 	    const std::string& message, PrintObjectBase &object, PrintStateBase::SlicingNotificationType message_id = PrintStateBase::SlicingDefaultNotification);
 
+    // While the PrintObjects are processed concurrently, the status updates are serialized and the progress percent is not
+    // allowed to decrease, so that the objects being at different steps do not make the progress jump back and forth.
+    void                   set_status_concurrent(bool concurrent) { m_status_concurrent.store(concurrent, std::memory_order_relaxed); m_status_percent = -1; }
+
     // If the background processing stop was requested, throw CanceledException.
     // To be called by the worker thread and its sub-threads (mostly launched on the TBB thread pool) regularly.
     void                   throw_if_canceled() const { if (m_cancel_status.load(std::memory_order_acquire)) throw CanceledException(); }
@@ -573,6 +578,11 @@ private:
     // while the data influencing the stage is modified.
     mutable std::mutex                      m_state_mutex;
 
+    // See set_status_concurrent().
+    std::atomic<bool>                       m_status_concurrent { false };
+    mutable std::mutex                      m_status_mutex;
+    mutable int                             m_status_percent { -1 };
+
     friend PrintTryCancel;
 };
 
@@ -594,9 +604,16 @@ public:
             this->status_update_warnings(static_cast<int>(active_step.first), warning_level, message, nullptr, message_id);
     }
 protected:
-    bool            set_started(PrintStepEnum step) { return m_state.set_started(step, this->state_mutex(), [this](){ this->throw_if_canceled(); }); }
+    bool            set_started(PrintStepEnum step) {
+        bool started = m_state.set_started(step, this->state_mutex(), [this](){ this->throw_if_canceled(); });
+        if (started)
+            m_step_zones.started(step);
+        return started;
+    }
 	PrintStateBase::TimeStamp set_done(PrintStepEnum step) {
 		std::pair<PrintStateBase::TimeStamp, bool> status = m_state.set_done(step, this->state_mutex(), [this](){ this->throw_if_canceled(); });
+        // trace_step_name() is provided for each step type next to the step enum.
+        m_step_zones.done(step, trace_step_name(step), [](){ return std::string(); });
         if (status.second)
             this->status_update_warnings(static_cast<int>(step), PrintStateBase::WarningLevel::NON_CRITICAL, std::string());
         return status.first;
@@ -617,6 +634,7 @@ protected:
 
 private:
     PrintState<PrintStepEnum, COUNT> m_state;
+    Trace::StepZones<COUNT>          m_step_zones;
 };
 
 template<typename PrintType, typename PrintObjectStepEnum, const size_t COUNT>
@@ -634,10 +652,15 @@ public:
 protected:
 	PrintObjectBaseWithState(PrintType *print, ModelObject *model_object) : PrintObjectBase(model_object), m_print(print) {}
 
-    bool            set_started(PrintObjectStepEnum step)
-        { return m_state.set_started(step, PrintObjectBase::state_mutex(m_print), [this](){ this->throw_if_canceled(); }); }
+    bool            set_started(PrintObjectStepEnum step) {
+        bool started = m_state.set_started(step, PrintObjectBase::state_mutex(m_print), [this](){ this->throw_if_canceled(); });
+        if (started)
+            m_step_zones.started(step);
+        return started;
+    }
 	PrintStateBase::TimeStamp set_done(PrintObjectStepEnum step) {
 		std::pair<PrintStateBase::TimeStamp, bool> status = m_state.set_done(step, PrintObjectBase::state_mutex(m_print), [this](){ this->throw_if_canceled(); });
+        m_step_zones.done(step, trace_step_name(step), [this](){ return this->model_object()->name; });
         if (status.second)
             this->status_update_warnings(m_print, static_cast<int>(step), PrintStateBase::WarningLevel::NON_CRITICAL, std::string());
         return status.first;
@@ -677,6 +700,7 @@ protected:
 
 private:
     PrintState<PrintObjectStepEnum, COUNT>   m_state;
+    Trace::StepZones<COUNT>                  m_step_zones;
 };
 
 } // namespace Slic3r
@@ -7645,6 +7645,35 @@ CLIMiscConfigDef::CLIMiscConfigDef()
     def->cli_params = "dir";
     def->set_default_value(new ConfigOptionString());
 
+    def = this->add("batch", coString);
+    def->label = L("Batch");
+    def->tooltip = L("Run the jobs listed in the given file one after another in a single process, one job per line, each line holding the command line arguments of the job. "
+                     "Use - to read the jobs from the standard input. The settings files are loaded once and shared by the jobs. "
+                     "Jobs without an output directory are exported into a numbered subdirectory of the output directory, the timings of the jobs are written to batch_result.json.");
+    def->cli_params = "file";
+    def->set_default_value(new ConfigOptionString());
+
+    def = this->add("slicing_cache_dir", coString);
+    def->label = L("Slicing cache directory");
+    def->tooltip = L("Store the results of slicing the meshes in the given directory and reuse them when the same objects are sliced again with the same layer heights.");
+    def->cli_params = "dir";
+    def->set_default_value(new ConfigOptionString());
+
+    def = this->add("slicing_cache_size", coInt);
+    def->label = L("Slicing cache size");
+    def->tooltip = L("Maximum size of the slicing cache directory in MB. The least recently used entries are removed once the limit is exceeded. 0 means unlimited.");
+    def->min = 0;
+    def->cli_params = "MB";
+    def->set_default_value(new ConfigOptionInt(1024));
+
+    def = this->add("trace_file", coString);
+    def->label = L("Trace file");
+    def->tooltip = L("Record the time spent in each slicing step and in each stage of the G-code export, and write it to the given file "
+                     "as Chrome trace events, to be opened with chrome://tracing or Perfetto. "
+                     "The total times per step are written next to it into a file with the .summary.json extension.");
+    def->cli_params = "trace.json";
+    def->set_default_value(new ConfigOptionString());
+
     def = this->add("debug", coInt);
     def->label = L("Debug level");
     def->tooltip = L("Sets debug logging level. 0:fatal, 1:error, 2:warning, 3:info, 4:debug, 5:trace\n");
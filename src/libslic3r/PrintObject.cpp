@@ -25,6 +25,7 @@
 #include <oneapi/tbb/blocked_range.h>
 #include <oneapi/tbb/concurrent_vector.h>
 #include <oneapi/tbb/parallel_for.h>
+#include <oneapi/tbb/task_arena.h>
 #include <string_view>
 #include <utility>
 
@@ -381,22 +382,71 @@ void PrintObject::make_perimeters()
         BOOST_LOG_TRIVIAL(debug) << "Generating extra perimeters for region " << region_id << " in parallel - end";
     }
 
+    // Editing the config of a single layer range only modifies the PrintRegions of that layer range, however posPerimeters is invalidated
+    // for the whole object. For objects with multiple layer ranges processed by the GUI, the perimeters are backed up per layer and the layers
+    // not referencing any region with a modified config are restored from the backup instead of being regenerated.
+    // Perimeters depend on the slices of the neighbor layers only, which did not change, as posSlice was not invalidated.
+    // The cross layer steps (top / bottom shells, infill) are still recalculated for the whole object.
+    const bool                 backup_perimeters = m_print->keep_perimeters_backup() && m_shared_regions->layer_ranges.size() > 1;
+    std::vector<unsigned char> region_modified(this->num_printing_regions(), true);
+    if (backup_perimeters && m_perimeters_cache && m_perimeters_cache->region_configs.size() == region_modified.size() &&
+        m_perimeters_cache->print_config == m_print->config() && m_perimeters_cache->object_config == m_config) {
+        for (size_t region_id = 0; region_id < region_modified.size(); ++ region_id)
+            region_modified[region_id] = m_perimeters_cache->region_configs[region_id] != this->printing_region(region_id).config();
+    }
+    // The backups will be overwritten by the layers being regenerated. Drop the cache in case the generation is canceled.
+    m_perimeters_cache.reset();
+    if (backup_perimeters && std::find(region_modified.begin(), region_modified.end(), false) == region_modified.end())
+        // Nothing may be restored, release all the backups before generating the new perimeters.
+        for (Layer *layer : m_layers)
+            layer->clear_perimeters_backup();
     BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - start";
     tbb::parallel_for(
         tbb::blocked_range<size_t>(0, m_layers.size()),
-        [this](const tbb::blocked_range<size_t>& range) {
+        [this, backup_perimeters, &region_modified](const tbb::blocked_range<size_t>& range) {
             for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                 m_print->throw_if_canceled();
-                m_layers[layer_idx]->make_perimeters();
+                Layer *layer = m_layers[layer_idx];
+                if (! backup_perimeters) {
+                    layer->clear_perimeters_backup();
+                    layer->make_perimeters();
+                    continue;
+                }
+                // Only the regions with non-empty slices contribute perimeters to this layer. Every layer references all regions
+                // of its layer range, thus testing all of them would mark the layer dirty if any region of the range was modified.
+                bool modified = false;
+                for (size_t region_id = 0; region_id < layer->region_count() && ! modified; ++ region_id)
+                    modified = region_modified[region_id] && ! layer->get_region(region_id)->slices.empty();
+                if (modified || ! layer->restore_perimeters()) {
+                    // Release the stale backup before regenerating, so that the old and the new copy do not coexist.
+                    layer->clear_perimeters_backup();
+                    layer->make_perimeters();
+                    layer->backup_perimeters();
+                }
             }
         }
     );
     m_print->throw_if_canceled();
     BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - end";
 
+    if (backup_perimeters) {
+        m_perimeters_cache = std::make_unique<PerimetersCache>();
+        m_perimeters_cache->print_config  = m_print->config();
+        m_perimeters_cache->object_config = m_config;
+        for (size_t region_id = 0; region_id < this->num_printing_regions(); ++ region_id)
+            m_perimeters_cache->region_configs.emplace_back(this->printing_region(region_id).config());
+    }
+
     this->set_done(posPerimeters);
 }
 
+void PrintObject::clear_perimeters_backup()
+{
+    m_perimeters_cache.reset();
+    for (Layer *layer : m_layers)
+        layer->clear_perimeters_backup();
+}
+
 void PrintObject::prepare_infill()
 {
     if (! this->set_started(posPrepareInfill))
@@ -803,8 +853,16 @@ FillLightning::GeneratorPtr PrintObject::prepare_lightning_infill_data()
 void PrintObject::clear_layers()
 {
     if (!m_shared_object) {
-        for (Layer *l : m_layers)
-            delete l;
+        // The layers do not reference each other when being destructed, release their surfaces and extrusions in parallel.
+        // Called from Print::clear() with the state mutex locked: the waiting thread shall not pick up unrelated tasks,
+        // which may try to lock the same mutex.
+        tbb::this_task_arena::isolate([this]() {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, m_layers.size()),
+                [this](const tbb::blocked_range<size_t> &range) {
+                    for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx)
+                        delete m_layers[layer_idx];
+                });
+        });
         m_layers.clear();
     }
 }
@@ -830,8 +888,14 @@ SupportLayer* PrintObject::get_support_layer_at_printz(coordf_t print_z, coordf_
 void PrintObject::clear_support_layers()
 {
     if (!m_shared_object) {
-        for (SupportLayer* l : m_support_layers)
-            delete l;
+        // See clear_layers() for why the parallel loop is isolated.
+        tbb::this_task_arena::isolate([this]() {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, m_support_layers.size()),
+                [this](const tbb::blocked_range<size_t> &range) {
+                    for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx)
+                        delete m_support_layers[layer_idx];
+                });
+        });
         m_support_layers.clear();
         for (auto l : m_layers) {
             l->sharp_tails.clear();
@@ -4,6 +4,7 @@
 #include "MultiMaterialSegmentation.hpp"
 #include "Print.hpp"
 #include "ClipperUtils.hpp"
+#include "SlicingCache.hpp"
 #include "Interlocking/InterlockingGenerator.hpp"
 //BBS
 #include "ShortestPath.hpp"
@@ -60,7 +61,14 @@ static std::vector<ExPolygons> slice_volume(
             params2.trafo = params2.trafo * volume.get_matrix();
             if (params2.trafo.rotation().determinant() < 0.)
                 its_flip_triangles(its);
-            layers = slice_mesh_ex(its, zs, params2, throw_on_cancel_callback);
+            if (SlicingCache::enabled()) {
+                std::string key = SlicingCache::make_key(its, zs, params2);
+                if (! SlicingCache::load(key, layers)) {
+                    layers = slice_mesh_ex(its, zs, params2, throw_on_cancel_callback);
+                    SlicingCache::store(key, layers);
+                }
+            } else
+                layers = slice_mesh_ex(its, zs, params2, throw_on_cancel_callback);
             throw_on_cancel_callback();
         }
     }
@@ -114,6 +114,29 @@ bool validate_pad(const indexed_triangle_set &pad, const sla::PadConfig &pcfg)
     return !pad.empty() || (pcfg.embed_object.enabled && !pcfg.embed_object.everywhere);
 }
 
+const char* trace_step_name(SLAPrintStep step)
+{
+    switch (step) {
+    case slapsMergeSlicesAndEval:   return "slapsMergeSlicesAndEval";
+    case slapsRasterize:            return "slapsRasterize";
+    default:                        return "SLAPrintStep";
+    }
+}
+
+const char* trace_step_name(SLAPrintObjectStep step)
+{
+    switch (step) {
+    case slaposHollowing:       return "slaposHollowing";
+    case slaposDrillHoles:      return "slaposDrillHoles";
+    case slaposObjectSlice:     return "slaposObjectSlice";
+    case slaposSupportPoints:   return "slaposSupportPoints";
+    case slaposSupportTree:     return "slaposSupportTree";
+    case slaposPad:             return "slaposPad";
+    case slaposSliceSupports:   return "slaposSliceSupports";
+    default:                    return "SLAPrintObjectStep";
+    }
+}
+
 void SLAPrint::clear()
 {
     std::scoped_lock<std::mutex> lock(this->state_mutex());
@@ -30,6 +30,10 @@ enum SLAPrintObjectStep : unsigned int {
 	slaposCount
 };
 
+// Names of the steps in the Trace zones.
+const char* trace_step_name(SLAPrintStep step);
+const char* trace_step_name(SLAPrintObjectStep step);
+
 class SLAPrint;
 class GLCanvas;
 
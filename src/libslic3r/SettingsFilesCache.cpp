@@ -0,0 +1,85 @@
+#include "SettingsFilesCache.hpp"
+
+#include <filesystem>
+
+#include <boost/log/trivial.hpp>
+
+namespace Slic3r {
+
+namespace SettingsFilesCache {
+
+// Size and modification time of a file. The modification time of boost::filesystem has the resolution of a second,
+// thus a file modified twice within a second would not be reloaded.
+struct FileStamp
+{
+    uintmax_t                       size { 0 };
+    std::filesystem::file_time_type last_write_time;
+
+    bool operator==(const FileStamp &rhs) const { return size == rhs.size && last_write_time == rhs.last_write_time; }
+};
+
+struct Entry
+{
+    FileStamp                           stamp;
+    DynamicPrintConfig                  config;
+    std::map<std::string, std::string>  key_values;
+};
+
+static bool                                                                        s_enabled { false };
+static std::map<std::pair<std::string, ForwardCompatibilitySubstitutionRule>, Entry> s_entries;
+
+void set_enabled(bool enabled)
+{
+    s_enabled = enabled;
+    if (! enabled)
+        s_entries.clear();
+}
+
+bool enabled()
+{
+    return s_enabled;
+}
+
+size_t num_entries()
+{
+    return s_entries.size();
+}
+
+// Returns false if the file could not be accessed.
+static bool get_file_stamp(const std::string &file, FileStamp &stamp)
+{
+    std::error_code             ec;
+    const std::filesystem::path path = std::filesystem::u8path(file);
+    stamp.size = std::filesystem::file_size(path, ec);
+    if (! ec)
+        stamp.last_write_time = std::filesystem::last_write_time(path, ec);
+    return ! ec;
+}
+
+ConfigSubstitutions load(const std::string &file, ForwardCompatibilitySubstitutionRule compatibility_rule, DynamicPrintConfig &config,
+                         std::map<std::string, std::string> &key_values, std::string &reason)
+{
+    FileStamp stamp;
+    if (! s_enabled || ! get_file_stamp(file, stamp))
+        return config.load_from_json(file, compatibility_rule, key_values, reason);
+
+    auto key = std::make_pair(file, compatibility_rule);
+    if (auto it = s_entries.find(key); it != s_entries.end()) {
+        if (it->second.stamp == stamp) {
+            BOOST_LOG_TRIVIAL(info) << "Settings files cache: reusing " << file;
+            config.apply(it->second.config);
+            key_values = it->second.key_values;
+            return {};
+        }
+        s_entries.erase(it);
+    }
+
+    ConfigSubstitutions substitutions = config.load_from_json(file, compatibility_rule, key_values, reason);
+    if (reason.empty() && substitutions.empty())
+        s_entries[std::move(key)] = Entry{ stamp, config, key_values };
+    return substitutions;
+}
+
+} // namespace SettingsFilesCache
+
+} // namespace Slic3r
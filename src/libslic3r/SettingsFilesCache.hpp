@@ -0,0 +1,31 @@
+#ifndef slic3r_SettingsFilesCache_hpp_
+#define slic3r_SettingsFilesCache_hpp_
+
+#include <map>
+#include <string>
+
+#include "PrintConfig.hpp"
+
+namespace Slic3r {
+
+// Settings json files parsed by DynamicPrintConfig::load_from_json(), kept for the following jobs of a CLI batch.
+// An entry is keyed by the path of the file and by the substitution rule the file was loaded with. It is reused while the size
+// and the modification time of the file, in the resolution of the file system, are unchanged.
+// Files loaded with substitutions are not cached, so that the substitutions are reported by every job.
+// The cache is disabled unless enabled by set_enabled(), it is not thread safe.
+namespace SettingsFilesCache {
+
+    // Disabling the cache clears it.
+    void        set_enabled(bool enabled);
+    bool        enabled();
+    size_t      num_entries();
+
+    // Same as config.load_from_json(file, compatibility_rule, key_values, reason), the file is parsed only if it is not cached.
+    ConfigSubstitutions load(const std::string &file, ForwardCompatibilitySubstitutionRule compatibility_rule, DynamicPrintConfig &config,
+                             std::map<std::string, std::string> &key_values, std::string &reason);
+
+} // namespace SettingsFilesCache
+
+} // namespace Slic3r
+
+#endif // slic3r_SettingsFilesCache_hpp_
@@ -6,43 +6,241 @@
 
 #include "clipper.hpp"
 #include "ShortestPath.hpp"
+#include "BoundingBox.hpp"
 #include "KDTreeIndirect.hpp"
 #include "MutablePriorityQueue.hpp"
 #include "Print.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <cassert>
+#include <limits>
 
 namespace Slic3r {
 
+// Uniform grid over the end points of segments for the closest point searches of the greedy chaining algorithms below.
+// Contrary to KDTreeIndirect, a point is removed from the grid in constant time, therefore the end points, which may never be
+// connected to again, are removed and the closest point search does not have to skip them with the filter over and over.
+// The coordinates of the points are stored as a structure of arrays sorted by the grid cells, so that a cell is scanned linearly.
+// Once most of the points are removed, the grid is rebuilt with larger cells to keep the number of empty cells visited low.
+class EndPointGrid
+{
+public:
+	template<typename PositionFn>
+	EndPointGrid(size_t num_points, PositionFn position_fn) : m_slot_of(num_points, npos)
+	{
+		std::vector<Vec2d> 	positions;
+		std::vector<size_t> indices;
+		positions.reserve(num_points);
+		indices.reserve(num_points);
+		for (size_t i = 0; i < num_points; ++ i) {
+			positions.emplace_back(position_fn(i));
+			indices.emplace_back(i);
+		}
+		this->build(positions, indices);
+	}
+
+	static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+	size_t 	size() const { return m_idx.size() - m_num_removed; }
+
+	// Remove a point from the grid in O(1), removing a point twice is a no-op.
+	void 	remove(size_t idx)
+	{
+		size_t slot = m_slot_of[idx];
+		if (slot == npos)
+			return;
+		uint32_t cell = m_cell[slot];
+		size_t   last = m_cell_begin[cell] + (-- m_cell_count[cell]);
+		m_x   [slot] = m_x   [last];
+		m_y   [slot] = m_y   [last];
+		m_idx [slot] = m_idx [last];
+		m_slot_of[m_idx[slot]] = slot;
+		m_slot_of[idx] = npos;
+		++ m_num_removed;
+		if (size_t num_points = this->size(); num_points > 0 && num_points * 4 < m_cell_count.size())
+			this->rebuild();
+	}
+
+	// Find the closest point to pos accepted by the filter, npos if there is none.
+	template<typename FilterFn>
+	size_t 	find_closest_point(const Vec2d &pos, FilterFn filter) const
+	{
+		size_t best_idx = npos;
+		double best_d2  = std::numeric_limits<double>::max();
+		if (this->size() == 0)
+			return best_idx;
+		const double fx = (pos.x() - m_origin.x()) * m_inv_cell_size;
+		const double fy = (pos.y() - m_origin.y()) * m_inv_cell_size;
+		const int    cx = std::clamp(int(std::floor(std::clamp(fx, -1., double(m_cols)))), 0, m_cols - 1);
+		const int    cy = std::clamp(int(std::floor(std::clamp(fy, -1., double(m_rows)))), 0, m_rows - 1);
+		const int    r_max = std::max(std::max(cx, m_cols - 1 - cx), std::max(cy, m_rows - 1 - cy));
+		auto visit_cell = [this, &pos, &filter, &best_idx, &best_d2](int col, int row) {
+			const size_t cell  = size_t(row) * m_cols + col;
+			const size_t begin = m_cell_begin[cell];
+			const size_t end   = begin + m_cell_count[cell];
+			for (size_t slot = begin; slot < end; ++ slot) {
+				const double dx = m_x[slot] - pos.x();
+				const double dy = m_y[slot] - pos.y();
+				const double d2 = dx * dx + dy * dy;
+				if (d2 < best_d2 && filter(m_idx[slot])) {
+					best_d2  = d2;
+					best_idx = m_idx[slot];
+				}
+			}
+		};
+		for (int r = 0; r <= r_max; ++ r) {
+			if (r > 0 && best_idx != npos) {
+				// Lower bound of the distance to the cells of ring r, which are outside of the square of cells of ring (r - 1).
+				double dmin = std::numeric_limits<double>::max();
+				if (cx - r >= 0)
+					dmin = std::min(dmin, fx - double(cx - r + 1));
+				if (cx + r < m_cols)
+					dmin = std::min(dmin, double(cx + r) - fx);
+				if (cy - r >= 0)
+					dmin = std::min(dmin, fy - double(cy - r + 1));
+				if (cy + r < m_rows)
+					dmin = std::min(dmin, double(cy + r) - fy);
+				dmin = std::max(dmin, 0.) * m_cell_size;
+				if (dmin * dmin >= best_d2)
+					break;
+			}
+			const int col_min = std::max(cx - r, 0);
+			const int col_max = std::min(cx + r, m_cols - 1);
+			for (int row = std::max(cy - r, 0); row <= std::min(cy + r, m_rows - 1); ++ row)
+				if (row == cy - r || row == cy + r) {
+					for (int col = col_min; col <= col_max; ++ col)
+						visit_cell(col, row);
+				} else {
+					if (cx - r >= 0)
+						visit_cell(cx - r, row);
+					if (r > 0 && cx + r < m_cols)
+						visit_cell(cx + r, row);
+				}
+		}
+		return best_idx;
+	}
+
+private:
+	void 	build(const std::vector<Vec2d> &positions, const std::vector<size_t> &indices)
+	{
+		BoundingBoxf bbox;
+		for (const Vec2d &p : positions)
+			bbox.merge(p);
+		const size_t num_points = positions.size();
+		const Vec2d  size       = bbox.defined ? bbox.size() : Vec2d::Zero();
+		// About two points per cell. Degenerate bounding boxes (points on a horizontal or vertical line) get a single row or column.
+		double cell_size = std::max(std::sqrt(size.x() * size.y() * 2. / double(std::max<size_t>(num_points, 1))),
+			                        std::max(size.x(), size.y()) * 2. / double(std::max<size_t>(num_points, 1)));
+		if (cell_size <= 0.)
+			cell_size = 1.;
+		m_origin 		= bbox.defined ? bbox.min : Vec2d::Zero();
+		m_cell_size 	= cell_size;
+		m_inv_cell_size = 1. / cell_size;
+		m_cols 			= std::max(1, int(size.x() * m_inv_cell_size) + 1);
+		m_rows 			= std::max(1, int(size.y() * m_inv_cell_size) + 1);
+		auto cell_of = [this](const Vec2d &p) {
+			int col = std::clamp(int((p.x() - m_origin.x()) * m_inv_cell_size), 0, m_cols - 1);
+			int row = std::clamp(int((p.y() - m_origin.y()) * m_inv_cell_size), 0, m_rows - 1);
+			return uint32_t(size_t(row) * m_cols + col);
+		};
+		// Counting sort of the points by their cells.
+		m_cell_count.assign(size_t(m_cols) * size_t(m_rows), 0);
+		m_cell_begin.assign(m_cell_count.size() + 1, 0);
+		std::vector<uint32_t> cells;
+		cells.reserve(num_points);
+		for (const Vec2d &p : positions) {
+			cells.emplace_back(cell_of(p));
+			++ m_cell_begin[cells.back() + 1];
+		}
+		for (size_t i = 1; i < m_cell_begin.size(); ++ i)
+			m_cell_begin[i] += m_cell_begin[i - 1];
+		m_x.assign(num_points, 0.);
+		m_y.assign(num_points, 0.);
+		m_idx.assign(num_points, 0);
+		m_cell.assign(num_points, 0);
+		for (size_t i = 0; i < num_points; ++ i) {
+			uint32_t cell = cells[i];
+			size_t   slot = m_cell_begin[cell] + m_cell_count[cell] ++;
+			m_x   [slot] = positions[i].x();
+			m_y   [slot] = positions[i].y();
+			m_idx [slot] = indices[i];
+			m_cell[slot] = cell;
+			m_slot_of[indices[i]] = slot;
+		}
+		m_num_removed = 0;
+	}
+
+	void 	rebuild()
+	{
+		std::vector<Vec2d>  positions;
+		std::vector<size_t> indices;
+		positions.reserve(this->size());
+		indices.reserve(this->size());
+		for (size_t cell = 0; cell < m_cell_count.size(); ++ cell)
+			for (size_t slot = m_cell_begin[cell]; slot < m_cell_begin[cell] + m_cell_count[cell]; ++ slot) {
+				positions.emplace_back(m_x[slot], m_y[slot]);
+				indices.emplace_back(m_idx[slot]);
+			}
+		this->build(positions, indices);
+	}
+
+	Vec2d 					m_origin { Vec2d::Zero() };
+	double 					m_cell_size { 1. };
+	double 					m_inv_cell_size { 1. };
+	int 					m_cols { 1 };
+	int 					m_rows { 1 };
+	// Start of the points of a cell in the arrays below, the cell contains m_cell_count[cell] points.
+	std::vector<size_t> 	m_cell_begin;
+	std::vector<uint32_t> 	m_cell_count;
+	// Structure of arrays of the points sorted by the grid cells.
+	std::vector<double> 	m_x;
+	std::vector<double> 	m_y;
+	std::vector<size_t> 	m_idx;
+	std::vector<uint32_t> 	m_cell;
+	// Slot of a point in the arrays above, npos if removed.
+	std::vector<size_t> 	m_slot_of;
+	size_t 					m_num_removed { 0 };
+};
+
+template<typename FilterFn>
+size_t find_closest_point(const EndPointGrid &grid, const Vec2d &pos, FilterFn filter)
+{
+	return grid.find_closest_point(pos, filter);
+}
+
 // Naive implementation of the Traveling Salesman Problem, it works by always taking the next closest neighbor.
 // This implementation will always produce valid result even if some segments cannot reverse.
-template<typename EndPointType, typename KDTreeType, typename CouldReverseFunc>
-std::vector<std::pair<size_t, bool>> chain_segments_closest_point(std::vector<EndPointType> &end_points, KDTreeType &kdtree, CouldReverseFunc &could_reverse_func, EndPointType &first_point)
+template<typename EndPointType, typename CouldReverseFunc>
+std::vector<std::pair<size_t, bool>> chain_segments_closest_point(std::vector<EndPointType> &end_points, CouldReverseFunc &could_reverse_func, EndPointType &first_point)
 {
 	assert((end_points.size() & 1) == 0);
     size_t num_segments = end_points.size() / 2;
 	assert(num_segments >= 2);
 	for (EndPointType &ep : end_points)
 		ep.chain_id = 0;
+	EndPointGrid grid(end_points.size(), [&end_points](size_t idx) { return end_points[idx].pos; });
 	std::vector<std::pair<size_t, bool>> out;
 	out.reserve(num_segments);
 	size_t first_point_idx = &first_point - end_points.data();
 	out.emplace_back(first_point_idx / 2, (first_point_idx & 1) != 0);
 	first_point.chain_id = 1;
+	grid.remove(first_point_idx);
 	size_t this_idx = first_point_idx ^ 1;
 	for (int iter = (int)num_segments - 2; iter >= 0; -- iter) {
 		EndPointType &this_point = end_points[this_idx];
     	this_point.chain_id = 1;
+		grid.remove(this_idx);
     	// Find the closest point to this end_point, which lies on a different extrusion path (filtered by the lambda).
     	// Ignore the starting point as the starting point is considered to be occupied, no end point coud connect to it.
-		size_t next_idx = find_closest_point(kdtree, this_point.pos,
+		size_t next_idx = find_closest_point(grid, this_point.pos,
 			[this_idx, &end_points, &could_reverse_func](size_t idx) {
 				return (idx ^ this_idx) > 1 && end_points[idx].chain_id == 0 && ((idx & 1) == 0 || could_reverse_func(idx >> 1));
 		});
 		assert(next_idx < end_points.size());
 		EndPointType &end_point = end_points[next_idx];
 		end_point.chain_id = 1;
+		grid.remove(next_idx);
 		assert((next_idx & 1) == 0 || could_reverse_func(next_idx >> 1));
 		out.emplace_back(next_idx / 2, (next_idx & 1) != 0);
 		this_idx = next_idx ^ 1;
@@ -79,7 +277,7 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 	} 
 	else
 	{
-		// End points of segments for the KD tree closest point search.
+		// End points of segments for the closest point search.
 		// A single end point is inserted into the search structure for loops, two end points are entered for open paths.
 		struct EndPoint {
 			EndPoint(const Vec2d &pos) : pos(pos) {}
@@ -100,9 +298,8 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
             end_points.emplace_back(end_point_func(i, false).template cast<double>());
 	    }
 
-	    // Construct the closest point KD tree over end points of segments.
-		auto coordinate_fn = [&end_points](size_t idx, size_t dimension) -> double { return end_points[idx].pos[dimension]; };
-		KDTreeIndirect<2, double, decltype(coordinate_fn)> kdtree(coordinate_fn, end_points.size());
+	    // Construct the closest point search grid over end points of segments.
+		EndPointGrid grid(end_points.size(), [&end_points](size_t idx) { return end_points[idx].pos; });
 
 		// Helper to detect loops in already connected paths.
 		// Unique chain IDs are assigned to paths. If paths are connected, end points will not have their chain IDs updated, but the chain IDs
@@ -166,7 +363,7 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 		EndPoint *first_point = nullptr;
 		size_t    first_point_idx = std::numeric_limits<size_t>::max();
 		if (start_near != nullptr) {
-            size_t idx = find_closest_point(kdtree, start_near->template cast<double>(),
+            size_t idx = find_closest_point(grid, start_near->template cast<double>(),
 				// Don't start with a reverse segment, if flipping of the segment is not allowed.
 				[&could_reverse_func](size_t idx) { return (idx & 1) == 0 || could_reverse_func(idx >> 1); });
 			assert(idx < end_points.size());
@@ -174,6 +371,7 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 			first_point->distance_out = 0.;
 			first_point->chain_id = equivalent_chain.next();
 			first_point_idx = idx;
+			grid.remove(idx);
 		}
 		EndPoint *initial_point = first_point;
 		EndPoint *last_point = nullptr;
@@ -185,7 +383,7 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 		    	size_t this_idx = &end_point - &end_points.front();
 		    	// Find the closest point to this end_point, which lies on a different extrusion path (filtered by the lambda).
 		    	// Ignore the starting point as the starting point is considered to be occupied, no end point coud connect to it.
-				size_t next_idx = find_closest_point(kdtree, end_point.pos, 
+				size_t next_idx = find_closest_point(grid, end_point.pos, 
 					[this_idx, first_point_idx](size_t idx){ return idx != first_point_idx && (idx ^ this_idx) > 1; });
 				assert(next_idx < end_points.size());
 				EndPoint &end_point2 = end_points[next_idx];
@@ -289,6 +487,9 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 								equivalent_chain.merge(end_point1_other_chain_id, end_point2_other_chain_id));
 				end_point1.chain_id = chain_id;
 				end_point2.chain_id = chain_id;
+				// Connected end points will never be connected to again.
+				grid.remove(&end_point1 - &end_points.front());
+				grid.remove(&end_point2 - &end_points.front());
 				assert(validate_graph_and_queue());
 				if (iter == 0) {
 					// Last iteration. There shall be exactly one or two end points waiting to be connected.
@@ -311,12 +512,12 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 		    	// Update edge_out and distance.
 		    	size_t this_idx = &end_point1 - &end_points.front();
 		    	// Find the closest point to this end_point, which lies on a different extrusion path (filtered by the filter lambda).
-				size_t next_idx = find_closest_point(kdtree, end_point1.pos, [&end_points, &equivalent_chain, this_idx](size_t idx) { 
+				size_t next_idx = find_closest_point(grid, end_point1.pos, [&end_points, &equivalent_chain, this_idx](size_t idx) { 
 			    	assert(end_points[this_idx].edge_out == nullptr);
 			    	assert(end_points[this_idx].chain_id == 0);
 					if ((idx ^ this_idx) <= 1 || end_points[idx].chain_id != 0)
 						// Points of the same segment shall not be connected,
-						// cannot connect to an already connected point (ideally those would be removed from the KD tree, but the update is difficult).
+						// cannot connect to an already connected point.
 						return false;
 			    	size_t chain1 = equivalent_chain(end_points[this_idx ^ 1].chain_id);
 			    	size_t chain2 = equivalent_chain(end_points[idx      ^ 1].chain_id);
@@ -331,8 +532,6 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 #endif /* NDEBUG */
 				// Update position of this end point in the queue based on the distance calculated at the line above.
 				queue.update(end_point1.heap_idx);
-		    	//FIXME Remove the other end point from the KD tree.
-		    	// As the KD tree update is expensive, do it only after some larger number of points is removed from the queue.
 				assert(validate_graph_and_queue());
 	    	}
 		}
@@ -383,7 +582,7 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 			}
 			if (failed)
 				// As a last resort, try a dumb algorithm, which is not sensitive to edge reversal constraints.
-				out = chain_segments_closest_point<EndPoint, decltype(kdtree), CouldReverseFunc>(end_points, kdtree, could_reverse_func, (initial_point != nullptr) ? *initial_point : end_points.front());
+				out = chain_segments_closest_point<EndPoint, CouldReverseFunc>(end_points, could_reverse_func, (initial_point != nullptr) ? *initial_point : end_points.front());
 		} else {
 			assert(! failed);
 		}
@@ -393,8 +592,8 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 	return out;
 }
 
-template<typename QueueType, typename KDTreeType, typename ChainsType, typename EndPointType>
-void update_end_point_in_queue(QueueType &queue, const KDTreeType &kdtree, ChainsType &chains, std::vector<EndPointType> &end_points, EndPointType &end_point, size_t first_point_idx, const EndPointType *first_point)
+template<typename QueueType, typename ChainsType, typename EndPointType>
+void update_end_point_in_queue(QueueType &queue, const EndPointGrid &grid, ChainsType &chains, std::vector<EndPointType> &end_points, EndPointType &end_point, size_t first_point_idx, const EndPointType *first_point)
 {
 	// Updating an end point or a 2nd from an end point.
 	size_t this_idx = end_point.index(end_points);
@@ -414,7 +613,7 @@ void update_end_point_in_queue(QueueType &queue, const KDTreeType &kdtree, Chain
 		size_t chain1b    = end_points[this_idx ^ 1].chain_id;
 		size_t this_chain = chains.equivalent(std::max(chain1a, chain1b));
 		// Find the closest point to this end_point, which lies on a different extrusion path (filtered by the filter lambda).
-		size_t next_idx = find_closest_point(kdtree, end_point.pos, [&end_points, &chains, this_idx, first_point_idx, first_point, this_chain](size_t idx) {
+		size_t next_idx = find_closest_point(grid, end_point.pos, [&end_points, &chains, this_idx, first_point_idx, first_point, this_chain](size_t idx) {
 	    	assert(end_points[this_idx].edge_candidate == nullptr);
 	    	// Either this end of the edge or the other end of the edge is not yet connected.
 	    	assert((end_points[this_idx    ].chain_id == 0 && end_points[this_idx    ].edge_out == nullptr) ||
@@ -427,7 +626,6 @@ void update_end_point_in_queue(QueueType &queue, const KDTreeType &kdtree, Chain
 			size_t chain2b = end_points[idx ^ 1].chain_id;
 			if (chain2a > 0 && chain2b > 0)
 				// Only unconnected end point or a point next to an unconnected end point may be connected to.
-				// Ideally those would be removed from the KD tree, but the update is difficult.
 				return false;
 	    	assert(chain2a == 0 || chain2b == 0);
 	    	size_t chain2 = chains.equivalent(std::max(chain2a, chain2b));
@@ -478,7 +676,7 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 	} 
 	else
 	{
-		// End points of segments for the KD tree closest point search.
+		// End points of segments for the closest point search.
 		// A single end point is inserted into the search structure for loops, two end points are entered for open paths.
 		struct EndPoint {
 			EndPoint(const Vec2d &pos) : pos(pos) {}
@@ -511,9 +709,8 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
             end_points.emplace_back(end_point_func(i, false).template cast<double>());
 	    }
 
-	    // Construct the closest point KD tree over end points of segments.
-		auto coordinate_fn = [&end_points](size_t idx, size_t dimension) -> double { return end_points[idx].pos[dimension]; };
-		KDTreeIndirect<2, double, decltype(coordinate_fn)> kdtree(coordinate_fn, end_points.size());
+	    // Construct the closest point search grid over end points of segments.
+		EndPointGrid grid(end_points.size(), [&end_points](size_t idx) { return end_points[idx].pos; });
 
 	    // Chained segments with their sum of connection lengths.
 	    // The chain supports flipping all the segments, connecting the segments at the opposite ends.
@@ -661,7 +858,7 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 		EndPoint *first_point = nullptr;
 		size_t    first_point_idx = std::numeric_limits<size_t>::max();
 		if (start_near != nullptr) {
-            size_t idx = find_closest_point(kdtree, start_near->template cast<double>());
+            size_t idx = find_closest_point(grid, start_near->template cast<double>());
 			assert(idx < end_points.size());
 			first_point = &end_points[idx];
 			first_point->distance_out = 0.;
@@ -670,6 +867,8 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 			chain.begin = first_point;
 			chain.end   = &first_point->opposite(end_points);
 			first_point_idx = idx;
+			// The first point is never connected to.
+			grid.remove(idx);
 		}
 		EndPoint *initial_point = first_point;
 		EndPoint *last_point = nullptr;
@@ -681,7 +880,7 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 		    	size_t this_idx = end_point.index(end_points);
 		    	// Find the closest point to this end_point, which lies on a different extrusion path (filtered by the lambda).
 		    	// Ignore the starting point as the starting point is considered to be occupied, no end point coud connect to it.
-				size_t next_idx = find_closest_point(kdtree, end_point.pos, 
+				size_t next_idx = find_closest_point(grid, end_point.pos, 
 					[this_idx, first_point_idx](size_t idx){ return idx != first_point_idx && (idx ^ this_idx) > 1; });
 				assert(next_idx < end_points.size());
 				EndPoint &end_point2 = end_points[next_idx];
@@ -857,6 +1056,12 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 					chain.begin->chain_id = 0;
 				if (chain.end != first_point)
 					chain.end->chain_id = 0;
+				// Segments connected at both ends are inside a chain for good, no end point may connect to them.
+				for (EndPoint *ept : { end_point1, end_point2 })
+					if (ept->opposite(end_points).edge_out != nullptr) {
+						grid.remove(ept->index(end_points));
+						grid.remove(ept->opposite(end_points).index(end_points));
+					}
 				if (-- num_connections_to_end == 0) {
 					assert(validate_graph_and_queue());
 					// Last iteration. There shall be exactly one or two end points waiting to be connected.
@@ -885,12 +1090,12 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 				} else {
 					//FIXME update the 2nd end points on the queue.
 					// Update end points of the flipped segments.
-					update_end_point_in_queue(queue, kdtree, chains, end_points, chain.begin->opposite(end_points), first_point_idx, first_point);
-					update_end_point_in_queue(queue, kdtree, chains, end_points, chain.end->opposite(end_points),   first_point_idx, first_point);
+					update_end_point_in_queue(queue, grid, chains, end_points, chain.begin->opposite(end_points), first_point_idx, first_point);
+					update_end_point_in_queue(queue, grid, chains, end_points, chain.end->opposite(end_points),   first_point_idx, first_point);
 					if (chain1_flip)
-						update_end_point_in_queue(queue, kdtree, chains, end_points, *chain.begin, first_point_idx, first_point);
+						update_end_point_in_queue(queue, grid, chains, end_points, *chain.begin, first_point_idx, first_point);
 					if (chain2_flip)
-						update_end_point_in_queue(queue, kdtree, chains, end_points, *chain.end,   first_point_idx, first_point);
+						update_end_point_in_queue(queue, grid, chains, end_points, *chain.end,   first_point_idx, first_point);
 					// End points of chains shall certainly stay in the queue.
 					assert(chain.begin == first_point || chain.begin->heap_idx < queue.size());
 					assert(chain.end   == first_point || chain.end  ->heap_idx < queue.size());
@@ -902,7 +1107,7 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 				}
 			} else {
 				// This edge forms a loop. Update end_point1 and try another one.
-				update_end_point_in_queue(queue, kdtree, chains, end_points, *end_point1, first_point_idx, first_point);
+				update_end_point_in_queue(queue, grid, chains, end_points, *end_point1, first_point_idx, first_point);
 #ifndef NDEBUG
 				// Each edge shall be longer than the last one removed from the queue.
 				//assert(end_point1->distance_out > distance_taken_last - SCALED_EPSILON);
@@ -910,8 +1115,6 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 //					printf("Warning: taking shorter length than previously is suspicious\n");
 				}
 #endif /* NDEBUG */
-		    	//FIXME Remove the other end point from the KD tree.
-		    	// As the KD tree update is expensive, do it only after some larger number of points is removed from the queue.
 		    }
 			assert(validate_graph_and_queue());
 		}
@@ -962,7 +1165,7 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy_constrained_reversals
 			}
 			if (failed)
 				// As a last resort, try a dumb algorithm, which is not sensitive to edge reversal constraints.
-				out = chain_segments_closest_point<EndPoint, decltype(kdtree), CouldReverseFunc>(end_points, kdtree, could_reverse_func, (initial_point != nullptr) ? *initial_point : end_points.front());
+				out = chain_segments_closest_point<EndPoint, CouldReverseFunc>(end_points, could_reverse_func, (initial_point != nullptr) ? *initial_point : end_points.front());
 		} else {
 			assert(! failed);
 		}
@@ -1287,6 +1490,8 @@ struct ConnectionCost {
 };
 static inline ConnectionCost operator-(const ConnectionCost &lhs, const ConnectionCost& rhs) { return ConnectionCost(lhs.cost - rhs.cost, lhs.cost_flipped - rhs.cost_flipped); }
 
+// Find the reordering, reversal and flipping of the three spans of edges with the lowest total cost of the connections.
+// Returns the cost and the constellation to be passed to do_crossover(), zero constellation if no improvement was found.
 static inline std::pair<double, size_t> minimum_crossover_cost(
 	const std::vector<FlipEdge>		  &edges,
 	const std::pair<size_t, size_t>   &span1, const ConnectionCost &cost1,
@@ -1294,63 +1499,88 @@ static inline std::pair<double, size_t> minimum_crossover_cost(
 	const std::pair<size_t, size_t>   &span3, const ConnectionCost &cost3,
 	const double					   cost_current)
 {
-	auto connection_cost = [&edges](
-		const std::pair<size_t, size_t> &span1, const ConnectionCost &cost1, bool reversed1, bool flipped1,
-		const std::pair<size_t, size_t> &span2, const ConnectionCost &cost2, bool reversed2, bool flipped2,
-		const std::pair<size_t, size_t> &span3, const ConnectionCost &cost3, bool reversed3, bool flipped3) {
-		auto first_point = [&edges](const std::pair<size_t, size_t> &span, bool flipped) { return flipped ? edges[span.first].p2 : edges[span.first].p1; };
-		auto last_point  = [&edges](const std::pair<size_t, size_t> &span, bool flipped) { return flipped ? edges[span.second - 1].p1 : edges[span.second - 1].p2; };
-		auto point       = [first_point, last_point](const std::pair<size_t, size_t> &span, bool start, bool flipped) { return start ? first_point(span, flipped) : last_point(span, flipped); };
-		auto cost        = [](const ConnectionCost &acost, bool flipped) { 
-			assert(acost.cost >= 0. && acost.cost_flipped >= 0.);
-			return flipped ? acost.cost_flipped : acost.cost;
-		};
-		// Ignore reversed single segment spans.
-		auto simple_span_ignore = [](const std::pair<size_t, size_t>& span, bool reversed) {
-			return span.first + 1 == span.second && reversed;
-		};
-		assert(span1.first < span1.second);
-		assert(span2.first < span2.second);
-		assert(span3.first < span3.second);
-		return 
-			simple_span_ignore(span1, reversed1) || simple_span_ignore(span2, reversed2) || simple_span_ignore(span3, reversed3) ?
-				// Don't perform unnecessary calculations simulating reversion of single segment spans.
-				std::numeric_limits<double>::max() :
-				// Calculate the cost of reverting chains and / or flipping segment orientations.
-				cost(cost1, flipped1) + cost(cost2, flipped2) + cost(cost3, flipped3) +
-					(point(span2, ! reversed2, flipped2) - point(span1, reversed1, flipped1)).norm() + 
-					(point(span3, ! reversed3, flipped3) - point(span2, reversed2, flipped2)).norm();
+	assert(span1.first < span1.second);
+	assert(span2.first < span2.second);
+	assert(span3.first < span3.second);
+	// A span is entered and left at one of its four end points: the first or the last point of its first or last edge,
+	// depending on whether the span is reversed and whether its edges are flipped. The lengths of the 3 * 16 connections
+	// between the end points of different spans are calculated once in a single loop over flat arrays, the 3 * 64
+	// constellations tested below only sum up the precalculated lengths and costs.
+	// End point index: bit 0 - the span starts at this point, bit 1 - the edges of the span are flipped.
+	const std::pair<size_t, size_t> *spans[3] = { &span1, &span2, &span3 };
+	const ConnectionCost 			*costs[3] = { &cost1, &cost2, &cost3 };
+	double 							 px[3][4], py[3][4];
+	for (int i = 0; i < 3; ++ i) {
+		const FlipEdge &first = edges[spans[i]->first];
+		const FlipEdge &last  = edges[spans[i]->second - 1];
+		const Vec2d    *pts[4] = { &last.p2, &first.p1, &last.p1, &first.p2 };
+		for (int j = 0; j < 4; ++ j) {
+			px[i][j] = pts[j]->x();
+			py[i][j] = pts[j]->y();
+		}
+	}
+	// dist[i][j][k][l]: length of the connection between end point k of span i and end point l of span j.
+	double dist[3][3][4][4];
+	for (int i = 0; i < 3; ++ i)
+		for (int j = i + 1; j < 3; ++ j)
+			for (int k = 0; k < 4; ++ k)
+				for (int l = 0; l < 4; ++ l) {
+					double dx = px[j][l] - px[i][k];
+					double dy = py[j][l] - py[i][k];
+					dist[j][i][l][k] = dist[i][j][k][l] = std::sqrt(dx * dx + dy * dy);
+				}
+	// Reversal of a single edge span is the same as flipping it.
+	const bool single[3] = { span1.first + 1 == span1.second, span2.first + 1 == span2.second, span3.first + 1 == span3.second };
+	auto cost = [](const ConnectionCost &acost, bool flipped) {
+		assert(acost.cost >= 0. && acost.cost_flipped >= 0.);
+		return flipped ? acost.cost_flipped : acost.cost;
+	};
+	// Cost of spans a, b, c chained in this order, reversed / flipped according to the bits of i.
+	auto connection_cost = [&dist, &costs, &single, &cost](int a, int b, int c, size_t i) {
+		const bool reversed_a = (i & 1) != 0, flipped_a = (i & (1 << 1)) != 0;
+		const bool reversed_b = (i & (1 << 2)) != 0, flipped_b = (i & (1 << 3)) != 0;
+		const bool reversed_c = (i & (1 << 4)) != 0, flipped_c = (i & (1 << 5)) != 0;
+		if ((single[a] && reversed_a) || (single[b] && reversed_b) || (single[c] && reversed_c))
+			// Don't perform unnecessary calculations simulating reversion of single segment spans.
+			return std::numeric_limits<double>::max();
+		auto end_point = [](bool start, bool flipped) { return int(start) | (int(flipped) << 1); };
+		return cost(*costs[a], flipped_a) + cost(*costs[b], flipped_b) + cost(*costs[c], flipped_c) +
+			dist[b][a][end_point(! reversed_b, flipped_b)][end_point(reversed_a, flipped_a)] +
+			dist[c][b][end_point(! reversed_c, flipped_c)][end_point(reversed_b, flipped_b)];
 	};
 
-#ifndef NDEBUG
-	{
-		double c = connection_cost(span1, cost1, false, false, span2, cost2, false, false, span3, cost3, false, false);
-		assert(std::abs(c - cost_current) < SCALED_EPSILON);
-	}
-#endif /* NDEBUG */
+	assert(std::abs(connection_cost(0, 1, 2, 0) - cost_current) < SCALED_EPSILON);
 
+	// From the three combinations of 1,2,3 ordering, the other three are reversals of the first three.
+	static constexpr const int orderings[3][3] = { { 0, 1, 2 }, { 0, 2, 1 }, { 1, 0, 2 } };
+	// Find the lowest cost first. Flipping the edges of a long span usually costs a lot, therefore the constellations are enumerated
+	// by the flipping of the spans, and the reversals are only tested if the costs of the flipped spans are lower than the best total cost.
 	double cost_min = cost_current;
-	size_t flip_min = 0; // no flip, no improvement
-	for (size_t i = 0; i < (1 << 6); ++ i) {
-		// From the three combinations of 1,2,3 ordering, the other three are reversals of the first three.
-		double c1 = (i == 0) ? cost_current : 
-			        connection_cost(span1, cost1, (i & 1) != 0, (i & (1 << 1)) != 0, span2, cost2, (i & (1 << 2)) != 0, (i & (1 << 3)) != 0, span3, cost3, (i & (1 << 4)) != 0, (i & (1 << 5)) != 0);
-		double c2 = connection_cost(span1, cost1, (i & 1) != 0, (i & (1 << 1)) != 0, span3, cost3, (i & (1 << 2)) != 0, (i & (1 << 3)) != 0, span2, cost2, (i & (1 << 4)) != 0, (i & (1 << 5)) != 0);
-		double c3 = connection_cost(span2, cost2, (i & 1) != 0, (i & (1 << 1)) != 0, span1, cost1, (i & (1 << 2)) != 0, (i & (1 << 3)) != 0, span3, cost3, (i & (1 << 4)) != 0, (i & (1 << 5)) != 0);
-		if (c1 < cost_min) {
-			cost_min = c1;
-			flip_min = i;
-		}
-		if (c2 < cost_min) {
-			cost_min = c2;
-			flip_min = i + (1 << 6);
-		}
-		if (c3 < cost_min) {
-			cost_min = c3;
-			flip_min = i + (2 << 6);
+	for (int ordering = 0; ordering < 3; ++ ordering) {
+		const int *o = orderings[ordering];
+		for (size_t flips = 0; flips < 8; ++ flips) {
+			const size_t flip_bits = ((flips & 1) << 1) | ((flips & 2) << 2) | ((flips & 4) << 3);
+			if (cost(*costs[o[0]], (flips & 1) != 0) + cost(*costs[o[1]], (flips & 2) != 0) + cost(*costs[o[2]], (flips & 4) != 0) >= cost_min)
+				// Connection lengths are non-negative, none of the reversals could improve the cost.
+				continue;
+			for (size_t reversals = 0; reversals < 8; ++ reversals) {
+				const size_t i = flip_bits | (reversals & 1) | ((reversals & 2) << 1) | ((reversals & 4) << 2);
+				if (ordering > 0 || i > 0)
+					cost_min = std::min(cost_min, connection_cost(o[0], o[1], o[2], i));
+			}
 		}
 	}
-	return std::make_pair(cost_min, flip_min);
+	if (cost_min >= cost_current)
+		// No flip, no improvement.
+		return std::make_pair(cost_current, size_t(0));
+	// Of the constellations with the lowest cost, return the first one in the order of the reversal / flip bits,
+	// then of the orderings, so that ties are resolved independently of the pruning above.
+	for (size_t i = 0; i < (1 << 6); ++ i)
+		for (int ordering = 0; ordering < 3; ++ ordering)
+			if ((ordering > 0 || i > 0) && connection_cost(orderings[ordering][0], orderings[ordering][1], orderings[ordering][2], i) == cost_min)
+				return std::make_pair(cost_min, i + (size_t(ordering) << 6));
+	assert(false);
+	return std::make_pair(cost_current, size_t(0));
 }
 
 #if 0
@@ -1546,12 +1776,18 @@ static inline void do_crossover(const std::vector<FlipEdge> &edges_in, std::vect
 }
 #endif
 
+// Limit of the crossovers evaluated by a single call of reorder_by_two_exchanges_with_segment_flipping(),
+// about 0.15 seconds on a current desktop CPU.
+static constexpr size_t two_exchanges_max_crossovers_evaluated = size_t(1) << 19;
+
 // Worst time complexity:    O(min(n, 100) * (n * log n + n^2)
 // Expected time complexity: O(min(n, 100) * (n * log n + k * n)
 // where n is the number of edges and k is the number of connection_lengths candidates after the first one
 // is found that improves the total cost.
+// The number of crossovers evaluated is limited by max_crossovers_evaluated to bound the running time for large n.
+// Contrary to a time limit, the limit keeps the result independent of the speed and the load of the machine.
 //FIXME there are likley better heuristics to lower the time complexity.
-static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<FlipEdge> &edges)
+static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<FlipEdge> &edges, size_t max_crossovers_evaluated)
 {
 	if (edges.size() < 2)
 		return;
@@ -1561,7 +1797,8 @@ static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<Fl
 	std::vector<std::pair<double, size_t>>	connection_lengths(edges.size() - 1, std::pair<double, size_t>(0., 0));
 	std::vector<char>						connection_tried(edges.size(), false);
 	const size_t 							max_iterations = std::min(edges.size(), size_t(100));
-	for (size_t iter = 0; iter < max_iterations; ++ iter) {
+	size_t 									num_crossovers_evaluated = 0;
+	for (size_t iter = 0; iter < max_iterations && num_crossovers_evaluated < max_crossovers_evaluated; ++ iter) {
 		// Initialize connection costs and connection lengths.
 		for (size_t i = 1; i < edges.size(); ++ i) {
 			const FlipEdge   	 &e1 = edges[i - 1];
@@ -1591,6 +1828,7 @@ static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<Fl
 					size_t b = longest_connection_idx;
 					if (a > b)
 						std::swap(a, b);
+					++ num_crossovers_evaluated;
 					std::pair<double, size_t> cost_and_flip = minimum_crossover_cost(edges, 
 						std::make_pair(size_t(0), a), connections[a - 1], std::make_pair(a, b), connections[b - 1] - connections[a], std::make_pair(b, edges.size()), connections.back() - connections[b],
 						connections.back().cost);
@@ -1607,6 +1845,9 @@ static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<Fl
 				crossover2_pos_final = crossover_pos_min;
 				crossover_flip_final = crossover_flip_min;
 				break;
+			} else if (num_crossovers_evaluated >= max_crossovers_evaluated) {
+				// Out of budget, keep the improvements found so far.
+				break;
 			} else {
 				// Continue with another long candidate edge.
 			}
@@ -1630,7 +1871,7 @@ static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<Fl
 static inline void reorder_by_three_exchanges_with_segment_flipping(std::vector<FlipEdge> &edges)
 {
 	if (edges.size() < 3) {
-		reorder_by_two_exchanges_with_segment_flipping(edges);
+		reorder_by_two_exchanges_with_segment_flipping(edges, two_exchanges_max_crossovers_evaluated);
 		return;
 	}
 
@@ -1784,7 +2025,7 @@ static inline std::pair<double, size_t> minimum_crossover_cost(
 static inline void reorder_by_three_exchanges_with_segment_flipping2(std::vector<FlipEdge> &edges)
 {
 	if (edges.size() < 3) {
-		reorder_by_two_exchanges_with_segment_flipping(edges);
+		reorder_by_two_exchanges_with_segment_flipping(edges, two_exchanges_max_crossovers_evaluated);
 		return;
 	}
 
@@ -1903,7 +2144,7 @@ static inline void improve_ordering_by_two_exchanges_with_segment_flipping(Polyl
     std::transform(polylines.begin(), polylines.end(), std::back_inserter(edges), 
     	[&polylines](const Polyline &pl){ return FlipEdge(pl.first_point().cast<double>(), pl.last_point().cast<double>(), &pl - polylines.data()); });
 #if 1
-	reorder_by_two_exchanges_with_segment_flipping(edges);
+	reorder_by_two_exchanges_with_segment_flipping(edges, two_exchanges_max_crossovers_evaluated);
 #else
 	// reorder_by_three_exchanges_with_segment_flipping(edges);
 	reorder_by_three_exchanges_with_segment_flipping2(edges);
@@ -0,0 +1,292 @@
+#include "SlicingCache.hpp"
+#include "Format/SlicedLayers.hpp"
+#include "libslic3r_version.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <mutex>
+
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include <openssl/md5.h>
+#include <miniz.h>
+
+namespace Slic3r {
+
+namespace SlicingCache {
+
+// Increase whenever the format of the cache entries or the output of slice_mesh_ex() changes.
+static constexpr const uint32_t ENTRY_VERSION = 1;
+static constexpr const char     ENTRY_MAGIC[4] = { 'O', 'S', 'L', 'C' };
+static constexpr const char    *ENTRY_EXTENSION = ".slc";
+
+// The size of an entry is checked against these before being decompressed, as the header of an entry read from the disk is not trusted.
+// Deflate does not compress better than about 1:1032.
+static constexpr const uint64_t ENTRY_MAX_COMPRESSION_RATIO = 1032;
+// Slicing results over 1 GiB are not cached. The limit also has to fit mz_ulong and size_t, which are 32 bits wide on some platforms.
+static constexpr const uint64_t ENTRY_MAX_UNCOMPRESSED_SIZE = std::min<uint64_t>({ uint64_t(1) << 30,
+    uint64_t(std::numeric_limits<mz_ulong>::max()), uint64_t(std::numeric_limits<size_t>::max()) });
+// Once the cache exceeds its size limit, it is shrunk to this fraction of the limit, so that the following stores do not evict again.
+static constexpr const double   EVICT_TO_SIZE_RATIO = 0.9;
+static constexpr const size_t   UNKNOWN_SIZE = std::numeric_limits<size_t>::max();
+
+static std::mutex  s_mutex;
+static std::string s_directory;
+static size_t      s_max_size { 0 };
+// Estimate of the total size of the entries: Scanned on the first store, then incremented by the stores of this process.
+// The entries stored by the other processes sharing the directory are accounted for by the directory scan of the next eviction.
+static size_t      s_total_size { UNKNOWN_SIZE };
+
+void set_directory(const std::string &dir, size_t max_size_bytes)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_directory  = dir;
+    s_max_size   = max_size_bytes;
+    s_total_size = UNKNOWN_SIZE;
+    if (! dir.empty()) {
+        boost::system::error_code ec;
+        boost::filesystem::create_directories(dir, ec);
+        if (ec) {
+            BOOST_LOG_TRIVIAL(error) << "Slicing cache: Failed to create directory " << dir << ": " << ec.message();
+            s_directory.clear();
+        } else
+            BOOST_LOG_TRIVIAL(info) << "Slicing cache: Using directory " << dir << ", size limit " << max_size_bytes << " bytes";
+    }
+}
+
+bool enabled()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return ! s_directory.empty();
+}
+
+static boost::filesystem::path entry_path(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return boost::filesystem::path(s_directory) / (key + ENTRY_EXTENSION);
+}
+
+template<typename T>
+static inline void md5_update_vector(MD5_CTX &ctx, const std::vector<T> &v)
+{
+    uint64_t size = v.size();
+    MD5_Update(&ctx, &size, sizeof(size));
+    if (! v.empty())
+        MD5_Update(&ctx, v.data(), v.size() * sizeof(T));
+}
+
+template<typename T>
+static inline void md5_update_value(MD5_CTX &ctx, const T &value)
+{
+    MD5_Update(&ctx, &value, sizeof(T));
+}
+
+std::string make_key(const indexed_triangle_set &its, const std::vector<float> &zs, const MeshSlicingParamsEx &params)
+{
+    MD5_CTX ctx;
+    MD5_Init(&ctx);
+    // Results produced by another version of the slicer are not reused.
+    MD5_Update(&ctx, SoftFever_VERSION, strlen(SoftFever_VERSION));
+    MD5_Update(&ctx, GIT_COMMIT_HASH, strlen(GIT_COMMIT_HASH));
+    md5_update_value(ctx, ENTRY_VERSION);
+    md5_update_vector(ctx, its.vertices);
+    md5_update_vector(ctx, its.indices);
+    md5_update_vector(ctx, zs);
+    md5_update_value(ctx, uint32_t(params.mode));
+    md5_update_value(ctx, uint64_t(params.slicing_mode_normal_below_layer));
+    md5_update_value(ctx, uint32_t(params.mode_below));
+    MD5_Update(&ctx, params.trafo.matrix().data(), 16 * sizeof(double));
+    md5_update_value(ctx, params.closing_radius);
+    md5_update_value(ctx, params.extra_offset);
+    md5_update_value(ctx, params.resolution);
+    unsigned char digest[16];
+    MD5_Final(digest, &ctx);
+    char key[33];
+    for (int j = 0; j < 16; ++ j)
+        sprintf(&key[j * 2], "%02x", (unsigned int)digest[j]);
+    return std::string(key, 32);
+}
+
+// Slices of the layers are stored with the SlicedLayers encoding of ExPolygons.
+static bool deserialize_layers(const unsigned char *begin, const unsigned char *end, std::vector<ExPolygons> &layers)
+{
+    try {
+        SlicedLayers::Reader reader(begin, end);
+        auto num_layers = reader.read_value<uint32_t>();
+        reader.check_available(num_layers);
+        layers.assign(num_layers, ExPolygons());
+        for (ExPolygons &expolygons : layers)
+            reader.read(expolygons);
+        return reader.at_end();
+    } catch (const Slic3r::FileIOError&) {
+        return false;
+    }
+}
+
+bool load(const std::string &key, std::vector<ExPolygons> &layers)
+{
+    if (! enabled())
+        return false;
+    boost::filesystem::path path = entry_path(key);
+    boost::system::error_code ec;
+    if (! boost::filesystem::exists(path, ec))
+        return false;
+
+    std::vector<unsigned char> data;
+    {
+        boost::nowide::ifstream ifs(path.string(), std::ios::binary);
+        if (! ifs)
+            return false;
+        data.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+
+    uint32_t version;
+    uint64_t uncompressed_size;
+    const size_t header_size = sizeof(ENTRY_MAGIC) + sizeof(version) + sizeof(uncompressed_size);
+    bool valid = data.size() >= header_size && memcmp(data.data(), ENTRY_MAGIC, sizeof(ENTRY_MAGIC)) == 0;
+    if (valid) {
+        memcpy(&version, data.data() + sizeof(ENTRY_MAGIC), sizeof(version));
+        memcpy(&uncompressed_size, data.data() + sizeof(ENTRY_MAGIC) + sizeof(version), sizeof(uncompressed_size));
+        const uint64_t compressed_size = data.size() - header_size;
+        valid = version == ENTRY_VERSION && uncompressed_size <= ENTRY_MAX_UNCOMPRESSED_SIZE &&
+                uncompressed_size <= compressed_size * ENTRY_MAX_COMPRESSION_RATIO;
+    }
+    if (valid) {
+        std::vector<unsigned char> uncompressed(size_t(uncompressed_size), 0);
+        mz_ulong                   len = mz_ulong(uncompressed_size);
+        valid = mz_uncompress(uncompressed.data(), &len, data.data() + header_size, mz_ulong(data.size() - header_size)) == MZ_OK &&
+                len == uncompressed_size &&
+                deserialize_layers(uncompressed.data(), uncompressed.data() + uncompressed.size(), layers);
+    }
+    if (! valid) {
+        BOOST_LOG_TRIVIAL(warning) << "Slicing cache: Removing invalid entry " << path.string();
+        layers.clear();
+        boost::filesystem::remove(path, ec);
+        return false;
+    }
+    // Mark the entry as recently used for the eviction.
+    boost::filesystem::last_write_time(path, std::time(nullptr), ec);
+    return true;
+}
+
+// Scan the cache directory, returns the total size of the entries.
+// If max_size is not zero and the entries exceed it, remove the least recently used entries except for keep.
+static size_t scan_and_evict(const boost::filesystem::path &dir, size_t max_size, const boost::filesystem::path &keep)
+{
+    struct Entry {
+        boost::filesystem::path path;
+        std::time_t             time;
+        size_t                  size;
+    };
+    std::vector<Entry>        entries;
+    size_t                    total_size = 0;
+    boost::system::error_code ec;
+    for (boost::filesystem::directory_iterator it(dir, ec), it_end; ! ec && it != it_end; it.increment(ec))
+        if (it->path().extension() == ENTRY_EXTENSION) {
+            boost::system::error_code ec_entry;
+            Entry entry { it->path(), boost::filesystem::last_write_time(it->path(), ec_entry), size_t(boost::filesystem::file_size(it->path(), ec_entry)) };
+            if (! ec_entry) {
+                total_size += entry.size;
+                entries.emplace_back(std::move(entry));
+            }
+        }
+    if (max_size == 0 || total_size <= max_size)
+        return total_size;
+
+    const size_t target_size = size_t(EVICT_TO_SIZE_RATIO * double(max_size));
+    std::sort(entries.begin(), entries.end(), [](const Entry &l, const Entry &r) { return l.time < r.time; });
+    for (const Entry &entry : entries) {
+        if (total_size <= target_size)
+            break;
+        if (entry.path == keep)
+            continue;
+        // Another process may have removed the entry already.
+        if (boost::filesystem::remove(entry.path, ec))
+            BOOST_LOG_TRIVIAL(debug) << "Slicing cache: Evicted " << entry.path.string();
+        total_size -= entry.size;
+    }
+    return total_size;
+}
+
+// Account for a newly stored entry. The cache directory is only scanned on the first store and once the cache exceeds its size limit.
+static void stored(const boost::filesystem::path &path, size_t size)
+{
+    boost::filesystem::path dir;
+    size_t                  max_size;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if (s_max_size == 0)
+            return;
+        if (s_total_size != UNKNOWN_SIZE) {
+            s_total_size += size;
+            if (s_total_size <= s_max_size)
+                return;
+        }
+        dir      = s_directory;
+        max_size = s_max_size;
+    }
+    // The size of the cache is not known yet or the estimate exceeds the limit: Scan the directory, evict if over the limit.
+    size_t total_size = scan_and_evict(dir, max_size, path);
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if (dir == s_directory)
+        s_total_size = total_size;
+}
+
+void store(const std::string &key, const std::vector<ExPolygons> &layers)
+{
+    if (! enabled())
+        return;
+
+    SlicedLayers::Writer writer;
+    writer.write_value(uint32_t(layers.size()));
+    for (const ExPolygons &expolygons : layers)
+        writer.write(expolygons);
+    const std::vector<unsigned char> &data = writer.data();
+    if (data.size() > ENTRY_MAX_UNCOMPRESSED_SIZE) {
+        // Such an entry would be rejected when loaded.
+        BOOST_LOG_TRIVIAL(warning) << "Slicing cache: Not storing entry " << key << " of " << data.size() << " bytes";
+        return;
+    }
+
+    mz_ulong                   compressed_size = mz_compressBound(mz_ulong(data.size()));
+    std::vector<unsigned char> compressed(compressed_size, 0);
+    if (mz_compress2(compressed.data(), &compressed_size, data.data(), mz_ulong(data.size()), MZ_DEFAULT_COMPRESSION) != MZ_OK) {
+        BOOST_LOG_TRIVIAL(error) << "Slicing cache: Failed to compress entry " << key;
+        return;
+    }
+
+    // Write into a temporary file first, then rename it, so that concurrent readers never see a partially written entry.
+    boost::filesystem::path   path     = entry_path(key);
+    boost::filesystem::path   path_tmp = path.parent_path() / boost::filesystem::unique_path(key + ".%%%%-%%%%.tmp");
+    boost::system::error_code ec;
+    uint32_t                  version     = ENTRY_VERSION;
+    uint64_t                  size        = data.size();
+    const size_t              header_size = sizeof(ENTRY_MAGIC) + sizeof(version) + sizeof(size);
+    {
+        boost::nowide::ofstream ofs(path_tmp.string(), std::ios::binary);
+        ofs.write(ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+        ofs.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        ofs.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        ofs.write(reinterpret_cast<const char*>(compressed.data()), compressed_size);
+        if (! ofs) {
+            BOOST_LOG_TRIVIAL(error) << "Slicing cache: Failed to write " << path_tmp.string();
+            ofs.close();
+            boost::filesystem::remove(path_tmp, ec);
+            return;
+        }
+    }
+    boost::filesystem::rename(path_tmp, path, ec);
+    if (ec) {
+        BOOST_LOG_TRIVIAL(error) << "Slicing cache: Failed to store " << path.string() << ": " << ec.message();
+        boost::filesystem::remove(path_tmp, ec);
+        return;
+    }
+    stored(path, header_size + compressed_size);
+}
+
+} // namespace SlicingCache
+
+} // namespace Slic3r
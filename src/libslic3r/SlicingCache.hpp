@@ -0,0 +1,36 @@
+#ifndef slic3r_SlicingCache_hpp_
+#define slic3r_SlicingCache_hpp_
+
+#include <string>
+#include <vector>
+
+#include "ExPolygon.hpp"
+#include "TriangleMesh.hpp"
+#include "TriangleMeshSlicer.hpp"
+
+namespace Slic3r {
+
+// Persistent content addressed cache of the mesh slicing results (the output of slice_mesh_ex()),
+// shared by all the processes pointing to the same cache directory.
+// An entry is keyed by a hash of the triangle mesh, the slicing planes and the slicing parameters including the transformation,
+// thus reslicing the same model with the same layer heights skips the mesh slicing.
+// Entries are stored compressed. Once the total size of the entries exceeds the size limit, the least recently used entries are evicted.
+// The cache is disabled unless a cache directory is set, for example by the --slicing_cache_dir command line option.
+namespace SlicingCache {
+
+    // Enable the cache, store the entries into dir. Empty dir disables the cache.
+    void        set_directory(const std::string &dir, size_t max_size_bytes);
+    bool        enabled();
+
+    // Key of the result of slice_mesh_ex(its, zs, params).
+    std::string make_key(const indexed_triangle_set &its, const std::vector<float> &zs, const MeshSlicingParamsEx &params);
+
+    // Returns false if there is no valid entry for the key.
+    bool        load(const std::string &key, std::vector<ExPolygons> &layers);
+    void        store(const std::string &key, const std::vector<ExPolygons> &layers);
+
+} // namespace SlicingCache
+
+} // namespace Slic3r
+
+#endif // slic3r_SlicingCache_hpp_
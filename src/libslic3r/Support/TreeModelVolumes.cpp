@@ -19,6 +19,7 @@
 #include "../Utils.hpp"
 #include "../format.hpp"
 
+#include <algorithm>
 #include <string_view>
 
 #include <boost/log/trivial.hpp>
@@ -124,6 +125,13 @@ TreeModelVolumes::TreeModelVolumes(
         m_min_resolution = std::min(m_min_resolution, data_pair.first.resolution);
     }
 
+    // Allocate the layers of the caches upfront, then the concurrent lookups never see the caches grow.
+    if (! m_layer_outlines.empty())
+        for (RadiusLayerPolygonCache *cache : { &m_collision_cache, &m_collision_cache_holefree, &m_avoidance_cache, &m_avoidance_cache_slow,
+                &m_avoidance_cache_to_model, &m_avoidance_cache_to_model_slow, &m_placeable_areas_cache, &m_avoidance_cache_holefree,
+                &m_avoidance_cache_holefree_to_model, &m_wall_restrictions_cache, &m_wall_restrictions_cache_min })
+            cache->reserve_layers(m_layer_outlines[m_current_outline_idx].second.size());
+
 #if 0
     for (size_t mesh_idx = 0; mesh_idx < storage.meshes.size(); mesh_idx++) {
         SliceMeshStorage mesh = storage.meshes[mesh_idx];
@@ -252,6 +260,7 @@ void TreeModelVolumes::precalculate(const PrintObject& print_object, const coord
 
 //    m_precalculated = true;
     BOOST_LOG_TRIVIAL(info) << "Precalculating collision took" << dur_col << " ms. Precalculating avoidance took " << dur_avo << " ms.";
+    this->log_cache_stats();
 
 #if 0
     // Paint caches into SVGs:
@@ -860,25 +869,112 @@ coord_t TreeModelVolumes::ceilRadius(const coord_t radius) const
     return out;
 }
 
+void TreeModelVolumes::log_cache_stats() const
+{
+    // Collecting the statistics visits all the cached polygons.
+    if (get_logging_level() < 4)
+        return;
+    for (const auto &[cache, name] : std::initializer_list<std::pair<const RadiusLayerPolygonCache*, const char*>> {
+            { &m_collision_cache,                   "collision" },
+            { &m_collision_cache_holefree,          "collision holefree" },
+            { &m_avoidance_cache,                   "avoidance" },
+            { &m_avoidance_cache_slow,              "avoidance slow" },
+            { &m_avoidance_cache_to_model,          "avoidance to model" },
+            { &m_avoidance_cache_to_model_slow,     "avoidance to model slow" },
+            { &m_placeable_areas_cache,             "placeable areas" },
+            { &m_avoidance_cache_holefree,          "avoidance holefree" },
+            { &m_avoidance_cache_holefree_to_model, "avoidance holefree to model" },
+            { &m_wall_restrictions_cache,           "wall restrictions" },
+            { &m_wall_restrictions_cache_min,       "wall restrictions min" } }) {
+        RadiusLayerPolygonCache::Stats stats = cache->stats();
+        BOOST_LOG_TRIVIAL(debug) << "Tree support " << name << " cache: " <<
+#ifndef NDEBUG
+            stats.hits << " hits, " << stats.misses << " misses, " <<
+#endif // NDEBUG
+            stats.memsize / (1024 * 1024) << " MB";
+    }
+}
+
 void TreeModelVolumes::RadiusLayerPolygonCache::allocate_layers(size_t num_layers)
 {
-    if (num_layers > m_data.size()) {
-        if (num_layers > m_data.capacity())
-            reserve_power_of_2(m_data, num_layers);
-        m_data.resize(num_layers, {});
+    if (size_t(this->num_layers()) >= num_layers)
+        return;
+    std::lock_guard<std::mutex> guard(m_grow_mutex);
+    if (m_layers.size() >= num_layers)
+        return;
+    // Grow geometrically to keep the number of the retired tables low.
+    num_layers = std::max(num_layers, m_layers.empty() ? 0 : 2 * m_layers.size());
+    while (m_layers.size() < num_layers)
+        m_layers.emplace_back(std::make_unique<Layer>());
+    auto table = std::make_unique<LayerTable>();
+    table->reserve(m_layers.size());
+    for (const std::unique_ptr<Layer> &layer : m_layers)
+        table->emplace_back(layer.get());
+    m_table.store(table.get(), std::memory_order_release);
+    // Readers may still be reading the previous table, keep it until clear().
+    m_tables.emplace_back(std::move(table));
+}
+
+void TreeModelVolumes::RadiusLayerPolygonCache::Layer::clear_all_but_smallest_radius()
+{
+    const size_t size = m_size.load(std::memory_order_relaxed);
+    if (size == 0)
+        return;
+    Chunk    *chunk    = &m_first;
+    coord_t   radius   = 0;
+    Polygons *smallest = nullptr;
+    for (size_t i = 0; i < size; ++ i) {
+        if (i > 0 && i % chunk_size == 0)
+            chunk = chunk->next.get();
+        if (! smallest || chunk->radii[i % chunk_size] < radius) {
+            radius   = chunk->radii[i % chunk_size];
+            smallest = &chunk->polygons[i % chunk_size];
+        }
     }
+    Polygons polygons = std::move(*smallest);
+    this->clear();
+    this->emplace(radius, std::move(polygons));
+}
+
+size_t TreeModelVolumes::RadiusLayerPolygonCache::Layer::memsize() const
+{
+    size_t out = sizeof(Layer);
+    for (const Chunk *chunk = m_first.next.get(); chunk; chunk = chunk->next.get())
+        out += sizeof(Chunk);
+    this->visit([&out](coord_t, const Polygons &polygons) {
+        out += polygons.capacity() * sizeof(Polygon);
+        for (const Polygon &polygon : polygons)
+            out += polygon.points.capacity() * sizeof(Point);
+        return false;
+    });
+    return out;
 }
 
 // For debugging purposes, sorted by layer index, then by radius.
 std::vector<std::pair<TreeModelVolumes::RadiusLayerPair, std::reference_wrapper<const Polygons>>> TreeModelVolumes::RadiusLayerPolygonCache::sorted() const
 {
     std::vector<std::pair<RadiusLayerPair, std::reference_wrapper<const Polygons>>> out;
-    for (auto &layer : m_data) {
-        auto layer_idx = LayerIndex(&layer - m_data.data());
-        for (auto &radius_polygons : layer)
-            out.emplace_back(std::make_pair(radius_polygons.first, layer_idx), radius_polygons.second);
+    for (LayerIndex layer_idx = 0; layer_idx < this->num_layers(); ++ layer_idx)
+        this->layer(layer_idx)->visit([layer_idx, &out](coord_t radius, const Polygons &polygons) {
+            out.emplace_back(std::make_pair(radius, layer_idx), polygons);
+            return false;
+        });
+    std::sort(out.begin(), out.end(), [](auto &l, auto &r){ return l.first.second < r.first.second || (l.first.second == r.first.second && l.first.first < r.first.first); });
+    return out;
+}
+
+TreeModelVolumes::RadiusLayerPolygonCache::Stats TreeModelVolumes::RadiusLayerPolygonCache::stats() const
+{
+    Stats out;
+#ifndef NDEBUG
+    out.hits   = m_hits.load(std::memory_order_relaxed);
+    out.misses = m_misses.load(std::memory_order_relaxed);
+#endif // NDEBUG
+    if (const LayerTable *table = m_table.load(std::memory_order_acquire); table) {
+        out.memsize = table->capacity() * sizeof(Layer*);
+        for (const Layer *layer : *table)
+            out.memsize += layer->memsize();
     }
-    assert(std::is_sorted(out.begin(), out.end(), [](auto &l, auto &r){ return l.first.second < r.first.second || (l.first.second == r.first.second) && l.first.first < r.first.first; }));
     return out;
 }
 
@@ -9,7 +9,11 @@
 #ifndef slic3r_TreeModelVolumes_hpp
 #define slic3r_TreeModelVolumes_hpp
 
+#include <array>
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <unordered_map>
 
 #include <boost/functional/hash.hpp>
@@ -57,6 +61,7 @@ public:
         m_placeable_areas_cache.clear();
     }
     void clear_all_but_object_collision() { 
+        this->log_cache_stats();
         //m_collision_cache.clear_all_but_radius0();
         m_collision_cache_holefree.clear();
         m_avoidance_cache.clear();
@@ -70,6 +75,9 @@ public:
         m_wall_restrictions_cache_min.clear();
     }
 
+    // Log the hits, misses, lock contention and memory of the caches.
+    void log_cache_stats() const;
+
     enum class AvoidanceType : int8_t
     {
         Slow,
@@ -193,47 +201,137 @@ private:
         LayerIndex            m_idx_end;
     };
 
+public:
     /*!
      * \brief Convenience typedef for the keys to the caches
      */
     using RadiusLayerPair             = std::pair<coord_t, LayerIndex>;
+    // Cache of polygons by layer and radius, read by all the threads generating the tree supports.
+    // Reads are lock free and they do not write to shared memory:
+    // - The table of layers is published through an atomic pointer. A grown table replaces the old one, which is retired
+    //   until clear(), as readers may still be reading it. Reserve the layers with reserve_layers() to never grow the table.
+    // - The entries of a layer are appended, never modified and never moved. An entry is published by incrementing
+    //   the entry count of its layer, a reader only visits the entries counted when it loaded the count.
+    // Writers of a layer are serialized by the mutex of that layer, writers to different layers do not block each other.
+    // References to the cached Polygons stay valid until clear().
     class RadiusLayerPolygonCache {
-        // Map from radius to Polygons. Cache of one layer collision regions.
-        using LayerData = std::map<coord_t, Polygons>;
-        // Vector of layers, at each layer map of radius to Polygons.
-        // Reference to Polygons returned shall be stable to insertion.
-        using Layers = std::vector<LayerData>;
+        class Layer {
+        public:
+            const Polygons* find(coord_t radius) const {
+                const Polygons *out = nullptr;
+                this->visit([radius, &out](coord_t r, const Polygons &polygons) { if (r == radius) { out = &polygons; return true; } return false; });
+                return out;
+            }
+            // Entry with the largest radius lower or equal to the radius.
+            std::optional<std::pair<coord_t, std::reference_wrapper<const Polygons>>> lower_bound(coord_t radius) const {
+                std::optional<std::pair<coord_t, std::reference_wrapper<const Polygons>>> out;
+                this->visit([radius, &out](coord_t r, const Polygons &polygons) {
+                    if (r <= radius && (! out || r > out->first))
+                        out.emplace(r, polygons);
+                    return false;
+                });
+                return out;
+            }
+            // Visit the published entries until fn() returns true.
+            template<typename Fn>
+            void visit(Fn &&fn) const {
+                const size_t size  = m_size.load(std::memory_order_acquire);
+                const Chunk *chunk = &m_first;
+                for (size_t i = 0; i < size; ++ i) {
+                    if (i > 0 && i % chunk_size == 0)
+                        chunk = chunk->next.get();
+                    if (fn(chunk->radii[i % chunk_size], chunk->polygons[i % chunk_size]))
+                        break;
+                }
+            }
+            // Like std::map::emplace(), the first entry of a radius is kept.
+            void emplace(coord_t radius, Polygons &&polygons) {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                const size_t size  = m_size.load(std::memory_order_relaxed);
+                Chunk       *chunk = &m_first;
+                for (size_t i = 0; i < size; ++ i) {
+                    if (i > 0 && i % chunk_size == 0)
+                        chunk = chunk->next.get();
+                    if (chunk->radii[i % chunk_size] == radius)
+                        return;
+                }
+                if (size > 0 && size % chunk_size == 0) {
+                    chunk->next = std::make_unique<Chunk>();
+                    chunk = chunk->next.get();
+                }
+                chunk->radii   [size % chunk_size] = radius;
+                chunk->polygons[size % chunk_size] = std::move(polygons);
+                m_size.store(size + 1, std::memory_order_release);
+            }
+            // Not thread safe.
+            void clear() {
+                m_first.next.reset();
+                for (Polygons &polygons : m_first.polygons)
+                    Polygons().swap(polygons);
+                m_size.store(0, std::memory_order_relaxed);
+            }
+            // Not thread safe.
+            void clear_all_but_smallest_radius();
+            size_t memsize() const;
+
+        private:
+            static constexpr const size_t chunk_size = 8;
+            struct Chunk {
+                std::array<coord_t, chunk_size>     radii;
+                std::array<Polygons, chunk_size>    polygons;
+                std::unique_ptr<Chunk>              next;
+            };
+            Chunk                   m_first;
+            std::atomic<size_t>     m_size { 0 };
+            std::mutex              m_mutex;
+        };
+        using LayerTable = std::vector<Layer*>;
+
     public:
         RadiusLayerPolygonCache() = default;
-        RadiusLayerPolygonCache(RadiusLayerPolygonCache &&rhs) : m_data(std::move(rhs.m_data)) {}
-        RadiusLayerPolygonCache& operator=(RadiusLayerPolygonCache &&rhs) { m_data = std::move(rhs.m_data); return *this; }
+        RadiusLayerPolygonCache(RadiusLayerPolygonCache &&rhs) { *this = std::move(rhs); }
+        // Not thread safe.
+        RadiusLayerPolygonCache& operator=(RadiusLayerPolygonCache &&rhs) {
+            m_layers = std::move(rhs.m_layers);
+            m_tables = std::move(rhs.m_tables);
+            m_table.store(rhs.m_table.exchange(nullptr, std::memory_order_relaxed), std::memory_order_relaxed);
+#ifndef NDEBUG
+            m_hits  .store(rhs.m_hits  .exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+            m_misses.store(rhs.m_misses.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+#endif // NDEBUG
+            return *this;
+        }
 
         RadiusLayerPolygonCache(const RadiusLayerPolygonCache&) = delete;
         RadiusLayerPolygonCache& operator=(const RadiusLayerPolygonCache&) = delete;
 
+        // Allocate the layers, so that the table of layers does not grow while the cache is being used. Not thread safe.
+        void reserve_layers(size_t num_layers) { this->allocate_layers(num_layers); }
+
         void insert(std::vector<std::pair<RadiusLayerPair, Polygons>> &&in) {
-            std::lock_guard<std::mutex> guard(m_mutex);
+            LayerIndex max_layer_idx = -1;
             for (auto &d : in)
-                this->get_allocate_layer_data(d.first.second).emplace(d.first.first, std::move(d.second));
+                max_layer_idx = std::max(max_layer_idx, d.first.second);
+            this->allocate_layers(max_layer_idx + 1);
+            for (auto &d : in)
+                this->layer(d.first.second).emplace(d.first.first, std::move(d.second));
         }
         // by layer
         void insert(std::vector<std::pair<coord_t, Polygons>> &&in, coord_t radius) {
-            std::lock_guard<std::mutex> guard(m_mutex);
+            LayerIndex max_layer_idx = -1;
+            for (auto &d : in)
+                max_layer_idx = std::max(max_layer_idx, LayerIndex(d.first));
+            this->allocate_layers(max_layer_idx + 1);
             for (auto &d : in)
-                this->get_allocate_layer_data(d.first).emplace(radius, std::move(d.second));
+                this->layer(d.first).emplace(radius, std::move(d.second));
         }
         void insert(std::vector<Polygons> &&in, coord_t first_layer_idx, coord_t radius) {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            allocate_layers(first_layer_idx + in.size());
+            this->allocate_layers(first_layer_idx + in.size());
             for (auto &d : in)
-                m_data[first_layer_idx ++].emplace(radius, std::move(d));
+                this->layer(first_layer_idx ++).emplace(radius, std::move(d));
         }
         void insert(LayerPolygonCache &&in, coord_t radius) {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            LayerIndex i = in.begin();
-            allocate_layers(i + LayerIndex(in.size()));
-            for (auto &d : in.polygons_mutable())
-                m_data[i ++].emplace(radius, std::move(d));
+            this->insert(std::move(in.polygons_mutable()), in.begin(), radius);
         }
         /*!
          * \brief Checks a cache for a given RadiusLayerPair and returns it if it is found
@@ -241,29 +339,22 @@ private:
          * \return A wrapped optional reference of the requested area (if it was found, an empty optional if nothing was found)
          */
         std::optional<std::reference_wrapper<const Polygons>> getArea(const TreeModelVolumes::RadiusLayerPair &key) const {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            if (key.second >= LayerIndex(m_data.size()))
-                return std::optional<std::reference_wrapper<const Polygons>>{};
-            const auto &layer = m_data[key.second];
-            auto it = layer.find(key.first);
-            return it == layer.end() ? 
-                std::optional<std::reference_wrapper<const Polygons>>{} : std::optional<std::reference_wrapper<const Polygons>>{ it->second };
+            if (const Layer *layer = this->layer(key.second); layer)
+                if (const Polygons *polygons = layer->find(key.first); polygons) {
+#ifndef NDEBUG
+                    m_hits.fetch_add(1, std::memory_order_relaxed);
+#endif // NDEBUG
+                    return std::optional<std::reference_wrapper<const Polygons>>{ *polygons };
+                }
+#ifndef NDEBUG
+            m_misses.fetch_add(1, std::memory_order_relaxed);
+#endif // NDEBUG
+            return std::optional<std::reference_wrapper<const Polygons>>{};
         }
         // Get a collision area at a given layer for a radius that is a lower or equial to the key radius.
         std::optional<std::pair<coord_t, std::reference_wrapper<const Polygons>>> get_lower_bound_area(const TreeModelVolumes::RadiusLayerPair &key) const {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            if (key.second >= LayerIndex(m_data.size()))
-                return {};
-            const auto &layer = m_data[key.second];
-            if (layer.empty())
-                return {};
-            auto it = layer.lower_bound(key.first);
-            if (it == layer.end() || it->first != key.first) {
-                if (it == layer.begin())
-                    return {};
-                -- it;
-            }
-            return std::make_pair(it->first, std::reference_wrapper<const Polygons>(it->second));
+            const Layer *layer = this->layer(key.second);
+            return layer ? layer->lower_bound(key.first) : std::nullopt;
         }
         /*!
          * \brief Get the highest already calculated layer in the cache.
@@ -273,10 +364,9 @@ private:
          * \return A wrapped optional reference of the requested area (if it was found, an empty optional if nothing was found)
          */
         LayerIndex getMaxCalculatedLayer(coord_t radius) const {
-            std::lock_guard<std::mutex> guard(m_mutex);
-            auto layer_idx = LayerIndex(m_data.size()) - 1;
+            auto layer_idx = this->num_layers() - 1;
             for (; layer_idx > 0; -- layer_idx)
-                if (const auto &layer = m_data[layer_idx]; layer.find(radius) != layer.end())
+                if (this->layer(layer_idx)->find(radius))
                     break;
             // The placeable on model areas do not exist on layer 0, as there can not be model below it. As such it may be possible that layer 1 is available, but layer 0 does not exist.
             return layer_idx == 0 ? -1 : layer_idx;
@@ -285,27 +375,57 @@ private:
         // For debugging purposes, sorted by layer index, then by radius.
         [[nodiscard]] std::vector<std::pair<RadiusLayerPair, std::reference_wrapper<const Polygons>>> sorted() const;
 
-        void clear() { m_data.clear(); }
-        void clear_all_but_radius0() { 
-            for (LayerData &l : m_data) {
-                auto begin = l.begin();
-                auto end = l.end();
-                if (begin != end && ++ begin != end)
-                    l.erase(begin, end);
-            }
+        // Cache efficiency, for logging. Hits and misses are only counted by debug builds.
+        struct Stats {
+            size_t      hits        { 0 };
+            size_t      misses      { 0 };
+            // Memory occupied by the cached polygons.
+            size_t      memsize     { 0 };
+        };
+        [[nodiscard]] Stats stats() const;
+
+        // Not thread safe. The layers stay allocated, the tables of layers retired by growing are released.
+        void clear() {
+            for (std::unique_ptr<Layer> &layer : m_layers)
+                layer->clear();
+            if (m_tables.size() > 1)
+                m_tables.erase(m_tables.begin(), m_tables.end() - 1);
+        }
+        void clear_all_but_radius0() {
+            for (std::unique_ptr<Layer> &layer : m_layers)
+                layer->clear_all_but_smallest_radius();
         }
 
     private:
-        LayerData&          get_allocate_layer_data(LayerIndex layer_idx) {
-            allocate_layers(layer_idx + 1);
-            return m_data[layer_idx];
+        LayerIndex          num_layers() const {
+            const LayerTable *table = m_table.load(std::memory_order_acquire);
+            return table ? LayerIndex(table->size()) : 0;
+        }
+        const Layer*        layer(LayerIndex layer_idx) const {
+            const LayerTable *table = m_table.load(std::memory_order_acquire);
+            return table && layer_idx >= 0 && layer_idx < LayerIndex(table->size()) ? (*table)[layer_idx] : nullptr;
+        }
+        Layer&              layer(LayerIndex layer_idx) {
+            const LayerTable *table = m_table.load(std::memory_order_acquire);
+            assert(table && layer_idx >= 0 && layer_idx < LayerIndex(table->size()));
+            return *(*table)[layer_idx];
         }
         void                allocate_layers(size_t num_layers);
 
-        Layers              m_data;
-        mutable std::mutex  m_mutex;
+        // Owners of the layers, guarded by m_grow_mutex.
+        std::vector<std::unique_ptr<Layer>>         m_layers;
+        // The current table of layers, which is the last of m_tables, and the retired tables. Guarded by m_grow_mutex.
+        std::vector<std::unique_ptr<LayerTable>>    m_tables;
+        std::atomic<const LayerTable*>              m_table { nullptr };
+        std::mutex                                  m_grow_mutex;
+#ifndef NDEBUG
+        mutable std::atomic<size_t>                 m_hits      { 0 };
+        mutable std::atomic<size_t>                 m_misses    { 0 };
+#endif // NDEBUG
     };
 
+private:
+
 
     /*!
      * \brief Provides the areas that have to be avoided by the tree's branches to prevent collision with the model on this layer. Holes are removed.
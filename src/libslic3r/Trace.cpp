@@ -0,0 +1,211 @@
+#include "Trace.hpp"
+#include "Thread.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/fstream.hpp>
+
+namespace Slic3r {
+
+namespace Trace {
+
+std::atomic<bool> detail::s_enabled { false };
+
+struct Event
+{
+    const char  *name;
+    int64_t      start;
+    int64_t      end;
+    std::string  detail;
+};
+
+// Zones of a single thread. The mutex is only contended by an export running in parallel with the recording.
+struct ThreadEvents
+{
+    uint32_t            thread_id;
+    std::string         thread_name;
+    std::mutex          mutex;
+    std::vector<Event>  events;
+};
+
+static std::mutex                                 s_threads_mutex;
+// Owned by the tracer, so that the zones of the threads that finished before the export are kept.
+static std::vector<std::unique_ptr<ThreadEvents>> s_threads;
+// Zones finished before this time are dropped.
+static std::atomic<int64_t>                       s_epoch { 0 };
+
+static ThreadEvents& thread_events()
+{
+    thread_local ThreadEvents *events = []() {
+        auto events = std::make_unique<ThreadEvents>();
+        std::optional<std::string> name = get_current_thread_name();
+        events->thread_name = name && ! name->empty() ? *name : std::string();
+        std::lock_guard<std::mutex> lock(s_threads_mutex);
+        events->thread_id = uint32_t(s_threads.size() + 1);
+        if (events->thread_name.empty())
+            events->thread_name = "thread " + std::to_string(events->thread_id);
+        s_threads.emplace_back(std::move(events));
+        return s_threads.back().get();
+    }();
+    return *events;
+}
+
+int64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void enable()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_threads_mutex);
+        for (std::unique_ptr<ThreadEvents> &thread : s_threads) {
+            std::lock_guard<std::mutex> thread_lock(thread->mutex);
+            thread->events.clear();
+        }
+    }
+    s_epoch.store(now(), std::memory_order_relaxed);
+    detail::s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void disable()
+{
+    detail::s_enabled.store(false, std::memory_order_relaxed);
+}
+
+void record(const char *name, int64_t start, int64_t end, std::string detail)
+{
+    ThreadEvents &thread = thread_events();
+    std::lock_guard<std::mutex> lock(thread.mutex);
+    thread.events.push_back({ name, start, end, std::move(detail) });
+}
+
+// Call fn(thread, event, epoch) for the events recorded since the last enable(), thread by thread.
+template<typename Fn>
+static void for_each_event(Fn &&fn)
+{
+    const int64_t epoch = s_epoch.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(s_threads_mutex);
+    for (const std::unique_ptr<ThreadEvents> &thread : s_threads) {
+        std::lock_guard<std::mutex> thread_lock(thread->mutex);
+        for (const Event &event : thread->events)
+            if (event.end >= epoch)
+                fn(*thread, event, epoch);
+    }
+}
+
+std::vector<ZoneSummary> summary()
+{
+    std::vector<ZoneSummary>                out;
+    std::unordered_map<std::string, size_t> map;
+    for_each_event([&out, &map](const ThreadEvents &, const Event &event, int64_t /* epoch */) {
+        auto [it, inserted] = map.emplace(event.name, out.size());
+        if (inserted) {
+            out.emplace_back();
+            out.back().name = event.name;
+        }
+        ZoneSummary &zone = out[it->second];
+        double       ms   = double(event.end - event.start) * 1e-6;
+        ++ zone.count;
+        zone.total_ms += ms;
+        zone.max_ms    = std::max(zone.max_ms, ms);
+    });
+    std::stable_sort(out.begin(), out.end(), [](const ZoneSummary &l, const ZoneSummary &r) { return l.total_ms > r.total_ms; });
+    return out;
+}
+
+static void append_json_string(std::string &out, const std::string &str)
+{
+    out += '"';
+    for (char c : str) {
+        switch (c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char buf[8];
+                sprintf(buf, "\\u%04x", int(c));
+                out += buf;
+            } else
+                out += c;
+        }
+    }
+    out += '"';
+}
+
+static bool write_file(const std::string &path, const std::string &data)
+{
+    boost::nowide::ofstream ofs(path, std::ios::binary);
+    if (ofs)
+        ofs.write(data.data(), data.size());
+    if (! ofs) {
+        BOOST_LOG_TRIVIAL(error) << "Trace: Failed to write " << path;
+        return false;
+    }
+    return true;
+}
+
+bool export_chrome_trace(const std::string &path)
+{
+    // Complete events ("ph":"X") with the times in microseconds relative to enable(), one array element per line.
+    std::string out = "{\"traceEvents\":[\n";
+    bool        first = true;
+    auto        separator = [&out, &first]() { out += first ? "" : ",\n"; first = false; };
+    char        buf[128];
+    {
+        std::lock_guard<std::mutex> lock(s_threads_mutex);
+        for (const std::unique_ptr<ThreadEvents> &thread : s_threads) {
+            separator();
+            sprintf(buf, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", thread->thread_id);
+            out += buf;
+            append_json_string(out, thread->thread_name);
+            out += "}}";
+        }
+    }
+    for_each_event([&out, &separator, &buf](const ThreadEvents &thread, const Event &event, int64_t epoch) {
+        separator();
+        out += "{\"ph\":\"X\",\"cat\":\"slicing\",\"name\":";
+        append_json_string(out, event.name);
+        sprintf(buf, ",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f", thread.thread_id,
+            double(std::max<int64_t>(event.start - epoch, 0)) * 1e-3, double(event.end - std::max(event.start, epoch)) * 1e-3);
+        out += buf;
+        if (! event.detail.empty()) {
+            out += ",\"args\":{\"detail\":";
+            append_json_string(out, event.detail);
+            out += '}';
+        }
+        out += '}';
+    });
+    out += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return write_file(path, out);
+}
+
+bool export_summary(const std::string &path)
+{
+    std::string out = "[\n";
+    char        buf[128];
+    std::vector<ZoneSummary> zones = summary();
+    for (const ZoneSummary &zone : zones) {
+        out += "{\"name\":";
+        append_json_string(out, zone.name);
+        sprintf(buf, ",\"count\":%zu,\"total_ms\":%.3f,\"max_ms\":%.3f}", zone.count, zone.total_ms, zone.max_ms);
+        out += buf;
+        out += &zone == &zones.back() ? "\n" : ",\n";
+    }
+    out += "]\n";
+    return write_file(path, out);
+}
+
+} // namespace Trace
+
+} // namespace Slic3r
@@ -0,0 +1,92 @@
+#ifndef slic3r_Trace_hpp_
+#define slic3r_Trace_hpp_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Slic3r {
+
+// Low overhead tracer of named scopes ("zones") to find out where a slicing job spends its time, in release builds as well.
+// Contrary to the Shiny profiler, which is compiled in with SLIC3R_PROFILE only and which is not thread safe, the tracer
+// is always compiled in and it records the zones of all threads, each thread into its own buffer.
+// While the tracer is disabled, a zone costs a single relaxed atomic load.
+// The recorded zones are exported as Chrome trace events (to be opened with chrome://tracing or https://ui.perfetto.dev)
+// and as a summary of the total times per zone name. From the command line, tracing is enabled with --trace_file.
+namespace Trace {
+
+    namespace detail {
+        extern std::atomic<bool> s_enabled;
+    }
+
+    // Start recording, drop the zones recorded so far.
+    void        enable();
+    // Stop recording, keep the recorded zones for export.
+    void        disable();
+    inline bool enabled() { return detail::s_enabled.load(std::memory_order_relaxed); }
+
+    // Nanoseconds of a monotonic clock.
+    int64_t     now();
+    // Record a zone of the calling thread. The name has to outlive the export, it is expected to be a string literal.
+    // The detail is shown in the arguments of the trace event, for example the name of the object being processed.
+    void        record(const char *name, int64_t start, int64_t end, std::string detail = std::string());
+
+    struct ZoneSummary
+    {
+        std::string name;
+        size_t      count    { 0 };
+        double      total_ms { 0. };
+        double      max_ms   { 0. };
+    };
+    // Zones of the same name aggregated, sorted by the total time, longest first.
+    std::vector<ZoneSummary> summary();
+
+    // Both return false and log an error if the file could not be written.
+    bool        export_chrome_trace(const std::string &path);
+    bool        export_summary(const std::string &path);
+
+    // Records the life time of the object as a zone of the calling thread.
+    class Zone
+    {
+    public:
+        explicit Zone(const char *name) : m_name(name), m_start(enabled() ? now() : -1) {}
+        ~Zone() { if (m_start >= 0) record(m_name, m_start, now()); }
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        const char *m_name;
+        int64_t     m_start;
+    };
+
+    // Records the steps of a Print or PrintObject as zones, from set_started() to set_done().
+    // A step canceled before set_done() is not recorded.
+    template<size_t COUNT>
+    class StepZones
+    {
+    public:
+        void started(size_t step) { m_start[step] = enabled() ? now() : -1; }
+        template<typename Detail>
+        void done(size_t step, const char *name, Detail detail) {
+            if (m_start[step] >= 0 && enabled())
+                record(name, m_start[step], now(), detail());
+            m_start[step] = -1;
+        }
+
+    private:
+        std::array<int64_t, COUNT> m_start { make_array() };
+        static std::array<int64_t, COUNT> make_array() { std::array<int64_t, COUNT> out; out.fill(-1); return out; }
+    };
+
+} // namespace Trace
+
+#define TRACE_ZONE_CAT2(a, b) a##b
+#define TRACE_ZONE_CAT(a, b) TRACE_ZONE_CAT2(a, b)
+// Record the rest of the enclosing scope as a zone.
+#define TRACE_ZONE(name) ::Slic3r::Trace::Zone TRACE_ZONE_CAT(trace_zone_, __LINE__)(name)
+
+} // namespace Slic3r
+
+#endif // slic3r_Trace_hpp_
@@ -16,6 +16,7 @@
 #include <libqhullcpp/QhullVertexSet.h>
 
 #include <cmath>
+#include <numeric>
 #include <deque>
 #include <queue>
 #include <vector>
@@ -27,6 +28,10 @@
 #include <boost/nowide/cstdio.hpp>
 #include <boost/predef/other/endian.h>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
 #include <Eigen/Core>
 #include <Eigen/Dense>
 
@@ -178,6 +183,211 @@ static void trianglemesh_repair_on_import(stl_file &stl)
     BOOST_LOG_TRIVIAL(debug) << "TriangleMesh::repair() finished";
 }
 
+namespace {
+// Edge of a face keyed by its end points regardless of its direction, to pair the faces sharing an edge.
+struct ImportEdge {
+    int     v0;
+    int     v1;
+    int     face;
+    int     edge;
+    bool    operator<(const ImportEdge &rhs) const { return v0 < rhs.v0 || (v0 == rhs.v0 && (v1 < rhs.v1 || (v1 == rhs.v1 && face < rhs.face))); }
+    bool    same_end_points(const ImportEdge &rhs) const { return v0 == rhs.v0 && v1 == rhs.v1; }
+};
+
+// Edges of all the faces sorted by their end points. Like admesh, only the first two faces sharing an edge are connected.
+static std::vector<ImportEdge> import_edges_sorted(const indexed_triangle_set &its)
+{
+    std::vector<ImportEdge> edges(its.indices.size() * 3);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, its.indices.size()), [&its, &edges](const tbb::blocked_range<size_t> &range) {
+        for (size_t face = range.begin(); face < range.end(); ++ face)
+            for (int edge = 0; edge < 3; ++ edge) {
+                int a = its.indices[face](edge);
+                int b = its.indices[face]((edge + 1) % 3);
+                edges[face * 3 + edge] = { std::min(a, b), std::max(a, b), int(face), edge };
+            }
+    });
+    tbb::parallel_sort(edges.begin(), edges.end());
+    return edges;
+}
+
+// Calls fn(edge) for edges not shared with another face and fn(edge, other_edge) for the first two faces sharing an edge.
+template<typename OpenFn, typename PairFn>
+static void import_edges_visit(const std::vector<ImportEdge> &edges, OpenFn open_fn, PairFn pair_fn)
+{
+    for (size_t i = 0; i < edges.size();) {
+        size_t j = i + 1;
+        while (j < edges.size() && edges[j].same_end_points(edges[i]))
+            ++ j;
+        if (j == i + 1)
+            open_fn(edges[i]);
+        else
+            pair_fn(edges[i], edges[i + 1]);
+        i = j;
+    }
+}
+
+static int import_remove_degenerate_faces(indexed_triangle_set &its, RepairedMeshErrors &errors)
+{
+    int removed = its_remove_degenerate_faces(its, false);
+    errors.degenerate_facets += removed;
+    errors.facets_removed    += removed;
+    return removed;
+}
+} // namespace
+
+RepairedMeshErrors its_repair_on_import(indexed_triangle_set &its)
+{
+    RepairedMeshErrors errors;
+    // Vertices with identical coordinates are expected to be shared already, as by its_read_stl(), which corresponds to stl_check_facets_exact().
+    import_remove_degenerate_faces(its, errors);
+    if (its.indices.empty())
+        return errors;
+
+    // Connect the open edges, whose end points are nearby, see stl_check_facets_nearby(). Same as trianglemesh_repair_on_import(),
+    // the tolerance starts at the shortest edge and it is increased once.
+    std::vector<ImportEdge> edges = import_edges_sorted(its);
+    auto open_edges = [&edges]() {
+        std::vector<ImportEdge> out;
+        import_edges_visit(edges, [&out](const ImportEdge &e) { out.emplace_back(e); }, [](const ImportEdge&, const ImportEdge&) {});
+        return out;
+    };
+    if (std::vector<ImportEdge> open = open_edges(); ! open.empty()) {
+        BoundingBoxf3 bbox = bounding_box(its);
+        float shortest_edge = std::numeric_limits<float>::max();
+        for (const stl_triangle_vertex_indices &face : its.indices)
+            for (int i = 0; i < 3; ++ i)
+                shortest_edge = std::min(shortest_edge, (its.vertices[face(i)] - its.vertices[face((i + 1) % 3)]).norm());
+        float       tolerance = shortest_edge;
+        const float increment = float(bbox.size().norm()) / 10000.f;
+        const Vec3f origin    = bbox.min.cast<float>();
+        for (int iteration = 0; iteration < 2 && ! open.empty() && tolerance > 0.f; ++ iteration, tolerance += increment) {
+            auto grid = [&its, &origin, tolerance](int v) -> Vec3i64 { return ((its.vertices[v] - origin) / tolerance).array().round().cast<int64_t>(); };
+            struct NearbyEdge {
+                Vec3i64 p0, p1;
+                int     a, b;
+                bool operator<(const NearbyEdge &rhs) const {
+                    return std::lexicographical_compare(p0.data(), p0.data() + 3, rhs.p0.data(), rhs.p0.data() + 3) ||
+                        (p0 == rhs.p0 && std::lexicographical_compare(p1.data(), p1.data() + 3, rhs.p1.data(), rhs.p1.data() + 3));
+                }
+            };
+            std::vector<NearbyEdge> nearby;
+            nearby.reserve(open.size());
+            for (const ImportEdge &e : open) {
+                NearbyEdge ne { grid(e.v0), grid(e.v1), e.v0, e.v1 };
+                if (std::lexicographical_compare(ne.p1.data(), ne.p1.data() + 3, ne.p0.data(), ne.p0.data() + 3)) {
+                    std::swap(ne.p0, ne.p1);
+                    std::swap(ne.a, ne.b);
+                }
+                nearby.emplace_back(ne);
+            }
+            std::sort(nearby.begin(), nearby.end());
+            // Map of the vertices merged into another vertex.
+            std::vector<int> vertex_map(its.vertices.size());
+            std::iota(vertex_map.begin(), vertex_map.end(), 0);
+            auto find = [&vertex_map](int v) { while (vertex_map[v] != v) v = vertex_map[v] = vertex_map[vertex_map[v]]; return v; };
+            int  edges_fixed = 0;
+            for (size_t i = 0; i + 1 < nearby.size();) {
+                const NearbyEdge &e1 = nearby[i];
+                const NearbyEdge &e2 = nearby[i + 1];
+                if (e1.p0 == e2.p0 && e1.p1 == e2.p1 && e1.p0 != e1.p1) {
+                    for (auto [from, to] : { std::make_pair(e2.a, e1.a), std::make_pair(e2.b, e1.b) })
+                        if (int f = find(from), t = find(to); f != t)
+                            vertex_map[f] = t;
+                    edges_fixed += 2;
+                    i += 2;
+                } else
+                    ++ i;
+            }
+            if (edges_fixed == 0)
+                continue;
+            errors.edges_fixed += edges_fixed;
+            for (stl_triangle_vertex_indices &face : its.indices)
+                for (int i = 0; i < 3; ++ i)
+                    face(i) = find(face(i));
+            import_remove_degenerate_faces(its, errors);
+            edges = import_edges_sorted(its);
+            open  = open_edges();
+        }
+    }
+
+    // Neighbor face of each edge, negative if the edge is open. Bit 30 is set if the neighbor passes the edge in the same direction.
+    static constexpr int same_direction = 1 << 30;
+    std::vector<Vec3i32> neighbors(its.indices.size(), Vec3i32(-1, -1, -1));
+    import_edges_visit(edges, [](const ImportEdge&) {},
+        [&its, &neighbors](const ImportEdge &e1, const ImportEdge &e2) {
+            bool same = its.indices[e1.face](e1.edge) == its.indices[e2.face](e2.edge);
+            neighbors[e1.face](e1.edge) = e2.face | (same ? same_direction : 0);
+            neighbors[e2.face](e2.edge) = e1.face | (same ? same_direction : 0);
+        });
+    edges = std::vector<ImportEdge>();
+
+    // Remove the faces not connected to any other face, see stl_remove_unconnected_facets().
+    // These faces are not referenced by the neighbors, thus the neighbors of the faces kept are renumbered only.
+    {
+        std::vector<int> face_map(its.indices.size(), -1);
+        size_t last = 0;
+        for (size_t face = 0; face < its.indices.size(); ++ face)
+            if (neighbors[face] != Vec3i32(-1, -1, -1)) {
+                face_map[face] = int(last);
+                its.indices[last] = its.indices[face];
+                neighbors[last ++] = neighbors[face];
+            }
+        errors.facets_removed += int(its.indices.size() - last);
+        if (last < its.indices.size()) {
+            its.indices.resize(last);
+            neighbors.resize(last);
+            for (Vec3i32 &n : neighbors)
+                for (int i = 0; i < 3; ++ i)
+                    if (n(i) >= 0)
+                        n(i) = face_map[n(i) & ~same_direction] | (n(i) & same_direction);
+        }
+    }
+
+    // Orient the faces of each patch consistently, see stl_fix_normal_directions(). The admesh stores the normals read from the file
+    // to pick the orientation of a patch, here the orientation of the majority of the faces of a patch is kept.
+    {
+        std::vector<signed char> flip(its.indices.size(), -1);
+        std::vector<int>         patch;
+        std::vector<int>         stack;
+        for (size_t seed = 0; seed < its.indices.size(); ++ seed)
+            if (flip[seed] == -1) {
+                patch.clear();
+                flip[seed] = 0;
+                stack.emplace_back(int(seed));
+                while (! stack.empty()) {
+                    int face = stack.back();
+                    stack.pop_back();
+                    patch.emplace_back(face);
+                    for (int i = 0; i < 3; ++ i)
+                        if (int n = neighbors[face](i); n >= 0) {
+                            int other = n & ~same_direction;
+                            if (flip[other] == -1) {
+                                flip[other] = flip[face] ^ ((n & same_direction) ? 1 : 0);
+                                stack.emplace_back(other);
+                            }
+                        }
+                }
+                size_t num_flipped = std::count_if(patch.begin(), patch.end(), [&flip](int face) { return flip[face] == 1; });
+                bool   invert      = 2 * num_flipped > patch.size();
+                for (int face : patch)
+                    if (bool(flip[face]) != invert) {
+                        std::swap(its.indices[face](1), its.indices[face](2));
+                        ++ errors.facets_reversed;
+                    }
+            }
+    }
+
+    // Flip all the faces if the volume is negative, see stl_calculate_volume().
+    if (its_volume(its) < 0.f) {
+        its_flip_triangles(its);
+        errors.facets_reversed += int(its.indices.size());
+    }
+
+    its_compactify_vertices(its);
+    its_shrink_to_fit(its);
+    return errors;
+}
+
 bool TriangleMesh::from_stl(stl_file& stl, bool repair)
 {
     if (repair)
@@ -211,8 +421,19 @@ bool TriangleMesh::from_stl(stl_file& stl, bool repair)
 
 bool TriangleMesh::ReadSTLFile(const char *input_file, bool repair, ImportstlProgressFn stlFn, int custom_header_length)
 {
+    // The admesh structures are not needed: Share the vertices by their coordinates while loading and repair the indexed mesh.
+    indexed_triangle_set its;
+    StlMappedResult      result = its_read_stl(input_file, its, stlFn, custom_header_length);
+    if (result == StlMappedResult::Success) {
+        this->its = std::move(its);
+        if (repair)
+            m_stats.repaired_errors = its_repair_on_import(this->its);
+        fill_initial_stats(this->its, m_stats);
+        return true;
+    }
+    // Fall back to reading the file through stdio only if it could not be memory mapped. A malformed file or a canceled load is not parsed again.
     stl_file stl;
-    if (!stl_open(&stl, input_file, stlFn, custom_header_length))
+    if (result == StlMappedResult::Failed || ! stl_open(&stl, input_file, stlFn, custom_header_length))
         return false;
     return from_stl(stl, repair);
 }
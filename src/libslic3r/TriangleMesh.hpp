@@ -214,6 +214,11 @@ int its_remove_degenerate_faces(indexed_triangle_set &its, bool shrink_to_fit =
 // Remove vertices, which none of the faces references. Return number of freed vertices.
 int its_compactify_vertices(indexed_triangle_set &its, bool shrink_to_fit = true);
 
+// Repair a mesh with shared vertices the way TriangleMesh::ReadSTLFile() repairs an stl_file with admesh: Connect the open edges
+// with nearby end points, remove the degenerate and the unconnected faces, orient the faces of each patch consistently
+// and flip all the faces if the volume is negative.
+RepairedMeshErrors its_repair_on_import(indexed_triangle_set &its);
+
 // store part of index triangle set
 bool its_store_triangle(const indexed_triangle_set &its, const char *obj_filename, size_t triangle_index);
 bool its_store_triangles(const indexed_triangle_set &its, const char *obj_filename, const std::vector<size_t>& triangles);
@@ -196,6 +196,8 @@ void BackgroundSlicingProcess::process_fff()
 {
     assert(m_print == m_fff_print);
     m_fff_print->is_BBL_printer() = wxGetApp().preset_bundle->is_bbl_vendor();
+    // The Print is likely to be processed again after editing a layer range, keep the perimeters to be restored.
+    m_fff_print->set_keep_perimeters_backup(true);
 	//BBS: add the logic to process from an existed gcode file
 	if (m_print->finished()) {
 		BOOST_LOG_TRIVIAL(info) << __FUNCTION__ << boost::format(" %1%: skip slicing, to process previous gcode file")%__LINE__;
@@ -250,6 +252,8 @@ void BackgroundSlicingProcess::process_fff()
 				finalize_gcode();
 			else
 				export_gcode();
+			// The G-code was exported, release the perimeters kept for the next edit.
+			m_fff_print->clear_perimeters_backup();
 	    } else if (! m_upload_job.empty()) {
 			wxQueueEvent(GUI::wxGetApp().mainframe->m_plater, new wxCommandEvent(m_event_export_began_id));
 			prepare_upload();
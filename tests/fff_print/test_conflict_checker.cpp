@@ -0,0 +1,57 @@
+#include <catch2/catch.hpp>
+
+#include <random>
+
+#include "libslic3r/GCode/ConflictChecker.hpp"
+
+using namespace Slic3r;
+
+static LineWithID line_with_id(double ax, double ay, double bx, double by, const void *id)
+{
+    return LineWithID(Line(Point::new_scale(ax, ay), Point::new_scale(bx, by)), id, ExtrusionRole::erPerimeter);
+}
+
+SCENARIO("Conflicts of extrusion lines", "[ConflictChecker]") {
+    const int obj1 = 0, obj2 = 0;
+    GIVEN("Crossing lines") {
+        WHEN("the lines belong to different objects") {
+            LineWithIDs lines { line_with_id(0., 0., 10., 10., &obj1), line_with_id(0., 10., 10., 0., &obj2) };
+            THEN("a conflict between the objects is found") {
+                ConflictComputeOpt res = ConflictChecker::find_inter_of_lines(lines);
+                REQUIRE(res.has_value());
+                REQUIRE(res->_obj1 == &obj2);
+                REQUIRE(res->_obj2 == &obj1);
+            }
+        }
+        WHEN("the lines belong to the same object") {
+            LineWithIDs lines { line_with_id(0., 0., 10., 10., &obj1), line_with_id(0., 10., 10., 0., &obj1) };
+            THEN("no conflict is found") {
+                REQUIRE(! ConflictChecker::find_inter_of_lines(lines).has_value());
+            }
+        }
+    }
+    GIVEN("Lines of different objects touching at their end points") {
+        LineWithIDs lines { line_with_id(0., 0., 10., 10., &obj1), line_with_id(10., 10., 20., 0., &obj2) };
+        THEN("no conflict is found") {
+            REQUIRE(! ConflictChecker::find_inter_of_lines(lines).has_value());
+        }
+    }
+    GIVEN("Short random lines of two objects spread over many grid cells") {
+        // A conflict is found if and only if a pair of the lines conflicts.
+        std::mt19937                           rng(0);
+        std::uniform_real_distribution<double> pos(0., 200.);
+        std::uniform_real_distribution<double> dir(-3., 3.);
+        for (int round = 0; round < 20; ++ round) {
+            LineWithIDs lines;
+            for (int i = 0; i < 200; ++ i) {
+                double x = pos(rng), y = pos(rng);
+                lines.push_back(line_with_id(x, y, x + dir(rng), y + dir(rng), i % 2 ? &obj1 : &obj2));
+            }
+            bool expected = false;
+            for (size_t i = 0; i < lines.size() && ! expected; ++ i)
+                for (size_t j = i + 1; j < lines.size() && ! expected; ++ j)
+                    expected = ConflictChecker::line_intersect(lines[i], lines[j]).has_value();
+            REQUIRE(ConflictChecker::find_inter_of_lines(lines).has_value() == expected);
+        }
+    }
+}
@@ -1,10 +1,12 @@
 #include <catch2/catch.hpp>
+#include <test_utils.hpp>
 
 #include <cstdlib>
 
 #include "libslic3r/ExtrusionEntityCollection.hpp"
 #include "libslic3r/ExtrusionEntity.hpp"
 #include "libslic3r/Point.hpp"
+#include "libslic3r/Print.hpp"
 #include "libslic3r/libslic3r.h"
 
 #include "test_data.hpp"
@@ -83,3 +85,36 @@ SCENARIO("ExtrusionEntityCollection: Polygon flattening", "[ExtrusionEntity]") {
         }
     }
 }
+
+// Wall times of generating and releasing the extrusions.
+TEST_CASE("Extrusion entities allocation benchmark", "[.Benchmark][ExtrusionEntity]") {
+    {
+        // Collections of loops and paths shaped like the perimeters and infill of a layer.
+        srand(0xDEADBEEF);
+        std::vector<ExtrusionEntityCollection> layers(500);
+        double time_create = measure_ms([&layers]() {
+            for (ExtrusionEntityCollection &layer : layers)
+                for (size_t i = 0; i < 100; ++ i) {
+                    ExtrusionEntityCollection perimeters;
+                    for (size_t j = 0; j < 3; ++ j)
+                        perimeters.append(ExtrusionLoop(random_paths(1, 50)));
+                    layer.append(std::move(perimeters));
+                    layer.append(random_paths(20, 10));
+                }
+        });
+        double time_release = measure_ms([&layers]() { layers.clear(); });
+        WARN("ExtrusionEntityCollection: create " << time_create << " ms, release " << time_release << " ms");
+    }
+    {
+        Print print;
+        Model model;
+        Test::init_print({ Test::TestMesh::sphere_50mm }, print, model, {
+            { "layer_height",           0.1 },
+            { "wall_loops",             4 },
+            { "sparse_infill_density",  "40%" }
+        });
+        double time_process = measure_ms([&print]() { print.process(); });
+        double time_clear   = measure_ms([&print]() { print.clear(); });
+        WARN("Print of a 50mm sphere: process() " << time_process << " ms, clear() " << time_clear << " ms");
+    }
+}
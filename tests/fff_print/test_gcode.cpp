@@ -1,8 +1,23 @@
 #include <catch2/catch.hpp>
 
+#include <chrono>
+#include <iomanip>
 #include <memory>
+#include <optional>
+#include <random>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include <tbb/global_control.h>
 
 #include "libslic3r/GCode.hpp"
+#include "libslic3r/GCodeReader.hpp"
+#include "libslic3r/ModelArrange.hpp"
+
+#include "test_data.hpp"
+
+#include <test_utils.hpp>
 
 using namespace Slic3r;
 
@@ -20,3 +35,251 @@ SCENARIO("Origin manipulation", "[GCode]") {
     	}
     }
 }
+
+TEST_CASE("GCodeLine::has_value() accepts the values accepted by strtod()", "[GCode]") {
+    auto value = [](const std::string &gcode, char axis) -> std::optional<float> {
+        std::optional<float> out;
+        GCodeReader().parse_line(gcode, [axis, &out](GCodeReader&, const GCodeReader::GCodeLine &line) {
+            if (float v; line.has_value(axis, v))
+                out = v;
+        });
+        return out;
+    };
+    CHECK(value("G1 X10.5 Y-2", 'X') == 10.5f);
+    CHECK(value("G1 X10.5 Y-2", 'Y') == -2.f);
+    CHECK(value("G1 X.5E1 ; comment", 'X') == 5.f);
+    SECTION("Leading plus sign") {
+        CHECK(value("G1 X+5", 'X') == 5.f);
+        CHECK(value("G1 X+.25", 'X') == .25f);
+        CHECK(! value("G1 X+-5", 'X'));
+        CHECK(! value("G1 X+ 5", 'X'));
+    }
+    SECTION("Leading whitespaces") {
+        CHECK(value("G1 X 5", 'X') == 5.f);
+        CHECK(value("G1 X\t-3", 'X') == -3.f);
+    }
+    SECTION("Empty value is zero") {
+        CHECK(value("G1 X", 'X') == 0.f);
+        CHECK(value("G1 X Y5", 'X') == 0.f);
+        CHECK(value("G1 X;comment", 'X') == 0.f);
+        CHECK(value("G1 X Y5", 'Y') == 5.f);
+    }
+    SECTION("Invalid value") {
+        CHECK(! value("G1 X1a", 'X'));
+        CHECK(! value("G1 X-", 'X'));
+        CHECK(! value("G1 Xa", 'X'));
+        CHECK(! value("G1 X1", 'Y'));
+    }
+}
+
+TEST_CASE("GCodeReader parses a file the same from a memory mapping and through a buffer", "[GCode]") {
+    struct Parsed {
+        std::vector<std::string> lines;
+        std::vector<std::string> raw_lines;
+        std::vector<size_t>      lines_ends;
+    };
+    const std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("gcode-reader-%%%%-%%%%.gcode")).string();
+    auto parse_file = [&path](const std::string &content, bool memory_mapping) {
+        {
+            boost::nowide::ofstream ofs(path, std::ios::binary);
+            ofs << content;
+        }
+        Parsed      out;
+        GCodeReader reader;
+        reader.set_memory_mapping(memory_mapping);
+        REQUIRE(reader.parse_file(path, [&out](GCodeReader&, const GCodeReader::GCodeLine &line) { out.lines.emplace_back(line.raw()); }, out.lines_ends));
+        REQUIRE(reader.parse_file_raw(path, [&out](GCodeReader&, const char *begin, const char *end) { out.raw_lines.emplace_back(begin, end); }));
+        boost::filesystem::remove(path);
+        return out;
+    };
+    // Lines split at "\r\n" or "\n", and the offsets following each '\n'.
+    auto expected = [](const std::string &content) {
+        Parsed out;
+        for (size_t begin = 0; begin < content.size();) {
+            size_t eol = content.find('\n', begin);
+            size_t end = eol == std::string::npos ? content.size() : eol;
+            out.raw_lines.emplace_back(content.substr(begin, end > begin && content[end - 1] == '\r' ? end - 1 - begin : end - begin));
+            if (eol == std::string::npos)
+                break;
+            out.lines_ends.emplace_back(eol + 1);
+            begin = eol + 1;
+        }
+        return out;
+    };
+    auto check = [&](const std::string &content) {
+        Parsed ref    = expected(content);
+        Parsed mapped = parse_file(content, true);
+        Parsed read   = parse_file(content, false);
+        std::vector<std::string> buffer_lines;
+        GCodeReader().parse_buffer(content, [&buffer_lines](GCodeReader&, const GCodeReader::GCodeLine &line) { buffer_lines.emplace_back(line.raw()); });
+        CHECK(mapped.raw_lines == ref.raw_lines);
+        CHECK(mapped.lines_ends == ref.lines_ends);
+        CHECK(mapped.lines == buffer_lines);
+        CHECK(read.raw_lines == mapped.raw_lines);
+        CHECK(read.lines_ends == mapped.lines_ends);
+        CHECK(read.lines == mapped.lines);
+    };
+    const std::string lines[] = { "G1 X1.5 Y2", "G1 E0.2 ; comment", "", "M104 S200 ; set temperature", ";TYPE:Outer wall" };
+    auto join = [&lines](const char *eol) {
+        std::string out;
+        for (const std::string &line : lines)
+            out += line + eol;
+        return out;
+    };
+    SECTION("LF") {
+        check(join("\n"));
+    }
+    SECTION("CRLF") {
+        check(join("\r\n"));
+    }
+    SECTION("Missing trailing newline") {
+        std::string content = join("\n");
+        content.pop_back();
+        check(content);
+        content = join("\r\n");
+        content.erase(content.size() - 2);
+        check(content);
+    }
+    SECTION("Empty file") {
+        check(std::string());
+    }
+    SECTION("CRLF across the blocks of the buffered reader") {
+        // The buffered reader reads 640 kB at a time. Place a "\r\n" at the end of the first block, split between the blocks.
+        const std::string block = join("\r\n");
+        std::string       content;
+        while (content.size() + block.size() < 655360 - 1)
+            content += block;
+        content += std::string(655360 - 1 - content.size(), ';') + "\r\nG1 X2\r\n";
+        REQUIRE(content.substr(655359, 2) == "\r\n");
+        check(content);
+    }
+}
+
+// G-code of a processed print, without the line holding the time of the export.
+static std::string export_gcode(Print &print)
+{
+    const std::string    path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("gcode-%%%%-%%%%.gcode")).string();
+    GCodeProcessorResult result;
+    print.export_gcode(path, &result, nullptr);
+    std::string gcode;
+    {
+        boost::nowide::ifstream ifs(path, std::ios::binary);
+        gcode.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    }
+    boost::filesystem::remove(path);
+    if (size_t pos = gcode.find("; generated by "); pos != std::string::npos)
+        gcode.erase(pos, gcode.find('\n', pos) - pos);
+    return gcode;
+}
+
+TEST_CASE("Reused avoid crossing perimeters boundaries produce the same travels", "[GCode]") {
+    Print print;
+    Model model;
+    DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+    config.set_deserialize_strict({ { "reduce_crossing_wall", "1" }, { "layer_height", "0.2" } });
+    Test::init_print({ Test::TestMesh::cube_with_hole, Test::TestMesh::two_hollow_squares }, print, model, config);
+    // Prismatic objects printed with several instances: The boundaries of a layer are reused by its instances and by the layers above.
+    duplicate_objects(model, 3);
+    arrange_objects(model, InfiniteBed{}, ArrangeParams{ scaled(min_object_distance(config)) });
+    print.apply(model, config);
+    print.process();
+
+    std::string gcode_reused = export_gcode(print);
+    AvoidCrossingPerimeters::set_boundary_cache_capacity(0);
+    std::string gcode_built  = export_gcode(print);
+    AvoidCrossingPerimeters::set_boundary_cache_capacity(AvoidCrossingPerimeters::default_boundary_cache_capacity);
+    REQUIRE(! gcode_reused.empty());
+    REQUIRE(gcode_reused == gcode_built);
+}
+
+// Print of different objects with supports, processed with the steps of the objects running concurrently or step by step.
+static std::string export_gcode_of_objects_processed(bool concurrently, double *time = nullptr)
+{
+    Print print;
+    Model model;
+    Test::init_print({ Test::TestMesh::overhang, Test::TestMesh::cube_with_hole, Test::TestMesh::pyramid, Test::TestMesh::sphere_50mm }, print, model, {
+        { "enable_support", true },
+        { "layer_height",   0.2 }
+    });
+    print.set_process_objects_concurrently(concurrently);
+    double process_time = measure_ms([&print]() { print.process(); });
+    if (time)
+        *time = process_time;
+    return export_gcode(print);
+}
+
+TEST_CASE("Objects processed concurrently produce the same G-code as processed step by step", "[GCode]") {
+    std::string gcode_serial = export_gcode_of_objects_processed(false);
+    REQUIRE(! gcode_serial.empty());
+    REQUIRE(export_gcode_of_objects_processed(true) == gcode_serial);
+}
+
+// Not executed by default, run with "[.Benchmark]" to print the wall times of Print::process() of different objects,
+// with the steps of the objects running concurrently against each step being a barrier over all objects.
+TEST_CASE("Concurrent object processing benchmark", "[.Benchmark][GCode]") {
+    double time_serial, time_concurrent;
+    std::string gcode_serial     = export_gcode_of_objects_processed(false, &time_serial);
+    std::string gcode_concurrent = export_gcode_of_objects_processed(true, &time_concurrent);
+    REQUIRE(gcode_concurrent == gcode_serial);
+    WARN("Print::process() of 4 objects: step by step " << time_serial << " ms, concurrent " << time_concurrent << " ms");
+}
+
+// Not executed by default, run with "[.Benchmark]" to print the wall times of the G-code export with overhang speed enabled,
+// where the layer data are prepared by the parallel stage of the process_layers() pipeline, against the export limited
+// to a single thread, which runs the pipeline serially. Both exports have to produce the same G-code.
+TEST_CASE("Parallel layer preparation benchmark", "[.Benchmark][GCode]") {
+    Print print;
+    Model model;
+    Test::init_print({ Test::TestMesh::overhang, Test::TestMesh::sphere_50mm, Test::TestMesh::A, Test::TestMesh::gt2_teeth }, print, model, {
+        { "enable_overhang_speed",  true },
+        { "overhang_speed_classic", false },
+        { "reduce_crossing_wall",   true },
+        { "layer_height",           0.1 }
+    });
+    print.process();
+    auto export_gcode = [&print](std::string &gcode) {
+        auto start = std::chrono::steady_clock::now();
+        gcode = Test::gcode(print);
+        double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        // The header contains the time of the export.
+        if (size_t pos = gcode.find("; generated by "); pos != std::string::npos)
+            gcode.erase(pos, gcode.find('\n', pos) - pos);
+        return time;
+    };
+    std::string gcode_serial, gcode_parallel;
+    double      time_serial;
+    {
+        tbb::global_control single_thread(tbb::global_control::max_allowed_parallelism, 1);
+        time_serial = export_gcode(gcode_serial);
+    }
+    double      time_parallel = export_gcode(gcode_parallel);
+    REQUIRE(gcode_parallel == gcode_serial);
+    WARN("G-code export of " << print.objects().front()->layer_count() << " layers: serial " << time_serial << " ms, parallel " << time_parallel << " ms");
+}
+
+// Not executed by default, run with "[.Benchmark]" to print the wall times of the print time estimate of a G-code of
+// 1M short extrusions, with the Normal time estimate machine only and with the Stealth machine enabled as well.
+TEST_CASE("G-code time estimate benchmark", "[.Benchmark][GCode]") {
+    std::string gcode = "M83\n";
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> coord(0., 200.);
+    char buf[128];
+    for (int layer = 1; layer <= 200; ++ layer) {
+        sprintf(buf, ";LAYER_CHANGE\nG1 Z%.2f F600\n", 0.2 * layer);
+        gcode += buf;
+        for (int i = 0; i < 5000; ++ i) {
+            sprintf(buf, "G1 X%.3f Y%.3f E0.01 F%d\n", coord(rng), coord(rng), 1200 + 600 * (i % 8));
+            gcode += buf;
+        }
+        // Dwell, which synchronizes the planner.
+        gcode += "G4 P100\n";
+    }
+    for (bool stealth : { false, true }) {
+        // GCodeProcessor is too large for the stack.
+        auto processor = std::make_unique<GCodeProcessor>();
+        processor->enable_stealth_time_estimator(stealth);
+        double time = measure_ms([&processor, &gcode]() { processor->process_buffer(gcode); processor->finalize(false); });
+        WARN((stealth ? "Normal and Stealth" : "Normal") << " time estimate: " << time << " ms, estimated print time " <<
+            std::setprecision(9) << processor->get_time(PrintEstimatedStatistics::ETimeMode::Normal) << " s");
+    }
+}
@@ -126,3 +126,18 @@ SCENARIO("Print: Brim generation", "[Print]") {
         }
     }
 }
+
+SCENARIO("Print: Objects with identical geometry share the slicing results", "[Print]") {
+    GIVEN("Two copies of a 20mm cube loaded as separate objects") {
+        Slic3r::Print print;
+        Slic3r::Test::init_and_process_print({ TestMesh::cube_20x20x20, TestMesh::cube_20x20x20 }, print, { { "fill_density", 0 } });
+        THEN("The second object shares the layers of the first one") {
+            REQUIRE(print.objects().size() == 2);
+            const PrintObject &object1 = *print.objects()[0];
+            const PrintObject &object2 = *print.objects()[1];
+            REQUIRE(object1.model_object()->volumes.front()->mesh_ptr() != object2.model_object()->volumes.front()->mesh_ptr());
+            REQUIRE(object2.get_shared_object() == &object1);
+            REQUIRE(object2.layer_count() == object1.layer_count());
+        }
+    }
+}
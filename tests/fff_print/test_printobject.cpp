@@ -87,3 +87,82 @@ SCENARIO("PrintObject: object layer heights", "[PrintObject]") {
 #endif
     }
 }
+
+SCENARIO("PrintObject: perimeters of unmodified layer ranges are restored", "[PrintObject]") {
+    GIVEN("20mm cube with two layer ranges of a different wall count") {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize_strict({
+            { "first_layer_height", 0.5 },
+            { "layer_height",       0.5 }
+        });
+        Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, config);
+        ModelObject *model_object = model.objects.front();
+        auto set_range = [model_object](t_layer_height_range range, int wall_loops) {
+            ModelConfig &range_config = model_object->layer_config_ranges[range];
+            range_config.set("layer_height", 0.5);
+            range_config.set("wall_loops", wall_loops);
+        };
+        set_range({ 0., 10. }, 2);
+        set_range({ 10., 20. }, 3);
+        auto has_backup = [&print]() {
+            for (const Layer *layer : print.objects().front()->layers())
+                for (const LayerRegion *layerm : layer->regions())
+                    if (layerm->perimeters_backup)
+                        return true;
+            return false;
+        };
+        print.apply(model, config);
+        print.process();
+        THEN("no perimeters are backed up unless requested") {
+            REQUIRE(! has_backup());
+        }
+
+        print.set_keep_perimeters_backup(true);
+        set_range({ 0., 10. }, 3);
+        set_range({ 10., 20. }, 2);
+        print.apply(model, config);
+        print.process();
+        REQUIRE(has_backup());
+
+        // Tag the backups of all layers by duplicating their first perimeter, so that a restored layer may be told from a regenerated one.
+        auto num_perimeters = [](const Layer *layer) {
+            size_t n = 0;
+            for (const LayerRegion *layerm : layer->regions())
+                n += layerm->perimeters.entities.size();
+            return n;
+        };
+        std::vector<size_t> perimeters_before;
+        for (const Layer *layer : print.objects().front()->layers()) {
+            perimeters_before.emplace_back(num_perimeters(layer));
+            for (LayerRegion *layerm : layer->regions())
+                if (layerm->perimeters_backup && ! layerm->perimeters_backup->perimeters.empty())
+                    layerm->perimeters_backup->perimeters.append(*layerm->perimeters_backup->perimeters.entities.front());
+        }
+
+        WHEN("the wall count of the upper layer range is changed") {
+            set_range({ 10., 20. }, 3);
+            print.apply(model, config);
+            print.process();
+            ConstLayerPtrsAdaptor layers = print.objects().front()->layers();
+            REQUIRE(layers.size() == perimeters_before.size());
+            THEN("the layers of the lower layer range are restored from the backup") {
+                for (size_t i = 0; i < layers.size(); ++ i)
+                    if (layers[i]->print_z < 9.)
+                        REQUIRE(num_perimeters(layers[i]) == perimeters_before[i] + 1);
+            }
+            AND_THEN("the layers of the upper layer range are regenerated") {
+                for (size_t i = 0; i < layers.size(); ++ i)
+                    if (layers[i]->print_z > 11.)
+                        REQUIRE(num_perimeters(layers[i]) == perimeters_before[i]);
+            }
+        }
+        WHEN("the backups are released") {
+            print.clear_perimeters_backup();
+            THEN("no layer keeps a backup") {
+                REQUIRE(! has_backup());
+            }
+        }
+    }
+}
@@ -0,0 +1,178 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/libslic3r.h"
+#include "libslic3r/Format/SlicedLayers.hpp"
+#include "libslic3r/Layer.hpp"
+#include "libslic3r/Print.hpp"
+
+#include "test_data.hpp"
+
+using namespace Slic3r;
+using namespace Slic3r::Test;
+
+template<typename T>
+static std::vector<unsigned char> encode(const T &data)
+{
+    SlicedLayers::Writer writer;
+    writer.write(data);
+    return writer.data();
+}
+
+SCENARIO("SlicedLayers: extrusion entities round trip", "[SlicedLayers]") {
+    GIVEN("A collection of a loop, a multi path and a nested non-sortable collection") {
+        ExtrusionEntityCollection collection;
+        {
+            ExtrusionPath path(erExternalPerimeter, 0.05, 0.45f, 0.2f);
+            path.polyline = Polyline({ { 0, 0 }, { 1000000, 0 }, { 1000000, 1000000 }, { 0, 1000000 }, { 0, 0 } });
+            ExtrusionLoop loop(path, elrHole);
+            loop.inset_idx = 0;
+            collection.append(std::move(loop));
+        }
+        {
+            ExtrusionPath path(erOverhangPerimeter, 0.07, 0.5f, 0.2f);
+            path.polyline = Polyline({ { 0, 0 }, { 500000, 500000 }, { 1000000, 0 } });
+            path.overhang_degree = 3;
+            path.curve_degree = 2;
+            path.polyline.fitting_result.push_back({ 0, 2, EMovePathType::Arc_move_cw,
+                ArcSegment(Point(500000, 0), 707107., Point(0, 0), Point(1000000, 0), ArcDirection::Arc_Dir_CW) });
+            ExtrusionMultiPath multipath(path);
+            multipath.set_reverse();
+            collection.append(std::move(multipath));
+        }
+        {
+            ExtrusionEntityCollection nested;
+            nested.no_sort = true;
+            ExtrusionPath path(erSolidInfill, 0.03, 0.42f, 0.2f);
+            path.polyline = Polyline({ { -100, -100 }, { 100, 100 } });
+            path.set_force_no_extrusion(true);
+            nested.append(path);
+            collection.append(std::move(nested));
+        }
+        std::vector<unsigned char> data = encode(collection);
+
+        WHEN("The collection is decoded") {
+            ExtrusionEntityCollection decoded;
+            SlicedLayers::Reader reader(data.data(), data.data() + data.size());
+            reader.read(decoded);
+            THEN("All the data were consumed") {
+                REQUIRE(reader.at_end());
+            }
+            THEN("The entity types are preserved") {
+                REQUIRE(decoded.entities.size() == 3);
+                REQUIRE(dynamic_cast<const ExtrusionLoop*>(decoded.entities[0]) != nullptr);
+                REQUIRE(dynamic_cast<const ExtrusionMultiPath*>(decoded.entities[1]) != nullptr);
+                REQUIRE(decoded.entities[2]->is_collection());
+            }
+            THEN("The properties of the entities are preserved") {
+                const auto &loop = *static_cast<const ExtrusionLoop*>(decoded.entities[0]);
+                REQUIRE(loop.loop_role() == elrHole);
+                REQUIRE(loop.role() == erExternalPerimeter);
+                REQUIRE(loop.paths.front().polyline.points == static_cast<const ExtrusionLoop*>(collection.entities[0])->paths.front().polyline.points);
+                const auto &multipath = *static_cast<const ExtrusionMultiPath*>(decoded.entities[1]);
+                REQUIRE(! multipath.can_reverse());
+                REQUIRE(multipath.paths.front().mm3_per_mm == Approx(0.07));
+                REQUIRE(multipath.paths.front().polyline.fitting_result.size() == 1);
+                REQUIRE(multipath.paths.front().polyline.fitting_result.front().arc_data.direction == ArcDirection::Arc_Dir_CW);
+                const auto &nested = *static_cast<const ExtrusionEntityCollection*>(decoded.entities[2]);
+                REQUIRE(nested.no_sort);
+                REQUIRE(static_cast<const ExtrusionPath*>(nested.entities.front())->is_force_no_extrusion());
+            }
+            THEN("Encoding the decoded collection produces the same data") {
+                REQUIRE(encode(decoded) == data);
+            }
+        }
+        WHEN("Truncated data are decoded") {
+            ExtrusionEntityCollection decoded;
+            SlicedLayers::Reader reader(data.data(), data.data() + data.size() / 2);
+            THEN("An exception is thrown") {
+                REQUIRE_THROWS_AS(reader.read(decoded), Slic3r::FileIOError);
+            }
+        }
+    }
+}
+
+SCENARIO("SlicedLayers: values out of the range of their types are rejected", "[SlicedLayers]") {
+    ExtrusionPath path(erPerimeter, 0.05, 0.45f, 0.2f);
+    path.polyline = Polyline({ { 0, 0 }, { 1000000, 0 }, { 1000000, 1000000 } });
+    // Decode data with the byte at offset replaced by value.
+    auto decode = [](std::vector<unsigned char> data, size_t offset, unsigned char value, auto &decoded) {
+        data[offset] = value;
+        SlicedLayers::Reader reader(data.data(), data.data() + data.size());
+        reader.read(decoded);
+    };
+    WHEN("An ExtrusionRole is out of range") {
+        ExtrusionPath decoded;
+        // The path starts with its role.
+        REQUIRE_NOTHROW(decode(encode(path), 0, uint8_t(erCount) - 1, decoded));
+        REQUIRE_THROWS_AS(decode(encode(path), 0, uint8_t(erCount), decoded), Slic3r::FileIOError);
+    }
+    WHEN("An ExtrusionLoopRole has an unknown flag") {
+        ExtrusionEntityCollection collection;
+        collection.append(ExtrusionLoop(ExtrusionPaths{ path }, elrHole));
+        ExtrusionEntityCollection decoded;
+        // Flags, inset index and number of entities of the collection, then the entity type and the loop role.
+        const size_t offset = 1 + sizeof(int32_t) + sizeof(uint32_t) + 1;
+        REQUIRE_NOTHROW(decode(encode(collection), offset, elrHole | elrInternal | elrSkirt, decoded));
+        REQUIRE_THROWS_AS(decode(encode(collection), offset, 0x8, decoded), Slic3r::FileIOError);
+    }
+    WHEN("A SurfaceType is out of range") {
+        SurfaceCollection surfaces;
+        surfaces.append(ExPolygons{ ExPolygon(path.polyline.points) }, stInternalSolid);
+        SurfaceCollection decoded;
+        // Number of surfaces, then the surface type.
+        REQUIRE_NOTHROW(decode(encode(surfaces), sizeof(uint32_t), uint8_t(stCount) - 1, decoded));
+        REQUIRE_THROWS_AS(decode(encode(surfaces), sizeof(uint32_t), uint8_t(stCount), decoded), Slic3r::FileIOError);
+    }
+    WHEN("An arc fitting starts after its end") {
+        path.polyline.fitting_result.push_back({ 1, 2, EMovePathType::Linear_move, ArcSegment() });
+        ExtrusionPath decoded;
+        std::vector<unsigned char> data = encode(path);
+        // The fitting is at the end of the path: start and end point indices and the path type.
+        const size_t offset = data.size() - 2 * sizeof(uint64_t) - 1;
+        REQUIRE_NOTHROW(decode(data, offset, 2, decoded));
+        REQUIRE_THROWS_AS(decode(data, offset, 3, decoded), Slic3r::FileIOError);
+    }
+}
+
+SCENARIO("SlicedLayers: PrintObject layers round trip", "[SlicedLayers]") {
+    GIVEN("A sliced overhanging model with support") {
+        Slic3r::Print print;
+        Slic3r::Test::init_and_process_print({ TestMesh::overhang }, print, {
+            { "enable_support", true },
+            { "layer_height",   0.4 }
+        });
+        const PrintObject &object = *print.objects().front();
+        std::vector<unsigned char> data = SlicedLayers::serialize(object);
+
+        WHEN("The layers are read back") {
+            SlicedLayers::LayersReader reader(data.data(), data.size());
+            THEN("The number of layers matches") {
+                REQUIRE(reader.num_layers() == object.layer_count());
+                REQUIRE(reader.num_support_layers() == object.support_layer_count());
+            }
+            THEN("Each layer matches the original layer") {
+                for (size_t i = 0; i < object.layer_count(); ++ i) {
+                    const Layer            &layer   = *object.get_layer(int(i));
+                    SlicedLayers::LayerData decoded = reader.layer(i);
+                    REQUIRE(decoded.print_z == layer.print_z);
+                    REQUIRE(decoded.height == layer.height);
+                    REQUIRE(encode(decoded.lslices) == encode(layer.lslices));
+                    REQUIRE(decoded.regions.size() == layer.region_count());
+                    for (size_t region_id = 0; region_id < layer.region_count(); ++ region_id) {
+                        const LayerRegion &layerm = *layer.get_region(int(region_id));
+                        REQUIRE(encode(decoded.regions[region_id].slices) == encode(layerm.slices));
+                        REQUIRE(encode(decoded.regions[region_id].perimeters) == encode(layerm.perimeters));
+                        REQUIRE(encode(decoded.regions[region_id].fills) == encode(layerm.fills));
+                    }
+                }
+            }
+            THEN("Each support layer matches the original support layer") {
+                for (size_t i = 0; i < object.support_layer_count(); ++ i) {
+                    SlicedLayers::SupportLayerData decoded = reader.support_layer(i);
+                    REQUIRE(decoded.print_z == object.support_layers()[i]->print_z);
+                    REQUIRE(encode(decoded.support_fills) == encode(object.support_layers()[i]->support_fills));
+                }
+            }
+        }
+    }
+}
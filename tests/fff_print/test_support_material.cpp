@@ -2,6 +2,12 @@
 
 #include "libslic3r/GCodeReader.hpp"
 #include "libslic3r/Layer.hpp"
+#include "libslic3r/Support/TreeModelVolumes.hpp"
+
+#include <test_utils.hpp>
+
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 
 #include "test_data.hpp" // get access to init_print, etc
 
@@ -119,6 +125,37 @@ SCENARIO("SupportMaterial: support_layers_z and contact_distance", "[SupportMate
     }
 }
 
+// Not executed by default, run with "[.Benchmark]" to print the wall times of tree support cache lookups by a single thread
+// and by all threads. All the threads read the same few layers, as the branches of neighbor trees do.
+TEST_CASE("SupportMaterial: tree support cache lookup benchmark", "[.Benchmark][SupportMaterial]")
+{
+    using RadiusLayerPolygonCache = TreeSupport3D::TreeModelVolumes::RadiusLayerPolygonCache;
+    static constexpr const TreeSupport3D::LayerIndex num_layers  = 500;
+    static constexpr const coord_t                   num_radii   = 30;
+    static constexpr const size_t                    num_lookups = 20000000;
+    RadiusLayerPolygonCache cache;
+    cache.reserve_layers(num_layers);
+    for (coord_t radius = 0; radius < num_radii; ++ radius)
+        cache.insert(std::vector<Polygons>(num_layers, Polygons{ Polygon::new_scale({ { 0., 0. }, { 1., 0. }, { 1., 1. } }) }), 0, radius);
+    auto lookups = [&cache]() {
+        std::atomic<size_t> found { 0 };
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, num_lookups, 4096), [&cache, &found](const tbb::blocked_range<size_t> &range) {
+            size_t n = 0;
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                n += cache.getArea({ coord_t(i % num_radii), TreeSupport3D::LayerIndex(100 + i % 4) }).has_value();
+            found += n;
+        });
+        return found.load();
+    };
+    size_t found_single = 0;
+    size_t found_all    = 0;
+    double time_single  = measure_ms([&lookups, &found_single]() { tbb::task_arena(1).execute([&lookups, &found_single]() { found_single = lookups(); }); });
+    double time_all     = measure_ms([&lookups, &found_all]() { found_all = lookups(); });
+    REQUIRE(found_single == num_lookups);
+    REQUIRE(found_all == num_lookups);
+    WARN(num_lookups << " lookups: 1 thread " << time_single << " ms, " << tbb::this_task_arena::max_concurrency() << " threads " << time_all << " ms");
+}
+
 #if 0
 // Test 8.
 TEST_CASE("SupportMaterial: forced support is generated", "[SupportMaterial]")
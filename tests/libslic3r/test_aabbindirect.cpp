@@ -1,8 +1,12 @@
 #include <catch2/catch.hpp>
 #include <test_utils.hpp>
 
+#include <random>
+
 #include <libslic3r/TriangleMesh.hpp>
 #include <libslic3r/AABBTreeIndirect.hpp>
+#include <libslic3r/AABBTreeWide.hpp>
+#include <libslic3r/AABBMesh.hpp>
 
 using namespace Slic3r;
 
@@ -58,3 +62,117 @@ TEST_CASE("Building a tree over a box, ray caster and closest query", "[AABBIndi
     REQUIRE(closest_point.y() == Approx(0.5));
     REQUIRE(closest_point.z() == Approx(1.));
 }
+
+// Rays from points above the surface of a mesh into the hemisphere around the surface normal,
+// the way the seam placer estimates the visibility of the surface.
+static std::vector<std::pair<Vec3d, Vec3d>> surface_rays(const indexed_triangle_set &its, size_t num_samples, size_t rays_per_sample)
+{
+    std::mt19937                          rng(0);
+    std::uniform_int_distribution<size_t> triangle_distribution(0, its.indices.size() - 1);
+    std::normal_distribution<double>      normal_distribution;
+    std::vector<std::pair<Vec3d, Vec3d>>  rays;
+    rays.reserve(num_samples * rays_per_sample);
+    for (size_t i = 0; i < num_samples; ++ i) {
+        size_t      triangle = triangle_distribution(rng);
+        const Vec3d normal   = its_face_normal(its, int(triangle)).cast<double>();
+        const Vec3d center   = ((its.vertices[its.indices[triangle](0)] + its.vertices[its.indices[triangle](1)] + its.vertices[its.indices[triangle](2)]) / 3.f).cast<double>();
+        for (size_t j = 0; j < rays_per_sample; ++ j) {
+            Vec3d dir(normal_distribution(rng), normal_distribution(rng), normal_distribution(rng));
+            dir.normalize();
+            if (dir.dot(normal) < 0)
+                dir = - dir;
+            rays.emplace_back(center + 0.01 * normal, dir);
+        }
+    }
+    return rays;
+}
+
+TEST_CASE("Wide tree ray casting matches the binary tree", "[AABBIndirect]")
+{
+    for (const char *obj : { "cube_with_concave_hole.obj", "extruder_idler.obj", "frog_legs.obj", "sloping_hole.obj" }) {
+        TriangleMesh mesh = load_model(obj);
+        REQUIRE(! mesh.empty());
+        auto tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(mesh.its.vertices, mesh.its.indices);
+        AABBTreeIndirect::WideTree wide_tree;
+        wide_tree.build(mesh.its);
+        REQUIRE(! wide_tree.empty());
+
+        size_t num_hits        = 0;
+        size_t first_hit_diff  = 0;
+        size_t all_hits_diff   = 0;
+        std::vector<igl::Hit> hits, wide_hits;
+        for (const auto &[origin, dir] : surface_rays(mesh.its, 500, 16)) {
+            igl::Hit hit, wide_hit;
+            bool     intersected      = AABBTreeIndirect::intersect_ray_first_hit(mesh.its.vertices, mesh.its.indices, tree, origin, dir, hit);
+            bool     wide_intersected = AABBTreeIndirect::intersect_ray_first_hit(mesh.its.vertices, mesh.its.indices, wide_tree, origin, dir, wide_hit);
+            if (intersected != wide_intersected || (intersected && hit.t != wide_hit.t))
+                ++ first_hit_diff;
+            num_hits += intersected;
+            AABBTreeIndirect::intersect_ray_all_hits(mesh.its.vertices, mesh.its.indices, tree, origin, dir, hits);
+            AABBTreeIndirect::intersect_ray_all_hits(mesh.its.vertices, mesh.its.indices, wide_tree, origin, dir, wide_hits);
+            if (hits.size() != wide_hits.size() || ! std::equal(hits.begin(), hits.end(), wide_hits.begin(), [](const igl::Hit &l, const igl::Hit &r) { return l.t == r.t; }))
+                ++ all_hits_diff;
+        }
+        INFO(obj);
+        REQUIRE(num_hits > 0);
+        REQUIRE(first_hit_diff == 0);
+        REQUIRE(all_hits_diff == 0);
+    }
+}
+
+// Wall times of casting the rays of the seam placer and of the SLA support generator with both trees.
+TEST_CASE("Wide tree ray casting benchmark", "[.Benchmark][AABBIndirect]")
+{
+    for (const char *obj : { "extruder_idler.obj", "frog_legs.obj", "ipadstand.obj", "bridge.obj", "A.obj" }) {
+        TriangleMesh mesh = load_model(obj);
+        AABBTreeIndirect::Tree3f   tree;
+        AABBTreeIndirect::WideTree wide_tree;
+        double build      = measure_ms([&]() { tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(mesh.its.vertices, mesh.its.indices); });
+        double wide_build = measure_ms([&]() { wide_tree.build(mesh.its); });
+        // The seam placer casts rays from a sample point per 3 mm2 of the surface, sqr_rays_per_sample_point^2 = 25 rays each.
+        auto   rays       = surface_rays(mesh.its, 20000, 25);
+        size_t cnt = 0, wide_cnt = 0;
+        std::vector<igl::Hit> hits;
+        auto   first_hit  = [&](const auto &tree, size_t &cnt) {
+            for (const auto &[origin, dir] : rays) {
+                igl::Hit hit;
+                cnt += AABBTreeIndirect::intersect_ray_first_hit(mesh.its.vertices, mesh.its.indices, tree, origin, dir, hit);
+            }
+        };
+        auto   all_hits   = [&](const auto &tree, size_t &cnt) {
+            for (const auto &[origin, dir] : rays)
+                cnt += AABBTreeIndirect::intersect_ray_all_hits(mesh.its.vertices, mesh.its.indices, tree, origin, dir, hits);
+        };
+        double first      = measure_ms([&]() { first_hit(tree, cnt); });
+        double wide_first = measure_ms([&]() { first_hit(wide_tree, wide_cnt); });
+        double all        = measure_ms([&]() { all_hits(tree, cnt); });
+        double wide_all   = measure_ms([&]() { all_hits(wide_tree, wide_cnt); });
+        REQUIRE(cnt == wide_cnt);
+        WARN(obj << " (" << mesh.its.indices.size() << " triangles, " << rays.size() << " rays): build " << build << " / " << wide_build <<
+            " ms, first hit " << first << " / " << wide_first << " ms, all hits " << all << " / " << wide_all << " ms (binary / wide tree)");
+    }
+}
+
+TEST_CASE("AABBMesh casts rays through the lazily built wide tree", "[AABBIndirect]")
+{
+    TriangleMesh mesh = load_model("extruder_idler.obj");
+    REQUIRE(! mesh.empty());
+    auto     tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(mesh.its.vertices, mesh.its.indices);
+    AABBMesh aabb_mesh(mesh);
+    // The copy shares the wide tree built by the first query of either mesh.
+    AABBMesh aabb_mesh_copy(aabb_mesh);
+    size_t   num_hits  = 0;
+    size_t   num_diffs = 0;
+    for (const auto &[origin, dir] : surface_rays(mesh.its, 200, 8)) {
+        igl::Hit             hit;
+        bool                 intersected = AABBTreeIndirect::intersect_ray_first_hit(mesh.its.vertices, mesh.its.indices, tree, origin, dir, hit);
+        AABBMesh::hit_result result      = aabb_mesh.query_ray_hit(origin, dir);
+        AABBMesh::hit_result result_copy = aabb_mesh_copy.query_ray_hit(origin, dir);
+        if (intersected != result.is_hit() || (intersected && (hit.t != result.distance() || int(hit.id) != result.face())) ||
+            result.distance() != result_copy.distance())
+            ++ num_diffs;
+        num_hits += intersected;
+    }
+    REQUIRE(num_hits > 0);
+    REQUIRE(num_diffs == 0);
+}
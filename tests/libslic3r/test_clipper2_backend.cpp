@@ -0,0 +1,143 @@
+#include <catch2/catch.hpp>
+#include <test_utils.hpp>
+
+#include "libslic3r/ClipperUtils.hpp"
+#include "libslic3r/MTUtils.hpp"
+#include "libslic3r/TriangleMesh.hpp"
+#include "libslic3r/TriangleMeshSlicer.hpp"
+#include "libslic3r/Format/OBJ.hpp"
+
+using namespace Slic3r;
+
+// Switches the ClipperUtils backend for the lifetime of the object.
+class BackendScope
+{
+public:
+    explicit BackendScope(ClipperUtils::Backend backend) : m_previous(ClipperUtils::backend()) { ClipperUtils::set_backend(backend); }
+    ~BackendScope() { ClipperUtils::set_backend(m_previous); }
+private:
+    ClipperUtils::Backend m_previous;
+};
+
+// Layers of a real model, sliced the way the slicer does.
+static std::vector<ExPolygons> sliced_layers(const std::string &obj_filename, float layer_height)
+{
+    TriangleMesh mesh;
+    ObjInfo      obj_info;
+    std::string  message;
+    REQUIRE(load_obj((std::string(TEST_DATA_DIR) + "/" + obj_filename).c_str(), &mesh, obj_info, message));
+    BoundingBoxf3 bb = mesh.bounding_box();
+    std::vector<ExPolygons> layers = slice_mesh_ex(mesh.its, grid(float(bb.min.z()) + layer_height / 2.f, float(bb.max.z()), layer_height));
+    layers.erase(std::remove_if(layers.begin(), layers.end(), [](const ExPolygons &layer) { return layer.empty(); }), layers.end());
+    return layers;
+}
+
+static ExPolygons shifted(ExPolygons expolygons, const Point &shift)
+{
+    for (ExPolygon &expolygon : expolygons)
+        expolygon.translate(shift);
+    return expolygons;
+}
+
+// Operations of ClipperUtils routed through the backend, applied to a layer.
+using Operation = std::function<ExPolygons(const ExPolygons&)>;
+struct NamedOperation
+{
+    std::string name;
+    // Boolean operations are expected to produce the same results with both backends, while the offsets differ slightly:
+    // ClipperLib decimates short edges before offsetting, and the libraries differ in the limits of the miter and round joins.
+    bool        is_offset;
+    Operation   operation;
+};
+static std::vector<NamedOperation> operations()
+{
+    const Point shift(scaled<coord_t>(1.), scaled<coord_t>(0.5));
+    return {
+        { "union_ex",        false, [shift](const ExPolygons &layer) { return union_ex(layer, shifted(layer, shift)); } },
+        { "union_",          false, [shift](const ExPolygons &layer) { return union_ex(union_(to_polygons(layer), to_polygons(shifted(layer, shift)))); } },
+        { "diff_ex",         false, [shift](const ExPolygons &layer) { return diff_ex(layer, shifted(layer, shift)); } },
+        { "intersection_ex", false, [shift](const ExPolygons &layer) { return intersection_ex(layer, shifted(layer, shift)); } },
+        { "offset_ex +",     true,  [](const ExPolygons &layer) { return offset_ex(layer, scaled<float>(0.4)); } },
+        { "offset_ex -",     true,  [](const ExPolygons &layer) { return offset_ex(layer, - scaled<float>(0.4)); } },
+        { "offset round",    true,  [](const ExPolygons &layer) { return union_ex(offset(layer, scaled<float>(0.3), jtRound, scaled<float>(0.005))); } },
+        { "offset2_ex",      true,  [](const ExPolygons &layer) { return offset2_ex(layer, - scaled<float>(0.5), scaled<float>(0.5)); } },
+        { "opening",         true,  [](const ExPolygons &layer) { return union_ex(opening(layer, scaled<float>(0.3))); } },
+        { "closing_ex",      true,  [](const ExPolygons &layer) { return closing_ex(to_polygons(layer), scaled<float>(0.3)); } },
+    };
+}
+
+static size_t num_holes(const ExPolygons &expolygons)
+{
+    size_t cnt = 0;
+    for (const ExPolygon &expolygon : expolygons)
+        cnt += expolygon.holes.size();
+    return cnt;
+}
+
+SCENARIO("Clipper2 backend conforms to the ClipperLib backend", "[ClipperUtils]") {
+    GIVEN("Layers of a sliced model") {
+        std::vector<ExPolygons> layers = sliced_layers("extruder_idler.obj", 0.3f);
+        REQUIRE(! layers.empty());
+        for (const NamedOperation &op : operations()) {
+            WHEN(op.name + " is performed with both backends") {
+                double area_clipper       = 0;
+                double area_clipper2      = 0;
+                size_t topology_different = 0;
+                bool   orientation_valid  = true;
+                for (const ExPolygons &layer : layers) {
+                    ExPolygons clipper, clipper2;
+                    {
+                        BackendScope scope(ClipperUtils::Backend::Clipper);
+                        clipper = op.operation(layer);
+                    }
+                    {
+                        BackendScope scope(ClipperUtils::Backend::Clipper2);
+                        clipper2 = op.operation(layer);
+                    }
+                    if (op.is_offset)
+                        REQUIRE(std::abs(area(clipper2) - area(clipper)) < scaled<double>(0.5) * scaled<double>(0.5));
+                    else
+                        REQUIRE(area(clipper2) == Approx(area(clipper)).epsilon(1e-6));
+                    area_clipper  += area(clipper);
+                    area_clipper2 += area(clipper2);
+                    if (clipper2.size() != clipper.size() || num_holes(clipper2) != num_holes(clipper))
+                        ++ topology_different;
+                    for (const ExPolygon &expolygon : clipper2) {
+                        orientation_valid &= expolygon.contour.is_counter_clockwise();
+                        for (const Polygon &hole : expolygon.holes)
+                            orientation_valid &= hole.is_clockwise();
+                    }
+                }
+                THEN("The total areas match") {
+                    REQUIRE(area_clipper2 == Approx(area_clipper).epsilon(op.is_offset ? 5e-4 : 1e-6));
+                }
+                THEN("The topology matches") {
+                    if (op.is_offset)
+                        // Thin features at the limit of the offset may split or vanish with one library only.
+                        REQUIRE(topology_different <= layers.size() / 20);
+                    else
+                        REQUIRE(topology_different == 0);
+                }
+                THEN("Contours are counter-clockwise, holes clockwise") {
+                    REQUIRE(orientation_valid);
+                }
+            }
+        }
+    }
+}
+
+// Wall times of both backends on the layers of a sliced mesh.
+TEST_CASE("Clipper2 backend benchmark", "[.Benchmark][ClipperUtils]") {
+    std::vector<ExPolygons> layers = sliced_layers("extruder_idler.obj", 0.1f);
+    for (const NamedOperation &op : operations()) {
+        double time[2];
+        for (ClipperUtils::Backend backend : { ClipperUtils::Backend::Clipper, ClipperUtils::Backend::Clipper2 }) {
+            BackendScope scope(backend);
+            time[int(backend)] = measure_ms([&layers, &op]() {
+                for (const ExPolygons &layer : layers)
+                    op.operation(layer);
+            });
+        }
+        WARN(op.name << ": ClipperLib " << time[0] << " ms, Clipper2 " << time[1] << " ms, " << layers.size() << " layers");
+    }
+}
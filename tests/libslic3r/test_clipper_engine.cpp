@@ -0,0 +1,120 @@
+// Built as its own test executable, as it replaces the global operator new and operator delete.
+#include <catch_main.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "libslic3r/ClipperUtils.hpp"
+#include "libslic3r/Polygon.hpp"
+
+using namespace Slic3r;
+
+// Count the heap allocations of this test executable to compare the reused Clipper engines with the engines created per call.
+static std::atomic<size_t> g_num_allocations { 0 };
+
+void* operator new(std::size_t size)
+{
+    ++ g_num_allocations;
+    if (void *ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+// A grid of regular polygons, similar to the islands of a layer.
+static Polygons polygons_grid(int rows, int cols, int num_points, coord_t radius, coord_t shift)
+{
+    Polygons out;
+    for (int r = 0; r < rows; ++ r)
+        for (int c = 0; c < cols; ++ c) {
+            Polygon polygon;
+            for (int i = 0; i < num_points; ++ i) {
+                double angle = 2. * PI * i / num_points;
+                polygon.points.emplace_back(shift + c * 3 * radius / 2 + coord_t(radius * cos(angle)), shift + r * 3 * radius / 2 + coord_t(radius * sin(angle)));
+            }
+            out.emplace_back(std::move(polygon));
+        }
+    return out;
+}
+
+template<typename Engine>
+static ClipperLib::Paths boolean(Engine &clipper, ClipperLib::ClipType clip_type, const Polygons &subject, const Polygons &clip)
+{
+    clipper.AddPaths(ClipperUtils::PolygonsProvider(subject), ClipperLib::ptSubject, true);
+    clipper.AddPaths(ClipperUtils::PolygonsProvider(clip), ClipperLib::ptClip, true);
+    ClipperLib::Paths out;
+    clipper.Execute(clip_type, out, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    return out;
+}
+
+template<typename Engine>
+static ClipperLib::Paths offset(Engine &co, const Polygons &polygons, double delta)
+{
+    co.MiterLimit = DefaultMiterLimit;
+    co.AddPaths(ClipperUtils::PolygonsProvider(polygons), ClipperLib::jtMiter, ClipperLib::etClosedPolygon);
+    ClipperLib::Paths out;
+    co.Execute(out, delta);
+    return out;
+}
+
+// Offset, union and difference, once with engines created for each call, once with the engines reused by the thread.
+struct Workload
+{
+    Polygons subject = polygons_grid(10, 10, 64, scaled<coord_t>(5.), 0);
+    Polygons clip    = polygons_grid(10, 10, 64, scaled<coord_t>(5.), scaled<coord_t>(2.));
+
+    std::vector<ClipperLib::Paths> run_fresh(int repeats) const {
+        std::vector<ClipperLib::Paths> out;
+        for (int i = 0; i < repeats; ++ i) {
+            { ClipperLib::ClipperOffset co; out.emplace_back(offset(co, subject, scaled<double>(0.4))); }
+            { ClipperLib::ClipperOffset co; out.emplace_back(offset(co, subject, - scaled<double>(0.4))); }
+            { ClipperLib::Clipper clipper; out.emplace_back(boolean(clipper, ClipperLib::ctUnion, subject, clip)); }
+            { ClipperLib::Clipper clipper; out.emplace_back(boolean(clipper, ClipperLib::ctDifference, subject, clip)); }
+        }
+        return out;
+    }
+    std::vector<ClipperLib::Paths> run_reused(int repeats) const {
+        std::vector<ClipperLib::Paths> out;
+        for (int i = 0; i < repeats; ++ i) {
+            { ClipperUtils::ReusableClipperOffset co; out.emplace_back(offset(*co, subject, scaled<double>(0.4))); }
+            { ClipperUtils::ReusableClipperOffset co; out.emplace_back(offset(*co, subject, - scaled<double>(0.4))); }
+            { ClipperUtils::ReusableClipper clipper; out.emplace_back(boolean(*clipper, ClipperLib::ctUnion, subject, clip)); }
+            { ClipperUtils::ReusableClipper clipper; out.emplace_back(boolean(*clipper, ClipperLib::ctDifference, subject, clip)); }
+        }
+        return out;
+    }
+};
+
+SCENARIO("Reused Clipper engines", "[ClipperUtils]") {
+    GIVEN("Offset, union and difference of a grid of polygons") {
+        Workload workload;
+        // Warm up the engines of this thread.
+        workload.run_reused(1);
+        WHEN("The workload is executed with fresh and with reused engines") {
+            size_t num_allocations_start = g_num_allocations;
+            std::vector<ClipperLib::Paths> fresh = workload.run_fresh(10);
+            size_t num_allocations_fresh = g_num_allocations - num_allocations_start;
+            num_allocations_start = g_num_allocations;
+            std::vector<ClipperLib::Paths> reused = workload.run_reused(10);
+            size_t num_allocations_reused = g_num_allocations - num_allocations_start;
+            THEN("The results are identical") {
+                REQUIRE(fresh == reused);
+            }
+            THEN("The reused engines allocate less") {
+                INFO("Allocations with fresh engines: " << num_allocations_fresh << ", with reused engines: " << num_allocations_reused);
+                REQUIRE(num_allocations_reused < num_allocations_fresh);
+            }
+        }
+        WHEN("The engines are borrowed recursively") {
+            ClipperUtils::ReusableClipper outer;
+            outer->ReverseSolution(true);
+            ClipperUtils::ReusableClipper inner;
+            THEN("Each borrower gets its own engine with default options") {
+                REQUIRE(&*outer != &*inner);
+                REQUIRE(! inner->ReverseSolution());
+            }
+        }
+    }
+}
@@ -2,6 +2,13 @@
 
 #include "libslic3r/PrintConfig.hpp"
 #include "libslic3r/LocalesUtils.hpp"
+#include "libslic3r/SettingsFilesCache.hpp"
+
+#include <chrono>
+#include <filesystem>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
 
 #include <cereal/types/polymorphic.hpp>
 #include <cereal/types/string.hpp> 
@@ -237,3 +244,64 @@ SCENARIO("DynamicPrintConfig serialization", "[Config]") {
         }
     }
 }
+
+SCENARIO("Settings files cache", "[Config]") {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path("settings-files-cache-%%%%-%%%%.json").string();
+    auto write_settings = [&path](const std::string &layer_height) {
+        boost::nowide::ofstream ofs(path.string());
+        ofs << "{ \"name\": \"test\", \"from\": \"User\", \"layer_height\": \"" << layer_height << "\" }";
+    };
+    auto load_layer_height = [&path](ForwardCompatibilitySubstitutionRule rule) {
+        DynamicPrintConfig                 config;
+        std::map<std::string, std::string> key_values;
+        std::string                        reason;
+        SettingsFilesCache::load(path.string(), rule, config, key_values, reason);
+        REQUIRE(reason.empty());
+        REQUIRE(key_values["name"] == "test");
+        return config.opt_float("layer_height");
+    };
+    SettingsFilesCache::set_enabled(true);
+
+    GIVEN("A loaded settings file") {
+        write_settings("0.2");
+        REQUIRE(load_layer_height(ForwardCompatibilitySubstitutionRule::Enable) == Approx(0.2));
+        REQUIRE(SettingsFilesCache::num_entries() == 1);
+        const std::filesystem::file_time_type last_write_time = std::filesystem::last_write_time(path);
+
+        WHEN("The file is modified keeping its size and its modification time") {
+            write_settings("0.3");
+            std::filesystem::last_write_time(path, last_write_time);
+            THEN("The cached settings are reused") {
+                REQUIRE(load_layer_height(ForwardCompatibilitySubstitutionRule::Enable) == Approx(0.2));
+            }
+        }
+        WHEN("The file is modified keeping its modification time, but not its size") {
+            write_settings("0.25");
+            std::filesystem::last_write_time(path, last_write_time);
+            THEN("The file is loaded again") {
+                REQUIRE(load_layer_height(ForwardCompatibilitySubstitutionRule::Enable) == Approx(0.25));
+            }
+        }
+        WHEN("The file is modified keeping its size within the same second") {
+            write_settings("0.3");
+            std::filesystem::last_write_time(path, last_write_time + std::chrono::milliseconds(10));
+            THEN("The file is loaded again") {
+                REQUIRE(load_layer_height(ForwardCompatibilitySubstitutionRule::Enable) == Approx(0.3));
+            }
+        }
+        WHEN("The file is loaded with another substitution rule") {
+            write_settings("0.3");
+            std::filesystem::last_write_time(path, last_write_time);
+            THEN("The file is loaded again and cached separately") {
+                REQUIRE(load_layer_height(ForwardCompatibilitySubstitutionRule::EnableSilent) == Approx(0.3));
+                REQUIRE(SettingsFilesCache::num_entries() == 2);
+            }
+        }
+    }
+
+    SettingsFilesCache::set_enabled(false);
+    REQUIRE(SettingsFilesCache::num_entries() == 0);
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+}
@@ -1,4 +1,5 @@
 #include <catch2/catch.hpp>
+#include <test_utils.hpp>
 
 #include "libslic3r/Point.hpp"
 #include "libslic3r/BoundingBox.hpp"
@@ -9,9 +10,13 @@
 #include "libslic3r/Geometry/Circle.hpp"
 #include "libslic3r/Geometry/ConvexHull.hpp"
 #include "libslic3r/ClipperUtils.hpp"
+#include "libslic3r/ExtrusionEntityCollection.hpp"
+#include "libslic3r/MTUtils.hpp"
 #include "libslic3r/ShortestPath.hpp"
+#include "libslic3r/TriangleMeshSlicer.hpp"
 
-//#include <random>
+#include <numeric>
+#include <random>
 //#include "libnest2d/tools/benchmark.h"
 #include "libslic3r/SVG.hpp"
 
@@ -286,6 +291,45 @@ TEST_CASE("smallest_enclosing_circle_welzl", "[Geometry]") {
     REQUIRE(num_on_boundary == 3);
 }
 
+// Greedy chaining of segments by brute force: The shortest connection of two end points, which neither connects an end point twice
+// nor closes a loop, is taken first. The end point closest to start_near starts the chain and is never connected to.
+static std::vector<std::pair<size_t, bool>> chain_segments_brute_force(const Lines &segments, const Point &start_near)
+{
+	static constexpr const size_t npos = std::numeric_limits<size_t>::max();
+	auto end_point = [&segments](size_t idx) -> const Point& { return (idx & 1) ? segments[idx >> 1].b : segments[idx >> 1].a; };
+	auto dist2     = [](const Point &p1, const Point &p2) { return (p2 - p1).cast<double>().squaredNorm(); };
+	const size_t num_end_points = segments.size() * 2;
+	size_t first = 0;
+	for (size_t i = 1; i < num_end_points; ++ i)
+		if (dist2(end_point(i), start_near) < dist2(end_point(first), start_near))
+			first = i;
+	std::vector<size_t> connected_to(num_end_points, npos);
+	// Chain of a segment, as a union find of segments.
+	std::vector<size_t> parent(segments.size());
+	std::iota(parent.begin(), parent.end(), 0);
+	auto chain = [&parent](size_t i) { while (parent[i] != i) i = parent[i]; return i; };
+	for (size_t iter = 1; iter < segments.size(); ++ iter) {
+		size_t best_i = npos, best_j = npos;
+		double best_dist = std::numeric_limits<double>::max();
+		for (size_t i = 0; i < num_end_points; ++ i)
+			if (i != first && connected_to[i] == npos)
+				for (size_t j = i + 1; j < num_end_points; ++ j)
+					if (j != first && connected_to[j] == npos && chain(i >> 1) != chain(j >> 1))
+						if (double d = dist2(end_point(i), end_point(j)); d < best_dist) {
+							best_dist = d;
+							best_i    = i;
+							best_j    = j;
+						}
+		connected_to[best_i] = best_j;
+		connected_to[best_j] = best_i;
+		parent[chain(best_i >> 1)] = chain(best_j >> 1);
+	}
+	std::vector<std::pair<size_t, bool>> out;
+	for (size_t idx = first; idx != npos; idx = connected_to[idx ^ 1])
+		out.emplace_back(idx >> 1, (idx & 1) != 0);
+	return out;
+}
+
 SCENARIO("Path chaining", "[Geometry]") {
 	GIVEN("A path") {
 		std::vector<Point> points = { Point(26,26),Point(52,26),Point(0,26),Point(26,52),Point(26,0),Point(0,52),Point(52,52),Point(52,0) };
@@ -355,6 +399,116 @@ SCENARIO("Path chaining", "[Geometry]") {
 			}
 		}
 	}
+	GIVEN("Random points") {
+		std::mt19937 rng(0);
+		std::uniform_int_distribution<coord_t> coord(0, scaled<coord_t>(100.));
+		Points points;
+		for (size_t i = 0; i < 2000; ++ i)
+			points.emplace_back(coord(rng), coord(rng));
+		Point start_near(0, 0);
+		THEN("Each point is visited once, starting with the point closest to start_near") {
+			std::vector<size_t> indices = chain_points(points, &start_near);
+			REQUIRE(indices.size() == points.size());
+			std::vector<size_t> sorted = indices;
+			std::sort(sorted.begin(), sorted.end());
+			for (size_t i = 0; i < sorted.size(); ++ i)
+				REQUIRE(sorted[i] == i);
+			auto dist = [&start_near](const Point &pt) { return (pt - start_near).cast<double>().squaredNorm(); };
+			REQUIRE(std::all_of(points.begin(), points.end(), [&](const Point &pt) { return dist(points[indices.front()]) <= dist(pt); }));
+		}
+	}
+	GIVEN("Random segments without equidistant end points") {
+		std::mt19937 rng(0);
+		std::uniform_int_distribution<coord_t> coord(0, scaled<coord_t>(100.));
+		Lines lines;
+		ExtrusionEntityCollection paths;
+		for (size_t i = 0; i < 200; ++ i) {
+			lines.emplace_back(Point(coord(rng), coord(rng)), Point(coord(rng), coord(rng)));
+			ExtrusionPath path(erInternalInfill);
+			path.polyline = Polyline(lines.back().a, lines.back().b);
+			paths.append(std::move(path));
+		}
+		Point start_near(0, 0);
+		THEN("chain_extrusion_entities() connects the same end points as the brute force greedy chaining") {
+			REQUIRE(chain_extrusion_entities(paths.entities, &start_near) == chain_segments_brute_force(lines, start_near));
+		}
+	}
+	GIVEN("Segments along a line, shuffled and randomly reversed") {
+		// The greedy chaining connects the neighbors along the line, which grows chains with segments in their interior.
+		// Most of the end points are connected long before the last connection, the closest point search grid is rebuilt several times.
+		std::mt19937 rng(0);
+		std::uniform_int_distribution<coord_t> gap(scaled<coord_t>(1.), scaled<coord_t>(3.));
+		std::uniform_int_distribution<coord_t> length(scaled<coord_t>(20.), scaled<coord_t>(40.));
+		Polylines ordered;
+		for (coord_t x = 0; ordered.size() < 2000;) {
+			coord_t x2 = x + length(rng);
+			ordered.emplace_back(Point(x, 0), Point(x2, 0));
+			x = x2 + gap(rng);
+		}
+		Polylines shuffled = ordered;
+		std::shuffle(shuffled.begin(), shuffled.end(), rng);
+		for (Polyline &pl : shuffled)
+			if (rng() & 1)
+				pl.reverse();
+		ExtrusionEntityCollection paths;
+		for (const Polyline &pl : shuffled) {
+			ExtrusionPath path(erInternalInfill);
+			path.polyline = pl;
+			paths.append(std::move(path));
+		}
+		Point start_near(- scaled<coord_t>(10.), 0);
+		THEN("chain_polylines() and chain_extrusion_entities() restore the order along the line") {
+			REQUIRE(chain_polylines(shuffled, &start_near) == ordered);
+			reorder_extrusion_entities(paths.entities, chain_extrusion_entities(paths.entities, &start_near));
+			Polylines chained;
+			for (const ExtrusionEntity *ee : paths.entities)
+				chained.emplace_back(static_cast<const ExtrusionPath*>(ee)->polyline);
+			REQUIRE(chained == ordered);
+		}
+		THEN("chain_polylines() without a start point restores the order along the line in either direction") {
+			Polylines chained = chain_polylines(shuffled);
+			if (chained.front().first_point() != ordered.front().first_point()) {
+				std::reverse(chained.begin(), chained.end());
+				for (Polyline &pl : chained)
+					pl.reverse();
+			}
+			REQUIRE(chained == ordered);
+		}
+	}
+}
+
+// Wall time of chaining infill-like lines of real layers.
+TEST_CASE("Path chaining benchmark", "[.Benchmark][Geometry]") {
+	TriangleMesh mesh = load_model("extruder_idler.obj");
+	REQUIRE(! mesh.empty());
+	BoundingBoxf3 bb = mesh.bounding_box();
+	std::vector<ExPolygons> layers = slice_mesh_ex(mesh.its, grid(float(bb.min.z()) + 0.1f, float(bb.max.z()), 2.f));
+	// Short slanted lines clipped by the layers, similar to the lines of a sparse infill before chaining.
+	std::vector<Polylines> lines;
+	for (const ExPolygons &layer : layers) {
+		BoundingBox bbox = get_extents(layer);
+		Polylines   hatch;
+		for (coord_t x = bbox.min.x(); x < bbox.max.x(); x += scaled<coord_t>(0.45))
+			for (coord_t y = bbox.min.y(); y < bbox.max.y(); y += scaled<coord_t>(2.))
+				hatch.emplace_back(Point(x, y), Point(x + scaled<coord_t>(0.3), y + scaled<coord_t>(1.8)));
+		lines.emplace_back(intersection_pl(hatch, offset_ex(layer, - scaled<float>(0.4))));
+	}
+	size_t num_lines  = 0;
+	double travel     = 0.;
+	double time_lines = 0.;
+	double time_points = 0.;
+	for (Polylines &polylines : lines) {
+		Points points;
+		for (const Polyline &pl : polylines)
+			points.emplace_back(pl.first_point());
+		num_lines += polylines.size();
+		time_points += measure_ms([&points]() { chain_points(points); });
+		Polylines chained;
+		time_lines  += measure_ms([&chained, &polylines]() { chained = chain_polylines(std::move(polylines)); });
+		for (size_t i = 1; i < chained.size(); ++ i)
+			travel += unscaled((chained[i].first_point() - chained[i - 1].last_point()).cast<double>().norm());
+	}
+	WARN(lines.size() << " layers, " << num_lines << " lines: chain_polylines " << time_lines << " ms, travel " << travel << " mm, chain_points " << time_points << " ms");
 }
 
 SCENARIO("Line distances", "[Geometry]"){
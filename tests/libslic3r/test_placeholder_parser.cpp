@@ -1,8 +1,12 @@
 #include <catch2/catch.hpp>
+#include <test_utils.hpp>
 
 #include "libslic3r/PlaceholderParser.hpp"
 #include "libslic3r/PrintConfig.hpp"
 
+#include <boost/nowide/fstream.hpp>
+#include "nlohmann/json.hpp"
+
 using namespace Slic3r;
 
 SCENARIO("Placeholder parser scripting", "[PlaceholderParser]") {
@@ -114,3 +118,199 @@ SCENARIO("Placeholder parser scripting", "[PlaceholderParser]") {
     SECTION("complex expression2") { REQUIRE(boolean_expression("printer_notes=~/.*PRINTER_VEwerfNDOR_PRUSA3D.*/ or printer_notes=~/.*PRINTertER_MODEL_MK2.*/ or (nozzle_diameter[0]==0.6 and num_extruders>1)")); }
     SECTION("complex expression3") { REQUIRE(! boolean_expression("printer_notes=~/.*PRINTER_VEwerfNDOR_PRUSA3D.*/ or printer_notes=~/.*PRINTertER_MODEL_MK2.*/ or (nozzle_diameter[0]==0.3 and num_extruders>1)")); }
 }
+
+SCENARIO("Placeholder parser compiled templates", "[PlaceholderParser]") {
+    PlaceholderParser parser;
+    parser.set("foo", 0);
+    parser.set("bar", 2);
+    // The first expansion of a template parses it as a whole and compiles it, the following expansions use the compiled template.
+    auto expand_twice = [&parser](const std::string &templ, PlaceholderParser::ContextData *context = nullptr) {
+        std::string first  = parser.process(templ, 0, nullptr, context);
+        std::string second = parser.process(templ, 0, nullptr, context);
+        return std::make_pair(first, second);
+    };
+    auto same = [&expand_twice](const std::string &templ, const std::string &expected) {
+        auto [first, second] = expand_twice(templ);
+        REQUIRE(first == expected);
+        REQUIRE(second == expected);
+    };
+    SECTION("plain text") { same("G28 ; home all\nG1 Z5 } F600\n", "G28 ; home all\nG1 Z5 } F600\n"); }
+    SECTION("empty template") { same("", ""); }
+    SECTION("leading whitespaces are skipped, the others are maintained") { same(" \n T[bar] {foo}  \n ", "T2 0  \n "); }
+    SECTION("conditional text blocks") { same("A{if foo == 0}zero [bar]{elsif bar == 2}two{else}other{endif}B", "Azero 2B"); }
+    SECTION("long texts between the macros") {
+        same("{if foo == 0}zero{endif}, a text long enough to be copied verbatim\n[bar]{bar}\n and another long text at the end ",
+             "zero, a text long enough to be copied verbatim\n22\n and another long text at the end ");
+    }
+    SECTION("nested conditional text blocks") {
+        same("{if foo == 0}  zero{if bar == 1}one{elsif bar == 2}\n two {bar}{else}other{endif}.{else}nonzero{endif}{if foo == 1}1{endif}",
+             "  zero\n two 2.");
+    }
+    SECTION("code blocks") { same("{if foo == 0 then \"zero\"; else \"other\"; endif}[bar]", "zero2"); }
+    SECTION("braces inside string literals and regular expressions") {
+        same("{if \"}{endif\" =~ /.*\\}.*/}match{endif}{if one_of(\"a}\", \"b\", /a\\}/)} one{endif}", "match one");
+    }
+    SECTION("a block mixed with a statement is expanded by the macro processor as a whole") {
+        same("{local x = bar; if x == 2}two{else}other{endif}{x}", "two2");
+    }
+    SECTION("compiled expressions") {
+        same("{foo + bar * 2 - 1}/{(bar + 1) / 2.}/{-bar % 3}/{+bar}/{min(bar, 1)}/{max(1, bar)}/{int(2.7)}/{round(2.5)}",
+             "3/1.5/-2/2/1/2/2/3");
+        same("{foo < bar}{foo > bar}{foo <= 0}{foo >= 1}{foo == 0}{foo != 0}{foo == 0 and bar == 2}{foo == 1 || ! (bar == 2)}{not true}",
+             "truefalsetruefalsetruefalsetruefalsefalse");
+        same("{\"a\\\"b\" + \"c\"}{bar == 2 ? 1 : 0}", "a\"bc1");
+        same("{if foo == 0 && bar >= 2}both{endif}{if bar == 2 ? true : false}ternary{endif}", "bothternary");
+    }
+    SECTION("errors of the compiled expressions match the errors of the macro processor") {
+        auto error = [&parser](const std::string &templ, const DynamicConfig &config) {
+            try {
+                parser.process(templ, 0, &config);
+            } catch (const std::exception &ex) {
+                return std::string(ex.what());
+            }
+            return std::string();
+        };
+        DynamicConfig good, bad;
+        good.set_key_value("x", new ConfigOptionInt(1));
+        good.set_key_value("c", new ConfigOptionBool(true));
+        good.set_key_value("v", new ConfigOptionInts({ 1, 2 }));
+        bad.set_key_value("x", new ConfigOptionString("a"));
+        bad.set_key_value("c", new ConfigOptionInt(1));
+        bad.set_key_value("v", new ConfigOptionInt(1));
+        for (const std::string templ : { "G1 X[bar]\nG1 Y{bar + x * 2}\n", "G1 X[bar]\n{if c}\nG1{endif}\n", "G1 X[bar]\nG1 Y{v[bar - 2]}\n" }) {
+            // The template failing on its first expansion is not compiled.
+            std::string expected = error(templ, bad);
+            REQUIRE(expected.find("line 2") != std::string::npos);
+            REQUIRE(error(templ, good).empty());
+            REQUIRE(error(templ, bad) == expected);
+        }
+    }
+    SECTION("local variables are shared by the macros") { same("{local x = bar * 2}x={x}\n{if x > 3}big{else}small{endif}", "x=4\nbig"); }
+    SECTION("global variables persist between the expansions") {
+        PlaceholderParser::ContextData context;
+        context.global_config = std::make_unique<DynamicConfig>();
+        parser.process("{global counter = 0}", 0, nullptr, &context);
+        auto [first, second] = expand_twice("{counter = counter + 1}counter={counter}", &context);
+        REQUIRE(first == "counter=1");
+        REQUIRE(second == "counter=2");
+    }
+    SECTION("errors refer to the whole template") {
+        auto error = [&parser]() {
+            try {
+                parser.process("G1 X[bar]\nG1 Y{foo +}\n");
+            } catch (const std::exception &ex) {
+                return std::string(ex.what());
+            }
+            return std::string();
+        };
+        std::string first  = error();
+        std::string second = error();
+        REQUIRE(! first.empty());
+        REQUIRE(first == second);
+    }
+    SECTION("a compiled template failing after an assignment is not evaluated again") {
+        PlaceholderParser::ContextData context;
+        context.global_config = std::make_unique<DynamicConfig>();
+        parser.process("{global counter = 0}", 0, nullptr, &context);
+        const std::string templ = "{counter = counter + 1}counter={counter}, a text long enough to be copied verbatim\nG1 X{100 / divisor}\n";
+        DynamicConfig config_override;
+        config_override.set_key_value("divisor", new ConfigOptionInt(1));
+        REQUIRE(parser.process(templ, 0, &config_override, &context) == "counter=1, a text long enough to be copied verbatim\nG1 X100\n");
+        config_override.set_key_value("divisor", new ConfigOptionInt(0));
+        std::string error;
+        try {
+            parser.process(templ, 0, &config_override, &context);
+        } catch (const std::exception &ex) {
+            error = ex.what();
+        }
+        // The error refers to the line of the whole template.
+        REQUIRE(error.find("line 2") != std::string::npos);
+        REQUIRE(error.find("G1 X{100 / divisor}") != std::string::npos);
+        // The assignment preceding the error is applied once.
+        REQUIRE(context.global_config->opt_int("counter") == 2);
+    }
+}
+
+// Wall times of expanding typical custom G-codes.
+TEST_CASE("Placeholder parser benchmark", "[.Benchmark][PlaceholderParser]") {
+    PlaceholderParser parser;
+    parser.set("initial_tool", 0);
+    parser.set("first_layer_temperature", new ConfigOptionInts({ 215, 240 }));
+    parser.set("first_layer_bed_temperature", new ConfigOptionInts({ 60, 80 }));
+    parser.set("filament_type", new ConfigOptionStrings({ "PLA", "PETG" }));
+    parser.set("layer_height", 0.2);
+    const std::string start_gcode =
+        "M862.3 P \"MK3S\" ; printer model check\nG90 ; use absolute coordinates\nM83 ; extruder relative mode\n"
+        "M104 S[first_layer_temperature_0] ; set extruder temp\nM140 S[first_layer_bed_temperature_0] ; set bed temp\n"
+        "M190 S[first_layer_bed_temperature_0] ; wait for bed temp\nM109 S[first_layer_temperature_0] ; wait for extruder temp\n"
+        "G28 W ; home all without mesh bed level\nG80 ; mesh bed leveling\n"
+        "{if filament_type[initial_tool]==\"PETG\"}\nG1 Z0.3 F720\nG1 Y-3 F1000 ; go outside print area\nG92 E0\nG1 X60 E9 F1000 ; intro line\n"
+        "{else}\nG1 Z0.2 F720\nG1 Y-3 F1000 ; go outside print area\nG92 E0\nG1 X60 E12.5 F1000 ; intro line\n{endif}\n"
+        "G92 E0\nM221 S{if layer_height<0.075}100{else}95{endif}\n";
+    const std::string layer_change_gcode = ";AFTER_LAYER_CHANGE\n;[layer_z]\n{if layer_num == 1}M106 S255\n{endif}";
+    const std::string change_filament_gcode =
+        "; change filament\nG1 E-2 F2400\nG1 Z{toolchange_z + 0.4} F720\nT[next_extruder]\n"
+        "M109 S{first_layer_temperature[next_extruder]}\nG1 E2 F2400\nG92 E0\n";
+    DynamicConfig layer_config;
+    DynamicConfig toolchange_config;
+    const int     repeats = 100000;
+    for (const auto &[name, templ, config] : { std::make_tuple("start", &start_gcode, (DynamicConfig*)nullptr),
+                                               std::make_tuple("layer change", &layer_change_gcode, &layer_config),
+                                               std::make_tuple("tool change", &change_filament_gcode, &toolchange_config) }) {
+        size_t length = 0;
+        double time   = measure_ms([&, templ = templ, config = config]() {
+            for (int i = 0; i < repeats; ++ i) {
+                layer_config.set_key_value("layer_num", new ConfigOptionInt(i));
+                layer_config.set_key_value("layer_z", new ConfigOptionFloat(0.2 * (i + 1)));
+                toolchange_config.set_key_value("toolchange_z", new ConfigOptionFloat(0.2 * (i + 1)));
+                toolchange_config.set_key_value("next_extruder", new ConfigOptionInt(i % 2));
+                length += parser.process(*templ, 0, config).size();
+            }
+        });
+        WARN(name << " G-code: " << time << " ms for " << repeats << " expansions, " << length << " characters");
+    }
+}
+
+// Wall times of expanding the macro heavy custom G-codes of a printer profile, with the variables set the way GCode.cpp sets them.
+TEST_CASE("Placeholder parser benchmark of printer profile templates", "[.Benchmark][PlaceholderParser]") {
+    nlohmann::json profile;
+    {
+        boost::nowide::ifstream ifs(TEST_DATA_DIR "/../../resources/profiles/BBL/machine/Bambu Lab A1 mini 0.4 nozzle.json");
+        REQUIRE(ifs.good());
+        ifs >> profile;
+    }
+    PlaceholderParser parser;
+    parser.apply_config(DynamicPrintConfig::full_print_config());
+    parser.set("in_head_wrap_detect_zone", false);
+    parser.set("first_layer_center_no_wipe_tower", new ConfigOptionFloats({ 90., 90. }));
+    parser.set("outer_wall_volumetric_speed", 12.);
+    parser.set("total_layer_count", 500);
+    DynamicConfig config;
+    for (const char *key : { "previous_extruder", "next_extruder", "layer_num", "toolchange_count", "old_filament_temp", "new_filament_temp",
+                             "old_filament_e_feedrate", "new_filament_e_feedrate" })
+        config.set_key_value(key, new ConfigOptionInt(0));
+    for (const char *key : { "layer_z", "max_layer_z", "toolchange_z", "old_retract_length_toolchange", "new_retract_length_toolchange",
+                             "x_after_toolchange", "y_after_toolchange", "z_after_toolchange", "flush_length" })
+        config.set_key_value(key, new ConfigOptionFloat(0.));
+    const int repeats = 5000;
+    for (const char *key : { "change_filament_gcode", "time_lapse_gcode", "layer_change_gcode" }) {
+        const std::string templ  = profile[key].get<std::string>();
+        size_t            length = 0;
+        double            time   = measure_ms([&]() {
+            for (int i = 0; i < repeats; ++ i) {
+                config.set_key_value("previous_extruder", new ConfigOptionInt(i % 2));
+                config.set_key_value("next_extruder", new ConfigOptionInt((i + 1) % 2));
+                config.set_key_value("layer_num", new ConfigOptionInt(i));
+                config.set_key_value("toolchange_count", new ConfigOptionInt(i + 1));
+                config.set_key_value("old_filament_temp", new ConfigOptionInt(220));
+                config.set_key_value("layer_z", new ConfigOptionFloat(0.2 * (i + 1)));
+                config.set_key_value("max_layer_z", new ConfigOptionFloat(0.2 * (i + 1)));
+                config.set_key_value("flush_length", new ConfigOptionFloat(100.));
+                for (int j = 1; j <= 4; ++ j)
+                    config.set_key_value("flush_length_" + std::to_string(j), new ConfigOptionFloat(25.));
+                length += parser.process(templ, 0, &config).size();
+            }
+        });
+        WARN(key << ": " << templ.size() << " characters, " << time << " ms for " << repeats << " expansions, " << length << " characters output");
+    }
+}
@@ -0,0 +1,129 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/SlicingCache.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+
+using namespace Slic3r;
+
+// Layers of a square with a square hole, the same for all the keys, so that all the entries have the same size.
+static std::vector<ExPolygons> test_layers(size_t num_layers)
+{
+    ExPolygon square;
+    square.contour = Polygon::new_scale({ { 0., 0. }, { 10., 0. }, { 10., 10. }, { 0., 10. } });
+    square.holes.emplace_back(Polygon::new_scale({ { 2., 2. }, { 2., 8. }, { 8., 8. }, { 8., 2. } }));
+    return std::vector<ExPolygons>(num_layers, ExPolygons{ square });
+}
+
+static std::string test_key(float z)
+{
+    return SlicingCache::make_key(its_make_cube(10., 10., 10.), { z, z + 0.2f }, MeshSlicingParamsEx{});
+}
+
+static std::vector<unsigned char> read_file(const boost::filesystem::path &path)
+{
+    boost::nowide::ifstream ifs(path.string(), std::ios::binary);
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const boost::filesystem::path &path, const std::vector<unsigned char> &data)
+{
+    boost::nowide::ofstream ofs(path.string(), std::ios::binary);
+    ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+SCENARIO("Slicing cache", "[SlicingCache]") {
+    boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("slicing-cache-%%%%-%%%%");
+    SlicingCache::set_directory(dir.string(), 0);
+    REQUIRE(SlicingCache::enabled());
+    auto entry_path = [&dir](const std::string &key) { return dir / (key + ".slc"); };
+
+    GIVEN("A stored entry") {
+        const std::string              key    = test_key(0.2f);
+        const std::vector<ExPolygons>  layers = test_layers(3);
+        SlicingCache::store(key, layers);
+        REQUIRE(boost::filesystem::exists(entry_path(key)));
+
+        THEN("The entry is loaded back unchanged") {
+            std::vector<ExPolygons> loaded;
+            REQUIRE(SlicingCache::load(key, loaded));
+            REQUIRE(loaded == layers);
+        }
+        THEN("A different key is not found") {
+            std::vector<ExPolygons> loaded;
+            REQUIRE(! SlicingCache::load(test_key(0.4f), loaded));
+        }
+        WHEN("The entry is truncated") {
+            std::vector<unsigned char> data = read_file(entry_path(key));
+            data.resize(data.size() / 2);
+            write_file(entry_path(key), data);
+            THEN("It is not loaded and it is removed") {
+                std::vector<ExPolygons> loaded;
+                REQUIRE(! SlicingCache::load(key, loaded));
+                REQUIRE(loaded.empty());
+                REQUIRE(! boost::filesystem::exists(entry_path(key)));
+            }
+        }
+        WHEN("The compressed data is damaged") {
+            std::vector<unsigned char> data = read_file(entry_path(key));
+            for (size_t i = 16; i < data.size(); ++ i)
+                data[i] ^= 0x5a;
+            write_file(entry_path(key), data);
+            THEN("It is not loaded and it is removed") {
+                std::vector<ExPolygons> loaded;
+                REQUIRE(! SlicingCache::load(key, loaded));
+                REQUIRE(! boost::filesystem::exists(entry_path(key)));
+            }
+        }
+        WHEN("The uncompressed size in the header is huge") {
+            std::vector<unsigned char> data = read_file(entry_path(key));
+            // Magic and version are followed by the uncompressed size.
+            uint64_t size = uint64_t(1) << 60;
+            memcpy(data.data() + 8, &size, sizeof(size));
+            write_file(entry_path(key), data);
+            THEN("It is rejected without being decompressed") {
+                std::vector<ExPolygons> loaded;
+                REQUIRE(! SlicingCache::load(key, loaded));
+                REQUIRE(! boost::filesystem::exists(entry_path(key)));
+            }
+        }
+    }
+
+    GIVEN("A cache limited to about four entries") {
+        const std::vector<ExPolygons> layers = test_layers(3);
+        SlicingCache::store(test_key(0.f), layers);
+        const size_t entry_size = size_t(boost::filesystem::file_size(entry_path(test_key(0.f))));
+        const size_t max_size   = 4 * entry_size + entry_size / 2;
+        SlicingCache::set_directory(dir.string(), max_size);
+
+        WHEN("Ten entries are stored") {
+            const std::time_t now = std::time(nullptr);
+            std::vector<std::string> keys;
+            for (int i = 0; i < 10; ++ i) {
+                keys.emplace_back(test_key(float(i)));
+                SlicingCache::store(keys.back(), layers);
+                // Make the order of the stores visible to the eviction, the modification times have a resolution of a second.
+                boost::system::error_code ec;
+                boost::filesystem::last_write_time(entry_path(keys.back()), now - 100 + i, ec);
+            }
+            THEN("The cache fits the limit") {
+                size_t total_size = 0;
+                for (boost::filesystem::directory_iterator it(dir), it_end; it != it_end; ++ it)
+                    total_size += size_t(boost::filesystem::file_size(it->path()));
+                REQUIRE(total_size <= max_size);
+            }
+            THEN("The least recently stored entries are evicted, the last one is kept") {
+                REQUIRE(! boost::filesystem::exists(entry_path(keys.front())));
+                std::vector<ExPolygons> loaded;
+                REQUIRE(SlicingCache::load(keys.back(), loaded));
+                REQUIRE(loaded == layers);
+            }
+        }
+    }
+
+    SlicingCache::set_directory(std::string(), 0);
+    REQUIRE(! SlicingCache::enabled());
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(dir, ec);
+}
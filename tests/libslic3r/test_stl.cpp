@@ -1,6 +1,11 @@
 #include <catch2/catch.hpp>
+#include <test_utils.hpp>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/nowide/cstdio.hpp>
 
 #include "libslic3r/Model.hpp"
+#include "libslic3r/TriangleMesh.hpp"
 #include "libslic3r/Format/STL.hpp"
 
 using namespace Slic3r;
@@ -55,3 +60,241 @@ SCENARIO("Reading an STL file", "[stl]") {
 		}
 	}
 }
+
+// Facets of both readers match, except for the facets with NaN vertices, which are left uninitialized by stl_open().
+static bool stl_facets_equal(const stl_file &l, const stl_file &r)
+{
+	if (l.stats.number_of_facets != r.stats.number_of_facets || l.stats.type != r.stats.type || l.stats.min != r.stats.min || l.stats.max != r.stats.max)
+		return false;
+	for (size_t i = 0; i < l.facet_start.size(); ++ i)
+		for (int j = 0; j < 3; ++ j)
+			if (l.facet_start[i].vertex[j] != r.facet_start[i].vertex[j])
+				return false;
+	return true;
+}
+
+SCENARIO("Reading an STL file through a memory mapping", "[stl]") {
+	// stl_open() does not support the CR line endings of the old Macs, the memory mapped reader does.
+	for (const char *path : { "Geräte/20mmbox-čřšřěá.stl", "ASCII/20mmbox-LF.stl", "ASCII/20mmbox-CRLF.stl", "ASCII/20mmbox-CR.stl", "ASCII/20mmbox-nonstandard.stl" }) {
+		GIVEN(path) {
+			WHEN("The file is read into the admesh structures") {
+				stl_file stl;
+				REQUIRE(stl_open_mapped(stl, stl_path(path).c_str()) == StlMappedResult::Success);
+				THEN("The facets match the ones read by stl_open()") {
+					REQUIRE(stl.stats.number_of_facets == 12);
+					REQUIRE(is_approx(stl.stats.size, stl_vertex(20.f, 20.f, 20.f)));
+					if (strstr(path, "-CR.stl") == nullptr) {
+						stl_file stl_stdio;
+						REQUIRE(stl_open(&stl_stdio, stl_path(path).c_str()));
+						REQUIRE(stl_facets_equal(stl, stl_stdio));
+					}
+				}
+			}
+			WHEN("The file is read into an indexed triangle set") {
+				indexed_triangle_set its;
+				REQUIRE(its_read_stl(stl_path(path).c_str(), its) == StlMappedResult::Success);
+				THEN("The vertices are shared") {
+					REQUIRE(its.indices.size() == 12);
+					REQUIRE(its.vertices.size() == 8);
+					REQUIRE(its_num_open_edges(its) == 0);
+					REQUIRE(its_volume(its) == Approx(8000.));
+				}
+			}
+		}
+	}
+	GIVEN("A mesh stored as a binary and an ASCII STL") {
+		indexed_triangle_set sphere = its_make_sphere(10., 2. * PI / 90.);
+		std::string path_binary = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("sphere-%%%%-%%%%.stl")).string();
+		std::string path_ascii  = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("sphere-%%%%-%%%%.stl")).string();
+		its_write_stl_binary(path_binary.c_str(), "sphere", sphere);
+		its_write_stl_ascii(path_ascii.c_str(), "sphere", sphere);
+		WHEN("The files are read into indexed triangle sets") {
+			indexed_triangle_set its_binary, its_ascii;
+			bool result_binary = its_read_stl(path_binary.c_str(), its_binary) == StlMappedResult::Success;
+			bool result_ascii  = its_read_stl(path_ascii.c_str(), its_ascii) == StlMappedResult::Success;
+			boost::filesystem::remove(path_binary);
+			boost::filesystem::remove(path_ascii);
+			THEN("The original mesh is restored") {
+				REQUIRE(result_binary);
+				REQUIRE(its_binary.vertices.size() == sphere.vertices.size());
+				REQUIRE(its_binary.indices.size() == sphere.indices.size());
+				bool same_triangles = true;
+				for (size_t i = 0; i < sphere.indices.size(); ++ i)
+					for (int j = 0; j < 3; ++ j)
+						same_triangles &= its_binary.vertices[its_binary.indices[i](j)] == sphere.vertices[sphere.indices[i](j)];
+				REQUIRE(same_triangles);
+				REQUIRE(result_ascii);
+				REQUIRE(its_ascii.vertices.size() == sphere.vertices.size());
+				REQUIRE(its_ascii.indices.size() == sphere.indices.size());
+			}
+		}
+	}
+}
+
+SCENARIO("Repairing an STL file loaded into an indexed triangle set", "[stl]") {
+	// Loads the file with both repair paths: the indexed mesh repaired by ReadSTLFile() and the admesh structures repaired by from_stl().
+	auto load = [](const indexed_triangle_set &soup) {
+		std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("repair-%%%%-%%%%.stl")).string();
+		its_write_stl_binary(path.c_str(), "repair", soup);
+		std::pair<TriangleMesh, TriangleMesh> out;
+		out.first.ReadSTLFile(path.c_str(), true);
+		stl_file stl;
+		stl_open(&stl, path.c_str());
+		out.second.from_stl(stl, true);
+		boost::filesystem::remove(path);
+		return out;
+	};
+	const indexed_triangle_set sphere = its_make_sphere(10., 2. * PI / 90.);
+	auto require_repaired = [&sphere](const TriangleMesh &mesh) {
+		REQUIRE(mesh.its.indices.size() == sphere.indices.size());
+		REQUIRE(mesh.stats().open_edges == 0);
+		REQUIRE(mesh.stats().number_of_parts == 1);
+		REQUIRE(mesh.stats().volume == Approx(its_volume(sphere)));
+	};
+	GIVEN("A sphere with flipped, degenerate and unconnected faces and a vertex slightly displaced") {
+		indexed_triangle_set soup = sphere;
+		for (size_t face : { 3, 50, 51, 400 })
+			std::swap(soup.indices[face](1), soup.indices[face](2));
+		soup.indices.emplace_back(0, 0, 1);
+		soup.vertices.emplace_back(100.f, 100.f, 100.f);
+		soup.vertices.emplace_back(101.f, 100.f, 100.f);
+		soup.vertices.emplace_back(100.f, 101.f, 100.f);
+		soup.indices.emplace_back(int(soup.vertices.size()) - 3, int(soup.vertices.size()) - 2, int(soup.vertices.size()) - 1);
+		// A copy of a vertex displaced well below the shortest edge, referenced by one of the faces of the original vertex.
+		const int vertex = soup.indices[200](0);
+		soup.vertices.emplace_back(soup.vertices[vertex] + Vec3f(1e-4f, 0.f, 0.f));
+		soup.indices[200](0) = int(soup.vertices.size()) - 1;
+		REQUIRE(its_num_open_edges(soup) > 0);
+		WHEN("It is loaded with repair") {
+			auto [repaired, admesh] = load(soup);
+			THEN("The indexed repair restores the sphere as the admesh repair does") {
+				require_repaired(repaired);
+				require_repaired(admesh);
+				REQUIRE(repaired.stats().repaired_errors.degenerate_facets == 1);
+				REQUIRE(repaired.stats().repaired_errors.facets_removed == 2);
+				REQUIRE(repaired.stats().repaired_errors.facets_reversed == 4);
+				REQUIRE(repaired.stats().repaired_errors.edges_fixed > 0);
+			}
+		}
+	}
+	GIVEN("A sphere with all faces flipped") {
+		indexed_triangle_set soup = sphere;
+		its_flip_triangles(soup);
+		WHEN("It is loaded with repair") {
+			auto [repaired, admesh] = load(soup);
+			THEN("The volume is positive") {
+				require_repaired(repaired);
+				require_repaired(admesh);
+				REQUIRE(repaired.stats().repaired_errors.facets_reversed == int(sphere.indices.size()));
+			}
+		}
+	}
+}
+
+SCENARIO("A failed STL load is not parsed again", "[stl]") {
+	// Counts the parsing attempts, each of the readers reports the progress at least once.
+	size_t num_reports = 0;
+	auto   progress    = [&num_reports](bool cancel) {
+		return [&num_reports, cancel](int, int, bool &cb_cancel, std::string&, std::string&) { ++ num_reports; cb_cancel = cancel; };
+	};
+	GIVEN("A binary STL file") {
+		WHEN("The load is canceled") {
+			for (bool repair : { false, true }) {
+				num_reports = 0;
+				TriangleMesh mesh;
+				REQUIRE(! mesh.ReadSTLFile(stl_path("Geräte/20mmbox-čřšřěá.stl").c_str(), repair, progress(true)));
+				REQUIRE(num_reports == 1);
+			}
+		}
+	}
+	GIVEN("A malformed ASCII STL file") {
+		std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("malformed-%%%%-%%%%.stl")).string();
+		{
+			FILE *f = boost::nowide::fopen(path.c_str(), "wb");
+			// The first facet misses a vertex, the parsers fail before reporting the progress again.
+			fputs("solid malformed\nfacet normal 0 0 1\n outer loop\n  vertex 0 0 0\n  vertex 1 0 0\n endloop\nendfacet\n", f);
+			for (int i = 0; i < 4; ++ i)
+				fputs("facet normal 0 0 1\n outer loop\n  vertex 0 0 0\n  vertex 1 0 0\n  vertex 0 1 0\n endloop\nendfacet\n", f);
+			fputs("endsolid malformed\n", f);
+			fclose(f);
+		}
+		WHEN("It is loaded") {
+			for (bool repair : { false, true }) {
+				num_reports = 0;
+				TriangleMesh mesh;
+				REQUIRE(! mesh.ReadSTLFile(path.c_str(), repair, progress(false)));
+				REQUIRE(num_reports == 1);
+			}
+		}
+		boost::filesystem::remove(path);
+	}
+}
+
+// Throughput of the STL readers. The size of the mesh may be overriden with the SLIC3R_STL_BENCHMARK_FACETS environment variable.
+TEST_CASE("STL reading benchmark", "[.Benchmark][stl]") {
+	size_t num_facets = 10000000;
+	if (const char *env = getenv("SLIC3R_STL_BENCHMARK_FACETS"))
+		num_facets = std::max<size_t>(std::atoll(env), 1000);
+	// Random triangles sharing their vertices in a grid.
+	indexed_triangle_set its;
+	const int side = int(std::sqrt(double(num_facets) / 2.)) + 1;
+	for (int i = 0; i <= side; ++ i)
+		for (int j = 0; j <= side; ++ j)
+			its.vertices.emplace_back(float(i) * 0.1f, float(j) * 0.1f, float((i * 7 + j * 13) % 17) * 0.01f);
+	for (int i = 0; i < side && its.indices.size() < num_facets; ++ i)
+		for (int j = 0; j < side; ++ j) {
+			int v = i * (side + 1) + j;
+			its.indices.emplace_back(v, v + side + 1, v + 1);
+			its.indices.emplace_back(v + 1, v + side + 1, v + side + 2);
+		}
+	std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("benchmark-%%%%-%%%%.stl")).string();
+	its_write_stl_binary(path.c_str(), "benchmark", its);
+	const double file_mb = double(boost::filesystem::file_size(path)) / (1024. * 1024.);
+	// Wall time in seconds.
+	auto time = [](auto &&fn) { return measure_ms(fn) * 0.001; };
+	double time_stdio  = time([&path]() {
+		stl_file stl;
+		stl_open(&stl, path.c_str());
+		stl_check_facets_exact(&stl);
+		indexed_triangle_set out;
+		stl_generate_shared_vertices(&stl, out);
+	});
+	double time_mapped = time([&path]() {
+		stl_file stl;
+		stl_open_mapped(stl, path.c_str());
+		stl_check_facets_exact(&stl);
+		indexed_triangle_set out;
+		stl_generate_shared_vertices(&stl, out);
+	});
+	indexed_triangle_set loaded;
+	double time_its    = time([&path, &loaded]() { its_read_stl(path.c_str(), loaded); });
+	REQUIRE(loaded.indices.size() == its.indices.size());
+	loaded = indexed_triangle_set();
+	// Import with repair as done by load_stl(): admesh read through stdio and repaired against the indexed mesh read and repaired.
+	// The peak of the resident memory includes the pages of the memory mapped file.
+	double time_admesh_repair = 0., time_its_repair = 0.;
+	double peak_admesh_repair = measure_peak_memory_mb([&path, &time_admesh_repair]() {
+		time_admesh_repair = measure_ms([&path]() {
+			stl_file stl;
+			stl_open(&stl, path.c_str());
+			TriangleMesh mesh;
+			mesh.from_stl(stl, true);
+		}) * 0.001;
+	});
+	double peak_its_repair = measure_peak_memory_mb([&path, &time_its_repair]() {
+		time_its_repair = measure_ms([&path]() { TriangleMesh mesh; mesh.ReadSTLFile(path.c_str(), true); }) * 0.001;
+	});
+	boost::filesystem::remove(path);
+
+	its_write_stl_ascii(path.c_str(), "benchmark", its);
+	const double ascii_mb = double(boost::filesystem::file_size(path)) / (1024. * 1024.);
+	double time_ascii_stdio  = time([&path]() { stl_file stl; stl_open(&stl, path.c_str()); });
+	double time_ascii_mapped = time([&path]() { stl_file stl; stl_open_mapped(stl, path.c_str()); });
+	boost::filesystem::remove(path);
+	WARN(ascii_mb << " MB ASCII STL. stl_open(): " << ascii_mb / time_ascii_stdio << " MB/s, stl_open_mapped(): " << ascii_mb / time_ascii_mapped << " MB/s");
+
+	WARN(its.indices.size() << " facets, " << file_mb << " MB binary STL. stl_open(): " << file_mb / time_stdio << " MB/s, " <<
+		"stl_open_mapped(): " << file_mb / time_mapped << " MB/s, its_read_stl(): " << file_mb / time_its << " MB/s");
+	WARN("Import with repair. admesh: " << file_mb / time_admesh_repair << " MB/s, peak " << peak_admesh_repair << " MB; " <<
+		"indexed: " << file_mb / time_its_repair << " MB/s, peak " << peak_its_repair << " MB");
+}
@@ -0,0 +1,82 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include <oneapi/tbb/parallel_for.h>
+
+#include "libslic3r/Trace.hpp"
+#include "nlohmann/json.hpp"
+
+using namespace Slic3r;
+
+static void traced_work()
+{
+    TRACE_ZONE("outer");
+    for (int i = 0; i < 3; ++ i) {
+        TRACE_ZONE("inner");
+        volatile double sum = 0;
+        for (int j = 0; j < 10000; ++ j)
+            sum = sum + j;
+    }
+}
+
+static const Trace::ZoneSummary* find_zone(const std::vector<Trace::ZoneSummary> &zones, const std::string &name)
+{
+    auto it = std::find_if(zones.begin(), zones.end(), [&name](const Trace::ZoneSummary &zone) { return zone.name == name; });
+    return it == zones.end() ? nullptr : &*it;
+}
+
+SCENARIO("Tracing of zones", "[Trace]") {
+    GIVEN("Zones entered on several threads") {
+        WHEN("The tracer is disabled") {
+            Trace::enable();
+            Trace::disable();
+            traced_work();
+            THEN("Nothing is recorded") {
+                REQUIRE(Trace::summary().empty());
+            }
+        }
+        WHEN("The tracer is enabled") {
+            Trace::enable();
+            tbb::parallel_for(0, 8, [](int) { traced_work(); });
+            Trace::disable();
+            std::vector<Trace::ZoneSummary> zones = Trace::summary();
+            THEN("The zones of all threads are summarized") {
+                const Trace::ZoneSummary *outer = find_zone(zones, "outer");
+                const Trace::ZoneSummary *inner = find_zone(zones, "inner");
+                REQUIRE(outer != nullptr);
+                REQUIRE(inner != nullptr);
+                REQUIRE(outer->count == 8);
+                REQUIRE(inner->count == 24);
+                REQUIRE(outer->total_ms >= inner->total_ms);
+                REQUIRE(outer->max_ms <= outer->total_ms);
+            }
+            THEN("A valid Chrome trace is exported") {
+                boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("trace-%%%%-%%%%.json");
+                REQUIRE(Trace::export_chrome_trace(path.string()));
+                boost::nowide::ifstream ifs(path.string());
+                nlohmann::json trace = nlohmann::json::parse(ifs);
+                ifs.close();
+                boost::filesystem::remove(path);
+                size_t num_complete = 0;
+                for (const nlohmann::json &event : trace["traceEvents"])
+                    if (event["ph"] == "X") {
+                        ++ num_complete;
+                        REQUIRE(event["dur"].get<double>() >= 0.);
+                        REQUIRE(event["ts"].get<double>() >= 0.);
+                    }
+                REQUIRE(num_complete == 32);
+            }
+            AND_WHEN("The tracer is enabled again") {
+                Trace::enable();
+                Trace::disable();
+                THEN("The zones recorded before are dropped") {
+                    REQUIRE(Trace::summary().empty());
+                }
+            }
+        }
+    }
+}
@@ -1,6 +1,10 @@
 #ifndef SLIC3R_TEST_UTILS
 #define SLIC3R_TEST_UTILS
 
+#include <chrono>
+#include <fstream>
+#include <string>
+
 #include <libslic3r/TriangleMesh.hpp>
 #include <libslic3r/Format/OBJ.hpp>
 
@@ -13,9 +17,41 @@
 inline Slic3r::TriangleMesh load_model(const std::string &obj_filename)
 {
     Slic3r::TriangleMesh mesh;
+    Slic3r::ObjInfo      obj_info;
+    std::string          message;
     auto fpath = TEST_DATA_DIR PATH_SEPARATOR + obj_filename;
-    Slic3r::load_obj(fpath.c_str(), &mesh);
+    Slic3r::load_obj(fpath.c_str(), &mesh, obj_info, message);
     return mesh;
 }
 
+// Wall time of fn() in milliseconds, for the hidden "[.Benchmark]" test cases.
+template<typename Fn> inline double measure_ms(Fn &&fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Peak of the resident memory of the process while running fn() above the resident memory before, in MB, for the hidden
+// "[.Benchmark]" test cases. The peak is reset through /proc/self/clear_refs, thus it is measured on Linux only, elsewhere -1 is returned.
+template<typename Fn> inline double measure_peak_memory_mb(Fn &&fn)
+{
+#ifdef __linux__
+    auto read_kb = [](const std::string &key) {
+        std::ifstream status("/proc/self/status");
+        for (std::string line; std::getline(status, line);)
+            if (line.compare(0, key.size(), key) == 0)
+                return std::stod(line.substr(key.size()));
+        return 0.;
+    };
+    std::ofstream("/proc/self/clear_refs") << "5";
+    double rss = read_kb("VmRSS:");
+    fn();
+    return (read_kb("VmHWM:") - rss) / 1024.;
+#else
+    fn();
+    return -1.;
+#endif
+}
+
 #endif // SLIC3R_TEST_UTILS